@@ -0,0 +1,78 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_BACKEND_H
+#define AUDIORECORDINGAPP_AUDIO_BACKEND_H
+
+#include <cstddef>
+
+#include "sample_format.h"
+
+struct AudioStreamConfig {
+    int sampleRate = 44100;
+    int channels = 1;
+    SampleFormat format = SampleFormat::INT16;
+    int framesPerBuffer = 1024;
+    int bufferCount = 2;
+
+    size_t getBytesPerFrame() const {
+        return static_cast<size_t>(channels) * getBytesPerSample(format);
+    }
+
+    bool operator==(const AudioStreamConfig& other) const {
+        return sampleRate == other.sampleRate && channels == other.channels &&
+               format == other.format && framesPerBuffer == other.framesPerBuffer &&
+               bufferCount == other.bufferCount;
+    }
+
+    bool operator!=(const AudioStreamConfig& other) const {
+        return !(*this == other);
+    }
+};
+
+// Receives captured audio. Called on the backend's audio thread once per
+// filled buffer of interleaved samples in the stream's SampleFormat;
+// |samples| is only valid for the duration of the call.
+class AudioCaptureCallback {
+public:
+    virtual ~AudioCaptureCallback() = default;
+    virtual void onCaptureBlock(const void* samples, size_t sampleCount) = 0;
+};
+
+// Supplies audio for playback. Called on the backend's audio thread each
+// time the device wants another buffer. The callback hands back a pointer
+// to interleaved samples in the stream's SampleFormat that must stay valid
+// until the backend is stopped or asks again, so sources can be played
+// without copying. Returning false ends the stream.
+class AudioRenderCallback {
+public:
+    virtual ~AudioRenderCallback() = default;
+    virtual bool onRenderBuffer(const void*& samples, size_t& sampleCount) = 0;
+};
+
+// Platform audio I/O used by AudioRecorder and AudioPlayer. Opening a stream
+// builds whatever device objects it needs; start/stop only pause and resume
+// it, so an open stream can be restarted cheaply. Each backend has at most
+// one capture and one playback stream open at a time.
+class AudioBackend {
+public:
+    virtual ~AudioBackend() = default;
+
+    virtual bool initialize() = 0;
+
+    // False for backends that pull buffers as fast as they are produced
+    // rather than at the device rate (offline rendering, tests); their
+    // callbacks may wait for data that a real-time one would have to skip
+    virtual bool isRealtime() const {
+        return true;
+    }
+
+    virtual bool openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) = 0;
+    virtual bool startCapture() = 0;
+    virtual void stopCapture() = 0;
+    virtual void closeCapture() = 0;
+
+    virtual bool openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) = 0;
+    virtual bool startPlayback() = 0;
+    virtual void stopPlayback() = 0;
+    virtual void closePlayback() = 0;
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_BACKEND_H
@@ -0,0 +1,92 @@
+#include "audio_engine.h"
+
+#include <android/log.h>
+#include <chrono>
+
+#define LOG_TAG "AudioEngine"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+AudioEngine& AudioEngine::getInstance() {
+    static AudioEngine instance;
+    return instance;
+}
+
+bool AudioEngine::acquire() {
+    std::lock_guard<std::mutex> lock(engineMutex);
+
+    if (refCount == 0 && !create()) {
+        destroy();
+        return false;
+    }
+
+    refCount++;
+    return true;
+}
+
+void AudioEngine::release() {
+    std::lock_guard<std::mutex> lock(engineMutex);
+
+    if (refCount == 0) return;
+
+    if (--refCount == 0) {
+        destroy();
+    }
+}
+
+bool AudioEngine::create() {
+    auto start = std::chrono::steady_clock::now();
+    SLresult result;
+
+    // Create engine
+    result = slCreateEngine(&engineObject, 0, nullptr, 0, nullptr, nullptr);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to create engine");
+        return false;
+    }
+
+    // Realize engine
+    result = (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to realize engine");
+        return false;
+    }
+
+    // Get engine interface
+    result = (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to get engine interface");
+        return false;
+    }
+
+    // Create the output mix up front so playback never waits for it
+    result = (*engineEngine)->CreateOutputMix(engineEngine, &outputMixObject, 0, nullptr, nullptr);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to create output mix");
+        return false;
+    }
+
+    result = (*outputMixObject)->Realize(outputMixObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to realize output mix");
+        return false;
+    }
+
+    float elapsedMs = std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    LOGI("Audio engine ready in %.2f ms", elapsedMs);
+    return true;
+}
+
+void AudioEngine::destroy() {
+    if (outputMixObject) {
+        (*outputMixObject)->Destroy(outputMixObject);
+        outputMixObject = nullptr;
+    }
+
+    if (engineObject) {
+        (*engineObject)->Destroy(engineObject);
+        engineObject = nullptr;
+        engineEngine = nullptr;
+    }
+}
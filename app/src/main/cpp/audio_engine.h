@@ -0,0 +1,42 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_ENGINE_H
+#define AUDIORECORDINGAPP_AUDIO_ENGINE_H
+
+#include <SLES/OpenSLES.h>
+#include <mutex>
+
+// Process-wide OpenSL ES engine and output mix. Both are created and
+// realized once, on the first acquire(), and shared by the recorder and the
+// player so neither pays for engine or mix setup when a take or playback
+// starts. They are torn down when the last user calls release().
+class AudioEngine {
+private:
+    SLObjectItf engineObject = nullptr;
+    SLEngineItf engineEngine = nullptr;
+    SLObjectItf outputMixObject = nullptr;
+    int refCount = 0;
+    std::mutex engineMutex;
+
+    AudioEngine() = default;
+
+    bool create();
+    void destroy();
+
+public:
+    static AudioEngine& getInstance();
+
+    AudioEngine(const AudioEngine&) = delete;
+    AudioEngine& operator=(const AudioEngine&) = delete;
+
+    bool acquire();
+    void release();
+
+    SLEngineItf getEngine() const {
+        return engineEngine;
+    }
+
+    SLObjectItf getOutputMix() const {
+        return outputMixObject;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_ENGINE_H
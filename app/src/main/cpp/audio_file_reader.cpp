@@ -0,0 +1,134 @@
+#include "audio_file_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sample_convert.h"
+#include "wav_probe.h"
+
+#define LOG_TAG "AudioFileReader"
+#include "audio_log.h"
+
+AudioFileReader::~AudioFileReader() {
+    close();
+}
+
+bool AudioFileReader::open(const std::string& path) {
+    close();
+
+    if (flacDecoder.open(path)) {
+        const FlacStreamInfo& info = flacDecoder.getStreamInfo();
+        if (info.channels < 1 || info.channels > 2) {
+            LOGE("Unsupported FLAC format in %s: %u channels", path.c_str(), info.channels);
+            flacDecoder.close();
+            return false;
+        }
+        isFlac = true;
+        format = SampleFormat::INT16;
+        channels = info.channels;
+        frameCount = info.totalFrames;
+        decodeBuffer.reserve(static_cast<size_t>(info.maxBlockSize) * channels);
+        sampleRate = info.sampleRate;
+        return true;
+    }
+
+    if (!probeWavFile(path, wavInfo) || !getWavSampleFormat(wavInfo, format) || wavInfo.channels < 1 ||
+        wavInfo.channels > 2 || wavInfo.blockAlign == 0) {
+        LOGE("Unsupported WAV format in %s: format %u, %u channels, %u bits", path.c_str(),
+             wavInfo.audioFormat, wavInfo.channels, wavInfo.bitsPerSample);
+        return false;
+    }
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Failed to open audio file: %s", path.c_str());
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    channels = wavInfo.channels;
+    frameCount = wavInfo.dataSize / wavInfo.blockAlign;
+    readBuffer.resize(READ_FRAMES * wavInfo.blockAlign);
+    sampleRate = wavInfo.sampleRate;
+    return true;
+}
+
+void AudioFileReader::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    flacDecoder.close();
+    isFlac = false;
+    wavInfo = WavInfo();
+    sampleRate = 0;
+    channels = 0;
+    frameCount = 0;
+    readFrame = 0;
+    decodeBuffer.clear();
+    decodeOffset = 0;
+}
+
+bool AudioFileReader::rewind() {
+    if (!isOpen()) {
+        return false;
+    }
+    if (isFlac) {
+        flacDecoder.rewind();
+    }
+    readFrame = 0;
+    decodeBuffer.clear();
+    decodeOffset = 0;
+    return true;
+}
+
+size_t AudioFileReader::read(float* out, size_t maxFrames) {
+    if (!isOpen() || maxFrames == 0) {
+        return 0;
+    }
+
+    if (isFlac) {
+        size_t frames = 0;
+        while (frames < maxFrames) {
+            if (decodeOffset == decodeBuffer.size()) {
+                decodeOffset = 0;
+                if (flacDecoder.decodeFrame(decodeBuffer) == 0) {
+                    decodeBuffer.clear();
+                    break;
+                }
+            }
+            size_t run = std::min((decodeBuffer.size() - decodeOffset) / channels, maxFrames - frames);
+            convertSamples(decodeBuffer.data() + decodeOffset, out + frames * channels, run * channels);
+            decodeOffset += run * channels;
+            frames += run;
+        }
+        readFrame += frames;
+        return frames;
+    }
+
+    uint64_t frames = std::min<uint64_t>(std::min(maxFrames, READ_FRAMES), frameCount - readFrame);
+    size_t wanted = static_cast<size_t>(frames) * wavInfo.blockAlign;
+    off_t offset = static_cast<off_t>(wavInfo.dataOffset + readFrame * wavInfo.blockAlign);
+    size_t have = 0;
+    while (have < wanted) {
+        ssize_t got = pread(fd, readBuffer.data() + have, wanted - have, offset + static_cast<off_t>(have));
+        if (got <= 0) break;
+        have += static_cast<size_t>(got);
+    }
+
+    frames = have / wavInfo.blockAlign;
+    size_t count = static_cast<size_t>(frames) * channels;
+    switch (format) {
+        case SampleFormat::INT16:
+            convertSamples(reinterpret_cast<const short*>(readBuffer.data()), out, count);
+            break;
+        case SampleFormat::INT24_PACKED:
+            convertSamples(reinterpret_cast<const Int24*>(readBuffer.data()), out, count);
+            break;
+        case SampleFormat::FLOAT32:
+            memcpy(out, readBuffer.data(), count * sizeof(float));
+            break;
+    }
+    readFrame += frames;
+    return static_cast<size_t>(frames);
+}
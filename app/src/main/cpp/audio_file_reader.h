@@ -0,0 +1,81 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_FILE_READER_H
+#define AUDIORECORDINGAPP_AUDIO_FILE_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "flac_decoder.h"
+#include "sample_format.h"
+#include "wav_file.h"
+
+// Reads a WAV or FLAC file front to back as float samples on the calling
+// thread, for offline passes over whole files. WAV data comes in with
+// pread() a block at a time and FLAC is decoded a frame at a time, so
+// memory stays at one block whatever the file length; unlike
+// PlaybackStream there is no prefetch thread and no seeking.
+class AudioFileReader {
+public:
+    static const size_t READ_FRAMES = 4096;
+
+private:
+    int fd = -1;
+    WavInfo wavInfo;
+    FlacDecoder flacDecoder;
+    bool isFlac = false;
+
+    SampleFormat format = SampleFormat::INT16;
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint64_t frameCount = 0;
+    uint64_t readFrame = 0;
+
+    // Raw WAV bytes, or decoded FLAC samples still to be handed out
+    std::vector<uint8_t> readBuffer;
+    std::vector<short> decodeBuffer;
+    size_t decodeOffset = 0;
+
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader();
+
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    // Mono or stereo 16-bit, 24-bit or float WAV, or mono or stereo FLAC
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const {
+        return sampleRate > 0;
+    }
+
+    // Back to the first frame, for a second pass
+    bool rewind();
+
+    // Up to |maxFrames| interleaved frames into |out|, full scale at
+    // +/-1.0. Returns the frames read; 0 at the end of the file or if it
+    // was cut short under us.
+    size_t read(float* out, size_t maxFrames);
+
+    // The file's own format; FLAC always decodes to 16-bit
+    SampleFormat getFormat() const {
+        return format;
+    }
+
+    uint32_t getSampleRate() const {
+        return sampleRate;
+    }
+
+    uint16_t getChannels() const {
+        return channels;
+    }
+
+    // 0 for FLAC streams that leave the length out
+    uint64_t getFrameCount() const {
+        return frameCount;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_FILE_READER_H
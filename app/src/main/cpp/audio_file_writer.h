@@ -0,0 +1,65 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_FILE_WRITER_H
+#define AUDIORECORDINGAPP_AUDIO_FILE_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class PreRollBuffer;
+
+enum class AudioFileFormat {
+    WAV = 0,
+    FLAC = 1,
+};
+
+// A file sink for a capture stream. write() is called from the audio
+// callback and must never block; implementations hand samples to their
+// own thread for encoding and disk I/O. Samples are interleaved, in the
+// format the writer was configured for, and counted in samples.
+class AudioFileWriter {
+private:
+    std::atomic<const PreRollBuffer*> prefix{nullptr};
+
+public:
+    virtual ~AudioFileWriter() = default;
+
+    virtual bool open(const std::string& path) = 0;
+    virtual bool write(const void* samples, size_t count) = 0;
+    virtual bool close() = 0;
+    virtual bool isOpen() const = 0;
+
+    virtual uint64_t getSamplesWritten() const = 0;
+    virtual uint64_t getSamplesDropped() const = 0;
+    // Accepted by write() but not yet handed to the file; how far the
+    // writer thread is behind. Safe to call from the writing thread.
+    virtual uint64_t getSamplesPending() const = 0;
+
+    // Audio captured before the file was opened, to go in ahead of every
+    // sample passed to write() after this call. Called on the writing
+    // thread; the writer thread reads it in place, so it must be left
+    // alone until close().
+    void setPrefix(const PreRollBuffer* preRoll) {
+        prefix.store(preRoll, std::memory_order_release);
+    }
+
+protected:
+    // Writer thread: the prefix, once. Check the ring for samples first:
+    // any that are there were written after the prefix was handed over.
+    const PreRollBuffer* takePrefix() {
+        return prefix.exchange(nullptr, std::memory_order_acquire);
+    }
+};
+
+// "take.wav" -> "take" + |extension|, for the sidecars written next to a
+// take; a path without an extension gets it appended
+inline std::string replaceFileExtension(const std::string& path, const char* extension) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return path + extension;
+    }
+    return path.substr(0, dot) + extension;
+}
+
+#endif // AUDIORECORDINGAPP_AUDIO_FILE_WRITER_H
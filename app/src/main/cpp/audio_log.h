@@ -0,0 +1,20 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_LOG_H
+#define AUDIORECORDINGAPP_AUDIO_LOG_H
+
+// Logging for the portable audio code. Define LOG_TAG before including.
+// On Android this goes to logcat; host builds print errors to stderr and
+// drop informational messages.
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+
+#define LOGI(...) ((void) 0)
+#define LOGE(...) (fprintf(stderr, "E/" LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+#endif // AUDIORECORDINGAPP_AUDIO_LOG_H
@@ -0,0 +1,380 @@
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "audio_trace.h"
+#include "mix_kernels.h"
+#include "sample_convert.h"
+
+#define LOG_TAG "AudioMixer"
+#include "audio_log.h"
+
+AudioMixer::Input::~Input() {
+    mixer.releaseInput(slot);
+}
+
+bool AudioMixer::Input::initialize() {
+    return mixer.backend.initialize();
+}
+
+bool AudioMixer::Input::isRealtime() const {
+    return mixer.backend.isRealtime();
+}
+
+bool AudioMixer::Input::openCapture(const AudioStreamConfig&, AudioCaptureCallback*) {
+    LOGE("Mixer inputs cannot capture");
+    return false;
+}
+
+bool AudioMixer::Input::startCapture() {
+    return false;
+}
+
+void AudioMixer::Input::stopCapture() {}
+
+void AudioMixer::Input::closeCapture() {}
+
+bool AudioMixer::Input::openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) {
+    return mixer.openInput(slot, config, callback);
+}
+
+bool AudioMixer::Input::startPlayback() {
+    return mixer.startInput(slot);
+}
+
+void AudioMixer::Input::stopPlayback() {
+    mixer.stopInput(slot);
+}
+
+void AudioMixer::Input::closePlayback() {
+    mixer.closeInput(slot);
+}
+
+void AudioMixer::Input::setGain(float gain) {
+    mixer.slots[slot].gain.store(toMixGain(gain), std::memory_order_relaxed);
+}
+
+float AudioMixer::Input::getGain() const {
+    return static_cast<float>(mixer.slots[slot].gain.load(std::memory_order_relaxed)) / MIX_UNITY_GAIN;
+}
+
+AudioMixer::AudioMixer(AudioBackend& backend) : backend(backend) {
+    for (std::vector<short>& buffer : outputBuffers) {
+        buffer.assign(static_cast<size_t>(FRAMES_PER_BUFFER) * OUTPUT_CHANNELS, 0);
+    }
+    for (std::vector<float>& buffer : floatOutputBuffers) {
+        buffer.assign(static_cast<size_t>(FRAMES_PER_BUFFER) * OUTPUT_CHANNELS, 0.0f);
+    }
+}
+
+AudioMixer::~AudioMixer() {
+    if (deviceOpen) {
+        closeDevice();
+    }
+}
+
+bool AudioMixer::initialize() {
+    return backend.initialize();
+}
+
+bool AudioMixer::setOutputSampleRate(int sampleRate) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    if (sampleRate <= 0 || hasActiveInput()) {
+        return false;
+    }
+
+    // The device stream reopens at the new rate with the next input
+    if (sampleRate != outputSampleRate && deviceOpen) {
+        closeDevice();
+    }
+    outputSampleRate = sampleRate;
+    return true;
+}
+
+std::unique_ptr<AudioMixer::Input> AudioMixer::createInput() {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    for (size_t i = 0; i < MAX_INPUTS; i++) {
+        Slot& slot = slots[i];
+        if (!slot.used) {
+            slot.used = true;
+            slot.open = false;
+            slot.callback = nullptr;
+            slot.gain.store(MIX_UNITY_GAIN, std::memory_order_relaxed);
+            return std::unique_ptr<Input>(new Input(*this, i));
+        }
+    }
+    LOGE("All %zu mixer inputs are in use", MAX_INPUTS);
+    return nullptr;
+}
+
+size_t AudioMixer::getActiveInputCount() const {
+    size_t count = 0;
+    for (const Slot& slot : slots) {
+        count += slot.active.load() ? 1 : 0;
+    }
+    return count;
+}
+
+bool AudioMixer::hasActiveInput() const {
+    for (const Slot& slot : slots) {
+        if (slot.active.load()) return true;
+    }
+    return false;
+}
+
+SampleFormat AudioMixer::getMixFormat(const Slot& starting) const {
+    for (const Slot& slot : slots) {
+        if ((&slot == &starting || slot.active.load()) && slot.config.format != SampleFormat::INT16) {
+            return SampleFormat::FLOAT32;
+        }
+    }
+    return SampleFormat::INT16;
+}
+
+void AudioMixer::deactivate(Slot& slot) {
+    // The render thread marks a slot before looking at whether it is
+    // active, so once it is seen unmarked here it cannot be inside it
+    slot.active.store(false);
+    while (slot.rendering.load()) {
+        std::this_thread::yield();
+    }
+}
+
+bool AudioMixer::openInput(size_t index, const AudioStreamConfig& config, AudioRenderCallback* callback) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    Slot& slot = slots[index];
+    deactivate(slot);
+    slot.open = false;
+
+    if (config.sampleRate != outputSampleRate) {
+        LOGE("Mixer inputs play at %d Hz, not %d Hz", outputSampleRate, config.sampleRate);
+        return false;
+    }
+    if (config.channels < 1 || config.channels > OUTPUT_CHANNELS) {
+        LOGE("Unsupported mixer input: %d channels", config.channels);
+        return false;
+    }
+
+    slot.config = config;
+    slot.callback = callback;
+    // Any input can end up in a float mix
+    slot.convertBuffer.resize(config.format == SampleFormat::FLOAT32
+                                      ? 0
+                                      : static_cast<size_t>(FRAMES_PER_BUFFER) * config.channels);
+    slot.open = true;
+    return true;
+}
+
+bool AudioMixer::startInput(size_t index) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    Slot& slot = slots[index];
+    if (!slot.open || slot.config.sampleRate != outputSampleRate) {
+        LOGE("Mixer input not open at %d Hz", outputSampleRate);
+        return false;
+    }
+
+    // The render thread may still be finishing the source's last buffer
+    deactivate(slot);
+    slot.pending = nullptr;
+    slot.pendingFrames = 0;
+
+    // A 24-bit or float input needs a float mix whatever else is playing.
+    // Back to 16-bit only with nothing else playing, so the others do not
+    // break twice.
+    SampleFormat format = getMixFormat(slot);
+    if (deviceOpen && format != outputFormat && (format == SampleFormat::FLOAT32 || !hasActiveInput())) {
+        closeDevice();
+    }
+    if (!deviceOpen) {
+        outputFormat = format;
+        if (!openDevice()) {
+            return false;
+        }
+    }
+    slot.active.store(true);
+
+    // The render thread either sees this input before it ends the device
+    // stream, or has ended it and left the restart to us
+    if (!deviceRunning.exchange(true)) {
+        backend.stopPlayback();
+        stats.reset();
+        renderPeriodUs = 0;
+        if (!backend.startPlayback()) {
+            LOGE("Failed to start the mixer's device stream");
+            deviceRunning = false;
+            slot.active.store(false);
+            return false;
+        }
+    }
+    return true;
+}
+
+void AudioMixer::stopInput(size_t index) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    deactivate(slots[index]);
+}
+
+void AudioMixer::closeInput(size_t index) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    Slot& slot = slots[index];
+    deactivate(slot);
+    slot.open = false;
+    slot.callback = nullptr;
+}
+
+void AudioMixer::releaseInput(size_t index) {
+    std::lock_guard<std::mutex> lock(mixerMutex);
+    Slot& slot = slots[index];
+    deactivate(slot);
+    slot.open = false;
+    slot.callback = nullptr;
+    slot.used = false;
+}
+
+bool AudioMixer::openDevice() {
+    AudioStreamConfig config;
+    config.sampleRate = outputSampleRate;
+    config.channels = OUTPUT_CHANNELS;
+    config.format = outputFormat;
+    config.framesPerBuffer = FRAMES_PER_BUFFER;
+    config.bufferCount = 2;
+
+    deviceOpen = backend.openPlayback(config, this);
+    if (!deviceOpen) {
+        LOGE("Failed to open the mixer's device stream at %d Hz", outputSampleRate);
+        return false;
+    }
+    deviceRunning = false;
+    bufferPeriodUs = static_cast<uint32_t>(static_cast<int64_t>(FRAMES_PER_BUFFER) * 1000000 / outputSampleRate);
+    return true;
+}
+
+void AudioMixer::closeDevice() {
+    backend.stopPlayback();
+    backend.closePlayback();
+    deviceOpen = false;
+    deviceRunning = false;
+}
+
+bool AudioMixer::onRenderBuffer(const void*& samples, size_t& sampleCount) {
+    AUDIO_TRACE_SECTION("AudioMixer mix");
+    const bool floatMix = outputFormat == SampleFormat::FLOAT32;
+    std::vector<short>& buffer = outputBuffers[nextOutputBuffer];
+    std::vector<float>& floatBuffer = floatOutputBuffers[nextOutputBuffer];
+    size_t mixedInputs = 0;
+    {
+        AudioStats::CallbackTimer timer(stats, renderPeriodUs);
+        if (floatMix) {
+            std::fill(floatBuffer.begin(), floatBuffer.end(), 0.0f);
+        } else {
+            std::fill(buffer.begin(), buffer.end(), 0);
+        }
+        for (Slot& slot : slots) {
+            // A relaxed look first keeps idle slots cheap; a stale answer
+            // only moves a start by one buffer
+            if (!slot.active.load(std::memory_order_relaxed)) continue;
+            slot.rendering.store(true);
+            if (slot.active.load() &&
+                (floatMix ? mixInput(slot, floatBuffer.data()) : mixInput(slot, buffer.data())) > 0) {
+                mixedInputs++;
+            }
+            slot.rendering.store(false, std::memory_order_release);
+        }
+    }
+
+    if (mixedInputs == 0 && !hasActiveInput()) {
+        // Nothing left to play: end the device stream. An input started
+        // meanwhile either is seen here and keeps it going, or finds it
+        // stopped and restarts it; nothing here runs after that.
+        renderPeriodUs = 0;
+        deviceRunning.store(false);
+        if (!hasActiveInput() || deviceRunning.exchange(true)) {
+            return false;
+        }
+    }
+
+    nextOutputBuffer ^= 1;
+    renderPeriodUs = bufferPeriodUs;
+    if (floatMix) {
+        samples = floatBuffer.data();
+    } else {
+        samples = buffer.data();
+    }
+    sampleCount = buffer.size();
+    return true;
+}
+
+template <typename Sample>
+size_t AudioMixer::mixInput(Slot& slot, Sample* out) {
+    const size_t channels = static_cast<size_t>(slot.config.channels);
+    const size_t bytesPerFrame = slot.config.getBytesPerFrame();
+    size_t filled = 0;
+
+    while (filled < static_cast<size_t>(FRAMES_PER_BUFFER)) {
+        if (slot.pendingFrames == 0) {
+            const void* samples = nullptr;
+            size_t sampleCount = 0;
+            if (!slot.callback->onRenderBuffer(samples, sampleCount)) {
+                // Played to the end; the rest of this buffer stays silent
+                slot.active.store(false);
+                slot.pending = nullptr;
+                break;
+            }
+            slot.pending = static_cast<const uint8_t*>(samples);
+            slot.pendingFrames = sampleCount / channels;
+            if (slot.pendingFrames == 0) break;
+        }
+
+        size_t frames = std::min(slot.pendingFrames, static_cast<size_t>(FRAMES_PER_BUFFER) - filled);
+        mixBlock(slot, slot.pending, frames, out + filled * OUTPUT_CHANNELS);
+        slot.pending += frames * bytesPerFrame;
+        slot.pendingFrames -= frames;
+        filled += frames;
+    }
+    return filled;
+}
+
+void AudioMixer::mixBlock(Slot& slot, const uint8_t* samples, size_t frames, short* out) {
+    int gain = slot.gain.load(std::memory_order_relaxed);
+    if (gain == 0) {
+        return;
+    }
+
+    // A 16-bit mix only ever has 16-bit inputs
+    const short* in = reinterpret_cast<const short*>(samples);
+    if (slot.config.channels == 1) {
+        mixMonoToStereo(out, in, frames, gain);
+    } else {
+        mixSamples(out, in, frames * slot.config.channels, gain);
+    }
+}
+
+void AudioMixer::mixBlock(Slot& slot, const uint8_t* samples, size_t frames, float* out) {
+    int gain = slot.gain.load(std::memory_order_relaxed);
+    if (gain == 0) {
+        return;
+    }
+
+    const size_t count = frames * slot.config.channels;
+    const float* in = reinterpret_cast<const float*>(samples);
+    switch (slot.config.format) {
+        case SampleFormat::INT24_PACKED:
+            convertSamples(reinterpret_cast<const Int24*>(samples), slot.convertBuffer.data(), count);
+            in = slot.convertBuffer.data();
+            break;
+        case SampleFormat::INT16:
+            convertSamples(reinterpret_cast<const short*>(samples), slot.convertBuffer.data(), count);
+            in = slot.convertBuffer.data();
+            break;
+        default:
+            break;
+    }
+
+    const float scale = static_cast<float>(gain) / MIX_UNITY_GAIN;
+    if (slot.config.channels == 1) {
+        mixMonoToStereo(out, in, frames, scale);
+    } else {
+        mixSamples(out, in, count, scale);
+    }
+}
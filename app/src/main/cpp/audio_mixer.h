@@ -0,0 +1,166 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_MIXER_H
+#define AUDIORECORDINGAPP_AUDIO_MIXER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_stats.h"
+
+// Mixes any number of playback sources, up to MAX_INPUTS, into the one
+// playback stream a backend has. Each source gets an Input: an
+// AudioBackend of its own whose playback stream is a slot in the mix, so
+// an AudioPlayer plays through the mixer exactly as it would through the
+// device. Inputs run at the mixer's rate in any SampleFormat, mono or
+// stereo.
+//
+// The render thread pulls every running input once per buffer and adds it
+// in with the input's gain. While every input is 16-bit the device stream
+// is 16-bit stereo, mixed with the saturating Q15 kernels. An input in
+// 24-bit or float moves it to float stereo as it starts, with a short break
+// for anything already playing, and everything is then converted to float
+// and mixed there, so nothing is cut to 16 bits on the way to the device;
+// it goes back to 16-bit only when it next starts with no other input
+// playing. The device stream starts with the first input and ends itself
+// once none is left.
+class AudioMixer : private AudioRenderCallback {
+public:
+    static const size_t MAX_INPUTS = 8;
+    static const int FRAMES_PER_BUFFER = 1024;
+    static const int OUTPUT_CHANNELS = 2;
+
+    class Input : public AudioBackend {
+    private:
+        AudioMixer& mixer;
+        size_t slot;
+
+    public:
+        Input(AudioMixer& mixer, size_t slot) : mixer(mixer), slot(slot) {}
+        ~Input() override;
+
+        Input(const Input&) = delete;
+        Input& operator=(const Input&) = delete;
+
+        bool initialize() override;
+
+        bool isRealtime() const override;
+
+        // Inputs only play
+        bool openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) override;
+        bool startCapture() override;
+        void stopCapture() override;
+        void closeCapture() override;
+
+        // The stream must be at the mixer's rate with one or two channels;
+        // the buffer size and count are the mixer's own
+        bool openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) override;
+        bool startPlayback() override;
+        // Returns once the render thread is done with the source
+        void stopPlayback() override;
+        void closePlayback() override;
+
+        // Linear, 0 to 1; takes effect from the next buffer
+        void setGain(float gain);
+        float getGain() const;
+    };
+
+private:
+    // One input's place in the mix. The control fields are only touched
+    // under mixerMutex while the slot is not active; the render thread
+    // only touches an active one, and says so in |rendering|.
+    struct Slot {
+        bool used = false;
+        bool open = false;
+        AudioStreamConfig config;
+        AudioRenderCallback* callback = nullptr;
+        // Float copy of a 16-bit or 24-bit buffer, for a float mix
+        std::vector<float> convertBuffer;
+
+        // Render thread: the rest of the buffer the source handed out last
+        const uint8_t* pending = nullptr;
+        size_t pendingFrames = 0;
+
+        std::atomic<bool> active{false};
+        std::atomic<bool> rendering{false};
+        std::atomic<int> gain{0};
+    };
+
+    AudioBackend& backend;
+    Slot slots[MAX_INPUTS];
+    // Serializes the control calls; the render thread never takes it
+    std::mutex mixerMutex;
+
+    int outputSampleRate = 48000;
+    // INT16 or FLOAT32; only changes while the device stream is stopped
+    SampleFormat outputFormat = SampleFormat::INT16;
+    bool deviceOpen = false;
+    uint32_t bufferPeriodUs = 0;
+    // Set by whoever starts the device stream and cleared by the render
+    // thread as it ends it
+    std::atomic<bool> deviceRunning{false};
+
+    // The backend holds on to the last buffer handed out until it asks
+    // for the next
+    std::vector<short> outputBuffers[2];
+    std::vector<float> floatOutputBuffers[2];
+    int nextOutputBuffer = 0;
+
+    AudioStats stats;
+    uint32_t renderPeriodUs = 0;
+
+    bool openInput(size_t index, const AudioStreamConfig& config, AudioRenderCallback* callback);
+    bool startInput(size_t index);
+    void stopInput(size_t index);
+    void closeInput(size_t index);
+    void releaseInput(size_t index);
+    static void deactivate(Slot& slot);
+    bool openDevice();
+    void closeDevice();
+    bool hasActiveInput() const;
+    // FLOAT32 if |starting| or any input playing is not 16-bit
+    SampleFormat getMixFormat(const Slot& starting) const;
+
+    bool onRenderBuffer(const void*& samples, size_t& sampleCount) override;
+    template <typename Sample>
+    size_t mixInput(Slot& slot, Sample* out);
+    void mixBlock(Slot& slot, const uint8_t* samples, size_t frames, short* out);
+    void mixBlock(Slot& slot, const uint8_t* samples, size_t frames, float* out);
+
+public:
+    explicit AudioMixer(AudioBackend& backend);
+    ~AudioMixer() override;
+
+    AudioMixer(const AudioMixer&) = delete;
+    AudioMixer& operator=(const AudioMixer&) = delete;
+
+    bool initialize();
+
+    // The device mixer's rate; inputs must run at it. Only while no input
+    // is playing.
+    bool setOutputSampleRate(int sampleRate);
+
+    int getOutputSampleRate() const {
+        return outputSampleRate;
+    }
+
+    // Format of the device stream last opened
+    SampleFormat getOutputFormat() const {
+        return outputFormat;
+    }
+
+    // A new input at unity gain, or null when all MAX_INPUTS are taken.
+    // Every input must be destroyed before the mixer.
+    std::unique_ptr<Input> createInput();
+
+    size_t getActiveInputCount() const;
+
+    // Timings of the device callbacks, each of which renders every input;
+    // counted since the device stream last started
+    const AudioStats& getStats() const {
+        return stats;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_MIXER_H
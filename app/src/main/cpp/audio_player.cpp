@@ -0,0 +1,693 @@
+#include "audio_player.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+#include "sample_convert.h"
+
+#define LOG_TAG "AudioPlayer"
+#include "audio_log.h"
+
+AudioPlayer::AudioPlayer(AudioBackend& backend) : backend(backend) {
+    previewBuffer.resize(BUFFER_SIZE);
+    underrunSilence.assign(UNDERRUN_SAMPLES * sizeof(float), 0);
+}
+
+AudioPlayer::~AudioPlayer() {
+    cleanup();
+}
+
+bool AudioPlayer::initialize() {
+    return backend.initialize();
+}
+
+bool AudioPlayer::loadAudioFile(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    unloadSource();
+    if (!getStream().open(filePath)) {
+        LOGE("Failed to open audio file: %s", filePath.c_str());
+        return false;
+    }
+    prepareSource();
+
+    LOGI("Loaded audio file: %s, frames: %llu, %u Hz, %u channels", filePath.c_str(),
+         static_cast<unsigned long long>(getStream().getFrameCount()), sourceSampleRate.load(), sourceChannels);
+    return true;
+}
+
+bool AudioPlayer::loadEditList(const EditList& list) {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    unloadSource();
+    if (!getStream().open(list)) {
+        LOGE("Failed to open edit list");
+        return false;
+    }
+    prepareSource();
+
+    LOGI("Loaded edit list: %zu ranges, frames: %llu, %u Hz, %u channels", list.getRanges().size(),
+         static_cast<unsigned long long>(getStream().getFrameCount()), sourceSampleRate.load(), sourceChannels);
+    return true;
+}
+
+bool AudioPlayer::setQueue(const std::vector<std::string>& paths, std::shared_ptr<QueueListener> listener) {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    unloadSource();
+
+    size_t first = 0;
+    while (first < paths.size() && !getStream().open(paths[first])) {
+        LOGE("Skipping queue item that does not open: %s", paths[first].c_str());
+        first++;
+    }
+    if (first == paths.size()) {
+        return false;
+    }
+    prepareSource();
+
+    queue = paths;
+    queueListener = std::move(listener);
+    queueActive = true;
+    queueNext = first + 1;
+    playingIndex.store(first, std::memory_order_relaxed);
+    reportedIndex = first;
+    prepareNext();
+
+    if (!queueRunning) {
+        queueRunning = true;
+        queueThread = std::thread(&AudioPlayer::queueLoop, this);
+    }
+    queueWake.notify_one();
+
+    LOGI("Queued %zu items, starting with %s", paths.size() - first, paths[first].c_str());
+    return true;
+}
+
+void AudioPlayer::clearQueue() {
+    queueActive = false;
+    queue.clear();
+    queueListener.reset();
+    queueNext = 0;
+    nextState.store(NEXT_NONE, std::memory_order_relaxed);
+    playingIndex.store(0, std::memory_order_relaxed);
+    reportedIndex = 0;
+    queueEnded.store(false, std::memory_order_relaxed);
+    getStandbyStream().close();
+}
+
+void AudioPlayer::prepareNext() {
+    PlaybackStream& next = getStandbyStream();
+    next.close();
+    // The render thread waits for this rather than ending the item
+    nextState.store(NEXT_PREPARING, std::memory_order_release);
+
+    while (queueNext < queue.size()) {
+        size_t index = queueNext++;
+        if (!next.open(queue[index])) {
+            LOGE("Skipping queue item that does not open: %s", queue[index].c_str());
+            continue;
+        }
+        nextIndex.store(index, std::memory_order_relaxed);
+
+        // The render thread can only carry on into audio its buffers,
+        // handler and resampler are already set up for
+        bool matches = next.getFormat() == sourceFormat && next.getSampleRate() == sourceSampleRate &&
+                       next.getChannels() == sourceChannels &&
+                       next.getMaxBlockSamples() <= previewBuffer.size() &&
+                       (!(resampling || stretching) || next.getMaxBlockSamples() <= sourceBuffer.size());
+        if (matches && next.start(0)) {
+            nextState.store(NEXT_READY, std::memory_order_release);
+        } else {
+            nextState.store(NEXT_RESTART, std::memory_order_release);
+        }
+        return;
+    }
+    nextState.store(NEXT_NONE, std::memory_order_release);
+}
+
+bool AudioPlayer::restartWithNext() {
+    // Playback has already stopped at the end of the last item; the next
+    // one is open in the other stream
+    PlaybackStream& previous = getStream();
+    PlaybackStream* next = &getStandbyStream();
+    size_t index = nextIndex.load(std::memory_order_relaxed);
+    unloadSourceState();
+    previous.close();
+    stream.store(next, std::memory_order_release);
+    prepareSource();
+
+    playingIndex.store(index, std::memory_order_release);
+    if (!startPlaybackLocked()) {
+        LOGE("Failed to restart the queue at %s", queue[index].c_str());
+        return false;
+    }
+    return true;
+}
+
+void AudioPlayer::queueLoop() {
+    std::unique_lock<std::mutex> lock(playerMutex);
+    while (queueRunning) {
+        if (!queueActive) {
+            queueWake.wait(lock);
+            continue;
+        }
+
+        // The render thread moved on to the next item: the one before is
+        // done with, and the one after goes into its stream
+        size_t playing = playingIndex.load(std::memory_order_acquire);
+        if (playing != reportedIndex) {
+            reportedIndex = playing;
+            prepareNext();
+            std::shared_ptr<QueueListener> listener = queueListener;
+            lock.unlock();
+            if (listener != nullptr) listener->onTrackStarted(playing);
+            lock.lock();
+            continue;
+        }
+
+        // Playback ran out: at the end of the queue, or of an item the next
+        // one could not follow in the same stream
+        if (queueEnded.exchange(false, std::memory_order_acquire) && !isPlaying) {
+            if (nextState.load(std::memory_order_acquire) == NEXT_RESTART && restartWithNext()) {
+                continue;
+            }
+            std::shared_ptr<QueueListener> listener = queueListener;
+            queueActive = false;
+            lock.unlock();
+            if (listener != nullptr) listener->onQueueFinished();
+            lock.lock();
+            continue;
+        }
+
+        queueWake.wait_for(lock, std::chrono::milliseconds(QUEUE_POLL_MS));
+    }
+}
+
+void AudioPlayer::unloadSource() {
+    unloadSourceState();
+    clearQueue();
+}
+
+void AudioPlayer::unloadSourceState() {
+    // The queue may still hold blocks of the current file, even after the
+    // last one of a file that played to the end was enqueued
+    isPlaying = false;
+    if (playbackOpen) {
+        backend.stopPlayback();
+    }
+
+    sourceSampleRate = 0;
+    sourceChannels = 0;
+    sourceFormat = SampleFormat::INT16;
+    renderHandler = nullptr;
+    resampling = false;
+    stretching = false;
+    startFrame = 0;
+    positionFrame = 0;
+}
+
+void AudioPlayer::prepareSource() {
+    sourceFormat = getStream().getFormat();
+    switch (sourceFormat) {
+        case SampleFormat::INT24_PACKED:
+            renderHandler = &AudioPlayer::meterBlock<Int24>;
+            break;
+        case SampleFormat::FLOAT32:
+            renderHandler = &AudioPlayer::meterBlock<float>;
+            break;
+        default:
+            renderHandler = &AudioPlayer::meterBlock<short>;
+            break;
+    }
+
+    sourceSampleRate = getStream().getSampleRate();
+    sourceChannels = getStream().getChannels();
+    previewBuffer.resize(getStream().getMaxBlockSamples());
+
+    prepareResampler();
+}
+
+bool AudioPlayer::setOutputSampleRate(int sampleRate) {
+    // The queue thread restarts playback under the lock, with |isPlaying|
+    // briefly clear
+    std::lock_guard<std::mutex> lock(playerMutex);
+    if (isPlaying || sampleRate < 0) {
+        return false;
+    }
+
+    outputSampleRate = sampleRate;
+    if (sourceSampleRate > 0) {
+        prepareResampler();
+    }
+    return true;
+}
+
+void AudioPlayer::prepareResampler() {
+    resampling = false;
+    if (outputSampleRate == 0 || static_cast<uint32_t>(outputSampleRate) == sourceSampleRate) {
+        return;
+    }
+
+    // Filter design and every buffer the render thread needs, up front
+    if (!resampler.configure(static_cast<int>(sourceSampleRate), outputSampleRate, sourceChannels)) {
+        LOGE("Playing at %u Hz without resampling", sourceSampleRate.load());
+        return;
+    }
+
+    sourceBuffer.resize(std::max(static_cast<size_t>(BUFFER_SIZE), getStream().getMaxBlockSamples()));
+    silence.assign(resampler.getDelayFrames() * sourceChannels, 0.0f);
+    for (std::vector<float>& buffer : floatBuffers) {
+        buffer.resize(BUFFER_SIZE);
+    }
+    resampling = true;
+}
+
+void AudioPlayer::prepareTimeStretch() {
+    stretching = false;
+    if (playbackSpeed.load(std::memory_order_relaxed) == 1.0f) {
+        return;
+    }
+
+    if (!timeStretch.configure(static_cast<int>(sourceSampleRate), sourceChannels)) {
+        LOGE("Playing at normal speed without the time stretch");
+        return;
+    }
+    sourceBuffer.resize(std::max(static_cast<size_t>(BUFFER_SIZE), getStream().getMaxBlockSamples()));
+    stretchBuffer.resize(BUFFER_SIZE);
+    stretchSilence.assign(timeStretch.getFlushFrames() * sourceChannels, 0.0f);
+    for (std::vector<float>& buffer : floatBuffers) {
+        buffer.resize(BUFFER_SIZE);
+    }
+    stretching = true;
+}
+
+bool AudioPlayer::setPlaybackSpeed(float speed) {
+    if (!(speed >= TimeStretch::MIN_SPEED && speed <= TimeStretch::MAX_SPEED)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(playerMutex);
+    playbackSpeed.store(speed, std::memory_order_relaxed);
+    if (!isPlaying || stretching || speed == 1.0f) {
+        return true;
+    }
+
+    // The stream was opened for the file's own format; carry on from here
+    // in float, with the stretch in the chain
+    isPlaying = false;
+    backend.stopPlayback();
+    // Past the block the backend already has, so none of it plays twice
+    startFrame = positionEndFrame.load(std::memory_order_relaxed);
+    return startPlaybackLocked();
+}
+
+bool AudioPlayer::startPlayback() {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    return startPlaybackLocked();
+}
+
+bool AudioPlayer::startPlaybackLocked() {
+    if (isPlaying || !getStream().isOpen()) {
+        return false;
+    }
+
+    startLatency.begin();
+
+    AudioStreamConfig config;
+    prepareTimeStretch();
+    config.sampleRate = resampling ? outputSampleRate : static_cast<int>(sourceSampleRate);
+    config.channels = sourceChannels;
+    config.format = resampling || stretching ? SampleFormat::FLOAT32 : sourceFormat;
+    config.framesPerBuffer = BUFFER_SIZE / sourceChannels;
+    config.bufferCount = 2;
+
+    // Reuse the stream from the last playback if the format matches
+    bool cold = !playbackOpen || config != playbackConfig;
+    if (cold) {
+        playbackOpen = backend.openPlayback(config, this);
+        if (!playbackOpen) {
+            return false;
+        }
+        playbackConfig = config;
+    } else {
+        backend.stopPlayback();
+    }
+
+    // Only the first block is read before the device starts
+    if (!getStream().start(startFrame)) {
+        LOGE("Nothing to play from frame %llu", static_cast<unsigned long long>(startFrame));
+        return false;
+    }
+    renderGeneration = getStream().getGeneration();
+    primed = false;
+    positionFrame = startFrame;
+    positionEndFrame = startFrame;
+    startFrame = 0;
+
+    levelMeter.reset();
+    stats.reset();
+    renderUsPerSample = 1e6f / (static_cast<float>(config.sampleRate) * config.channels);
+    renderPeriodUs = 0;
+    resetFloatPath();
+    isPlaying = true;
+
+    if (!backend.startPlayback()) {
+        isPlaying = false;
+        getStream().stop();
+        return false;
+    }
+
+    startLatency.endSetup(cold);
+    LOGI("Playback started (%s, %.2f ms)", cold ? "cold" : "warm", startLatency.getSetupMs());
+    return true;
+}
+
+bool AudioPlayer::stopPlayback() {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    if (!isPlaying) return false;
+
+    isPlaying = false;
+
+    // Keep the stream open so the next playback starts warm
+    backend.stopPlayback();
+    getStream().stop();
+    clearQueue();
+    positionFrame = 0;
+
+    LOGI("Playback stopped: %llu callbacks, longest %u us, jitter up to %u us, %llu blocks starved",
+         static_cast<unsigned long long>(stats.getCallbackCount()), stats.getDurations().getMaxUs(),
+         stats.getJitter().getMaxUs(), static_cast<unsigned long long>(stats.getStarvedBlocks()));
+    return true;
+}
+
+static uint64_t clampSeekFrame(const PlaybackStream& stream, uint64_t frame) {
+    // Streams of unknown length take the frame as it is
+    return stream.getFrameCount() > 0 ? std::min(frame, stream.getFrameCount()) : frame;
+}
+
+bool AudioPlayer::seekTo(int64_t positionMs) {
+    std::lock_guard<std::mutex> lock(playerMutex);
+    if (!getStream().isOpen() || positionMs < 0) {
+        return false;
+    }
+
+    uint64_t target = static_cast<uint64_t>(positionMs) * sourceSampleRate / 1000;
+    PlaybackStream* seeking = &getStream();
+    if (!isPlaying) {
+        startFrame = clampSeekFrame(*seeking, target);
+        positionFrame = startFrame;
+        return true;
+    }
+
+    // The prefetch thread does the work; the render thread drops whatever
+    // it had read ahead of the old position. It may also be moving on to
+    // the next queued item: the seek keeps the finished item from being
+    // left if it lands first, otherwise it follows the swap.
+    for (;;) {
+        uint64_t frame = clampSeekFrame(*seeking, target);
+        positionFrame = frame;
+        positionEndFrame = frame;
+        seeking->seek(frame);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (handingOver.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        PlaybackStream* playing = &getStream();
+        if (playing == seeking) {
+            return true;
+        }
+        seeking = playing;
+    }
+}
+
+int64_t AudioPlayer::getPositionMs() const {
+    uint32_t rate = sourceSampleRate;
+    return rate > 0 ? static_cast<int64_t>(positionFrame.load() * 1000 / rate) : 0;
+}
+
+int64_t AudioPlayer::getDurationMs() const {
+    uint32_t rate = sourceSampleRate;
+    return rate > 0 ? static_cast<int64_t>(getStream().getFrameCount() * 1000 / rate) : 0;
+}
+
+bool AudioPlayer::onRenderBuffer(const void*& samples, size_t& sampleCount) {
+    AudioStats::CallbackTimer timer(stats, renderPeriodUs);
+    bool rendered = renderBuffer(samples, sampleCount);
+    // The next request is due once this buffer has played
+    renderPeriodUs = rendered ? static_cast<uint32_t>(sampleCount * renderUsPerSample) : 0;
+    return rendered;
+}
+
+bool AudioPlayer::renderBuffer(const void*& samples, size_t& sampleCount) {
+    // The first request primes the queue from inside startPlayback(); the
+    // device's own callbacks start with the second one
+    if (primed) {
+        startLatency.onCallback();
+    }
+    primed = true;
+
+    // After a seek, audio read ahead of the old position is dropped
+    uint32_t generation = getStream().getGeneration();
+    if (generation != renderGeneration) {
+        renderGeneration = generation;
+        resetFloatPath();
+    }
+
+    if (resampling || stretching) {
+        return renderFloat(samples, sampleCount);
+    }
+
+    // The backend is done with the block handed out last time once it
+    // asks again
+    while (getStream().getHeldCount() > 0) {
+        getStream().release();
+    }
+    return renderSource(samples, sampleCount);
+}
+
+bool AudioPlayer::renderSource(const void*& samples, size_t& sampleCount) {
+    if (!isPlaying) {
+        return false;
+    }
+
+    const PlaybackBlock* block = acquireBlock();
+    if (block == nullptr && !backend.isRealtime()) {
+        // Nothing is listening in real time, so wait rather than skip
+        while (block == nullptr && isPlaying && !isSourceFinished()) {
+            std::this_thread::yield();
+            block = acquireBlock();
+        }
+    }
+
+    if (block == nullptr) {
+        if (isSourceFinished()) {
+            finishPlayback();
+            return false;
+        }
+        // The prefetch thread is behind or still seeking; keep the device fed
+        stats.onStarvedBlock();
+        samples = underrunSilence.data();
+        sampleCount = UNDERRUN_SAMPLES;
+        return true;
+    }
+
+    samples = block->data.data();
+    sampleCount = block->sampleCount;
+    positionFrame.store(block->startFrame, std::memory_order_relaxed);
+    positionEndFrame.store(block->startFrame + sampleCount / sourceChannels, std::memory_order_relaxed);
+    (this->*renderHandler)(samples, sampleCount);
+    return true;
+}
+
+const PlaybackBlock* AudioPlayer::acquireBlock() {
+    PlaybackStream* source = stream.load(std::memory_order_relaxed);
+    const PlaybackBlock* block = source->acquire();
+    if (block != nullptr || !source->isFinished() || nextState.load(std::memory_order_acquire) != NEXT_READY) {
+        return block;
+    }
+
+    // Checked again once marked: a seek that came in since has either
+    // reopened this item or will wait for the swap and follow it
+    handingOver.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!source->isFinished()) {
+        handingOver.store(false, std::memory_order_release);
+        return nullptr;
+    }
+
+    // The end of a queued item: the next one is already reading ahead, so
+    // its first block follows this one's last sample. Anything the backend
+    // still holds of this item was released before we got here.
+    PlaybackStream* next = source == &streams[0] ? &streams[1] : &streams[0];
+    nextState.store(NEXT_NONE, std::memory_order_relaxed);
+    stream.store(next, std::memory_order_release);
+    renderGeneration = next->getGeneration();
+    playingIndex.store(nextIndex.load(std::memory_order_relaxed), std::memory_order_release);
+    handingOver.store(false, std::memory_order_release);
+    return next->acquire();
+}
+
+bool AudioPlayer::isSourceFinished() const {
+    // Still to come while the queue thread is getting the next item ready
+    return getStream().isFinished() && nextState.load(std::memory_order_acquire) != NEXT_PREPARING;
+}
+
+template <typename Sample>
+void AudioPlayer::meterBlock(const void* samples, size_t sampleCount) {
+    // The meter works on 16-bit samples; the device gets the file's own
+    if constexpr (std::is_same<Sample, short>::value) {
+        levelMeter.publish(static_cast<const short*>(samples), sampleCount);
+    } else {
+        convertSamples(static_cast<const Sample*>(samples), previewBuffer.data(), sampleCount);
+        levelMeter.publish(previewBuffer.data(), sampleCount);
+    }
+}
+
+void AudioPlayer::finishPlayback() {
+    isPlaying = false;
+    positionFrame.store(0, std::memory_order_relaxed);
+    queueEnded.store(true, std::memory_order_release);
+}
+
+bool AudioPlayer::renderFloat(const void*& samples, size_t& sampleCount) {
+    std::vector<float>& buffer = floatBuffers[nextFloatBuffer];
+    nextFloatBuffer ^= 1;
+
+    const size_t channels = sourceChannels;
+    const size_t capacity = buffer.size() / channels;
+    size_t produced = 0;
+    size_t used = 0;
+
+    while (produced < capacity) {
+        float* out = buffer.data() + produced * channels;
+        if (sourceFrames > 0) {
+            if (resampling) {
+                produced += resampler.process(sourceSamples, sourceFrames, used, out, capacity - produced);
+            } else {
+                used = std::min(sourceFrames, capacity - produced);
+                std::copy(sourceSamples, sourceSamples + used * channels, out);
+                produced += used;
+            }
+            sourceSamples += used * channels;
+            sourceFrames -= used;
+        } else if (!sourceDrained) {
+            bool more = stretching ? stretchSource() : readSourceBlock(sourceSamples, sourceFrames);
+            if (!more) {
+                // Silence pushes the filter's look-ahead past the last block
+                sourceDrained = true;
+                flushFrames = resampling ? resampler.getDelayFrames() : 0;
+            }
+        } else if (flushFrames > 0) {
+            produced += resampler.process(silence.data(), flushFrames, used, out, capacity - produced);
+            flushFrames -= used;
+        } else {
+            break;
+        }
+    }
+
+    if (produced == 0) {
+        isPlaying = false;
+        return false;
+    }
+
+    samples = buffer.data();
+    sampleCount = produced * channels;
+    return true;
+}
+
+void AudioPlayer::resetFloatPath() {
+    if (resampling) {
+        resampler.reset();
+    }
+    if (stretching) {
+        timeStretch.reset();
+        stretchFrames = 0;
+        stretchDrained = false;
+    }
+    sourceSamples = nullptr;
+    sourceFrames = 0;
+    sourceDrained = false;
+    flushFrames = 0;
+}
+
+bool AudioPlayer::readSourceBlock(const float*& samples, size_t& frames) {
+    // The last block is used up, even if it was read in place
+    while (getStream().getHeldCount() > 0) {
+        getStream().release();
+    }
+    // The source path still meters and counts what it hands over
+    const void* block = nullptr;
+    size_t count = 0;
+    if (!renderSource(block, count)) {
+        return false;
+    }
+    convertSourceBlock(block, count, samples, frames);
+    return true;
+}
+
+bool AudioPlayer::stretchSource() {
+    timeStretch.setSpeed(playbackSpeed.load(std::memory_order_relaxed));
+    const size_t channels = sourceChannels;
+    const size_t capacity = stretchBuffer.size() / channels;
+    while (true) {
+        if (stretchFrames == 0 && !stretchDrained && !readSourceBlock(stretchSamples, stretchFrames)) {
+            stretchDrained = true;
+            stretchSamples = stretchSilence.data();
+            stretchFrames = stretchSilence.size() / channels;
+        }
+        if (stretchFrames == 0) {
+            return false;
+        }
+
+        size_t used = 0;
+        size_t produced = timeStretch.process(stretchSamples, stretchFrames, used, stretchBuffer.data(), capacity);
+        stretchSamples += used * channels;
+        stretchFrames -= used;
+        if (produced > 0) {
+            sourceSamples = stretchBuffer.data();
+            sourceFrames = produced;
+            return true;
+        }
+    }
+}
+
+void AudioPlayer::convertSourceBlock(const void* samples, size_t sampleCount, const float*& converted,
+                                     size_t& frames) {
+    frames = sampleCount / sourceChannels;
+    switch (sourceFormat) {
+        case SampleFormat::INT24_PACKED:
+            convertSamples(static_cast<const Int24*>(samples), sourceBuffer.data(), sampleCount);
+            break;
+        case SampleFormat::FLOAT32:
+            // Already float; read straight from the block
+            converted = static_cast<const float*>(samples);
+            return;
+        default:
+            convertSamples(static_cast<const short*>(samples), sourceBuffer.data(), sampleCount);
+            break;
+    }
+    converted = sourceBuffer.data();
+}
+
+void AudioPlayer::cleanup() {
+    if (queueThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(playerMutex);
+            queueRunning = false;
+        }
+        queueWake.notify_one();
+        queueThread.join();
+    }
+
+    if (isPlaying) {
+        stopPlayback();
+    }
+
+    if (playbackOpen) {
+        backend.closePlayback();
+        playbackOpen = false;
+    }
+    clearQueue();
+    getStream().close();
+}
@@ -0,0 +1,271 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_PLAYER_H
+#define AUDIORECORDINGAPP_AUDIO_PLAYER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_stats.h"
+#include "level_meter.h"
+#include "playback_stream.h"
+#include "resampler.h"
+#include "start_latency_probe.h"
+#include "time_stretch.h"
+
+// Plays a WAV or FLAC file, or an EditList of WAV takes without rendering
+// it first, through an AudioBackend playback stream. A
+// PlaybackStream reads the file a few blocks ahead on its own thread, so
+// memory stays the same whatever the length and playback starts as soon as
+// the first block is in. WAV samples (16-bit, packed 24-bit or float, mono
+// or stereo) reach the backend in their own format, through a render path
+// compiled per sample type; FLAC arrives decoded to 16-bit. The stream is
+// kept open between playbacks while the file format matches.
+//
+// With an output rate set (the device mixer's), files at any other rate
+// are converted to float and resampled on the render thread, so the stream
+// opens at the mixer's rate and the system does not resample again.
+//
+// At any speed but 1 the float audio goes through a TimeStretch first,
+// so it plays faster or slower at the same pitch. The speed can change
+// while playing and follows within a hop of the stretch.
+//
+// A play queue runs through a list of files without stopping: while one
+// plays, a queue thread opens the next in a second stream and reads it
+// ahead, and the render thread carries on into it on the sample after the
+// last one, with no gap and nothing torn down. An item in another format
+// than the one before cannot share the stream; playback stops at its end
+// and the queue thread restarts it in the new format.
+class AudioPlayer : private AudioRenderCallback {
+public:
+    // Queue transitions, told on the queue thread, never the render thread
+    class QueueListener {
+    public:
+        virtual ~QueueListener() = default;
+        // Item |index| of the queue is playing, from its first sample
+        virtual void onTrackStarted(size_t index) = 0;
+        // The last item has played out
+        virtual void onQueueFinished() = 0;
+    };
+
+private:
+    AudioBackend& backend;
+
+    // Format the open playback stream was created for
+    AudioStreamConfig playbackConfig;
+    bool playbackOpen = false;
+
+    std::atomic<bool> isPlaying{false};
+    // Serializes the control calls; the render thread never takes it
+    std::mutex playerMutex;
+
+    // The stream playing, and the other one a queue reads its next item
+    // into. Only the render thread moves |stream| while playing.
+    PlaybackStream streams[2];
+    std::atomic<PlaybackStream*> stream{&streams[0]};
+    // Marked by the render thread from the end-of-item check through the
+    // swap; seekTo() waits it out to find the stream its seek belongs to
+    std::atomic<bool> handingOver{false};
+    // Read for the position and duration without the lock
+    std::atomic<uint32_t> sourceSampleRate{0};
+    uint16_t sourceChannels = 0;
+    SampleFormat sourceFormat = SampleFormat::INT16;
+
+    // Frame the next playback starts from, and the first and one past the
+    // last frame of the block last handed to the backend
+    uint64_t startFrame = 0;
+    std::atomic<uint64_t> positionFrame{0};
+    std::atomic<uint64_t> positionEndFrame{0};
+    // Seek generation the render thread last saw, and whether the queue
+    // has been primed since the last start
+    uint32_t renderGeneration = 0;
+    bool primed = false;
+
+    // Handed to the backend when the prefetch thread falls behind
+    std::vector<uint8_t> underrunSilence;
+
+    // Meters and hands over one block of the source's sample type
+    using RenderHandler = void (AudioPlayer::*)(const void* samples, size_t sampleCount);
+    RenderHandler renderHandler = nullptr;
+
+    // 16-bit copy of each buffer for the level meter, for other formats
+    std::vector<short> previewBuffer;
+
+    // Rate the stream opens at when the file's differs; 0 plays every file
+    // at its own rate
+    int outputSampleRate = 0;
+    bool resampling = false;
+    Resampler resampler;
+
+    // Rest of the last source block as float, waiting for the resampler;
+    // converted into sourceBuffer unless the file is float already, in
+    // which case the stream's block stays held until it is used up
+    std::vector<float> sourceBuffer;
+    const float* sourceSamples = nullptr;
+    size_t sourceFrames = 0;
+    bool sourceDrained = false;
+    size_t flushFrames = 0;
+    std::vector<float> silence;
+
+    // Set from any thread and picked up by the render thread every buffer.
+    // Once it is off 1 the stretch stays in the chain until the next
+    // start, so going back to 1 is as smooth as any other change.
+    std::atomic<float> playbackSpeed{1.0f};
+    bool stretching = false;
+    TimeStretch timeStretch;
+
+    // Source frames as float waiting for the stretch, which writes into
+    // stretchBuffer for the resampler; at the end, silence pushes its last
+    // segments out
+    const float* stretchSamples = nullptr;
+    size_t stretchFrames = 0;
+    bool stretchDrained = false;
+    std::vector<float> stretchBuffer;
+    std::vector<float> stretchSilence;
+
+    // Float output alternates between two buffers: the backend holds on to
+    // the last one handed out until it asks for the next
+    std::vector<float> floatBuffers[2];
+    int nextFloatBuffer = 0;
+
+    // Play queue, guarded by playerMutex. |queueNext| is the first item not
+    // yet opened; |nextIndex| is the one waiting in the other stream.
+    enum NextState { NEXT_NONE, NEXT_PREPARING, NEXT_READY, NEXT_RESTART };
+    std::vector<std::string> queue;
+    std::shared_ptr<QueueListener> queueListener;
+    bool queueActive = false;
+    size_t queueNext = 0;
+    std::atomic<int> nextState{NEXT_NONE};
+    std::atomic<size_t> nextIndex{0};
+    // Item the render thread is playing, and the last one the queue thread
+    // reported; the render thread sets |queueEnded| when it runs out
+    std::atomic<size_t> playingIndex{0};
+    size_t reportedIndex = 0;
+    std::atomic<bool> queueEnded{false};
+    // Waits on playerMutex; the render thread never wakes it, so it polls
+    // while a queue plays
+    std::thread queueThread;
+    bool queueRunning = false;
+    std::condition_variable queueWake;
+
+    StartLatencyProbe startLatency;
+    LevelMeter levelMeter;
+    AudioStats stats;
+    // Length of a sample at the stream's rate, and of the buffer handed
+    // out last, which is when the next request is due
+    float renderUsPerSample = 0.0f;
+    uint32_t renderPeriodUs = 0;
+
+    static const int BUFFER_SIZE = 4096;
+    static const size_t UNDERRUN_SAMPLES = 512;
+    static const int QUEUE_POLL_MS = 10;
+
+public:
+    explicit AudioPlayer(AudioBackend& backend);
+    ~AudioPlayer() override;
+
+    AudioPlayer(const AudioPlayer&) = delete;
+    AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+    bool initialize();
+    bool loadAudioFile(const std::string& filePath);
+    // Plays a snapshot of |list| straight from its sources; later edits
+    // to the list need another load
+    bool loadEditList(const EditList& list);
+    // Loads the first of |paths| that opens, as loadAudioFile() would;
+    // startPlayback() then plays through the rest. Items that do not open
+    // are skipped. Loading anything else or stopping ends the queue.
+    bool setQueue(const std::vector<std::string>& paths, std::shared_ptr<QueueListener> listener);
+    // Queue item playing; 0 without a queue
+    size_t getQueueIndex() const {
+        return playingIndex.load(std::memory_order_relaxed);
+    }
+
+    // Rate of the device's mixer, or 0 to play each file at its own rate.
+    // Only between playbacks.
+    bool setOutputSampleRate(int sampleRate);
+
+    // TimeStretch::MIN_SPEED to MAX_SPEED, at the same pitch. Takes effect
+    // within a hop of the stretch once a playback has run at a speed other
+    // than 1; one started at 1 restarts where it is with the stretch.
+    bool setPlaybackSpeed(float speed);
+
+    float getPlaybackSpeed() const {
+        return playbackSpeed.load(std::memory_order_relaxed);
+    }
+
+    bool startPlayback();
+    bool stopPlayback();
+
+    // Constant time whatever the file length. While stopped, sets where
+    // the next playback starts.
+    bool seekTo(int64_t positionMs);
+    // Start of the audio last handed to the device; 0 once playback ends
+    int64_t getPositionMs() const;
+    int64_t getDurationMs() const;
+
+    bool isCurrentlyPlaying() const {
+        return isPlaying;
+    }
+
+    const StartLatencyProbe& getStartLatency() const {
+        return startLatency;
+    }
+
+    LevelMeter& getLevelMeter() {
+        return levelMeter;
+    }
+
+    // Callback timings and starved blocks for the current or most recent
+    // playback
+    const AudioStats& getStats() const {
+        return stats;
+    }
+
+private:
+    void unloadSource();
+    void unloadSourceState();
+    void prepareSource();
+    void prepareResampler();
+    void prepareTimeStretch();
+    bool startPlaybackLocked();
+
+    PlaybackStream& getStream() {
+        return *stream.load(std::memory_order_acquire);
+    }
+
+    const PlaybackStream& getStream() const {
+        return *stream.load(std::memory_order_acquire);
+    }
+
+    PlaybackStream& getStandbyStream() {
+        return stream.load() == &streams[0] ? streams[1] : streams[0];
+    }
+
+    void clearQueue();
+    void prepareNext();
+    bool restartWithNext();
+    void queueLoop();
+    const PlaybackBlock* acquireBlock();
+    bool isSourceFinished() const;
+    bool onRenderBuffer(const void*& samples, size_t& sampleCount) override;
+    bool renderBuffer(const void*& samples, size_t& sampleCount);
+    bool renderSource(const void*& samples, size_t& sampleCount);
+    bool renderFloat(const void*& samples, size_t& sampleCount);
+    void resetFloatPath();
+    bool readSourceBlock(const float*& samples, size_t& frames);
+    bool stretchSource();
+    void convertSourceBlock(const void* samples, size_t sampleCount, const float*& converted, size_t& frames);
+    void finishPlayback();
+
+    template <typename Sample>
+    void meterBlock(const void* samples, size_t sampleCount);
+
+    void cleanup();
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_PLAYER_H
@@ -1,617 +1,615 @@
-#include <jni.h>
-#include <android/log.h>
-#include <SLES/OpenSLES.h>
-#include <SLES/OpenSLES_Android.h>
-#include <string>
-#include <vector>
-#include <fstream>
+#include "audio_recorder.h"
+
+#include <algorithm>
 #include <thread>
-#include <atomic>
-#include <mutex>
+#include <type_traits>
+
+#include "sample_convert.h"
 
 #define LOG_TAG "AudioRecorder"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-class AudioRecorder {
-private:
-    SLObjectItf engineObject = nullptr;
-    SLEngineItf engineEngine = nullptr;
-    SLObjectItf recorderObject = nullptr;
-    SLRecordItf recorderRecord = nullptr;
-    SLAndroidSimpleBufferQueueItf recorderBufferQueue = nullptr;
-    
-    std::atomic<bool> isRecording{false};
-    std::vector<short> audioBuffer;
-    std::mutex bufferMutex;
-    std::string outputFilePath;
-    
-    static const int SAMPLE_RATE = 44100;
-    static const int CHANNELS = 1;
-    static const int BITS_PER_SAMPLE = 16;
-    static const int BUFFER_SIZE = 4096;
-    
-    short recordBuffer[BUFFER_SIZE];
-    
-public:
-    AudioRecorder() = default;
-    ~AudioRecorder() {
-        cleanup();
-    }
-    
-    bool initialize() {
-        SLresult result;
-        
-        // Create engine
-        result = slCreateEngine(&engineObject, 0, nullptr, 0, nullptr, nullptr);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to create engine");
-            return false;
-        }
-        
-        // Realize engine
-        result = (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to realize engine");
-            return false;
-        }
-        
-        // Get engine interface
-        result = (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get engine interface");
-            return false;
-        }
-        
-        return true;
+#include "audio_log.h"
+
+AudioRecorder::AudioRecorder(AudioBackend& backend) : backend(backend) {
+    captureConfig.sampleRate = DEFAULT_SAMPLE_RATE;
+    captureConfig.channels = DEFAULT_CHANNELS;
+    captureConfig.format = SampleFormat::INT16;
+    captureConfig.bufferCount = DEFAULT_BUFFER_COUNT;
+    captureConfig.framesPerBuffer = DEFAULT_FRAMES_PER_BUFFER;
+    captureHandler = &AudioRecorder::captureBlock<short>;
+    wavWriter.setCommitInterval(COMMIT_INTERVAL_MS);
+}
+
+AudioRecorder::~AudioRecorder() {
+    cleanup();
+}
+
+bool AudioRecorder::initialize() {
+    return backend.initialize();
+}
+
+bool AudioRecorder::configureCapture(int bufferCount, int framesPerBuffer) {
+    if (isRecording || armed) {
+        LOGE("Cannot reconfigure capture while recording or armed");
+        return false;
     }
-    
-    bool startRecording(const std::string& filePath) {
-        if (isRecording) {
-            LOGE("Already recording");
-            return false;
-        }
-        
-        outputFilePath = filePath;
-        audioBuffer.clear();
-        
-        SLresult result;
-        
-        // Configure audio source
-        SLDataLocator_IODevice loc_dev = {SL_DATALOCATOR_IODEVICE, SL_IODEVICE_AUDIOINPUT,
-                                          SL_DEFAULTDEVICEID_AUDIOINPUT, nullptr};
-        SLDataSource audioSrc = {&loc_dev, nullptr};
-        
-        // Configure audio sink
-        SLDataLocator_AndroidSimpleBufferQueue loc_bq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, 2};
-        SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
-                                       SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
-                                       SL_SPEAKER_FRONT_CENTER, SL_BYTEORDER_LITTLEENDIAN};
-        SLDataSink audioSnk = {&loc_bq, &format_pcm};
-        
-        // Create audio recorder
-        const SLInterfaceID id[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
-        const SLboolean req[1] = {SL_BOOLEAN_TRUE};
-        result = (*engineEngine)->CreateAudioRecorder(engineEngine, &recorderObject, &audioSrc,
-                                                       &audioSnk, 1, id, req);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to create audio recorder");
-            return false;
-        }
-        
-        // Realize the audio recorder
-        result = (*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to realize audio recorder");
-            return false;
-        }
-        
-        // Get the record interface
-        result = (*recorderObject)->GetInterface(recorderObject, SL_IID_RECORD, &recorderRecord);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get record interface");
-            return false;
-        }
-        
-        // Get the buffer queue interface
-        result = (*recorderObject)->GetInterface(recorderObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE,
-                                                  &recorderBufferQueue);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get buffer queue interface");
-            return false;
-        }
-        
-        // Register callback
-        result = (*recorderBufferQueue)->RegisterCallback(recorderBufferQueue, bqRecorderCallback, this);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to register callback");
-            return false;
-        }
-        
-        // Enqueue initial buffer
-        result = (*recorderBufferQueue)->Enqueue(recorderBufferQueue, recordBuffer, BUFFER_SIZE * sizeof(short));
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to enqueue buffer");
-            return false;
+
+    if (bufferCount < MIN_BUFFER_COUNT || bufferCount > MAX_BUFFER_COUNT ||
+        framesPerBuffer < MIN_FRAMES_PER_BUFFER || framesPerBuffer > MAX_FRAMES_PER_BUFFER) {
+        LOGE("Invalid capture config: %d buffers of %d frames", bufferCount, framesPerBuffer);
+        return false;
+    }
+
+    // The queue depth is fixed when the capture stream is opened
+    if (bufferCount != captureConfig.bufferCount || framesPerBuffer != captureConfig.framesPerBuffer) {
+        backend.closeCapture();
+        captureOpen = false;
+    }
+
+    captureConfig.bufferCount = bufferCount;
+    captureConfig.framesPerBuffer = framesPerBuffer;
+    LOGI("Capture config: %d buffers of %d frames, latency %.1f ms, headroom %.1f ms",
+         bufferCount, framesPerBuffer, getInputLatencyMs(), getCaptureHeadroomMs());
+    return true;
+}
+
+bool AudioRecorder::configureFormat(int sampleRate, int channels, SampleFormat format) {
+    if (isRecording || armed) {
+        LOGE("Cannot change format while recording or armed");
+        return false;
+    }
+
+    if (pcmTap != nullptr) {
+        LOGE("Cannot change format while the PCM tap is open");
+        return false;
+    }
+
+    if (spectrogram != nullptr) {
+        LOGE("Cannot change format while the spectrogram is open");
+        return false;
+    }
+
+    if (sampleRate < MIN_SAMPLE_RATE || sampleRate > MAX_SAMPLE_RATE || channels < 1 || channels > 2) {
+        LOGE("Invalid capture format: %d Hz, %d channels", sampleRate, channels);
+        return false;
+    }
+
+    if (sampleRate != captureConfig.sampleRate || channels != captureConfig.channels ||
+        format != captureConfig.format) {
+        backend.closeCapture();
+        captureOpen = false;
+    }
+
+    captureConfig.sampleRate = sampleRate;
+    captureConfig.channels = channels;
+    captureConfig.format = format;
+
+    switch (format) {
+        case SampleFormat::INT24_PACKED:
+            captureHandler = &AudioRecorder::captureBlock<Int24>;
+            break;
+        case SampleFormat::FLOAT32:
+            captureHandler = &AudioRecorder::captureBlock<float>;
+            break;
+        default:
+            captureHandler = &AudioRecorder::captureBlock<short>;
+            break;
+    }
+
+    wavWriter.setFormat(sampleRate, channels, format);
+    flacWriter.setFormat(sampleRate, channels);
+    waveformIndex = WaveformIndex(sampleRate, channels);
+    voiceDetector = VoiceActivityDetector(sampleRate, channels);
+    voiceDetector.configure(voiceConfig);
+    effects.configure(sampleRate, channels);
+
+    LOGI("Capture format: %d Hz, %d channels, %d-bit%s", sampleRate, channels,
+         getBitsPerSample(format), format == SampleFormat::FLOAT32 ? " float" : "");
+    return true;
+}
+
+bool AudioRecorder::configureVoiceActivity(const VoiceActivityConfig& config) {
+    if (isRecording) {
+        LOGE("Cannot change voice activity settings while recording");
+        return false;
+    }
+
+    if (config.thresholdDb <= 0.0f || config.thresholdDb > 60.0f || config.hangoverMs < 0 ||
+        config.hangoverMs > MAX_VOICE_HANGOVER_MS || config.preRollMs < 0 ||
+        config.preRollMs > MAX_VOICE_PRE_ROLL_MS) {
+        LOGE("Invalid voice activity settings: %.1f dB, hangover %d ms, pre-roll %d ms",
+             config.thresholdDb, config.hangoverMs, config.preRollMs);
+        return false;
+    }
+
+    voiceConfig = config;
+    voiceDetector.configure(config);
+    LOGI("Voice activity %s: %.1f dB, hangover %d ms, pre-roll %d ms", config.enabled ? "on" : "off",
+         config.thresholdDb, config.hangoverMs, config.preRollMs);
+    return true;
+}
+
+bool AudioRecorder::setEffects(const EffectSettings& settings) {
+    if ((settings.highPassHz != 0.0f &&
+         (settings.highPassHz < MIN_HIGH_PASS_HZ || settings.highPassHz > MAX_HIGH_PASS_HZ)) ||
+        settings.gateThresholdDb < -90.0f || settings.gateThresholdDb > 0.0f || settings.gateHoldMs < 0 ||
+        settings.gateHoldMs > MAX_VOICE_HANGOVER_MS || settings.agcTargetDb < -40.0f ||
+        settings.agcTargetDb > 0.0f || settings.agcMaxGainDb < 0.0f || settings.agcMaxGainDb > 40.0f ||
+        settings.limiterCeilingDb < -20.0f || settings.limiterCeilingDb > 0.0f) {
+        LOGE("Invalid capture effects: high-pass %.0f Hz, gate %.1f dB, AGC %.1f dB up to +%.1f dB, "
+             "limiter %.1f dB", settings.highPassHz, settings.gateThresholdDb, settings.agcTargetDb,
+             settings.agcMaxGainDb, settings.limiterCeilingDb);
+        return false;
+    }
+
+    effects.setSettings(settings);
+    LOGI("Capture effects: high-pass %s, gate %s, AGC %s, limiter %s",
+         settings.highPassHz > 0.0f ? "on" : "off", settings.gateEnabled ? "on" : "off",
+         settings.agcEnabled ? "on" : "off", settings.limiterEnabled ? "on" : "off");
+    return true;
+}
+
+bool AudioRecorder::arm(int preRollMs) {
+    if (isRecording) {
+        LOGE("Cannot arm while recording");
+        return false;
+    }
+
+    if (preRollMs <= 0 || preRollMs > MAX_ARMED_PRE_ROLL_MS) {
+        LOGE("Invalid pre-roll: %d ms", preRollMs);
+        return false;
+    }
+
+    // Re-arming with another length starts over
+    if (armed) {
+        captureState = CaptureState::IDLE;
+        backend.stopCapture();
+        armed = false;
+        while (armedBlock.load()) {
+            std::this_thread::yield();
         }
-        
-        // Start recording
-        result = (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_RECORDING);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to start recording");
+    }
+
+    if (!captureOpen) {
+        captureOpen = backend.openCapture(captureConfig, this);
+        if (!captureOpen) {
             return false;
         }
-        
-        isRecording = true;
-        LOGI("Recording started");
-        return true;
-    }
-    
-    bool stopRecording() {
-        if (!isRecording) {
-            LOGE("Not recording");
+    }
+
+    // Everything the callback touches is sized before the stream runs
+    size_t frames = static_cast<size_t>(preRollMs) * captureConfig.sampleRate / 1000;
+    armedBuffer.configure(frames, captureConfig.channels, getBytesPerSample(captureConfig.format));
+    sizeBlockBuffers();
+    capturePeriodUs = static_cast<uint32_t>(1000000ull * captureConfig.framesPerBuffer / captureConfig.sampleRate);
+    levelMeter.reset();
+
+    armed = true;
+    captureState = CaptureState::ARMED;
+    if (!backend.startCapture()) {
+        captureState = CaptureState::IDLE;
+        armed = false;
+        return false;
+    }
+
+    LOGI("Armed with %d ms of pre-roll", preRollMs);
+    return true;
+}
+
+void AudioRecorder::disarm() {
+    if (!armed) {
+        return;
+    }
+    armed = false;
+
+    // A take in progress keeps the stream and may still be writing out
+    // the buffer; stopRecording() finishes the job
+    if (isRecording) {
+        return;
+    }
+    captureState = CaptureState::IDLE;
+    backend.stopCapture();
+    while (armedBlock.load()) {
+        std::this_thread::yield();
+    }
+    armedBuffer = PreRollBuffer();
+    LOGI("Disarmed");
+}
+
+bool AudioRecorder::startRecording(const std::string& filePath, AudioFileFormat format) {
+    if (isRecording) {
+        LOGE("Already recording");
+        return false;
+    }
+
+    if (format == AudioFileFormat::FLAC && captureConfig.format != SampleFormat::INT16) {
+        LOGE("FLAC output needs 16-bit capture");
+        return false;
+    }
+
+    outputFilePath = filePath;
+    startLatency.begin();
+
+    // Armed, the stream is running already and only changes hands
+    bool standby = armed;
+
+    // Reuse the capture stream from the previous take when there is one
+    bool cold = !captureOpen;
+    if (cold) {
+        captureOpen = backend.openCapture(captureConfig, this);
+        if (!captureOpen) {
             return false;
         }
-        
+    }
+
+    // Header goes out now, samples stream to disk while recording
+    fileWriter = format == AudioFileFormat::FLAC ? static_cast<AudioFileWriter*>(&flacWriter) : &wavWriter;
+    if (!fileWriter->open(outputFilePath)) {
+        return false;
+    }
+
+    // Sized before the stream runs, so the callback never allocates
+    if (!standby) {
+        sizeBlockBuffers();
+    }
+    voiceSegments.clear();
+    if (voiceConfig.enabled) {
+        size_t preRollFrames = static_cast<size_t>(voiceConfig.preRollMs) * captureConfig.sampleRate / 1000;
+        preRoll.configure(preRollFrames, captureConfig.channels, getBytesPerSample(captureConfig.format));
+        voiceSegments.reserve(MAX_VOICE_SEGMENTS);
+        voiceDetector.reset();
+    }
+    inVoiceSegment = false;
+    capturedFrames = 0;
+    fileFrames = 0;
+
+    stats.reset();
+    waveformIndex.reset();
+    if (!standby) {
+        // Callbacks are due one buffer period apart
+        capturePeriodUs = static_cast<uint32_t>(1000000ull * captureConfig.framesPerBuffer / captureConfig.sampleRate);
+        levelMeter.reset();
+    }
+
+    // From the next block on, the callback records; the first one hands
+    // the held input to the writer
+    preRollPending = standby;
+    isRecording = true;
+    captureState = CaptureState::RECORDING;
+    if (!standby && !backend.startCapture()) {
+        captureState = CaptureState::IDLE;
         isRecording = false;
-        
-        if (recorderRecord) {
-            (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED);
-        }
-        
-        // Save audio data to file
-        saveToFile();
-        
-        // Cleanup recorder
-        if (recorderObject) {
-            (*recorderObject)->Destroy(recorderObject);
-            recorderObject = nullptr;
-            recorderRecord = nullptr;
-            recorderBufferQueue = nullptr;
-        }
-        
-        LOGI("Recording stopped");
-        return true;
-    }
-    
-    bool isCurrentlyRecording() const {
-        return isRecording;
-    }
-    
-private:
-    static void bqRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void *context) {
-        AudioRecorder* recorder = static_cast<AudioRecorder*>(context);
-        recorder->processAudioData();
-    }
-    
-    void processAudioData() {
-        if (!isRecording) return;
-        
-        {
-            std::lock_guard<std::mutex> lock(bufferMutex);
-            audioBuffer.insert(audioBuffer.end(), recordBuffer, recordBuffer + BUFFER_SIZE);
-        }
-        
-        // Re-enqueue the buffer
-        if (recorderBufferQueue && isRecording) {
-            (*recorderBufferQueue)->Enqueue(recorderBufferQueue, recordBuffer, BUFFER_SIZE * sizeof(short));
-        }
+        fileWriter->close();
+        return false;
     }
-    
-    void saveToFile() {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-        
-        if (audioBuffer.empty()) {
-            LOGE("No audio data to save");
-            return;
-        }
-        
-        std::ofstream file(outputFilePath, std::ios::binary);
-        if (!file.is_open()) {
-            LOGE("Failed to open output file: %s", outputFilePath.c_str());
-            return;
-        }
-        
-        // Write WAV header
-        writeWavHeader(file, audioBuffer.size());
-        
-        // Write audio data
-        file.write(reinterpret_cast<const char*>(audioBuffer.data()), 
-                   audioBuffer.size() * sizeof(short));
-        
-        file.close();
-        LOGI("Audio saved to: %s", outputFilePath.c_str());
-    }
-    
-    void writeWavHeader(std::ofstream& file, size_t dataSize) {
-        uint32_t fileSize = 36 + dataSize * sizeof(short);
-        uint32_t byteRate = SAMPLE_RATE * CHANNELS * BITS_PER_SAMPLE / 8;
-        uint16_t blockAlign = CHANNELS * BITS_PER_SAMPLE / 8;
-        uint32_t subchunk2Size = dataSize * sizeof(short);
-        
-        // RIFF header
-        file.write("RIFF", 4);
-        file.write(reinterpret_cast<const char*>(&fileSize), 4);
-        file.write("WAVE", 4);
-        
-        // fmt subchunk
-        file.write("fmt ", 4);
-        uint32_t subchunk1Size = 16;
-        file.write(reinterpret_cast<const char*>(&subchunk1Size), 4);
-        uint16_t audioFormat = 1; // PCM
-        file.write(reinterpret_cast<const char*>(&audioFormat), 2);
-        uint16_t numChannels = CHANNELS;
-        file.write(reinterpret_cast<const char*>(&numChannels), 2);
-        uint32_t sampleRate = SAMPLE_RATE;
-        file.write(reinterpret_cast<const char*>(&sampleRate), 4);
-        file.write(reinterpret_cast<const char*>(&byteRate), 4);
-        file.write(reinterpret_cast<const char*>(&blockAlign), 2);
-        uint16_t bitsPerSample = BITS_PER_SAMPLE;
-        file.write(reinterpret_cast<const char*>(&bitsPerSample), 2);
-        
-        // data subchunk
-        file.write("data", 4);
-        file.write(reinterpret_cast<const char*>(&subchunk2Size), 4);
-    }
-    
-    void cleanup() {
-        if (isRecording) {
-            stopRecording();
-        }
-        
-        if (recorderObject) {
-            (*recorderObject)->Destroy(recorderObject);
-            recorderObject = nullptr;
-        }
-        
-        if (engineObject) {
-            (*engineObject)->Destroy(engineObject);
-            engineObject = nullptr;
-        }
+
+    startLatency.endSetup(cold);
+    LOGI("Recording started (%s, %.2f ms), %d buffers of %d frames, input latency %.1f ms",
+         cold ? "cold" : "warm", startLatency.getSetupMs(), captureConfig.bufferCount,
+         captureConfig.framesPerBuffer, getInputLatencyMs());
+    return true;
+}
+
+bool AudioRecorder::stopRecording() {
+    if (!isRecording) {
+        LOGE("Not recording");
+        return false;
     }
-};
-
-class AudioPlayer {
-private:
-    SLObjectItf engineObject = nullptr;
-    SLEngineItf engineEngine = nullptr;
-    SLObjectItf playerObject = nullptr;
-    SLPlayItf playerPlay = nullptr;
-    SLAndroidSimpleBufferQueueItf playerBufferQueue = nullptr;
-    
-    std::atomic<bool> isPlaying{false};
-    std::vector<short> audioData;
-    std::mutex playerMutex;
-    size_t currentPosition = 0;
-    
-    static const int SAMPLE_RATE = 44100;
-    static const int CHANNELS = 1;
-    static const int BUFFER_SIZE = 4096;
-    
-public:
-    AudioPlayer() = default;
-    ~AudioPlayer() {
-        cleanup();
-    }
-    
-    bool initialize() {
-        SLresult result;
-        
-        // Create engine
-        result = slCreateEngine(&engineObject, 0, nullptr, 0, nullptr, nullptr);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to create player engine");
-            return false;
-        }
-        
-        // Realize engine
-        result = (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to realize player engine");
-            return false;
-        }
-        
-        // Get engine interface
-        result = (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get player engine interface");
-            return false;
-        }
-        
-        return true;
-    }
-    
-    bool loadAudioFile(const std::string& filePath) {
-        std::ifstream file(filePath, std::ios::binary);
-        if (!file.is_open()) {
-            LOGE("Failed to open audio file: %s", filePath.c_str());
-            return false;
-        }
-        
-        // Skip WAV header (44 bytes)
-        file.seekg(44);
-        
-        // Read audio data
-        audioData.clear();
-        short sample;
-        while (file.read(reinterpret_cast<char*>(&sample), sizeof(short))) {
-            audioData.push_back(sample);
-        }
-        
-        file.close();
-        currentPosition = 0;
-        
-        LOGI("Loaded audio file: %s, samples: %zu", filePath.c_str(), audioData.size());
-        return !audioData.empty();
-    }
-    
-    bool startPlayback() {
-        if (isPlaying || audioData.empty()) {
-            return false;
-        }
-        
-        SLresult result;
-        
-        // Configure audio source
-        SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, 2};
-        SLDataFormat_PCM format_pcm = {SL_DATAFORMAT_PCM, CHANNELS, SL_SAMPLINGRATE_44_1,
-                                       SL_PCMSAMPLEFORMAT_FIXED_16, SL_PCMSAMPLEFORMAT_FIXED_16,
-                                       SL_SPEAKER_FRONT_CENTER, SL_BYTEORDER_LITTLEENDIAN};
-        SLDataSource audioSrc = {&loc_bufq, &format_pcm};
-        
-        // Configure audio sink
-        SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX, nullptr};
-        SLDataSink audioSnk = {&loc_outmix, nullptr};
-        
-        // Create output mix
-        SLObjectItf outputMixObject;
-        result = (*engineEngine)->CreateOutputMix(engineEngine, &outputMixObject, 0, nullptr, nullptr);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to create output mix");
-            return false;
-        }
-        
-        result = (*outputMixObject)->Realize(outputMixObject, SL_BOOLEAN_FALSE);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to realize output mix");
-            return false;
-        }
-        
-        loc_outmix.outputMix = outputMixObject;
-        
-        // Create audio player
-        const SLInterfaceID ids[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
-        const SLboolean req[1] = {SL_BOOLEAN_TRUE};
-        result = (*engineEngine)->CreateAudioPlayer(engineEngine, &playerObject, &audioSrc, &audioSnk, 1, ids, req);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to create audio player");
-            return false;
-        }
-        
-        // Realize the player
-        result = (*playerObject)->Realize(playerObject, SL_BOOLEAN_FALSE);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to realize audio player");
-            return false;
-        }
-        
-        // Get the play interface
-        result = (*playerObject)->GetInterface(playerObject, SL_IID_PLAY, &playerPlay);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get play interface");
-            return false;
-        }
-        
-        // Get the buffer queue interface
-        result = (*playerObject)->GetInterface(playerObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &playerBufferQueue);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to get player buffer queue interface");
-            return false;
-        }
-        
-        // Register callback
-        result = (*playerBufferQueue)->RegisterCallback(playerBufferQueue, bqPlayerCallback, this);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to register player callback");
-            return false;
-        }
-        
-        // Start playback
-        result = (*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING);
-        if (SL_RESULT_SUCCESS != result) {
-            LOGE("Failed to start playback");
-            return false;
-        }
-        
-        isPlaying = true;
-        currentPosition = 0;
-        
-        // Enqueue first buffer
-        enqueueBuffer();
-        
-        LOGI("Playback started");
-        return true;
-    }
-    
-    bool stopPlayback() {
-        if (!isPlaying) return false;
-        
-        isPlaying = false;
-        
-        if (playerPlay) {
-            (*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_STOPPED);
-        }
-        
-        if (playerObject) {
-            (*playerObject)->Destroy(playerObject);
-            playerObject = nullptr;
-            playerPlay = nullptr;
-            playerBufferQueue = nullptr;
-        }
-        
-        LOGI("Playback stopped");
-        return true;
-    }
-    
-    bool isCurrentlyPlaying() const {
-        return isPlaying;
-    }
-    
-private:
-    static void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *context) {
-        AudioPlayer* player = static_cast<AudioPlayer*>(context);
-        player->enqueueBuffer();
-    }
-    
-    void enqueueBuffer() {
-        if (!isPlaying || currentPosition >= audioData.size()) {
-            isPlaying = false;
-            return;
-        }
-        
-        std::lock_guard<std::mutex> lock(playerMutex);
-        
-        size_t remainingSamples = audioData.size() - currentPosition;
-        size_t samplesToPlay = std::min(static_cast<size_t>(BUFFER_SIZE), remainingSamples);
-        
-        if (samplesToPlay > 0 && playerBufferQueue) {
-            (*playerBufferQueue)->Enqueue(playerBufferQueue, 
-                                          &audioData[currentPosition], 
-                                          samplesToPlay * sizeof(short));
-            currentPosition += samplesToPlay;
-        }
-        
-        if (currentPosition >= audioData.size()) {
-            isPlaying = false;
-        }
+
+    isRecording = false;
+    captureState = CaptureState::IDLE;
+
+    // A block already past the state check finishes before the writer, the
+    // index and the held input are touched from here
+    while (recordingBlock.load()) {
+        std::this_thread::yield();
     }
-    
-    void cleanup() {
-        if (isPlaying) {
-            stopPlayback();
-        }
-        
-        if (playerObject) {
-            (*playerObject)->Destroy(playerObject);
-            playerObject = nullptr;
-        }
-        
-        if (engineObject) {
-            (*engineObject)->Destroy(engineObject);
-            engineObject = nullptr;
+    // Likewise a block still holding input from before the take started
+    while (armedBlock.load()) {
+        std::this_thread::yield();
+    }
+
+    // Keep the capture stream open so the next take starts warm; armed, it
+    // keeps running
+    if (!armed) {
+        backend.stopCapture();
+    }
+
+    // A take stopped before its first block still gets the held input
+    if (preRollPending.exchange(false)) {
+        claimArmedBuffer();
+    }
+
+    // Flush the tail of the take and patch the file header
+    fileWriter->close();
+    if (inVoiceSegment) {
+        closeVoiceSegment();
+    }
+
+    if (fileWriter->getSamplesWritten() > 0) {
+        waveformIndex.finish();
+        waveformIndex.save(WaveformIndex::getSidecarPath(outputFilePath));
+        if (voiceConfig.enabled) {
+            saveVoiceSegments(getVoiceSegmentsPath(outputFilePath), captureConfig.sampleRate, voiceSegments);
+            LOGI("Kept %llu of %llu frames in %zu segments", static_cast<unsigned long long>(fileFrames),
+                 static_cast<unsigned long long>(capturedFrames), voiceSegments.size());
         }
     }
-};
 
-// Global instances
-static AudioRecorder* g_recorder = nullptr;
-static AudioPlayer* g_player = nullptr;
+    // Back to holding input for the next take, from now on
+    if (armed) {
+        armedBuffer.clear();
+        captureState = CaptureState::ARMED;
+    } else if (armedBuffer.getCapacityFrames() > 0) {
+        armedBuffer = PreRollBuffer();
+    }
+
+    LOGI("Recording stopped: %llu callbacks, longest %u us, jitter up to %u us, %llu blocks dropped, "
+         "writer lag up to %u us", static_cast<unsigned long long>(stats.getCallbackCount()),
+         stats.getDurations().getMaxUs(), stats.getJitter().getMaxUs(),
+         static_cast<unsigned long long>(stats.getDroppedBlocks()), stats.getMaxWriterLagUs());
+    return true;
+}
 
-extern "C" {
+void AudioRecorder::onCaptureBlock(const void* samples, size_t sampleCount) {
+    blockState = captureState.load(std::memory_order_acquire);
+    if (blockState == CaptureState::IDLE) return;
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_initializeRecorder(JNIEnv *env, jobject thiz) {
-    if (g_recorder == nullptr) {
-        g_recorder = new AudioRecorder();
+    AudioStats::CallbackTimer timer(stats, capturePeriodUs);
+    if (effects.beginBlock()) {
+        samples = applyEffects(samples, sampleCount);
+    }
+    if (activeTap.load(std::memory_order_relaxed) != nullptr) {
+        tapBlock(samples, sampleCount);
+    }
+    if (blockState == CaptureState::ARMED) {
+        // Disarmed since the state was read: the buffer may be going away
+        armedBlock.store(true);
+        if (captureState.load() == CaptureState::ARMED) {
+            (this->*captureHandler)(samples, sampleCount);
+        }
+        armedBlock.store(false, std::memory_order_release);
+        return;
     }
-    return g_recorder->initialize();
+
+    // Take stopped since the state was read: the writer may be closing
+    recordingBlock.store(true);
+    if (captureState.load() != CaptureState::RECORDING) {
+        recordingBlock.store(false, std::memory_order_release);
+        return;
+    }
+
+    startLatency.onCallback();
+    if (preRollPending.load(std::memory_order_relaxed) && preRollPending.exchange(false)) {
+        claimArmedBuffer();
+    }
+    (this->*captureHandler)(samples, sampleCount);
+
+    // Audio handed to the writer that has not reached the file yet
+    uint64_t pending = fileWriter->getSamplesPending();
+    stats.setWriterLag(static_cast<uint32_t>(pending * 1000000ull /
+                                             (static_cast<uint64_t>(captureConfig.sampleRate) * captureConfig.channels)));
+    recordingBlock.store(false, std::memory_order_release);
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_startRecording(JNIEnv *env, jobject thiz, jstring filePath) {
-    if (g_recorder == nullptr) {
-        LOGE("Recorder not initialized");
-        return false;
+void AudioRecorder::tapBlock(const void* samples, size_t sampleCount) {
+    // The samples go in as captured; a full tap drops the block and counts it
+    tapping.store(true);
+    PcmTap* tap = activeTap.load();
+    if (tap != nullptr) {
+        tap->write(samples, sampleCount);
     }
-    
-    const char* path = env->GetStringUTFChars(filePath, nullptr);
-    bool result = g_recorder->startRecording(std::string(path));
-    env->ReleaseStringUTFChars(filePath, path);
-    
-    return result;
+    tapping.store(false, std::memory_order_release);
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_stopRecording(JNIEnv *env, jobject thiz) {
-    if (g_recorder == nullptr) {
-        LOGE("Recorder not initialized");
-        return false;
+void AudioRecorder::analyzeBlock(const short* preview, size_t sampleCount) {
+    analyzing.store(true);
+    LiveSpectrogram* live = activeSpectrogram.load();
+    if (live != nullptr) {
+        live->write(preview, sampleCount);
     }
-    
-    return g_recorder->stopRecording();
+    analyzing.store(false, std::memory_order_release);
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_isRecording(JNIEnv *env, jobject thiz) {
-    if (g_recorder == nullptr) {
-        return false;
+void AudioRecorder::sizeBlockBuffers() {
+    // The effect buffers are there even with every effect off, as one may
+    // be switched on mid-take
+    size_t count = static_cast<size_t>(captureConfig.framesPerBuffer) * captureConfig.channels;
+    if (captureConfig.format != SampleFormat::INT16) {
+        previewBuffer.resize(count);
+    }
+    effectBuffer.resize(count);
+    if (captureConfig.format != SampleFormat::FLOAT32) {
+        effectOutput.resize(count * getBytesPerSample(captureConfig.format));
     }
-    
-    return g_recorder->isCurrentlyRecording();
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_initializePlayer(JNIEnv *env, jobject thiz) {
-    if (g_player == nullptr) {
-        g_player = new AudioPlayer();
+const void* AudioRecorder::applyEffects(const void* samples, size_t& sampleCount) {
+    sampleCount = std::min(sampleCount, effectBuffer.size());
+    size_t frames = sampleCount / captureConfig.channels;
+    switch (captureConfig.format) {
+        case SampleFormat::INT24_PACKED: {
+            Int24* out = reinterpret_cast<Int24*>(effectOutput.data());
+            convertSamples(static_cast<const Int24*>(samples), effectBuffer.data(), sampleCount);
+            effects.process(effectBuffer.data(), frames);
+            convertSamples(effectBuffer.data(), out, sampleCount);
+            return out;
+        }
+        case SampleFormat::FLOAT32: {
+            const float* in = static_cast<const float*>(samples);
+            std::copy(in, in + sampleCount, effectBuffer.begin());
+            effects.process(effectBuffer.data(), frames);
+            return effectBuffer.data();
+        }
+        default: {
+            short* out = reinterpret_cast<short*>(effectOutput.data());
+            convertSamples(static_cast<const short*>(samples), effectBuffer.data(), sampleCount);
+            effects.process(effectBuffer.data(), frames);
+            convertSamples(effectBuffer.data(), out, sampleCount);
+            return out;
+        }
     }
-    return g_player->initialize();
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_loadAudioFile(JNIEnv *env, jobject thiz, jstring filePath) {
-    if (g_player == nullptr) {
-        LOGE("Player not initialized");
-        return false;
+template <typename Sample>
+void AudioRecorder::captureBlock(const void* samples, size_t sampleCount) {
+    // The meter and the waveform index work on 16-bit samples
+    const short* preview;
+    if constexpr (std::is_same<Sample, short>::value) {
+        preview = static_cast<const short*>(samples);
+    } else {
+        sampleCount = std::min(sampleCount, previewBuffer.size());
+        convertSamples(static_cast<const Sample*>(samples), previewBuffer.data(), sampleCount);
+        preview = previewBuffer.data();
+    }
+
+    levelMeter.publish(preview, sampleCount);
+    if (activeSpectrogram.load(std::memory_order_relaxed) != nullptr) {
+        analyzeBlock(preview, sampleCount);
+    }
+
+    if (blockState == CaptureState::ARMED) {
+        armedBuffer.push(samples, preview, sampleCount / captureConfig.channels);
+    } else if (voiceConfig.enabled) {
+        gateBlock(samples, preview, sampleCount);
+    } else {
+        writeBlock(samples, preview, sampleCount);
     }
-    
-    const char* path = env->GetStringUTFChars(filePath, nullptr);
-    bool result = g_player->loadAudioFile(std::string(path));
-    env->ReleaseStringUTFChars(filePath, path);
-    
-    return result;
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_startPlayback(JNIEnv *env, jobject thiz) {
-    if (g_player == nullptr) {
-        LOGE("Player not initialized");
+bool AudioRecorder::writeBlock(const void* samples, const short* preview, size_t sampleCount) {
+    // Blocks the writer had to drop are left out of the preview as well;
+    // the file gets the samples in their captured format
+    if (!fileWriter->write(samples, sampleCount)) {
+        stats.onDroppedBlock();
         return false;
     }
-    
-    return g_player->startPlayback();
+    waveformIndex.addSamples(preview, sampleCount);
+    fileFrames += sampleCount / captureConfig.channels;
+    return true;
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_stopPlayback(JNIEnv *env, jobject thiz) {
-    if (g_player == nullptr) {
-        LOGE("Player not initialized");
-        return false;
+void AudioRecorder::claimArmedBuffer() {
+    size_t frames = armedBuffer.getFrameCount();
+    if (frames == 0) {
+        return;
     }
-    
-    return g_player->stopPlayback();
+
+    // The writer thread copies the held input into the file ahead of
+    // anything written from here on, reading it where it is; only the
+    // preview passes through here
+    fileWriter->setPrefix(&armedBuffer);
+    armedBuffer.read([this](const void*, const short* preview, size_t count) {
+        waveformIndex.addSamples(preview, count);
+    });
+    capturedFrames += frames;
+    fileFrames += frames;
+
+    // Gated, the held input opens the first kept stretch
+    if (voiceConfig.enabled) {
+        voiceSegments.push_back({0, 0, 0});
+        inVoiceSegment = true;
+    }
+}
+
+void AudioRecorder::gateBlock(const void* samples, const short* preview, size_t sampleCount) {
+    size_t frames = sampleCount / captureConfig.channels;
+
+    // The detector sees every block, so its noise floor keeps tracking
+    bool keep = voiceDetector.process(preview, sampleCount);
+    if (!keep && inVoiceSegment && voiceSegments.size() == MAX_VOICE_SEGMENTS) {
+        keep = true;
+    }
+
+    if (!keep) {
+        if (inVoiceSegment) {
+            closeVoiceSegment();
+        }
+        preRoll.push(samples, preview, frames);
+    } else {
+        if (!inVoiceSegment) {
+            // Starts with whatever pre-roll was held back
+            voiceSegments.push_back({capturedFrames - preRoll.getFrameCount(), fileFrames, 0});
+            inVoiceSegment = true;
+            preRoll.drain([this](const void* heldSamples, const short* heldPreview, size_t heldCount) {
+                writeBlock(heldSamples, heldPreview, heldCount);
+            });
+        }
+        writeBlock(samples, preview, sampleCount);
+    }
+    capturedFrames += frames;
+}
+
+void AudioRecorder::closeVoiceSegment() {
+    VoiceSegment& segment = voiceSegments.back();
+    segment.frameCount = fileFrames - segment.fileFrame;
+    inVoiceSegment = false;
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_isPlaying(JNIEnv *env, jobject thiz) {
-    if (g_player == nullptr) {
+PcmTap* AudioRecorder::openPcmTap(int capacityMs) {
+    if (capacityMs <= 0 || capacityMs > MAX_PCM_TAP_MS) {
+        LOGE("Invalid PCM tap length: %d ms", capacityMs);
+        return nullptr;
+    }
+
+    closePcmTap();
+    size_t samples = static_cast<size_t>(captureConfig.sampleRate) * captureConfig.channels * capacityMs / 1000;
+    pcmTap.reset(new PcmTap(captureConfig.sampleRate, captureConfig.channels, captureConfig.format, samples));
+    activeTap.store(pcmTap.get());
+
+    LOGI("PCM tap open: %zu samples", pcmTap->getCapacity());
+    return pcmTap.get();
+}
+
+void AudioRecorder::closePcmTap() {
+    if (pcmTap == nullptr) {
+        return;
+    }
+
+    activeTap.store(nullptr);
+    while (tapping.load()) {
+        std::this_thread::yield();
+    }
+    pcmTap.reset();
+}
+
+bool AudioRecorder::openSpectrogram(int fftSize, int hopSize) {
+    if (fftSize <= 0 || hopSize <= 0 || !StftAnalyzer::isValid(fftSize, hopSize)) {
+        LOGE("Invalid spectrogram: FFT size %d, hop %d", fftSize, hopSize);
         return false;
     }
-    
-    return g_player->isCurrentlyPlaying();
+
+    closeSpectrogram();
+    size_t capacityFrames =
+        std::max<size_t>(static_cast<size_t>(captureConfig.sampleRate) * SPECTROGRAM_BACKLOG_MS / 1000 / hopSize, 1);
+    spectrogram.reset(new LiveSpectrogram(fftSize, hopSize, captureConfig.channels, capacityFrames));
+    activeSpectrogram.store(spectrogram.get());
+
+    LOGI("Spectrogram open: FFT size %d, hop %d, %zu frames held", fftSize, hopSize, capacityFrames);
+    return true;
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_audiorecordingapp_AudioRecorderNative_cleanup(JNIEnv *env, jobject thiz) {
-    if (g_recorder != nullptr) {
-        delete g_recorder;
-        g_recorder = nullptr;
+void AudioRecorder::closeSpectrogram() {
+    if (spectrogram == nullptr) {
+        return;
     }
-    
-    if (g_player != nullptr) {
-        delete g_player;
-        g_player = nullptr;
+
+    activeSpectrogram.store(nullptr);
+    while (analyzing.load()) {
+        std::this_thread::yield();
     }
+    spectrogram.reset();
 }
 
+void AudioRecorder::cleanup() {
+    if (isRecording) {
+        stopRecording();
+    }
+    disarm();
+    closePcmTap();
+    closeSpectrogram();
+
+    if (captureOpen) {
+        backend.closeCapture();
+        captureOpen = false;
+    }
 }
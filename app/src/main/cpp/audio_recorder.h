@@ -0,0 +1,278 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_RECORDER_H
+#define AUDIORECORDINGAPP_AUDIO_RECORDER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_stats.h"
+#include "audio_file_writer.h"
+#include "effect_chain.h"
+#include "flac_writer.h"
+#include "level_meter.h"
+#include "pcm_tap.h"
+#include "pre_roll_buffer.h"
+#include "spectrogram.h"
+#include "start_latency_probe.h"
+#include "voice_activity.h"
+#include "waveform_index.h"
+#include "wav_writer.h"
+
+// Records from an AudioBackend capture stream straight into a WAV or FLAC
+// file, at any sample rate, mono or stereo, as 16-bit, packed 24-bit or
+// float samples. Each sample type has its own compiled capture path.
+// The stream is opened on the first take and kept open between takes, so
+// only a change of capture config pays for rebuilding it.
+//
+// With voice activity detection on, silent blocks are left out of the file
+// as they arrive; each kept stretch, with its pre-roll and hangover, is
+// listed with its original timing in a sidecar next to the take.
+//
+// Armed, the stream keeps running between takes and the last few seconds
+// of input are held in a circular buffer; a take started then begins with
+// them, with no gap before its first block and no device to open.
+//
+// A PcmTap, when open, gets every captured block as it arrives, armed or
+// recording, for live consumers outside the native code. A
+// LiveSpectrogram, when open, analyzes the same blocks as they arrive.
+//
+// WAV takes are committed every COMMIT_INTERVAL_MS of audio, so a take cut
+// short by the process dying can be finished with recoverTakes() on the
+// next launch, losing at most the audio since the last commit.
+//
+// Capture effects, when any are on, run on each block before anything
+// else sees it: the meter, the tap, the held input and the file all get
+// the processed audio. They can be changed at any time, mid-take included.
+class AudioRecorder : private AudioCaptureCallback {
+private:
+    AudioBackend& backend;
+
+    std::atomic<bool> isRecording{false};
+    std::string outputFilePath;
+
+    static const int DEFAULT_SAMPLE_RATE = 44100;
+    static const int DEFAULT_CHANNELS = 1;
+    static const int MIN_SAMPLE_RATE = 8000;
+    static const int MAX_SAMPLE_RATE = 192000;
+    static const int DEFAULT_BUFFER_COUNT = 4;
+    static const int DEFAULT_FRAMES_PER_BUFFER = 1024;
+    static const int MIN_BUFFER_COUNT = 2;
+    static const int MAX_BUFFER_COUNT = 16;
+    static const int MIN_FRAMES_PER_BUFFER = 64;
+    static const int MAX_FRAMES_PER_BUFFER = 16384;
+    static const int MAX_VOICE_HANGOVER_MS = 5000;
+    static const int MAX_VOICE_PRE_ROLL_MS = 2000;
+    // Segments are reserved up front; the last one runs to the end of the
+    // take once they are used up
+    static const size_t MAX_VOICE_SEGMENTS = 4096;
+    static const int MAX_ARMED_PRE_ROLL_MS = 30000;
+    static const int MAX_PCM_TAP_MS = 60000;
+    // Spectrogram frames held for a reader that falls behind
+    static const int SPECTROGRAM_BACKLOG_MS = 2000;
+    // One sync and a header write per commit
+    static const int COMMIT_INTERVAL_MS = 2000;
+    static const int MIN_HIGH_PASS_HZ = 10;
+    static const int MAX_HIGH_PASS_HZ = 1000;
+
+    // The backend queues bufferCount buffers of framesPerBuffer frames and
+    // re-queues each one as soon as we have copied it out
+    AudioStreamConfig captureConfig;
+    bool captureOpen = false;
+
+    // What the capture callback does with each block: nothing, hold it
+    // while armed, or record it. The callback reads it once per block.
+    enum class CaptureState {
+        IDLE,
+        ARMED,
+        RECORDING,
+    };
+    std::atomic<CaptureState> captureState{CaptureState::IDLE};
+    CaptureState blockState = CaptureState::IDLE;
+
+    // Input held between takes while armed. A take claims it once, from
+    // its first callback or, failing that, from stopRecording(); the file
+    // writer then copies it straight into the file ahead of the first block.
+    std::atomic<bool> armed{false};
+    PreRollBuffer armedBuffer;
+    std::atomic<bool> preRollPending{false};
+
+    // Marked by the capture callback around the recording path and checked
+    // against |captureState| once marked, the way |tapping| guards the tap:
+    // stopRecording() publishes IDLE and waits for it to clear before it
+    // closes the writer, so no block that saw RECORDING is still writing.
+    std::atomic<bool> recordingBlock{false};
+
+    // The same for the armed path: disarm(), re-arm() and stopRecording()
+    // wait for it before the held input is freed, resized or claimed.
+    std::atomic<bool> armedBlock{false};
+
+    // Live tap, when open. The capture callback marks |tapping| before it
+    // looks at |activeTap|, so a tap seen unmarked after being unpublished
+    // is no longer in use and can be freed.
+    std::unique_ptr<PcmTap> pcmTap;
+    std::atomic<PcmTap*> activeTap{nullptr};
+    std::atomic<bool> tapping{false};
+
+    // Live spectrogram, when open; handed over the same way as the tap
+    std::unique_ptr<LiveSpectrogram> spectrogram;
+    std::atomic<LiveSpectrogram*> activeSpectrogram{nullptr};
+    std::atomic<bool> analyzing{false};
+
+    // Capture path for the configured sample type
+    using CaptureHandler = void (AudioRecorder::*)(const void* samples, size_t sampleCount);
+    CaptureHandler captureHandler = nullptr;
+
+    // 16-bit copy of each block for the meter and the waveform index, when
+    // capturing in another sample format
+    std::vector<short> previewBuffer;
+
+    // The device's buffer is only lent to the callback, so effects run on a
+    // float copy, converted back into |effectOutput| in the capture format
+    EffectChain effects{DEFAULT_SAMPLE_RATE, DEFAULT_CHANNELS};
+    std::vector<float> effectBuffer;
+    std::vector<uint8_t> effectOutput;
+
+    // One writer per output format; fileWriter points at the one in use
+    WavWriter wavWriter{DEFAULT_SAMPLE_RATE, DEFAULT_CHANNELS, SampleFormat::INT16};
+    FlacWriter flacWriter{DEFAULT_SAMPLE_RATE, DEFAULT_CHANNELS};
+    AudioFileWriter* fileWriter = &wavWriter;
+    // Preview peaks, saved next to the WAV when the take ends
+    WaveformIndex waveformIndex{DEFAULT_SAMPLE_RATE, DEFAULT_CHANNELS};
+    StartLatencyProbe startLatency;
+    LevelMeter levelMeter;
+    AudioStats stats;
+    uint32_t capturePeriodUs = 0;
+
+    // Silence gating, when enabled
+    VoiceActivityConfig voiceConfig;
+    VoiceActivityDetector voiceDetector{DEFAULT_SAMPLE_RATE, DEFAULT_CHANNELS};
+    PreRollBuffer preRoll;
+    std::vector<VoiceSegment> voiceSegments;
+    bool inVoiceSegment = false;
+    // Frames captured this take, and frames that made it into the file
+    uint64_t capturedFrames = 0;
+    uint64_t fileFrames = 0;
+
+public:
+    explicit AudioRecorder(AudioBackend& backend);
+    ~AudioRecorder() override;
+
+    AudioRecorder(const AudioRecorder&) = delete;
+    AudioRecorder& operator=(const AudioRecorder&) = delete;
+
+    bool initialize();
+    bool configureCapture(int bufferCount, int framesPerBuffer);
+    // FLAC output needs SampleFormat::INT16
+    bool configureFormat(int sampleRate, int channels, SampleFormat format);
+    // Only between takes
+    bool configureVoiceActivity(const VoiceActivityConfig& config);
+    // Any time, from any thread but the audio thread; the next block on
+    // uses the new settings
+    bool setEffects(const EffectSettings& settings);
+
+    // Starts the capture stream and keeps the last |preRollMs| of input
+    // until the next take, which starts with it. Only between takes; the
+    // format and capture config are fixed until disarm().
+    bool arm(int preRollMs);
+    // Stops holding input between takes; a take in progress carries on
+    void disarm();
+
+    bool isArmed() const {
+        return armed;
+    }
+
+    // Opens a tap holding up to |capacityMs| of input in the current
+    // capture format, replacing any open one; null if |capacityMs| is out
+    // of range. The format is fixed while it is open. Any thread but the
+    // audio thread.
+    PcmTap* openPcmTap(int capacityMs);
+    // Returns once the audio thread is done with the tap, which is freed
+    void closePcmTap();
+
+    PcmTap* getPcmTap() {
+        return pcmTap.get();
+    }
+
+    // Opens a live spectrogram of the capture, mixed down to mono, with a
+    // window of |fftSize| frames every |hopSize|, replacing any open one.
+    // The format is fixed while it is open. Any thread but the audio thread.
+    bool openSpectrogram(int fftSize, int hopSize);
+    // Returns once the audio thread is done with it, and frees it
+    void closeSpectrogram();
+
+    LiveSpectrogram* getSpectrogram() {
+        return spectrogram.get();
+    }
+
+    bool startRecording(const std::string& filePath, AudioFileFormat format = AudioFileFormat::WAV);
+    bool stopRecording();
+
+    bool isCurrentlyRecording() const {
+        return isRecording;
+    }
+
+    // A block reaches us once its buffer is full, so input latency is one
+    // buffer period regardless of queue depth
+    float getInputLatencyMs() const {
+        return 1000.0f * captureConfig.framesPerBuffer / captureConfig.sampleRate;
+    }
+
+    // How long a callback can stall before the device runs out of buffers
+    float getCaptureHeadroomMs() const {
+        return 1000.0f * (captureConfig.bufferCount - 1) * captureConfig.framesPerBuffer /
+               captureConfig.sampleRate;
+    }
+
+    const AudioStreamConfig& getCaptureConfig() const {
+        return captureConfig;
+    }
+
+    const StartLatencyProbe& getStartLatency() const {
+        return startLatency;
+    }
+
+    // Callback timings, dropped blocks and writer lag for the current or
+    // most recent take
+    const AudioStats& getStats() const {
+        return stats;
+    }
+
+    // Writer for the current or most recent take
+    const AudioFileWriter& getFileWriter() const {
+        return *fileWriter;
+    }
+
+    LevelMeter& getLevelMeter() {
+        return levelMeter;
+    }
+
+    const WaveformIndex& getWaveformIndex() const {
+        return waveformIndex;
+    }
+
+    // Kept stretches of the current or most recent take, when gating
+    const std::vector<VoiceSegment>& getVoiceSegments() const {
+        return voiceSegments;
+    }
+
+private:
+    void onCaptureBlock(const void* samples, size_t sampleCount) override;
+    void tapBlock(const void* samples, size_t sampleCount);
+    void analyzeBlock(const short* preview, size_t sampleCount);
+    const void* applyEffects(const void* samples, size_t& sampleCount);
+    void sizeBlockBuffers();
+
+    template <typename Sample>
+    void captureBlock(const void* samples, size_t sampleCount);
+
+    bool writeBlock(const void* samples, const short* preview, size_t sampleCount);
+    void claimArmedBuffer();
+    void gateBlock(const void* samples, const short* preview, size_t sampleCount);
+    void closeVoiceSegment();
+
+    void cleanup();
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_RECORDER_H
@@ -0,0 +1,1210 @@
+#include <jni.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "audio_mixer.h"
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "batch_job.h"
+#include "edit_list.h"
+#include "opensl_backend.h"
+#include "spectrogram.h"
+#include "take_recovery.h"
+#include "voice_activity.h"
+#include "waveform_index.h"
+#include "wav_probe.h"
+
+#define LOG_TAG "AudioRecorder"
+#include "audio_log.h"
+
+// Global instances
+static OpenSlBackend* g_backend = nullptr;
+static AudioRecorder* g_recorder = nullptr;
+static AudioMixer* g_mixer = nullptr;
+static BatchJob* g_batchJob = nullptr;
+
+// A player and its place in the mix. Java holds a handle, the index plus
+// one; calls look the session up and keep it alive while they use it, so a
+// release from another thread cannot pull it out from under them.
+struct PlayerSession {
+    std::unique_ptr<AudioMixer::Input> input;
+    std::unique_ptr<AudioPlayer> player;
+};
+
+static std::mutex g_sessionsMutex;
+static std::shared_ptr<PlayerSession> g_sessions[AudioMixer::MAX_INPUTS];
+
+static std::shared_ptr<PlayerSession> findSession(jint handle) {
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    if (handle < 1 || handle > static_cast<jint>(AudioMixer::MAX_INPUTS)) {
+        return nullptr;
+    }
+    return g_sessions[handle - 1];
+}
+
+// Edit lists Java holds by handle, the index plus one. Edits are quick, so
+// one lock covers the table and every list; rendering and playback work
+// on a copy taken under it.
+static const size_t MAX_EDIT_LISTS = 32;
+static std::mutex g_editListsMutex;
+static std::unique_ptr<EditList> g_editLists[MAX_EDIT_LISTS];
+
+// Caller holds g_editListsMutex
+static EditList* findEditList(jint handle) {
+    if (handle < 1 || handle > static_cast<jint>(MAX_EDIT_LISTS)) {
+        return nullptr;
+    }
+    return g_editLists[handle - 1].get();
+}
+
+// Caller holds g_editListsMutex; 0 when every slot is taken
+static jint addEditList(std::unique_ptr<EditList> list) {
+    for (size_t i = 0; i < MAX_EDIT_LISTS; i++) {
+        if (g_editLists[i] != nullptr) continue;
+        g_editLists[i] = std::move(list);
+        return static_cast<jint>(i + 1);
+    }
+    LOGE("All %zu edit lists are in use", MAX_EDIT_LISTS);
+    return 0;
+}
+
+// Milliseconds to frames of the list; negative means none
+static uint64_t editFrames(const EditList& list, jlong ms) {
+    return ms > 0 ? static_cast<uint64_t>(ms) * list.getSampleRate() / 1000 : 0;
+}
+
+// Passes queue transitions on to a Kotlin PlaybackQueueListener. The
+// player calls it from its queue thread, which is attached to the VM only
+// for the length of each call.
+class JniQueueListener : public AudioPlayer::QueueListener {
+public:
+    JniQueueListener(JNIEnv* env, jobject listener) {
+        env->GetJavaVM(&vm);
+        target = env->NewGlobalRef(listener);
+        jclass type = env->GetObjectClass(listener);
+        trackStarted = env->GetMethodID(type, "onTrackStarted", "(I)V");
+        queueFinished = env->GetMethodID(type, "onQueueFinished", "()V");
+        env->DeleteLocalRef(type);
+    }
+
+    ~JniQueueListener() override {
+        withEnv([this](JNIEnv* env) { env->DeleteGlobalRef(target); });
+    }
+
+    void onTrackStarted(size_t index) override {
+        withEnv([this, index](JNIEnv* env) { env->CallVoidMethod(target, trackStarted, static_cast<jint>(index)); });
+    }
+
+    void onQueueFinished() override {
+        withEnv([this](JNIEnv* env) { env->CallVoidMethod(target, queueFinished); });
+    }
+
+private:
+    JavaVM* vm = nullptr;
+    jobject target = nullptr;
+    jmethodID trackStarted = nullptr;
+    jmethodID queueFinished = nullptr;
+
+    template <typename Call>
+    void withEnv(Call call) {
+        JNIEnv* env = nullptr;
+        bool attached = false;
+        if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+            if (vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+                LOGE("Could not attach the queue thread");
+                return;
+            }
+            attached = true;
+        }
+        call(env);
+        // A throwing listener must not leave the exception pending
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+        }
+        if (attached) {
+            vm->DetachCurrentThread();
+        }
+    }
+};
+
+// Meter values returned by get*Levels: peak, rms, clip count, block count
+static const int LEVEL_FIELDS = 4;
+
+// From a meter's shared words, wherever they came from
+static jboolean readLevels(JNIEnv* env, const void* sharedWords, jfloatArray out) {
+    LevelSnapshot snapshot;
+    if (!LevelMeter::readShared(sharedWords, snapshot)) {
+        return false;
+    }
+    
+    float levels[LEVEL_FIELDS] = {snapshot.peak, snapshot.rms,
+                                  static_cast<float>(snapshot.clipCount),
+                                  static_cast<float>(snapshot.blockCount)};
+    env->SetFloatArrayRegion(out, 0, LEVEL_FIELDS, levels);
+    return true;
+}
+
+// Fields per file in the packed probeWavFiles result, in this order
+static const int PROBE_FIELDS = 5;
+
+// Fields per file in getBatchResults: status, loudness, gain, sample peak
+static const int BATCH_FIELDS = 4;
+
+// Null entries come back as empty strings
+static std::vector<std::string> toStringVector(JNIEnv* env, jobjectArray array) {
+    jsize count = array != nullptr ? env->GetArrayLength(array) : 0;
+    std::vector<std::string> strings(count);
+    for (jsize i = 0; i < count; i++) {
+        auto string = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+        if (string != nullptr) {
+            const char* chars = env->GetStringUTFChars(string, nullptr);
+            strings[i] = chars;
+            env->ReleaseStringUTFChars(string, chars);
+            env->DeleteLocalRef(string);
+        }
+    }
+    return strings;
+}
+
+static AudioBackend& getBackend() {
+    if (g_backend == nullptr) {
+        g_backend = new OpenSlBackend();
+    }
+    return *g_backend;
+}
+
+extern "C" {
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_initializeRecorder(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        g_recorder = new AudioRecorder(getBackend());
+    }
+    return g_recorder->initialize();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_configureRecorder(JNIEnv *env, jobject thiz,
+                                                                         jint bufferCount,
+                                                                         jint framesPerBuffer) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    return g_recorder->configureCapture(bufferCount, framesPerBuffer);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_configureRecorderFormat(JNIEnv *env, jobject thiz,
+                                                                               jint sampleRate,
+                                                                               jint channels,
+                                                                               jint sampleFormat) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    if (!isValidSampleFormat(sampleFormat)) {
+        LOGE("Unknown sample format: %d", sampleFormat);
+        return false;
+    }
+    
+    return g_recorder->configureFormat(sampleRate, channels, static_cast<SampleFormat>(sampleFormat));
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_configureVoiceActivity(JNIEnv *env, jobject thiz,
+                                                                              jboolean enabled,
+                                                                              jfloat thresholdDb,
+                                                                              jint hangoverMs,
+                                                                              jint preRollMs) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    VoiceActivityConfig config;
+    config.enabled = enabled;
+    config.thresholdDb = thresholdDb;
+    config.hangoverMs = hangoverMs;
+    config.preRollMs = preRollMs;
+    return g_recorder->configureVoiceActivity(config);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setCaptureEffects(JNIEnv *env, jobject thiz,
+                                                                         jfloat highPassHz,
+                                                                         jboolean gateEnabled,
+                                                                         jfloat gateThresholdDb,
+                                                                         jboolean agcEnabled,
+                                                                         jfloat agcTargetDb,
+                                                                         jfloat agcMaxGainDb,
+                                                                         jboolean limiterEnabled,
+                                                                         jfloat limiterCeilingDb) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    EffectSettings settings;
+    settings.highPassHz = highPassHz;
+    settings.gateEnabled = gateEnabled;
+    settings.gateThresholdDb = gateThresholdDb;
+    settings.agcEnabled = agcEnabled;
+    settings.agcTargetDb = agcTargetDb;
+    settings.agcMaxGainDb = agcMaxGainDb;
+    settings.limiterEnabled = limiterEnabled;
+    settings.limiterCeilingDb = limiterCeilingDb;
+    return g_recorder->setEffects(settings);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_armRecorder(JNIEnv *env, jobject thiz, jint preRollMs) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    return g_recorder->arm(preRollMs);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_disarmRecorder(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return;
+    }
+    
+    g_recorder->disarm();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_isRecorderArmed(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return false;
+    }
+    
+    return g_recorder->isArmed();
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getInputLatencyMs(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return 0.0f;
+    }
+    
+    return g_recorder->getInputLatencyMs();
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getRecordStartLatency(JNIEnv *env, jobject thiz) {
+    float latency[3] = {0.0f, 0.0f, 0.0f};
+    if (g_recorder != nullptr) {
+        g_recorder->getStartLatency().snapshot(latency);
+    }
+    
+    jfloatArray result = env->NewFloatArray(3);
+    env->SetFloatArrayRegion(result, 0, 3, latency);
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_startRecording(JNIEnv *env, jobject thiz,
+                                                                      jstring filePath, jint format) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    if (format != static_cast<jint>(AudioFileFormat::WAV) && format != static_cast<jint>(AudioFileFormat::FLAC)) {
+        LOGE("Unknown output format: %d", format);
+        return false;
+    }
+    
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    bool result = g_recorder->startRecording(std::string(path), static_cast<AudioFileFormat>(format));
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_stopRecording(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    return g_recorder->stopRecording();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_isRecording(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return false;
+    }
+    
+    return g_recorder->isCurrentlyRecording();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getRecordLevels(JNIEnv *env, jobject thiz,
+                                                                       jfloatArray levels) {
+    if (g_recorder == nullptr) {
+        return false;
+    }
+    
+    return readLevels(env, g_recorder->getLevelMeter().getSharedWords(), levels);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_readLevelWords(JNIEnv *env, jclass clazz,
+                                                                      jobject buffer, jfloatArray levels) {
+    void* words = env->GetDirectBufferAddress(buffer);
+    if (words == nullptr || env->GetDirectBufferCapacity(buffer) < static_cast<jlong>(LevelMeter::getSharedSize())) {
+        return false;
+    }
+    
+    return readLevels(env, words, levels);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getRecordLevelWords(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return nullptr;
+    }
+    
+    LevelMeter& meter = g_recorder->getLevelMeter();
+    return env->NewDirectByteBuffer(meter.getSharedWords(), LevelMeter::getSharedSize());
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_openPcmTapBuffer(JNIEnv *env, jobject thiz, jint capacityMs) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return nullptr;
+    }
+    
+    PcmTap* tap = g_recorder->openPcmTap(capacityMs);
+    if (tap == nullptr) {
+        return nullptr;
+    }
+    return env->NewDirectByteBuffer(tap->getSharedMemory(), tap->getSharedSize());
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_closePcmTapBuffer(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return;
+    }
+    
+    g_recorder->closePcmTap();
+}
+
+// Only from PcmTap.read(), which holds the tap open until this returns
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_readPcmTapSamples(JNIEnv *env, jclass clazz,
+                                                                         jbyteArray out) {
+    PcmTap* tap = g_recorder != nullptr ? g_recorder->getPcmTap() : nullptr;
+    if (tap == nullptr) {
+        return 0;
+    }
+    
+    size_t bytesPerSample = tap->getSampleSize();
+    size_t maxSamples = static_cast<size_t>(env->GetArrayLength(out)) / bytesPerSample;
+    void* bytes = env->GetPrimitiveArrayCritical(out, nullptr);
+    if (bytes == nullptr) {
+        return 0;
+    }
+    size_t count = tap->read(bytes, maxSamples);
+    env->ReleasePrimitiveArrayCritical(out, bytes, 0);
+    return static_cast<jint>(count * bytesPerSample);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_openSpectrogram(JNIEnv *env, jobject thiz,
+                                                                       jint fftSize, jint hopSize) {
+    if (g_recorder == nullptr) {
+        LOGE("Recorder not initialized");
+        return false;
+    }
+    
+    return g_recorder->openSpectrogram(fftSize, hopSize);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_readSpectrogram(JNIEnv *env, jobject thiz,
+                                                                       jbyteArray out) {
+    if (g_recorder == nullptr) {
+        return 0;
+    }
+    
+    LiveSpectrogram* spectrogram = g_recorder->getSpectrogram();
+    if (spectrogram == nullptr) {
+        return 0;
+    }
+    
+    // Only whole frames, straight into the array
+    size_t maxFrames = static_cast<size_t>(env->GetArrayLength(out)) / spectrogram->getBinCount();
+    if (maxFrames == 0) {
+        return 0;
+    }
+    void* bytes = env->GetPrimitiveArrayCritical(out, nullptr);
+    if (bytes == nullptr) {
+        return 0;
+    }
+    size_t frames = spectrogram->read(static_cast<uint8_t*>(bytes), maxFrames);
+    env->ReleasePrimitiveArrayCritical(out, bytes, 0);
+    return static_cast<jint>(frames);
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_closeSpectrogram(JNIEnv *env, jobject thiz) {
+    if (g_recorder == nullptr) {
+        return;
+    }
+    
+    g_recorder->closeSpectrogram();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_initializePlayer(JNIEnv *env, jobject thiz) {
+    if (g_mixer == nullptr) {
+        g_mixer = new AudioMixer(getBackend());
+    }
+    return g_mixer->initialize();
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_createPlayer(JNIEnv *env, jobject thiz) {
+    if (g_mixer == nullptr) {
+        LOGE("Player not initialized");
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    for (size_t i = 0; i < AudioMixer::MAX_INPUTS; i++) {
+        if (g_sessions[i] != nullptr) continue;
+        
+        std::unique_ptr<AudioMixer::Input> input = g_mixer->createInput();
+        if (input == nullptr) {
+            return 0;
+        }
+        auto session = std::make_shared<PlayerSession>();
+        session->player.reset(new AudioPlayer(*input));
+        session->input = std::move(input);
+        session->player->setOutputSampleRate(g_mixer->getOutputSampleRate());
+        g_sessions[i] = session;
+        return static_cast<jint>(i + 1);
+    }
+    
+    LOGE("All %zu players are in use", AudioMixer::MAX_INPUTS);
+    return 0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_releasePlayerNative(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session;
+    {
+        std::lock_guard<std::mutex> lock(g_sessionsMutex);
+        if (handle < 1 || handle > static_cast<jint>(AudioMixer::MAX_INPUTS) || g_sessions[handle - 1] == nullptr) {
+            LOGE("Unknown player: %d", handle);
+            return;
+        }
+        session.swap(g_sessions[handle - 1]);
+    }
+    
+    // Stopped and closed here unless a call on another thread still holds it
+    session.reset();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_loadAudioFile(JNIEnv *env, jobject thiz, jint handle,
+                                                                     jstring filePath) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    bool result = session->player->loadAudioFile(std::string(path));
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setPlaybackSampleRate(JNIEnv *env, jobject thiz, jint sampleRate) {
+    if (g_mixer == nullptr) {
+        LOGE("Player not initialized");
+        return false;
+    }
+    
+    if (!g_mixer->setOutputSampleRate(sampleRate)) {
+        return false;
+    }
+    
+    // Every player resamples to the mix
+    std::lock_guard<std::mutex> lock(g_sessionsMutex);
+    for (const std::shared_ptr<PlayerSession>& session : g_sessions) {
+        if (session != nullptr) {
+            session->player->setOutputSampleRate(sampleRate);
+        }
+    }
+    return true;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setPlayerGain(JNIEnv *env, jobject thiz, jint handle,
+                                                                     jfloat gain) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    session->input->setGain(gain);
+    return true;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setPlaybackSpeed(JNIEnv *env, jobject thiz, jint handle,
+                                                                        jfloat speed) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    return session->player->setPlaybackSpeed(speed);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_startPlayback(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    return session->player->startPlayback();
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPlayStartLatency(JNIEnv *env, jobject thiz, jint handle) {
+    float latency[3] = {0.0f, 0.0f, 0.0f};
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session != nullptr) {
+        session->player->getStartLatency().snapshot(latency);
+    }
+    
+    jfloatArray result = env->NewFloatArray(3);
+    env->SetFloatArrayRegion(result, 0, 3, latency);
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPlayLevels(JNIEnv *env, jobject thiz, jint handle,
+                                                                     jfloatArray levels) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        return false;
+    }
+    
+    return readLevels(env, session->player->getLevelMeter().getSharedWords(), levels);
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPlayLevelWords(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        return nullptr;
+    }
+    
+    LevelMeter& meter = session->player->getLevelMeter();
+    return env->NewDirectByteBuffer(meter.getSharedWords(), LevelMeter::getSharedSize());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_stopPlayback(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    return session->player->stopPlayback();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_seekTo(JNIEnv *env, jobject thiz, jint handle,
+                                                              jlong positionMs) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", handle);
+        return false;
+    }
+    
+    return session->player->seekTo(positionMs);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPositionMs(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        return 0;
+    }
+    
+    return session->player->getPositionMs();
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getDurationMs(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        return 0;
+    }
+    
+    return session->player->getDurationMs();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_isPlaying(JNIEnv *env, jobject thiz, jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session == nullptr) {
+        return false;
+    }
+    
+    return session->player->isCurrentlyPlaying();
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPlayerStats(JNIEnv *env, jobject thiz, jint handle) {
+    // The player's own render calls and starved blocks; all zero for an
+    // unknown handle
+    jlong packed[AudioStats::PACKED_SIZE] = {};
+    std::shared_ptr<PlayerSession> session = findSession(handle);
+    if (session != nullptr) {
+        session->player->getStats().snapshot(packed);
+    }
+    
+    jlongArray result = env->NewLongArray(AudioStats::PACKED_SIZE);
+    env->SetLongArrayRegion(result, 0, AudioStats::PACKED_SIZE, packed);
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getStats(JNIEnv *env, jobject thiz) {
+    // Recorder then the mixer's device stream, AudioStats::PACKED_SIZE
+    // each; all zero for whichever has not been initialized
+    jlong packed[2 * AudioStats::PACKED_SIZE] = {};
+    if (g_recorder != nullptr) {
+        g_recorder->getStats().snapshot(packed);
+    }
+    if (g_mixer != nullptr) {
+        g_mixer->getStats().snapshot(packed + AudioStats::PACKED_SIZE);
+    }
+    
+    jlongArray result = env->NewLongArray(2 * AudioStats::PACKED_SIZE);
+    env->SetLongArrayRegion(result, 0, 2 * AudioStats::PACKED_SIZE, packed);
+    return result;
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_recoverRecordings(JNIEnv *env, jobject thiz,
+                                                                         jstring directory) {
+    // The take being recorded has its marker too
+    std::vector<std::string> recovered;
+    if (g_recorder != nullptr && g_recorder->isCurrentlyRecording()) {
+        LOGE("Cannot recover takes while recording");
+    } else {
+        const char* chars = env->GetStringUTFChars(directory, nullptr);
+        recoverTakes(std::string(chars), recovered);
+        env->ReleaseStringUTFChars(directory, chars);
+    }
+    
+    jobjectArray result = env->NewObjectArray(static_cast<jsize>(recovered.size()),
+                                              env->FindClass("java/lang/String"), nullptr);
+    for (size_t i = 0; i < recovered.size(); i++) {
+        jstring path = env->NewStringUTF(recovered[i].c_str());
+        env->SetObjectArrayElement(result, static_cast<jsize>(i), path);
+        env->DeleteLocalRef(path);
+    }
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_probeWavFiles(JNIEnv *env, jobject thiz,
+                                                                     jobjectArray filePaths) {
+    std::vector<std::string> paths = toStringVector(env, filePaths);
+    jsize count = static_cast<jsize>(paths.size());
+    
+    // [sampleRate, channels, bitsPerSample, frameCount, durationMs] per file,
+    // all zero when the file could not be read as WAV
+    std::vector<jlong> packed(static_cast<size_t>(count) * PROBE_FIELDS, 0);
+    std::vector<WavProbeResult> results = probeWavFiles(paths);
+    for (size_t i = 0; i < results.size(); i++) {
+        if (!results[i].valid) continue;
+        const WavInfo& info = results[i].info;
+        jlong* fields = &packed[i * PROBE_FIELDS];
+        fields[0] = info.sampleRate;
+        fields[1] = info.channels;
+        fields[2] = info.bitsPerSample;
+        fields[3] = static_cast<jlong>(info.frameCount);
+        fields[4] = getWavDurationMs(info);
+    }
+    
+    jlongArray result = env->NewLongArray(static_cast<jsize>(packed.size()));
+    env->SetLongArrayRegion(result, 0, static_cast<jsize>(packed.size()), packed.data());
+    return result;
+}
+
+JNIEXPORT jshortArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getWaveform(JNIEnv *env, jobject thiz,
+                                                                   jstring filePath, jint level) {
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    std::string sidecarPath = WaveformIndex::getSidecarPath(path);
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    // {min, max, rms} per bin; empty when the recording has no sidecar
+    std::vector<PeakBin> bins;
+    WaveformIndex::loadLevel(sidecarPath, level, bins);
+    
+    jsize length = static_cast<jsize>(bins.size() * 3);
+    jshortArray result = env->NewShortArray(length);
+    static_assert(sizeof(PeakBin) == 3 * sizeof(jshort), "PeakBin must be three packed shorts");
+    env->SetShortArrayRegion(result, 0, length, reinterpret_cast<const jshort*>(bins.data()));
+    return result;
+}
+
+JNIEXPORT jbyteArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_analyzeSpectrogram(JNIEnv *env, jobject thiz,
+                                                                          jstring filePath, jint fftSize,
+                                                                          jint columns) {
+    if (fftSize <= 0 || columns <= 0) {
+        LOGE("Invalid spectrogram: FFT size %d, %d columns", fftSize, columns);
+        return nullptr;
+    }
+    
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    std::vector<uint8_t> frames;
+    bool analyzed = analyzeSpectrogram(std::string(path), fftSize, columns, frames);
+    env->ReleaseStringUTFChars(filePath, path);
+    if (!analyzed) {
+        return nullptr;
+    }
+    
+    jsize length = static_cast<jsize>(frames.size());
+    jbyteArray result = env->NewByteArray(length);
+    env->SetByteArrayRegion(result, 0, length, reinterpret_cast<const jbyte*>(frames.data()));
+    return result;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getVoiceSegments(JNIEnv *env, jobject thiz,
+                                                                        jstring filePath) {
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    std::string cuesPath = getVoiceSegmentsPath(path);
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    // {captureFrame, fileFrame, frameCount} per kept segment; empty when
+    // the recording was not gated
+    std::vector<VoiceSegment> segments;
+    loadVoiceSegments(cuesPath, segments);
+    
+    std::vector<jlong> packed;
+    packed.reserve(segments.size() * 3);
+    for (const VoiceSegment& segment : segments) {
+        packed.push_back(static_cast<jlong>(segment.captureFrame));
+        packed.push_back(static_cast<jlong>(segment.fileFrame));
+        packed.push_back(static_cast<jlong>(segment.frameCount));
+    }
+    
+    jlongArray result = env->NewLongArray(static_cast<jsize>(packed.size()));
+    env->SetLongArrayRegion(result, 0, static_cast<jsize>(packed.size()), packed.data());
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_startBatchJob(JNIEnv *env, jobject thiz,
+                                                                     jobjectArray inputPaths,
+                                                                     jobjectArray outputPaths,
+                                                                     jboolean normalize,
+                                                                     jfloat targetLufs,
+                                                                     jint outputFormat,
+                                                                     jint sampleFormat) {
+    if (g_batchJob != nullptr && !g_batchJob->isFinished()) {
+        LOGE("Batch job already running");
+        return false;
+    }
+    
+    if (outputFormat != static_cast<jint>(AudioFileFormat::WAV) &&
+        outputFormat != static_cast<jint>(AudioFileFormat::FLAC)) {
+        LOGE("Unknown output format: %d", outputFormat);
+        return false;
+    }
+    if (sampleFormat >= 0 && !isValidSampleFormat(sampleFormat)) {
+        LOGE("Unknown sample format: %d", sampleFormat);
+        return false;
+    }
+    
+    BatchOptions options;
+    options.normalize = normalize;
+    options.targetLufs = targetLufs;
+    options.outputFormat = static_cast<AudioFileFormat>(outputFormat);
+    options.convertSampleFormat = sampleFormat >= 0;
+    if (options.convertSampleFormat) {
+        options.sampleFormat = static_cast<SampleFormat>(sampleFormat);
+    }
+    
+    delete g_batchJob;
+    g_batchJob = new BatchJob(toStringVector(env, inputPaths), toStringVector(env, outputPaths), options);
+    if (!g_batchJob->start(0)) {
+        delete g_batchJob;
+        g_batchJob = nullptr;
+        return false;
+    }
+    return true;
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getBatchProgress(JNIEnv *env, jobject thiz) {
+    if (g_batchJob == nullptr) {
+        return -1.0f;
+    }
+    
+    return g_batchJob->getProgress();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_isBatchJobFinished(JNIEnv *env, jobject thiz) {
+    if (g_batchJob == nullptr) {
+        return true;
+    }
+    
+    return g_batchJob->isFinished();
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_cancelBatchJob(JNIEnv *env, jobject thiz) {
+    if (g_batchJob == nullptr) {
+        return;
+    }
+    
+    g_batchJob->cancel();
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getBatchResults(JNIEnv *env, jobject thiz) {
+    if (g_batchJob == nullptr) {
+        return nullptr;
+    }
+    
+    // Files still pending report status 0 and zeros
+    size_t count = g_batchJob->getFileCount();
+    std::vector<jfloat> packed(count * BATCH_FIELDS, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        BatchFileResult result = g_batchJob->getResult(i);
+        jfloat* fields = &packed[i * BATCH_FIELDS];
+        fields[0] = static_cast<jfloat>(result.status);
+        fields[1] = static_cast<jfloat>(result.loudness);
+        fields[2] = static_cast<jfloat>(result.gainDb);
+        fields[3] = result.samplePeak > 0.0f ? 20.0f * std::log10(result.samplePeak) : -INFINITY;
+    }
+    
+    jfloatArray results = env->NewFloatArray(static_cast<jsize>(packed.size()));
+    env->SetFloatArrayRegion(results, 0, static_cast<jsize>(packed.size()), packed.data());
+    return results;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_createEditList(JNIEnv *env, jobject thiz) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    return addEditList(std::unique_ptr<EditList>(new EditList()));
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_releaseEditList(JNIEnv *env, jobject thiz, jint handle) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    if (findEditList(handle) == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return;
+    }
+    
+    g_editLists[handle - 1].reset();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_editListAppend(JNIEnv *env, jobject thiz, jint handle,
+                                                                      jstring filePath, jlong startMs,
+                                                                      jlong durationMs) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return false;
+    }
+    
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    std::string sourcePath(path);
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    int source = list->addSource(sourcePath);
+    if (source < 0) {
+        return false;
+    }
+    
+    // A negative duration, or one past the end, runs to the end of the take
+    uint64_t start = editFrames(*list, startMs);
+    uint64_t sourceFrames = list->getSourceFrameCount(static_cast<size_t>(source));
+    uint64_t frames = sourceFrames > start ? sourceFrames - start : 0;
+    if (durationMs >= 0) {
+        frames = std::min(frames, editFrames(*list, durationMs));
+    }
+    return list->append(static_cast<size_t>(source), start, frames);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_editListJoin(JNIEnv *env, jobject thiz, jint handle,
+                                                                    jint otherHandle) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    EditList* other = findEditList(otherHandle);
+    if (list == nullptr || other == nullptr) {
+        LOGE("Unknown edit list: %d or %d", handle, otherHandle);
+        return false;
+    }
+    
+    // Joined onto itself through a copy, as append() reads as it goes
+    EditList copy = *other;
+    return list->append(copy);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_editListCut(JNIEnv *env, jobject thiz, jint handle,
+                                                                   jlong startMs, jlong durationMs) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return false;
+    }
+    
+    uint64_t start = std::min(editFrames(*list, startMs), list->getFrameCount());
+    uint64_t frames = std::min(editFrames(*list, durationMs), list->getFrameCount() - start);
+    return list->cut(start, frames);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_editListTrim(JNIEnv *env, jobject thiz, jint handle,
+                                                                    jlong startMs, jlong durationMs) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return false;
+    }
+    
+    uint64_t start = std::min(editFrames(*list, startMs), list->getFrameCount());
+    uint64_t frames = std::min(editFrames(*list, durationMs), list->getFrameCount() - start);
+    return list->trim(start, frames);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_editListSplit(JNIEnv *env, jobject thiz, jint handle,
+                                                                     jlong positionMs) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return 0;
+    }
+    
+    // Find a slot before touching the list, so a failed split changes nothing
+    bool hasSlot = false;
+    for (const std::unique_ptr<EditList>& slot : g_editLists) {
+        hasSlot = hasSlot || slot == nullptr;
+    }
+    if (!hasSlot) {
+        LOGE("All %zu edit lists are in use", MAX_EDIT_LISTS);
+        return 0;
+    }
+    
+    std::unique_ptr<EditList> tail(new EditList());
+    if (!list->split(editFrames(*list, positionMs), *tail)) {
+        return 0;
+    }
+    return addEditList(std::move(tail));
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setEditListCrossfade(JNIEnv *env, jobject thiz, jint handle,
+                                                                            jint crossfadeMs) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return;
+    }
+    
+    list->setCrossfade(editFrames(*list, crossfadeMs));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getEditListDurationMs(JNIEnv *env, jobject thiz,
+                                                                             jint handle) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr || list->getSampleRate() == 0) {
+        return 0;
+    }
+    
+    return static_cast<jlong>(list->getFrameCount() * 1000 / list->getSampleRate());
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_saveEditList(JNIEnv *env, jobject thiz, jint handle,
+                                                                    jstring filePath) {
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    EditList* list = findEditList(handle);
+    if (list == nullptr) {
+        LOGE("Unknown edit list: %d", handle);
+        return false;
+    }
+    
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    bool result = list->save(std::string(path));
+    env->ReleaseStringUTFChars(filePath, path);
+    
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_loadEditList(JNIEnv *env, jobject thiz, jstring filePath) {
+    const char* path = env->GetStringUTFChars(filePath, nullptr);
+    std::unique_ptr<EditList> list(new EditList());
+    bool loaded = list->load(std::string(path));
+    env->ReleaseStringUTFChars(filePath, path);
+    if (!loaded) {
+        return 0;
+    }
+    
+    std::lock_guard<std::mutex> lock(g_editListsMutex);
+    return addEditList(std::move(list));
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_renderEditList(JNIEnv *env, jobject thiz, jint handle,
+                                                                      jstring outputPath) {
+    EditList snapshot;
+    {
+        std::lock_guard<std::mutex> lock(g_editListsMutex);
+        EditList* list = findEditList(handle);
+        if (list == nullptr) {
+            LOGE("Unknown edit list: %d", handle);
+            return false;
+        }
+        snapshot = *list;
+    }
+    
+    const char* path = env->GetStringUTFChars(outputPath, nullptr);
+    bool result = snapshot.render(std::string(path));
+    env->ReleaseStringUTFChars(outputPath, path);
+    
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_loadPlayerEditList(JNIEnv *env, jobject thiz, jint player,
+                                                                          jint handle) {
+    std::shared_ptr<PlayerSession> session = findSession(player);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", player);
+        return false;
+    }
+    
+    EditList snapshot;
+    {
+        std::lock_guard<std::mutex> lock(g_editListsMutex);
+        EditList* list = findEditList(handle);
+        if (list == nullptr) {
+            LOGE("Unknown edit list: %d", handle);
+            return false;
+        }
+        snapshot = *list;
+    }
+    
+    return session->player->loadEditList(snapshot);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_setPlayQueue(JNIEnv *env, jobject thiz, jint player,
+                                                                    jobjectArray filePaths, jobject listener) {
+    std::shared_ptr<PlayerSession> session = findSession(player);
+    if (session == nullptr) {
+        LOGE("Unknown player: %d", player);
+        return false;
+    }
+    
+    std::shared_ptr<AudioPlayer::QueueListener> queueListener;
+    if (listener != nullptr) {
+        queueListener = std::make_shared<JniQueueListener>(env, listener);
+    }
+    return session->player->setQueue(toStringVector(env, filePaths), std::move(queueListener));
+}
+
+JNIEXPORT jint JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_getPlayQueueIndex(JNIEnv *env, jobject thiz, jint player) {
+    std::shared_ptr<PlayerSession> session = findSession(player);
+    if (session == nullptr) {
+        return 0;
+    }
+    
+    return static_cast<jint>(session->player->getQueueIndex());
+}
+
+JNIEXPORT void JNICALL
+Java_com_example_audiorecordingapp_AudioRecorderNative_cleanupNative(JNIEnv *env, jobject thiz) {
+    if (g_recorder != nullptr) {
+        delete g_recorder;
+        g_recorder = nullptr;
+    }
+    
+    // Every player goes before the mixer it plays through
+    {
+        std::lock_guard<std::mutex> lock(g_sessionsMutex);
+        for (std::shared_ptr<PlayerSession>& session : g_sessions) {
+            session.reset();
+        }
+    }
+    
+    if (g_mixer != nullptr) {
+        delete g_mixer;
+        g_mixer = nullptr;
+    }
+    
+    if (g_batchJob != nullptr) {
+        delete g_batchJob;
+        g_batchJob = nullptr;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(g_editListsMutex);
+        for (std::unique_ptr<EditList>& list : g_editLists) {
+            list.reset();
+        }
+    }
+    
+    if (g_backend != nullptr) {
+        delete g_backend;
+        g_backend = nullptr;
+    }
+}
+
+}
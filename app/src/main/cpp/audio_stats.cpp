@@ -0,0 +1,37 @@
+#include "audio_stats.h"
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint32_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    maxUs.store(0, std::memory_order_relaxed);
+}
+
+void AudioStats::snapshot(int64_t out[PACKED_SIZE]) const {
+    out[CALLBACKS] = static_cast<int64_t>(getCallbackCount());
+    out[MAX_CALLBACK_US] = durations.getMaxUs();
+    out[MAX_JITTER_US] = jitter.getMaxUs();
+    out[DROPPED_BLOCKS] = static_cast<int64_t>(getDroppedBlocks());
+    out[STARVED_BLOCKS] = static_cast<int64_t>(getStarvedBlocks());
+    out[WRITER_LAG_US] = writerLagUs.load(std::memory_order_relaxed);
+    out[MAX_WRITER_LAG_US] = getMaxWriterLagUs();
+    for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+        out[DURATION_BUCKETS + i] = durations.getCount(i);
+        out[JITTER_BUCKETS + i] = jitter.getCount(i);
+    }
+}
+
+void AudioStats::reset() {
+    durations.reset();
+    jitter.reset();
+    callbacks.store(0, std::memory_order_relaxed);
+    droppedBlocks.store(0, std::memory_order_relaxed);
+    starvedBlocks.store(0, std::memory_order_relaxed);
+    writerLagUs.store(0, std::memory_order_relaxed);
+    maxWriterLagUs.store(0, std::memory_order_relaxed);
+    lastCallbackNs.store(0, std::memory_order_relaxed);
+}
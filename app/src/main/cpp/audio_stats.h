@@ -0,0 +1,198 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_STATS_H
+#define AUDIORECORDINGAPP_AUDIO_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Microsecond timings counted in fixed power-of-two buckets. One thread
+// adds, any thread reads; nothing locks or allocates. Bucket 0 holds
+// everything under 64 us, bucket i the range [32 << i, 64 << i) us, and the
+// last one everything from about a second up.
+class LatencyHistogram {
+public:
+    static const size_t BUCKET_COUNT = 16;
+
+private:
+    static const int FIRST_BUCKET_BITS = 6;
+
+    std::atomic<uint32_t> buckets[BUCKET_COUNT];
+    std::atomic<uint32_t> maxUs{0};
+
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    static size_t bucketFor(uint32_t us) {
+        uint32_t scaled = us >> FIRST_BUCKET_BITS;
+        size_t bucket = scaled == 0 ? 0 : static_cast<size_t>(32 - __builtin_clz(scaled));
+        return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+    }
+
+    // Exclusive upper bound of |bucket|; the last one has none
+    static uint32_t getBucketLimitUs(size_t bucket) {
+        return bucket + 1 < BUCKET_COUNT ? 64u << bucket : UINT32_MAX;
+    }
+
+    // Writer thread only: a plain load and store, no read-modify-write
+    void add(uint32_t us) {
+        std::atomic<uint32_t>& bucket = buckets[bucketFor(us)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (us > maxUs.load(std::memory_order_relaxed)) {
+            maxUs.store(us, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t getCount(size_t bucket) const {
+        return buckets[bucket].load(std::memory_order_relaxed);
+    }
+
+    uint32_t getMaxUs() const {
+        return maxUs.load(std::memory_order_relaxed);
+    }
+
+    // Call while the writer thread is idle
+    void reset();
+};
+
+// Lock-free instrumentation for one direction of the audio path: how long
+// each callback ran, how far it strayed from when it was due, and counters
+// for the trouble the owner notices along the way. The audio thread times
+// each callback with a CallbackTimer; everything can be read from any
+// thread while the stream runs, and snapshot() packs it all for Java:
+//
+//   [0] callbacks       [1] max callback us   [2] max jitter us
+//   [3] dropped blocks  [4] starved blocks
+//   [5] writer lag us   [6] max writer lag us
+//   [7...] callback duration buckets, then jitter buckets
+class AudioStats {
+public:
+    static const size_t CALLBACKS = 0;
+    static const size_t MAX_CALLBACK_US = 1;
+    static const size_t MAX_JITTER_US = 2;
+    static const size_t DROPPED_BLOCKS = 3;
+    static const size_t STARVED_BLOCKS = 4;
+    static const size_t WRITER_LAG_US = 5;
+    static const size_t MAX_WRITER_LAG_US = 6;
+    static const size_t DURATION_BUCKETS = 7;
+    static const size_t JITTER_BUCKETS = DURATION_BUCKETS + LatencyHistogram::BUCKET_COUNT;
+    static const size_t PACKED_SIZE = JITTER_BUCKETS + LatencyHistogram::BUCKET_COUNT;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyHistogram durations;
+    // Distance between when each callback arrived and when it was due
+    LatencyHistogram jitter;
+
+    // Written only by the audio thread
+    std::atomic<uint64_t> callbacks{0};
+    std::atomic<uint64_t> droppedBlocks{0};
+    std::atomic<uint64_t> starvedBlocks{0};
+    std::atomic<uint32_t> writerLagUs{0};
+    std::atomic<uint32_t> maxWriterLagUs{0};
+
+    // Audio thread: when the last callback started, 0 before the first
+    std::atomic<int64_t> lastCallbackNs{0};
+
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now().time_since_epoch()).count();
+    }
+
+    static uint32_t toUs(int64_t ns) {
+        return ns <= 0 ? 0 : static_cast<uint32_t>(std::min<int64_t>(ns / 1000, UINT32_MAX));
+    }
+
+public:
+    AudioStats() = default;
+
+    AudioStats(const AudioStats&) = delete;
+    AudioStats& operator=(const AudioStats&) = delete;
+
+    // Times one callback from construction to destruction. |dueUs| is how
+    // long after the previous callback this one was expected, or 0 when
+    // there is nothing to compare against.
+    class CallbackTimer {
+    private:
+        AudioStats& stats;
+        int64_t startNs;
+
+    public:
+        CallbackTimer(AudioStats& stats, uint32_t dueUs) : stats(stats), startNs(nowNs()) {
+            int64_t lastNs = stats.lastCallbackNs.load(std::memory_order_relaxed);
+            if (lastNs != 0 && dueUs > 0) {
+                int64_t lateNs = startNs - lastNs - static_cast<int64_t>(dueUs) * 1000;
+                stats.jitter.add(toUs(lateNs < 0 ? -lateNs : lateNs));
+            }
+            stats.lastCallbackNs.store(startNs, std::memory_order_relaxed);
+        }
+
+        ~CallbackTimer() {
+            stats.durations.add(toUs(nowNs() - startNs));
+            increment(stats.callbacks);
+        }
+
+        CallbackTimer(const CallbackTimer&) = delete;
+        CallbackTimer& operator=(const CallbackTimer&) = delete;
+    };
+
+    // A block the consumer could not keep up with was thrown away
+    void onDroppedBlock() {
+        increment(droppedBlocks);
+    }
+
+    // The device was handed silence because nothing was ready
+    void onStarvedBlock() {
+        increment(starvedBlocks);
+    }
+
+    // How much audio is waiting for the disk writer right now
+    void setWriterLag(uint32_t us) {
+        writerLagUs.store(us, std::memory_order_relaxed);
+        if (us > maxWriterLagUs.load(std::memory_order_relaxed)) {
+            maxWriterLagUs.store(us, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t getCallbackCount() const {
+        return callbacks.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getDroppedBlocks() const {
+        return droppedBlocks.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getStarvedBlocks() const {
+        return starvedBlocks.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getMaxWriterLagUs() const {
+        return maxWriterLagUs.load(std::memory_order_relaxed);
+    }
+
+    const LatencyHistogram& getDurations() const {
+        return durations;
+    }
+
+    const LatencyHistogram& getJitter() const {
+        return jitter;
+    }
+
+    // Any thread; the fields are read one at a time, so a snapshot taken
+    // mid-callback may be off by that one callback
+    void snapshot(int64_t out[PACKED_SIZE]) const;
+
+    // Call while the audio thread is idle
+    void reset();
+};
+
+#endif // AUDIORECORDINGAPP_AUDIO_STATS_H
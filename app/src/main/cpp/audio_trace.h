@@ -0,0 +1,35 @@
+#ifndef AUDIORECORDINGAPP_AUDIO_TRACE_H
+#define AUDIORECORDINGAPP_AUDIO_TRACE_H
+
+// Systrace/Perfetto sections around the audio hot paths, compiled in only
+// when the library is built with -DAUDIO_ATRACE=ON. Everywhere else
+// AUDIO_TRACE_SECTION() expands to nothing.
+//
+//   AUDIO_TRACE_SECTION("capture callback");
+
+#if defined(__ANDROID__) && defined(AUDIO_ATRACE)
+#include <android/trace.h>
+
+// Ends the section when it goes out of scope
+class AudioTraceSection {
+public:
+    explicit AudioTraceSection(const char* name) {
+        ATrace_beginSection(name);
+    }
+
+    ~AudioTraceSection() {
+        ATrace_endSection();
+    }
+
+    AudioTraceSection(const AudioTraceSection&) = delete;
+    AudioTraceSection& operator=(const AudioTraceSection&) = delete;
+};
+
+#define AUDIO_TRACE_CONCAT_INNER(a, b) a##b
+#define AUDIO_TRACE_CONCAT(a, b) AUDIO_TRACE_CONCAT_INNER(a, b)
+#define AUDIO_TRACE_SECTION(name) AudioTraceSection AUDIO_TRACE_CONCAT(traceSection, __LINE__)(name)
+#else
+#define AUDIO_TRACE_SECTION(name) ((void) 0)
+#endif
+
+#endif // AUDIORECORDINGAPP_AUDIO_TRACE_H
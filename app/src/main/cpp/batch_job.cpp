@@ -0,0 +1,328 @@
+#include "batch_job.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include "audio_file_reader.h"
+#include "flac_encoder.h"
+#include "loudness_meter.h"
+#include "sample_convert.h"
+#include "wav_file.h"
+#include "wav_probe.h"
+#include "waveform_index.h"
+
+#define LOG_TAG "BatchJob"
+#include "audio_log.h"
+
+static const char* PART_EXTENSION = ".part";
+
+static double toDb(double gain) {
+    return 20.0 * std::log10(gain);
+}
+
+// Writes a whole file synchronously from a worker: the capture writers'
+// rings and threads are there to keep the audio thread from waiting,
+// which an offline pass does not need
+class BatchOutputFile {
+private:
+    std::ofstream file;
+    AudioFileFormat fileFormat;
+    SampleFormat format;
+    int sampleRate;
+    int channels;
+    std::unique_ptr<FlacEncoder> encoder;
+    WaveformIndex waveform;
+
+    std::vector<short> shorts;
+    std::vector<uint8_t> bytes;
+    std::vector<short> block;
+    size_t blockFill = 0;
+    uint64_t dataBytes = 0;
+
+    bool encodeBlock() {
+        bytes.clear();
+        encoder->encodeBlock(block.data(), blockFill / channels, bytes);
+        blockFill = 0;
+        return writeBytes(bytes.data(), bytes.size());
+    }
+
+    bool writeBytes(const void* data, size_t count) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(count));
+        dataBytes += count;
+        return static_cast<bool>(file);
+    }
+
+public:
+    BatchOutputFile(AudioFileFormat fileFormat, SampleFormat format, int sampleRate, int channels)
+            : fileFormat(fileFormat), format(fileFormat == AudioFileFormat::FLAC ? SampleFormat::INT16 : format),
+              sampleRate(sampleRate), channels(channels), waveform(sampleRate, channels) {
+    }
+
+    bool open(const std::string& path) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        // Placeholder header, patched in close() once the length is known
+        if (fileFormat == AudioFileFormat::FLAC) {
+            encoder.reset(new FlacEncoder(sampleRate, channels));
+            block.resize(static_cast<size_t>(encoder->getBlockSize()) * channels);
+            encoder->writeStreamHeader(bytes);
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        } else {
+            uint8_t header[WAV_HEADER_SIZE];
+            buildWavHeader(sampleRate, channels, format, 0, header);
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Interleaved samples, full scale at +/-1.0
+    bool write(const float* samples, size_t frames) {
+        size_t count = frames * channels;
+        shorts.resize(count);
+        convertSamples(samples, shorts.data(), count);
+        waveform.addSamples(shorts.data(), count);
+
+        if (fileFormat == AudioFileFormat::FLAC) {
+            for (size_t done = 0; done < count;) {
+                size_t run = std::min(count - done, block.size() - blockFill);
+                std::copy(shorts.begin() + done, shorts.begin() + done + run, block.begin() + blockFill);
+                blockFill += run;
+                done += run;
+                if (blockFill == block.size() && !encodeBlock()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        switch (format) {
+            case SampleFormat::INT16:
+                return writeBytes(shorts.data(), count * sizeof(short));
+            case SampleFormat::INT24_PACKED:
+                bytes.resize(count * sizeof(Int24));
+                convertSamples(samples, reinterpret_cast<Int24*>(bytes.data()), count);
+                return writeBytes(bytes.data(), bytes.size());
+            case SampleFormat::FLOAT32:
+                return writeBytes(samples, count * sizeof(float));
+        }
+        return false;
+    }
+
+    bool close() {
+        if (fileFormat == AudioFileFormat::FLAC) {
+            if (blockFill > 0 && !encodeBlock()) {
+                return false;
+            }
+            bytes.clear();
+            encoder->writeStreamHeader(bytes);
+            file.seekp(0);
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        } else {
+            uint8_t header[WAV_HEADER_SIZE];
+            buildWavHeader(sampleRate, channels, format, dataBytes, header);
+            file.seekp(0);
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        }
+        file.close();
+        return static_cast<bool>(file);
+    }
+
+    bool saveWaveform(const std::string& sidecarPath) {
+        waveform.finish();
+        return waveform.save(sidecarPath);
+    }
+};
+
+BatchJob::BatchJob(std::vector<std::string> inputs, std::vector<std::string> outputs, const BatchOptions& options)
+        : inputs(std::move(inputs)), outputs(std::move(outputs)), options(options),
+          files(new FileState[this->inputs.size()]) {
+}
+
+BatchJob::~BatchJob() {
+    cancel();
+    pool.reset();
+}
+
+bool BatchJob::start(int threadCount) {
+    if (pool != nullptr) {
+        LOGE("Batch job already started");
+        return false;
+    }
+    if (!outputs.empty() && outputs.size() != inputs.size()) {
+        LOGE("%zu output paths for %zu inputs", outputs.size(), inputs.size());
+        return false;
+    }
+    if (outputs.empty() && !options.normalize) {
+        LOGE("Batch job has nothing to do");
+        return false;
+    }
+
+    // Headers only, so the job's length is known before any file is read
+    int passes = (options.normalize ? 1 : 0) + (outputs.empty() ? 0 : 1);
+    for (const WavProbeResult& probe : probeWavFiles(inputs)) {
+        if (probe.valid) {
+            totalFrames += static_cast<uint64_t>(probe.info.frameCount) * passes;
+        }
+    }
+
+    pool.reset(new WorkStealingPool(threadCount));
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (options.normalize) {
+            pool->submit([this, i] { measureFile(i); });
+        } else {
+            pool->submit([this, i] { writeFile(i); });
+        }
+    }
+    return true;
+}
+
+void BatchJob::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+void BatchJob::wait() {
+    if (pool != nullptr) {
+        pool->wait();
+    }
+}
+
+float BatchJob::getProgress() const {
+    if (isFinished()) {
+        return 1.0f;
+    }
+    if (totalFrames == 0) {
+        return 0.0f;
+    }
+    // FLAC files without a length count nothing up front but still get read
+    return std::min(1.0f, static_cast<float>(processedFrames.load(std::memory_order_relaxed)) / totalFrames);
+}
+
+BatchFileResult BatchJob::getResult(size_t index) const {
+    BatchFileResult result;
+    if (index >= inputs.size()) {
+        return result;
+    }
+    BatchStatus status = files[index].status.load(std::memory_order_acquire);
+    if (status != BatchStatus::PENDING) {
+        result = files[index].result;
+    }
+    result.status = status;
+    return result;
+}
+
+void BatchJob::finishFile(size_t index, BatchStatus status) {
+    files[index].status.store(status, std::memory_order_release);
+    finishedFiles.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void BatchJob::measureFile(size_t index) {
+    if (cancelled.load(std::memory_order_relaxed)) {
+        finishFile(index, BatchStatus::CANCELLED);
+        return;
+    }
+
+    AudioFileReader reader;
+    if (!reader.open(inputs[index])) {
+        finishFile(index, BatchStatus::FAILED);
+        return;
+    }
+
+    LoudnessMeter meter(static_cast<int>(reader.getSampleRate()), reader.getChannels());
+    std::vector<float> samples(AudioFileReader::READ_FRAMES * reader.getChannels());
+    while (size_t frames = reader.read(samples.data(), AudioFileReader::READ_FRAMES)) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+            finishFile(index, BatchStatus::CANCELLED);
+            return;
+        }
+        meter.process(samples.data(), frames);
+        processedFrames.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    // Silence, or nothing that passes the gate, is left as it is
+    BatchFileResult& result = files[index].result;
+    result.loudness = meter.getIntegratedLoudness();
+    result.samplePeak = meter.getSamplePeak();
+    result.gainDb = 0.0;
+    if (std::isfinite(result.loudness)) {
+        result.gainDb = options.targetLufs - result.loudness;
+        if (result.samplePeak > 0.0f) {
+            result.gainDb = std::min(result.gainDb, options.maxPeakDbfs - toDb(result.samplePeak));
+        }
+    }
+
+    if (outputs.empty()) {
+        finishFile(index, BatchStatus::DONE);
+        return;
+    }
+    // Onto this worker's own queue, next in line, while the file is warm
+    // in the page cache
+    pool->submit([this, index] { writeFile(index); });
+}
+
+void BatchJob::writeFile(size_t index) {
+    if (cancelled.load(std::memory_order_relaxed)) {
+        finishFile(index, BatchStatus::CANCELLED);
+        return;
+    }
+
+    AudioFileReader reader;
+    if (!reader.open(inputs[index])) {
+        finishFile(index, BatchStatus::FAILED);
+        return;
+    }
+
+    BatchFileResult& result = files[index].result;
+    if (!options.normalize) {
+        result.loudness = -std::numeric_limits<double>::infinity();
+    }
+    SampleFormat format = options.convertSampleFormat ? options.sampleFormat : reader.getFormat();
+    BatchOutputFile output(options.outputFormat, format, static_cast<int>(reader.getSampleRate()),
+                           reader.getChannels());
+    const std::string partPath = outputs[index] + PART_EXTENSION;
+    if (!output.open(partPath)) {
+        LOGE("Failed to open output file: %s", partPath.c_str());
+        finishFile(index, BatchStatus::FAILED);
+        return;
+    }
+
+    const float gain = static_cast<float>(std::pow(10.0, result.gainDb / 20.0));
+    std::vector<float> samples(AudioFileReader::READ_FRAMES * reader.getChannels());
+    bool written = true;
+    while (size_t frames = reader.read(samples.data(), AudioFileReader::READ_FRAMES)) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+            written = false;
+            break;
+        }
+        if (gain != 1.0f) {
+            for (size_t i = 0; i < frames * reader.getChannels(); i++) {
+                samples[i] *= gain;
+            }
+        }
+        if (!output.write(samples.data(), frames)) {
+            LOGE("Failed to write audio data to: %s", partPath.c_str());
+            written = false;
+            break;
+        }
+        processedFrames.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    reader.close();
+    if (!written || !output.close() ||
+        std::rename(partPath.c_str(), outputs[index].c_str()) != 0) {
+        std::remove(partPath.c_str());
+        finishFile(index, cancelled.load(std::memory_order_relaxed) ? BatchStatus::CANCELLED : BatchStatus::FAILED);
+        return;
+    }
+
+    const std::string sidecarPath = WaveformIndex::getSidecarPath(outputs[index]);
+    if (!output.saveWaveform(sidecarPath)) {
+        LOGE("Failed to save waveform sidecar: %s", sidecarPath.c_str());
+    }
+    finishFile(index, BatchStatus::DONE);
+}
@@ -0,0 +1,125 @@
+#ifndef AUDIORECORDINGAPP_BATCH_JOB_H
+#define AUDIORECORDINGAPP_BATCH_JOB_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_file_writer.h"
+#include "sample_format.h"
+#include "work_stealing_pool.h"
+
+// What a batch job does to each file. Values are shared with the Kotlin side.
+struct BatchOptions {
+    // Gain every file to |targetLufs| integrated loudness, held back so the
+    // sample peak stays at or under |maxPeakDbfs|
+    bool normalize = true;
+    double targetLufs = -23.0;
+    double maxPeakDbfs = -1.0;
+
+    // Output container, and for WAV the sample format; FLAC is always
+    // 16-bit. Without |convertSampleFormat| WAV keeps the source's.
+    AudioFileFormat outputFormat = AudioFileFormat::WAV;
+    bool convertSampleFormat = false;
+    SampleFormat sampleFormat = SampleFormat::INT16;
+};
+
+enum class BatchStatus {
+    PENDING = 0,
+    DONE = 1,
+    FAILED = 2,
+    CANCELLED = 3,
+};
+
+struct BatchFileResult {
+    BatchStatus status = BatchStatus::PENDING;
+    // Integrated loudness as measured, -infinity for silence or when not
+    // normalizing; the gain applied; the source's sample peak
+    double loudness = 0.0;
+    double gainDb = 0.0;
+    float samplePeak = 0.0f;
+};
+
+// Loudness normalization and format conversion over a list of files, on
+// a WorkStealingPool. A normalized file takes two passes, measuring with
+// LoudnessMeter then writing with the gain, and the second is queued from
+// the first on the same worker, so files finish one after another rather
+// than all at the end. Every pass streams the file through
+// AudioFileReader, so memory per worker stays the same whatever the
+// length.
+//
+// Output goes to "<output>.part" and is renamed over the output once
+// complete, so the output may be the input itself and a cancelled or
+// failed file leaves the original alone. A waveform sidecar is written
+// for each output. Without output paths the job only measures.
+class BatchJob {
+private:
+    struct FileState {
+        std::atomic<BatchStatus> status{BatchStatus::PENDING};
+        BatchFileResult result;
+    };
+
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    BatchOptions options;
+
+    std::unique_ptr<FileState[]> files;
+    std::atomic<size_t> finishedFiles{0};
+    std::atomic<uint64_t> processedFrames{0};
+    uint64_t totalFrames = 0;
+    std::atomic<bool> cancelled{false};
+
+    // Last member, so its workers are joined before anything they use goes
+    std::unique_ptr<WorkStealingPool> pool;
+
+    void measureFile(size_t index);
+    void writeFile(size_t index);
+    void finishFile(size_t index, BatchStatus status);
+
+public:
+    // |outputs| is empty, or holds one path per input
+    BatchJob(std::vector<std::string> inputs, std::vector<std::string> outputs, const BatchOptions& options);
+
+    // Cancels whatever is left and waits for the workers
+    ~BatchJob();
+
+    BatchJob(const BatchJob&) = delete;
+    BatchJob& operator=(const BatchJob&) = delete;
+
+    // Starts on |threadCount| workers, every core for 0, and returns at once
+    bool start(int threadCount);
+
+    // Files not yet started are skipped and the ones in progress stop at
+    // their next block, leaving no output behind
+    void cancel();
+
+    // Blocks until every file is finished
+    void wait();
+
+    bool isFinished() const {
+        return finishedFiles.load(std::memory_order_acquire) == inputs.size();
+    }
+
+    // Share of the job's frames processed so far, across both passes
+    float getProgress() const;
+
+    size_t getFileCount() const {
+        return inputs.size();
+    }
+
+    size_t getFinishedCount() const {
+        return finishedFiles.load(std::memory_order_acquire);
+    }
+
+    // A file's result once its status is no longer PENDING
+    BatchFileResult getResult(size_t index) const;
+
+    uint64_t getStealCount() const {
+        return pool != nullptr ? pool->getStealCount() : 0;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_BATCH_JOB_H
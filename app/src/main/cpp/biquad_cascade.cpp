@@ -0,0 +1,162 @@
+#include "biquad_cascade.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BIQUAD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BIQUAD_SSE2 1
+#endif
+
+// Well under anything audible in float samples, and well over the
+// denormal range
+static const float DENORMAL_FLOOR = 1e-20f;
+
+BiquadCoefficients BiquadCoefficients::highPass(double sampleRate, double frequency, double q) {
+    const double pi = 3.14159265358979323846;
+    double w0 = 2.0 * pi * frequency / sampleRate;
+    double cosW0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double a0 = 1.0 + alpha;
+
+    BiquadCoefficients section;
+    section.b0 = static_cast<float>((1.0 + cosW0) / 2.0 / a0);
+    section.b1 = static_cast<float>(-(1.0 + cosW0) / a0);
+    section.b2 = section.b0;
+    section.a1 = static_cast<float>(-2.0 * cosW0 / a0);
+    section.a2 = static_cast<float>((1.0 - alpha) / a0);
+    return section;
+}
+
+BiquadCascade::BiquadCascade(int channels) : channels(std::min(std::max(channels, 1), MAX_CHANNELS)) {
+    setSections(nullptr, 0);
+    reset();
+}
+
+void BiquadCascade::setSections(const BiquadCoefficients* sections, int count) {
+    for (int lane = 0; lane < MAX_SECTIONS; lane++) {
+        BiquadCoefficients section = lane < count ? sections[lane] : BiquadCoefficients();
+        b0[lane] = section.b0;
+        b1[lane] = section.b1;
+        b2[lane] = section.b2;
+        a1[lane] = section.a1;
+        a2[lane] = section.a2;
+    }
+}
+
+void BiquadCascade::setChannels(int channels) {
+    this->channels = std::min(std::max(channels, 1), MAX_CHANNELS);
+    reset();
+}
+
+void BiquadCascade::reset() {
+    for (ChannelState& channel : state) {
+        std::fill(channel.s1, channel.s1 + MAX_SECTIONS, 0.0f);
+        std::fill(channel.s2, channel.s2 + MAX_SECTIONS, 0.0f);
+        std::fill(channel.y, channel.y + MAX_SECTIONS, 0.0f);
+    }
+}
+
+void BiquadCascade::flushDenormals() {
+    for (int c = 0; c < channels; c++) {
+        ChannelState& channel = state[c];
+        for (int lane = 0; lane < MAX_SECTIONS; lane++) {
+            if (std::fabs(channel.s1[lane]) < DENORMAL_FLOOR) channel.s1[lane] = 0.0f;
+            if (std::fabs(channel.s2[lane]) < DENORMAL_FLOOR) channel.s2[lane] = 0.0f;
+            if (std::fabs(channel.y[lane]) < DENORMAL_FLOOR) channel.y[lane] = 0.0f;
+        }
+    }
+}
+
+void BiquadCascade::processScalar(float* samples, size_t frames) {
+    for (int c = 0; c < channels; c++) {
+        ChannelState& channel = state[c];
+        for (size_t i = 0; i < frames; i++) {
+            float* sample = samples + i * channels + c;
+            // Each section takes what the one before it gave last time
+            float x[MAX_SECTIONS];
+            x[0] = *sample;
+            for (int lane = 1; lane < MAX_SECTIONS; lane++) {
+                x[lane] = channel.y[lane - 1];
+            }
+            for (int lane = 0; lane < MAX_SECTIONS; lane++) {
+                float y = b0[lane] * x[lane] + channel.s1[lane];
+                channel.s1[lane] = (b1[lane] * x[lane] + channel.s2[lane]) - a1[lane] * y;
+                channel.s2[lane] = b2[lane] * x[lane] - a2[lane] * y;
+                channel.y[lane] = y;
+            }
+            *sample = channel.y[MAX_SECTIONS - 1];
+        }
+    }
+    flushDenormals();
+}
+
+#if BIQUAD_NEON
+
+void BiquadCascade::process(float* samples, size_t frames) {
+    const float32x4_t vb0 = vld1q_f32(b0);
+    const float32x4_t vb1 = vld1q_f32(b1);
+    const float32x4_t vb2 = vld1q_f32(b2);
+    const float32x4_t va1 = vld1q_f32(a1);
+    const float32x4_t va2 = vld1q_f32(a2);
+    for (int c = 0; c < channels; c++) {
+        ChannelState& channel = state[c];
+        float32x4_t s1 = vld1q_f32(channel.s1);
+        float32x4_t s2 = vld1q_f32(channel.s2);
+        float32x4_t y = vld1q_f32(channel.y);
+        for (size_t i = 0; i < frames; i++) {
+            float* sample = samples + i * channels + c;
+            // [input, y0, y1, y2]: every lane moves up one section
+            float32x4_t x = vextq_f32(vdupq_n_f32(*sample), y, 3);
+            y = vmlaq_f32(s1, vb0, x);
+            s1 = vmlsq_f32(vmlaq_f32(s2, vb1, x), va1, y);
+            s2 = vmlsq_f32(vmulq_f32(vb2, x), va2, y);
+            *sample = vgetq_lane_f32(y, 3);
+        }
+        vst1q_f32(channel.s1, s1);
+        vst1q_f32(channel.s2, s2);
+        vst1q_f32(channel.y, y);
+    }
+    flushDenormals();
+}
+
+#elif BIQUAD_SSE2
+
+void BiquadCascade::process(float* samples, size_t frames) {
+    const __m128 vb0 = _mm_load_ps(b0);
+    const __m128 vb1 = _mm_load_ps(b1);
+    const __m128 vb2 = _mm_load_ps(b2);
+    const __m128 va1 = _mm_load_ps(a1);
+    const __m128 va2 = _mm_load_ps(a2);
+    for (int c = 0; c < channels; c++) {
+        ChannelState& channel = state[c];
+        __m128 s1 = _mm_load_ps(channel.s1);
+        __m128 s2 = _mm_load_ps(channel.s2);
+        __m128 y = _mm_load_ps(channel.y);
+        for (size_t i = 0; i < frames; i++) {
+            float* sample = samples + i * channels + c;
+            // [input, y0, y1, y2]: every lane moves up one section
+            __m128 shifted = _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(y), 4));
+            __m128 x = _mm_move_ss(shifted, _mm_set_ss(*sample));
+            y = _mm_add_ps(_mm_mul_ps(vb0, x), s1);
+            s1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(vb1, x), s2), _mm_mul_ps(va1, y));
+            s2 = _mm_sub_ps(_mm_mul_ps(vb2, x), _mm_mul_ps(va2, y));
+            *sample = _mm_cvtss_f32(_mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+        _mm_store_ps(channel.s1, s1);
+        _mm_store_ps(channel.s2, s2);
+        _mm_store_ps(channel.y, y);
+    }
+    flushDenormals();
+}
+
+#else
+
+void BiquadCascade::process(float* samples, size_t frames) {
+    processScalar(samples, frames);
+}
+
+#endif
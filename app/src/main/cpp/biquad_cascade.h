@@ -0,0 +1,69 @@
+#ifndef AUDIORECORDINGAPP_BIQUAD_CASCADE_H
+#define AUDIORECORDINGAPP_BIQUAD_CASCADE_H
+
+#include <cstddef>
+
+// One second-order section, normalized so a0 = 1. The defaults pass
+// samples through unchanged.
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+
+    // RBJ cookbook high-pass at |frequency| Hz with quality |q|
+    static BiquadCoefficients highPass(double sampleRate, double frequency, double q);
+};
+
+// Up to MAX_SECTIONS biquads in series over interleaved float blocks, in
+// place, each channel with its own state. The sections run side by side
+// in the lanes of one vector, section k on the sample section k-1 produced
+// one step earlier, so a whole cascade costs one vector update per sample
+// where a plain loop would take one update per section. The price is a
+// fixed delay of LATENCY_FRAMES, whatever the number of sections in use;
+// unused sections pass samples through. NEON or SSE where available.
+//
+// Does not allocate. State tiny enough to turn denormal is flushed to
+// zero after every block.
+class BiquadCascade {
+public:
+    static const int MAX_SECTIONS = 4;
+    static const int MAX_CHANNELS = 2;
+    static const int LATENCY_FRAMES = MAX_SECTIONS - 1;
+
+private:
+    // Per lane: coefficients, and for each channel the transposed direct
+    // form II state and the output from the last sample
+    alignas(16) float b0[MAX_SECTIONS];
+    alignas(16) float b1[MAX_SECTIONS];
+    alignas(16) float b2[MAX_SECTIONS];
+    alignas(16) float a1[MAX_SECTIONS];
+    alignas(16) float a2[MAX_SECTIONS];
+
+    struct ChannelState {
+        alignas(16) float s1[MAX_SECTIONS];
+        alignas(16) float s2[MAX_SECTIONS];
+        alignas(16) float y[MAX_SECTIONS];
+    };
+    ChannelState state[MAX_CHANNELS];
+    int channels;
+
+    void flushDenormals();
+
+public:
+    explicit BiquadCascade(int channels = 1);
+
+    // Keeps the running state, so a filter can be retuned mid-stream
+    void setSections(const BiquadCoefficients* sections, int count);
+    void setChannels(int channels);
+    void reset();
+
+    void process(float* samples, size_t frames);
+
+    // Same lanes in plain loops, kept as the reference for tests and
+    // benchmarks
+    void processScalar(float* samples, size_t frames);
+};
+
+#endif // AUDIORECORDINGAPP_BIQUAD_CASCADE_H
@@ -0,0 +1,149 @@
+#ifndef AUDIORECORDINGAPP_EDIT_LIST_H
+#define AUDIORECORDINGAPP_EDIT_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sample_format.h"
+#include "wav_file.h"
+
+// A stretch of one source take, in frames
+struct EditRange {
+    size_t source = 0;
+    uint64_t startFrame = 0;
+    uint64_t frameCount = 0;
+};
+
+// Non-destructive edit of one or more WAV takes: an ordered list of
+// source ranges played back to back. Trimming, cutting, splitting and
+// joining rewrite the list and never the audio, so each costs the same
+// whatever the take length. A PlaybackStream plays the list straight from
+// the sources; render() writes it out as a new WAV, copying the inside of
+// each range as it is and only processing the samples at the joins.
+//
+// Joins are hard cuts unless a crossfade is set. The fade is centred on
+// the join and runs into the material the edit left out on either side,
+// so it never changes the length or where anything sits on the timeline.
+// It is shortened to what is there; a join with nothing cut away on one
+// side, such as two whole takes end to end, stays a hard cut.
+//
+// Every source has the sample rate, channel count and format of the
+// first. Positions are timeline frames. Copies share the open sources, so
+// a player can take a snapshot to read from its own thread while the
+// original goes on being edited.
+class EditList {
+public:
+    static const size_t MAX_RANGES = 4096;
+
+private:
+    struct Source {
+        std::string path;
+        WavInfo info;
+        int fd = -1;
+
+        ~Source();
+    };
+
+    // The timeline as read: plain source frames, or a crossfade from the
+    // end of one range into the start of the next
+    struct Piece {
+        uint64_t timelineFrame = 0;
+        uint64_t frameCount = 0;
+        size_t source = 0;
+        uint64_t sourceFrame = 0;
+        bool fade = false;
+        size_t fadeSource = 0;
+        uint64_t fadeSourceFrame = 0;
+    };
+
+    std::vector<std::shared_ptr<const Source>> sources;
+    std::vector<EditRange> ranges;
+    std::vector<Piece> pieces;
+    uint64_t crossfadeFrames = 0;
+    uint64_t frameCount = 0;
+
+    SampleFormat format = SampleFormat::INT16;
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint16_t blockAlign = 0;
+
+    // Merges ranges that run on in the same source, then lays out pieces
+    void rebuild();
+    // Index of the range that starts at |frame|, splitting one if needed;
+    // ranges.size() for the end of the timeline
+    size_t splitRange(uint64_t frame);
+    size_t findPiece(uint64_t frame) const;
+    bool readSource(size_t source, uint64_t sourceFrame, uint8_t* out, size_t frames) const;
+    bool readFade(const Piece& piece, uint64_t offset, uint8_t* out, size_t frames) const;
+
+public:
+    // Opens |path| as a source, or finds it if it already is one, and
+    // returns its index; -1 if it cannot be read or does not match
+    int addSource(const std::string& path);
+
+    // Plays |frames| of a source from |startFrame| after everything else
+    bool append(size_t source, uint64_t startFrame, uint64_t frames);
+    // Joins another list on the end
+    bool append(const EditList& other);
+
+    // Removes |frames| from |start| and closes the gap
+    bool cut(uint64_t start, uint64_t frames);
+    // Keeps only |frames| from |start|
+    bool trim(uint64_t start, uint64_t frames);
+    // Moves everything from |frame| on into |tail|
+    bool split(uint64_t frame, EditList& tail);
+
+    void setCrossfade(uint64_t frames);
+    void clear();
+
+    // Up to |maxFrames| frames from timeline |frame| into |out|, in the
+    // sources' format; returns how many. Safe from any number of threads
+    // while the list is not edited.
+    size_t read(uint64_t frame, uint8_t* out, size_t maxFrames) const;
+
+    // Writes the timeline to |path| as a WAV: range interiors are copied
+    // byte for byte in large blocks, and only the crossfades are decoded
+    // and mixed.
+    bool render(const std::string& path) const;
+
+    // Source paths and ranges, so an edit outlives the process
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    const std::vector<EditRange>& getRanges() const {
+        return ranges;
+    }
+
+    const std::string& getSourcePath(size_t source) const {
+        return sources[source]->path;
+    }
+
+    uint64_t getSourceFrameCount(size_t source) const {
+        return sources[source]->info.dataSize / blockAlign;
+    }
+
+    uint64_t getFrameCount() const {
+        return frameCount;
+    }
+
+    uint64_t getCrossfade() const {
+        return crossfadeFrames;
+    }
+
+    SampleFormat getFormat() const {
+        return format;
+    }
+
+    uint32_t getSampleRate() const {
+        return sampleRate;
+    }
+
+    uint16_t getChannels() const {
+        return channels;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_EDIT_LIST_H
@@ -0,0 +1,190 @@
+#include "effect_chain.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Fourth-order Butterworth as two sections
+static const double BUTTERWORTH_Q[2] = {0.54119610014619701, 1.3065629648763766};
+
+static float fromDb(double db) {
+    return static_cast<float>(std::pow(10.0, db / 20.0));
+}
+
+// One-pole smoothing coefficient reaching ~63% of a step in |ms|
+static float smoothingPerFrame(double ms, int sampleRate) {
+    return static_cast<float>(1.0 - std::exp(-1000.0 / (ms * sampleRate)));
+}
+
+EffectChain::EffectChain(int sampleRate, int channels)
+    : sampleRate(sampleRate), channels(std::min(std::max(channels, 1), MAX_CHANNELS)), highPass(this->channels) {
+}
+
+void EffectChain::configure(int sampleRate, int channels) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    this->sampleRate = sampleRate;
+    this->channels = std::min(std::max(channels, 1), MAX_CHANNELS);
+    highPass.setChannels(this->channels);
+    resetState();
+    params.write(makeParams());
+}
+
+void EffectChain::setSettings(const EffectSettings& settings) {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    this->settings = settings;
+    params.write(makeParams());
+}
+
+EffectSettings EffectChain::getSettings() {
+    std::lock_guard<std::mutex> lock(settingsMutex);
+    return settings;
+}
+
+EffectChain::Params EffectChain::makeParams() const {
+    Params p;
+    p.highPass = settings.highPassHz > 0.0f;
+    if (p.highPass) {
+        for (int i = 0; i < 2; i++) {
+            p.sections[i] = BiquadCoefficients::highPass(sampleRate, settings.highPassHz, BUTTERWORTH_Q[i]);
+        }
+    }
+
+    p.gate = settings.gateEnabled;
+    p.gateOpenLevel = fromDb(settings.gateThresholdDb);
+    p.gateCloseLevel = fromDb(settings.gateThresholdDb - GATE_HYSTERESIS_DB);
+    p.gateFloor = fromDb(-GATE_RANGE_DB);
+    // At least a frame, so an open gate always counts as held
+    p.gateHoldFrames = std::max<uint32_t>(1, static_cast<uint32_t>(
+            static_cast<int64_t>(std::max(settings.gateHoldMs, 0)) * sampleRate / 1000));
+    p.gateAttack = smoothingPerFrame(GATE_ATTACK_MS, sampleRate);
+    p.gateRelease = smoothingPerFrame(GATE_RELEASE_MS, sampleRate);
+
+    const double nepersPerDb = std::log(10.0) / 20.0;
+    p.agc = settings.agcEnabled;
+    p.agcTargetPower = fromDb(2.0 * settings.agcTargetDb);
+    p.agcMinPower = fromDb(2.0 * AGC_MIN_INPUT_DB);
+    p.agcMinGain = fromDb(AGC_MIN_GAIN_DB);
+    p.agcMaxGain = fromDb(settings.agcMaxGainDb);
+    p.agcDownPerFrame = static_cast<float>(nepersPerDb * AGC_DOWN_DB_PER_SECOND / sampleRate);
+    p.agcUpPerFrame = static_cast<float>(nepersPerDb * AGC_UP_DB_PER_SECOND / sampleRate);
+
+    p.limiter = settings.limiterEnabled;
+    p.limiterCeiling = fromDb(settings.limiterCeilingDb);
+    p.limiterRelease = smoothingPerFrame(LIMITER_RELEASE_MS, sampleRate);
+    return p;
+}
+
+void EffectChain::resetState() {
+    highPass.reset();
+    gateGain = 1.0f;
+    gateHold = 0;
+    agcGain = 1.0f;
+    limiterGain = 1.0f;
+}
+
+bool EffectChain::beginBlock() {
+    if (params.update()) {
+        const Params& p = params.read();
+        highPass.setSections(p.sections, p.highPass ? 2 : 0);
+        // An effect switched off starts from unity when it comes back
+        if (!p.highPass) highPass.reset();
+        if (!p.gate) {
+            gateGain = 1.0f;
+            gateHold = 0;
+        }
+        if (!p.agc) agcGain = 1.0f;
+        if (!p.limiter) limiterGain = 1.0f;
+    }
+    const Params& p = params.read();
+    return p.highPass || p.gate || p.agc || p.limiter;
+}
+
+void EffectChain::process(float* samples, size_t frames) {
+    const Params& p = params.read();
+    if (p.highPass) highPass.process(samples, frames);
+    if (p.gate) processGate(p, samples, frames);
+    if (p.agc) processAgc(p, samples, frames);
+    if (p.limiter) processLimiter(p, samples, frames);
+}
+
+void EffectChain::processGate(const Params& p, float* samples, size_t frames) {
+    float gain = gateGain;
+    uint32_t hold = gateHold;
+    for (size_t i = 0; i < frames; i++) {
+        float* frame = samples + i * channels;
+        float peak = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            peak = std::max(peak, std::fabs(frame[c]));
+        }
+
+        // Open, the gate holds on down to the lower level
+        if (peak >= (hold > 0 ? p.gateCloseLevel : p.gateOpenLevel)) {
+            hold = p.gateHoldFrames;
+        } else if (hold > 0) {
+            hold--;
+        }
+        float target = hold > 0 ? 1.0f : p.gateFloor;
+        gain += (target - gain) * (target > gain ? p.gateAttack : p.gateRelease);
+
+        for (int c = 0; c < channels; c++) {
+            frame[c] *= gain;
+        }
+    }
+    gateGain = gain;
+    gateHold = hold;
+}
+
+void EffectChain::processAgc(const Params& p, float* samples, size_t frames) {
+    if (frames == 0) {
+        return;
+    }
+    size_t count = frames * channels;
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i] * samples[i];
+    }
+    float power = sum / static_cast<float>(count);
+
+    // Gain toward the target level, within the range and the rate limits
+    float target = agcGain;
+    if (power > p.agcMinPower) {
+        target = std::sqrt(p.agcTargetPower / power);
+        target = std::min(std::max(target, p.agcMinGain), p.agcMaxGain);
+        float lowest = agcGain * std::exp(-p.agcDownPerFrame * static_cast<float>(frames));
+        float highest = agcGain * std::exp(p.agcUpPerFrame * static_cast<float>(frames));
+        target = std::min(std::max(target, lowest), highest);
+    }
+
+    // Ramped across the block, so a change never steps
+    float gain = agcGain;
+    float step = (target - agcGain) / static_cast<float>(frames);
+    for (size_t i = 0; i < frames; i++) {
+        gain += step;
+        float* frame = samples + i * channels;
+        for (int c = 0; c < channels; c++) {
+            frame[c] *= gain;
+        }
+    }
+    agcGain = target;
+}
+
+void EffectChain::processLimiter(const Params& p, float* samples, size_t frames) {
+    // Instant attack, so nothing gets past the ceiling; the gain then
+    // recovers toward unity
+    float gain = limiterGain;
+    for (size_t i = 0; i < frames; i++) {
+        float* frame = samples + i * channels;
+        float peak = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            peak = std::max(peak, std::fabs(frame[c]));
+        }
+
+        gain += (1.0f - gain) * p.limiterRelease;
+        if (peak * gain > p.limiterCeiling) {
+            gain = p.limiterCeiling / peak;
+        }
+        for (int c = 0; c < channels; c++) {
+            frame[c] *= gain;
+        }
+    }
+    limiterGain = gain;
+}
@@ -0,0 +1,135 @@
+#ifndef AUDIORECORDINGAPP_EFFECT_CHAIN_H
+#define AUDIORECORDINGAPP_EFFECT_CHAIN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "biquad_cascade.h"
+#include "triple_buffer.h"
+
+// Which capture effects run, and how. Levels are dBFS, full scale 0 dB.
+struct EffectSettings {
+    // Fourth-order Butterworth high-pass against DC offset, handling noise
+    // and rumble; 0 leaves it out
+    float highPassHz = 0.0f;
+
+    // Turns the input down by GATE_RANGE_DB while its peaks stay under the
+    // threshold, after holding open for |gateHoldMs|
+    bool gateEnabled = false;
+    float gateThresholdDb = -50.0f;
+    int gateHoldMs = 100;
+
+    // Slowly rides the gain so speech sits around |agcTargetDb| RMS,
+    // boosting by no more than |agcMaxGainDb|
+    bool agcEnabled = false;
+    float agcTargetDb = -18.0f;
+    float agcMaxGainDb = 24.0f;
+
+    // Brickwall peak limiter, last in the chain
+    bool limiterEnabled = false;
+    float limiterCeilingDb = -1.0f;
+};
+
+// In-place effects for interleaved float capture blocks: high-pass, noise
+// gate, automatic gain and limiter, in that order. The gate and limiter
+// act on both channels of a frame alike, so the stereo image holds.
+//
+// setSettings() may be called from any thread at any time, including mid-
+// take: it works out every coefficient on the caller's thread and hands
+// them over through a TripleBuffer, which the audio thread picks up at its
+// next block without waiting. Processing never allocates, locks or takes
+// a logarithm.
+class EffectChain {
+public:
+    static const int MAX_CHANNELS = BiquadCascade::MAX_CHANNELS;
+    static constexpr float GATE_RANGE_DB = 40.0f;
+
+private:
+    // How far under the opening threshold the input must fall before a
+    // gate that is open starts its hold
+    static constexpr float GATE_HYSTERESIS_DB = 6.0f;
+    static constexpr float GATE_ATTACK_MS = 1.0f;
+    static constexpr float GATE_RELEASE_MS = 60.0f;
+    // Gain rides down faster than up, so a sudden loud passage is tamed
+    // before a quiet one is brought up
+    static constexpr float AGC_DOWN_DB_PER_SECOND = 20.0f;
+    static constexpr float AGC_UP_DB_PER_SECOND = 6.0f;
+    static constexpr float AGC_MIN_GAIN_DB = -12.0f;
+    // Blocks quieter than this leave the gain where it is, so pauses and
+    // room tone are not pumped up
+    static constexpr float AGC_MIN_INPUT_DB = -55.0f;
+    static constexpr float LIMITER_RELEASE_MS = 80.0f;
+
+    // Everything processing needs, as linear gains and per-frame
+    // coefficients
+    struct Params {
+        bool highPass = false;
+        BiquadCoefficients sections[2];
+
+        bool gate = false;
+        float gateOpenLevel = 0.0f;
+        float gateCloseLevel = 0.0f;
+        float gateFloor = 1.0f;
+        uint32_t gateHoldFrames = 0;
+        float gateAttack = 1.0f;
+        float gateRelease = 1.0f;
+
+        bool agc = false;
+        float agcTargetPower = 0.0f;
+        float agcMinPower = 0.0f;
+        float agcMinGain = 1.0f;
+        float agcMaxGain = 1.0f;
+        // Per-frame limits on the gain's rate of change, as natural logs
+        float agcDownPerFrame = 0.0f;
+        float agcUpPerFrame = 0.0f;
+
+        bool limiter = false;
+        float limiterCeiling = 1.0f;
+        float limiterRelease = 1.0f;
+    };
+
+    // Serializes writers; the audio thread never takes it
+    std::mutex settingsMutex;
+    EffectSettings settings;
+    int sampleRate;
+    int channels;
+    TripleBuffer<Params> params;
+
+    // Audio thread only
+    BiquadCascade highPass;
+    float gateGain = 1.0f;
+    uint32_t gateHold = 0;
+    float agcGain = 1.0f;
+    float limiterGain = 1.0f;
+
+    Params makeParams() const;
+    void resetState();
+
+    void processGate(const Params& p, float* samples, size_t frames);
+    void processAgc(const Params& p, float* samples, size_t frames);
+    void processLimiter(const Params& p, float* samples, size_t frames);
+
+public:
+    EffectChain(int sampleRate, int channels);
+
+    EffectChain(const EffectChain&) = delete;
+    EffectChain& operator=(const EffectChain&) = delete;
+
+    // New stream format; starts the effects over. Not while the audio
+    // thread is processing.
+    void configure(int sampleRate, int channels);
+
+    // Any thread
+    void setSettings(const EffectSettings& settings);
+    EffectSettings getSettings();
+
+    // Audio thread: takes up new settings, if any, and tells whether any
+    // effect is on. Call once per block, ahead of process().
+    bool beginBlock();
+
+    // Audio thread: runs the enabled effects over |frames| frames in place
+    void process(float* samples, size_t frames);
+};
+
+#endif // AUDIORECORDINGAPP_EFFECT_CHAIN_H
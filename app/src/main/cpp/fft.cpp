@@ -0,0 +1,299 @@
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "sample_convert.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FFT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define FFT_SSE2 1
+#endif
+
+static const double PI = 3.14159265358979323846;
+
+bool FftPlan::isValidSize(size_t size) {
+    return size >= MIN_SIZE && size <= MAX_SIZE && (size & (size - 1)) == 0;
+}
+
+FftPlan::FftPlan(size_t size) : size(size), workRe(size), workIm(size) {
+    for (size_t n = size; n >= 4; n /= 4) {
+        size_t quarter = n / 4;
+        for (int k = 1; k <= 3; k++) {
+            for (size_t p = 0; p < quarter; p++) {
+                twiddles.push_back(static_cast<float>(std::cos(2.0 * PI * k * p / n)));
+            }
+            for (size_t p = 0; p < quarter; p++) {
+                twiddles.push_back(static_cast<float>(-std::sin(2.0 * PI * k * p / n)));
+            }
+        }
+    }
+}
+
+// One radix-4 Stockham stage over |n|-point transforms |s| apart: the four
+// quarters of x, combined and twiddled, interleave into y
+static void radix4Scalar(size_t n, size_t s, const float* xr, const float* xi, float* yr, float* yi,
+                         const float* tw) {
+    size_t quarter = n / 4;
+    const float* w1r = tw;
+    const float* w1i = tw + quarter;
+    const float* w2r = tw + 2 * quarter;
+    const float* w2i = tw + 3 * quarter;
+    const float* w3r = tw + 4 * quarter;
+    const float* w3i = tw + 5 * quarter;
+    for (size_t p = 0; p < quarter; p++) {
+        for (size_t q = 0; q < s; q++) {
+            size_t a = q + s * p;
+            size_t b = a + s * quarter;
+            size_t c = b + s * quarter;
+            size_t d = c + s * quarter;
+            float apcR = xr[a] + xr[c], apcI = xi[a] + xi[c];
+            float amcR = xr[a] - xr[c], amcI = xi[a] - xi[c];
+            float bpdR = xr[b] + xr[d], bpdI = xi[b] + xi[d];
+            float bmdR = xr[b] - xr[d], bmdI = xi[b] - xi[d];
+
+            // (a - c) - j(b - d), (a + c) - (b + d), (a - c) + j(b - d)
+            float t1R = amcR + bmdI, t1I = amcI - bmdR;
+            float t2R = apcR - bpdR, t2I = apcI - bpdI;
+            float t3R = amcR - bmdI, t3I = amcI + bmdR;
+
+            size_t out = q + s * 4 * p;
+            yr[out] = apcR + bpdR;
+            yi[out] = apcI + bpdI;
+            yr[out + s] = t1R * w1r[p] - t1I * w1i[p];
+            yi[out + s] = t1R * w1i[p] + t1I * w1r[p];
+            yr[out + 2 * s] = t2R * w2r[p] - t2I * w2i[p];
+            yi[out + 2 * s] = t2R * w2i[p] + t2I * w2r[p];
+            yr[out + 3 * s] = t3R * w3r[p] - t3I * w3i[p];
+            yi[out + 3 * s] = t3R * w3i[p] + t3I * w3r[p];
+        }
+    }
+}
+
+// The last stage of an odd power of two: 2-point transforms, no twiddles
+static void radix2Scalar(size_t s, const float* xr, const float* xi, float* yr, float* yi) {
+    for (size_t q = 0; q < s; q++) {
+        float ar = xr[q], ai = xi[q], br = xr[q + s], bi = xi[q + s];
+        yr[q] = ar + br;
+        yi[q] = ai + bi;
+        yr[q + s] = ar - br;
+        yi[q + s] = ai - bi;
+    }
+}
+
+#if FFT_NEON || FFT_SSE2
+
+#if FFT_NEON
+
+typedef float32x4_t Vec;
+
+static inline Vec load(const float* p) { return vld1q_f32(p); }
+static inline void store(float* p, Vec v) { vst1q_f32(p, v); }
+static inline Vec splat(float value) { return vdupq_n_f32(value); }
+static inline Vec add(Vec a, Vec b) { return vaddq_f32(a, b); }
+static inline Vec sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+static inline Vec mul(Vec a, Vec b) { return vmulq_f32(a, b); }
+
+static inline void transpose(Vec& a, Vec& b, Vec& c, Vec& d) {
+    float32x4x2_t ab = vtrnq_f32(a, b);
+    float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+#else
+
+typedef __m128 Vec;
+
+static inline Vec load(const float* p) { return _mm_loadu_ps(p); }
+static inline void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+static inline Vec splat(float value) { return _mm_set1_ps(value); }
+static inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+static inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+static inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+
+static inline void transpose(Vec& a, Vec& b, Vec& c, Vec& d) {
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+}
+
+#endif
+
+// Four radix-4 butterflies at once; y0..y3 come back as real and
+// imaginary pairs
+struct Butterfly {
+    Vec r[4];
+    Vec i[4];
+};
+
+static inline Butterfly butterfly(Vec ar, Vec ai, Vec br, Vec bi, Vec cr, Vec ci, Vec dr, Vec di,
+                                  const Vec w1[2], const Vec w2[2], const Vec w3[2]) {
+    Vec apcR = add(ar, cr), apcI = add(ai, ci);
+    Vec amcR = sub(ar, cr), amcI = sub(ai, ci);
+    Vec bpdR = add(br, dr), bpdI = add(bi, di);
+    Vec bmdR = sub(br, dr), bmdI = sub(bi, di);
+
+    Vec t1R = add(amcR, bmdI), t1I = sub(amcI, bmdR);
+    Vec t2R = sub(apcR, bpdR), t2I = sub(apcI, bpdI);
+    Vec t3R = sub(amcR, bmdI), t3I = add(amcI, bmdR);
+
+    Butterfly out;
+    out.r[0] = add(apcR, bpdR);
+    out.i[0] = add(apcI, bpdI);
+    out.r[1] = sub(mul(t1R, w1[0]), mul(t1I, w1[1]));
+    out.i[1] = add(mul(t1R, w1[1]), mul(t1I, w1[0]));
+    out.r[2] = sub(mul(t2R, w2[0]), mul(t2I, w2[1]));
+    out.i[2] = add(mul(t2R, w2[1]), mul(t2I, w2[0]));
+    out.r[3] = sub(mul(t3R, w3[0]), mul(t3I, w3[1]));
+    out.i[3] = add(mul(t3R, w3[1]), mul(t3I, w3[0]));
+    return out;
+}
+
+static void radix4(size_t n, size_t s, const float* xr, const float* xi, float* yr, float* yi, const float* tw) {
+    size_t quarter = n / 4;
+    if (s == 1) {
+        // The first stage: four consecutive butterflies across the lanes,
+        // each with its own twiddles, then a transpose so each one's four
+        // outputs go out together
+        for (size_t p = 0; p < quarter; p += 4) {
+            const Vec w1[2] = {load(tw + p), load(tw + quarter + p)};
+            const Vec w2[2] = {load(tw + 2 * quarter + p), load(tw + 3 * quarter + p)};
+            const Vec w3[2] = {load(tw + 4 * quarter + p), load(tw + 5 * quarter + p)};
+            Butterfly out = butterfly(load(xr + p), load(xi + p), load(xr + p + quarter), load(xi + p + quarter),
+                                      load(xr + p + 2 * quarter), load(xi + p + 2 * quarter),
+                                      load(xr + p + 3 * quarter), load(xi + p + 3 * quarter), w1, w2, w3);
+            transpose(out.r[0], out.r[1], out.r[2], out.r[3]);
+            transpose(out.i[0], out.i[1], out.i[2], out.i[3]);
+            for (int k = 0; k < 4; k++) {
+                store(yr + 4 * (p + k), out.r[k]);
+                store(yi + 4 * (p + k), out.i[k]);
+            }
+        }
+        return;
+    }
+
+    // Later stages: runs of s inputs share each twiddle
+    for (size_t p = 0; p < quarter; p++) {
+        const Vec w1[2] = {splat(tw[p]), splat(tw[quarter + p])};
+        const Vec w2[2] = {splat(tw[2 * quarter + p]), splat(tw[3 * quarter + p])};
+        const Vec w3[2] = {splat(tw[4 * quarter + p]), splat(tw[5 * quarter + p])};
+        size_t a = s * p;
+        size_t b = a + s * quarter;
+        size_t c = b + s * quarter;
+        size_t d = c + s * quarter;
+        size_t out = s * 4 * p;
+        for (size_t q = 0; q < s; q += 4) {
+            Butterfly result = butterfly(load(xr + a + q), load(xi + a + q), load(xr + b + q), load(xi + b + q),
+                                         load(xr + c + q), load(xi + c + q), load(xr + d + q), load(xi + d + q),
+                                         w1, w2, w3);
+            for (int k = 0; k < 4; k++) {
+                store(yr + out + k * s + q, result.r[k]);
+                store(yi + out + k * s + q, result.i[k]);
+            }
+        }
+    }
+}
+
+static void radix2(size_t s, const float* xr, const float* xi, float* yr, float* yi) {
+    for (size_t q = 0; q < s; q += 4) {
+        Vec ar = load(xr + q), ai = load(xi + q), br = load(xr + q + s), bi = load(xi + q + s);
+        store(yr + q, add(ar, br));
+        store(yi + q, add(ai, bi));
+        store(yr + q + s, sub(ar, br));
+        store(yi + q + s, sub(ai, bi));
+    }
+}
+
+#else
+
+static void radix4(size_t n, size_t s, const float* xr, const float* xi, float* yr, float* yi, const float* tw) {
+    radix4Scalar(n, s, xr, xi, yr, yi, tw);
+}
+
+static void radix2(size_t s, const float* xr, const float* xi, float* yr, float* yi) {
+    radix2Scalar(s, xr, xi, yr, yi);
+}
+
+#endif
+
+template <bool Vectorized>
+static void runStages(size_t size, const float* twiddles, float* re, float* im, float* workRe, float* workIm) {
+    float* xr = re;
+    float* xi = im;
+    float* yr = workRe;
+    float* yi = workIm;
+    size_t n = size;
+    size_t s = 1;
+    const float* tw = twiddles;
+    for (; n >= 4; n /= 4, s *= 4) {
+        if (Vectorized) {
+            radix4(n, s, xr, xi, yr, yi, tw);
+        } else {
+            radix4Scalar(n, s, xr, xi, yr, yi, tw);
+        }
+        tw += 6 * (n / 4);
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    if (n == 2) {
+        if (Vectorized) {
+            radix2(s, xr, xi, yr, yi);
+        } else {
+            radix2Scalar(s, xr, xi, yr, yi);
+        }
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+
+    // An odd number of stages leaves the result in the work buffers
+    if (xr != re) {
+        std::copy(xr, xr + size, re);
+        std::copy(xi, xi + size, im);
+    }
+}
+
+void FftPlan::forward(float* re, float* im) {
+    runStages<true>(size, twiddles.data(), re, im, workRe.data(), workIm.data());
+}
+
+void FftPlan::forwardScalar(float* re, float* im) {
+    runStages<false>(size, twiddles.data(), re, im, workRe.data(), workIm.data());
+}
+
+bool RealFft::isValidSize(size_t size) {
+    return size % 2 == 0 && FftPlan::isValidSize(size / 2);
+}
+
+RealFft::RealFft(size_t size)
+    : size(size), plan(size / 2), cosines(size / 2), sines(size / 2), packedRe(size / 2), packedIm(size / 2) {
+    for (size_t k = 0; k < size / 2; k++) {
+        cosines[k] = static_cast<float>(std::cos(2.0 * PI * k / size));
+        sines[k] = static_cast<float>(std::sin(2.0 * PI * k / size));
+    }
+}
+
+void RealFft::forward(const float* in, float* re, float* im) {
+    const size_t half = size / 2;
+    deinterleaveStereo(in, packedRe.data(), packedIm.data(), half);
+    plan.forward(packedRe.data(), packedIm.data());
+
+    // Z[k] and conj(Z[half - k]) give the even and odd samples' spectra,
+    // E and O; the odd one is then shifted by half a sample
+    re[0] = packedRe[0] + packedIm[0];
+    im[0] = 0.0f;
+    re[half] = packedRe[0] - packedIm[0];
+    im[half] = 0.0f;
+    for (size_t k = 1; k < half; k++) {
+        float zr = packedRe[k], zi = packedIm[k];
+        float cr = packedRe[half - k], ci = -packedIm[half - k];
+        float evenR = 0.5f * (zr + cr), evenI = 0.5f * (zi + ci);
+        float oddR = 0.5f * (zi - ci), oddI = -0.5f * (zr - cr);
+        re[k] = evenR + cosines[k] * oddR + sines[k] * oddI;
+        im[k] = evenI + cosines[k] * oddI - sines[k] * oddR;
+    }
+}
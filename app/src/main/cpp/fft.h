@@ -0,0 +1,79 @@
+#ifndef AUDIORECORDINGAPP_FFT_H
+#define AUDIORECORDINGAPP_FFT_H
+
+#include <cstddef>
+#include <vector>
+
+// Forward complex FFT of a fixed power-of-two size, on split real and
+// imaginary arrays. Stockham autosort, so there is no bit-reversal pass:
+// radix-4 stages, and one radix-2 stage at the end for odd powers of two.
+// Every twiddle factor is worked out when the plan is made. The first
+// stage runs four butterflies across the vector lanes and transposes its
+// outputs; every later stage has runs of at least four contiguous inputs
+// that share a twiddle. NEON or SSE where available.
+//
+// Unnormalized: a unit impulse gives all ones. A plan holds its own work
+// buffer, so one plan serves one thread.
+class FftPlan {
+public:
+    static const size_t MIN_SIZE = 16;
+    static const size_t MAX_SIZE = 32768;
+
+private:
+    size_t size;
+    // Per radix-4 stage, n/4 each of w^p, w^2p and w^3p as real then
+    // imaginary runs, stages one after another
+    std::vector<float> twiddles;
+    std::vector<float> workRe;
+    std::vector<float> workIm;
+
+public:
+    // |size| must be a power of two from MIN_SIZE to MAX_SIZE
+    explicit FftPlan(size_t size);
+
+    static bool isValidSize(size_t size);
+
+    size_t getSize() const {
+        return size;
+    }
+
+    // In place
+    void forward(float* re, float* im);
+
+    // Same stages in plain loops, kept as the reference for tests and
+    // benchmarks
+    void forwardScalar(float* re, float* im);
+};
+
+// Forward FFT of |size| real samples, through an FftPlan of half the size:
+// even samples as the real part, odd as the imaginary, then split apart.
+// Gives the size / 2 + 1 bins from DC to Nyquist.
+class RealFft {
+private:
+    size_t size;
+    FftPlan plan;
+    // cos and sin of 2 pi k / size, for k up to size / 2
+    std::vector<float> cosines;
+    std::vector<float> sines;
+    std::vector<float> packedRe;
+    std::vector<float> packedIm;
+
+public:
+    // |size| must be a power of two from 2 * FftPlan::MIN_SIZE up
+    explicit RealFft(size_t size);
+
+    static bool isValidSize(size_t size);
+
+    size_t getSize() const {
+        return size;
+    }
+
+    size_t getBinCount() const {
+        return size / 2 + 1;
+    }
+
+    // |re| and |im| take getBinCount() values
+    void forward(const float* in, float* re, float* im);
+};
+
+#endif // AUDIORECORDINGAPP_FFT_H
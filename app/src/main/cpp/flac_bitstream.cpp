@@ -0,0 +1,40 @@
+#include "flac_bitstream.h"
+
+// CRC-8 (polynomial x^8 + x^2 + x + 1) over the frame header and CRC-16
+// (x^16 + x^15 + x^2 + 1) over the whole frame, both MSB first, zero init
+
+uint8_t flacCrc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static const uint16_t* getCrc16Table() {
+    static uint16_t table[256];
+    static bool built = [] {
+        for (int i = 0; i < 256; i++) {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x8005) : static_cast<uint16_t>(crc << 1);
+            }
+            table[i] = crc;
+        }
+        return true;
+    }();
+    (void) built;
+    return table;
+}
+
+uint16_t flacCrc16(const uint8_t* data, size_t size) {
+    const uint16_t* table = getCrc16Table();
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
@@ -0,0 +1,136 @@
+#ifndef AUDIORECORDINGAPP_FLAC_BITSTREAM_H
+#define AUDIORECORDINGAPP_FLAC_BITSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Bit-level reader and writer for FLAC frames (MSB first), plus the two
+// frame checksums. Shared by the encoder and decoder.
+
+uint8_t flacCrc8(const uint8_t* data, size_t size);
+uint16_t flacCrc16(const uint8_t* data, size_t size);
+
+class FlacBitWriter {
+private:
+    std::vector<uint8_t>& out;
+    uint64_t accumulator = 0;
+    int pendingBits = 0;
+
+public:
+    explicit FlacBitWriter(std::vector<uint8_t>& out) : out(out) {
+    }
+
+    // Appends the low |bits| bits of |value|, bits <= 32
+    void write(uint32_t value, int bits) {
+        if (bits == 0) return;
+        accumulator = (accumulator << bits) | (value & (0xFFFFFFFFull >> (32 - bits)));
+        pendingBits += bits;
+        while (pendingBits >= 8) {
+            pendingBits -= 8;
+            out.push_back(static_cast<uint8_t>(accumulator >> pendingBits));
+        }
+    }
+
+    void writeSigned(int32_t value, int bits) {
+        write(static_cast<uint32_t>(value), bits);
+    }
+
+    // |zeros| zero bits followed by a one
+    void writeUnary(uint32_t zeros) {
+        while (zeros >= 32) {
+            write(0, 32);
+            zeros -= 32;
+        }
+        write(1, zeros + 1);
+    }
+
+    // Zigzag-folded value: quotient in unary, then |parameter| low bits
+    void writeRice(int32_t value, int parameter) {
+        uint32_t folded = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        writeUnary(folded >> parameter);
+        write(folded, parameter);
+    }
+
+    // Pads with zero bits to the next byte boundary
+    void alignToByte() {
+        if (pendingBits > 0) write(0, 8 - pendingBits);
+    }
+};
+
+class FlacBitReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t bitPosition = 0;
+    bool overrun = false;
+
+public:
+    FlacBitReader(const uint8_t* data, size_t size) : data(data), size(size) {
+    }
+
+    // Reads |bits| bits as an unsigned value, bits <= 32. Reading past the
+    // end yields zeros and sets the overrun flag.
+    uint32_t read(int bits) {
+        uint64_t value = 0;
+        for (int remaining = bits; remaining > 0;) {
+            size_t byteIndex = bitPosition >> 3;
+            if (byteIndex >= size) {
+                overrun = true;
+                return 0;
+            }
+            int offset = static_cast<int>(bitPosition & 7);
+            int take = 8 - offset < remaining ? 8 - offset : remaining;
+            uint32_t byte = data[byteIndex];
+            value = (value << take) | ((byte >> (8 - offset - take)) & ((1u << take) - 1));
+            bitPosition += take;
+            remaining -= take;
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    int32_t readSigned(int bits) {
+        if (bits == 0) return 0;
+        uint32_t value = read(bits);
+        uint32_t signBit = 1u << (bits - 1);
+        return static_cast<int32_t>((value ^ signBit) - signBit);
+    }
+
+    uint32_t readUnary() {
+        uint32_t zeros = 0;
+        while (true) {
+            size_t byteIndex = bitPosition >> 3;
+            if (byteIndex >= size) {
+                overrun = true;
+                return zeros;
+            }
+            // Skip whole zero bytes at once when byte aligned
+            if ((bitPosition & 7) == 0 && data[byteIndex] == 0) {
+                zeros += 8;
+                bitPosition += 8;
+                continue;
+            }
+            if (read(1)) return zeros;
+            zeros++;
+        }
+    }
+
+    int32_t readRice(int parameter) {
+        uint32_t folded = (readUnary() << parameter) | read(parameter);
+        return static_cast<int32_t>(folded >> 1) ^ -static_cast<int32_t>(folded & 1);
+    }
+
+    void alignToByte() {
+        bitPosition = (bitPosition + 7) & ~static_cast<size_t>(7);
+    }
+
+    size_t getBytePosition() const {
+        return bitPosition >> 3;
+    }
+
+    bool hasOverrun() const {
+        return overrun;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_FLAC_BITSTREAM_H
@@ -0,0 +1,411 @@
+#include "flac_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flac_bitstream.h"
+
+#define LOG_TAG "FlacDecoder"
+#include "audio_log.h"
+
+static const size_t STREAMINFO_SIZE = 34;
+
+static const int32_t FIXED_COEFFICIENTS[5][4] = {
+        {0, 0, 0, 0},
+        {1, 0, 0, 0},
+        {2, -1, 0, 0},
+        {3, -3, 1, 0},
+        {4, -6, 4, -1},
+};
+
+bool parseFlacStreamInfo(const uint8_t* data, size_t available, FlacStreamInfo& info,
+                         size_t& firstFrameOffset) {
+    info = FlacStreamInfo();
+    if (available < 8 + STREAMINFO_SIZE || memcmp(data, "fLaC", 4) != 0) {
+        return false;
+    }
+
+    // STREAMINFO is always the first metadata block
+    if ((data[4] & 0x7F) != 0) {
+        return false;
+    }
+
+    FlacBitReader reader(data + 8, STREAMINFO_SIZE);
+    info.minBlockSize = reader.read(16);
+    info.maxBlockSize = reader.read(16);
+    reader.read(24);
+    reader.read(24);
+    info.sampleRate = reader.read(20);
+    info.channels = static_cast<uint16_t>(reader.read(3) + 1);
+    info.bitsPerSample = static_cast<uint16_t>(reader.read(5) + 1);
+    info.totalFrames = (static_cast<uint64_t>(reader.read(4)) << 32) | reader.read(32);
+
+    // Skip the remaining metadata blocks up to the one flagged as last
+    size_t offset = 4;
+    while (true) {
+        if (offset + 4 > available) {
+            return false;
+        }
+        bool last = (data[offset] & 0x80) != 0;
+        size_t length = (static_cast<size_t>(data[offset + 1]) << 16) |
+                        (static_cast<size_t>(data[offset + 2]) << 8) | data[offset + 3];
+        offset += 4 + length;
+        if (last) break;
+    }
+
+    firstFrameOffset = offset;
+    return info.sampleRate > 0 && info.maxBlockSize > 0;
+}
+
+FlacDecoder::~FlacDecoder() {
+    close();
+}
+
+bool FlacDecoder::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    mapping = mapped;
+    mappingSize = fileSize;
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    data = static_cast<const uint8_t*>(mapping);
+    size = mappingSize;
+    if (!start()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool FlacDecoder::openMemory(const uint8_t* bytes, size_t byteCount) {
+    close();
+    data = bytes;
+    size = byteCount;
+    if (!start()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool FlacDecoder::start() {
+    if (!parseFlacStreamInfo(data, size, info, firstFrameOffset) || firstFrameOffset > size ||
+        info.channels > MAX_CHANNELS || info.bitsPerSample > 32) {
+        return false;
+    }
+
+    for (int c = 0; c < info.channels; c++) {
+        channelSamples[c].assign(info.maxBlockSize, 0);
+    }
+    rewind();
+    return true;
+}
+
+void FlacDecoder::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    data = nullptr;
+    size = 0;
+    info = FlacStreamInfo();
+    position = 0;
+    error = false;
+}
+
+bool FlacDecoder::decodeSubframe(FlacBitReader& reader, int32_t* samples, int count,
+                                 int bitsPerSample) {
+    if (reader.read(1) != 0) {
+        return false;
+    }
+    uint32_t type = reader.read(6);
+
+    int wastedBits = 0;
+    if (reader.read(1)) {
+        wastedBits = static_cast<int>(reader.readUnary()) + 1;
+        bitsPerSample -= wastedBits;
+    }
+
+    int order = 0;
+    int32_t coefficients[32];
+    int shift = 0;
+    bool lpc = false;
+
+    if (type == 0) {
+        int32_t value = reader.readSigned(bitsPerSample);
+        for (int i = 0; i < count; i++) samples[i] = value;
+    } else if (type == 1) {
+        for (int i = 0; i < count; i++) samples[i] = reader.readSigned(bitsPerSample);
+    } else if (type >= 8 && type <= 12) {
+        order = static_cast<int>(type - 8);
+    } else if (type >= 32) {
+        order = static_cast<int>(type - 31);
+        lpc = true;
+    } else {
+        return false;
+    }
+
+    if (type >= 8) {
+        if (order > count) return false;
+        for (int i = 0; i < order; i++) samples[i] = reader.readSigned(bitsPerSample);
+
+        if (lpc) {
+            int precision = static_cast<int>(reader.read(4)) + 1;
+            shift = reader.readSigned(5);
+            if (precision == 16 || shift < 0) return false;
+            for (int i = 0; i < order; i++) coefficients[i] = reader.readSigned(precision);
+        } else {
+            for (int i = 0; i < order; i++) coefficients[i] = FIXED_COEFFICIENTS[order][i];
+        }
+
+        // Residual partitions
+        uint32_t method = reader.read(2);
+        if (method > 1) return false;
+        int parameterBits = method == 0 ? 4 : 5;
+        uint32_t escape = method == 0 ? 15 : 31;
+        int partitionOrder = static_cast<int>(reader.read(4));
+        int partitions = 1 << partitionOrder;
+        int partitionSize = count >> partitionOrder;
+        if ((partitionSize << partitionOrder) != count || partitionSize < order) return false;
+
+        int i = order;
+        for (int p = 0; p < partitions; p++) {
+            int end = (p + 1) * partitionSize;
+            uint32_t parameter = reader.read(parameterBits);
+            if (parameter == escape) {
+                int rawBits = static_cast<int>(reader.read(5));
+                for (; i < end; i++) samples[i] = reader.readSigned(rawBits);
+            } else {
+                for (; i < end; i++) samples[i] = reader.readRice(static_cast<int>(parameter));
+            }
+        }
+
+        // Residuals become samples in place, front to back
+        for (i = order; i < count; i++) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++) sum += static_cast<int64_t>(coefficients[j]) * samples[i - 1 - j];
+            samples[i] += static_cast<int32_t>(sum >> shift);
+        }
+    }
+
+    if (wastedBits > 0) {
+        for (int i = 0; i < count; i++) samples[i] = static_cast<int32_t>(static_cast<uint32_t>(samples[i]) << wastedBits);
+    }
+    return !reader.hasOverrun();
+}
+
+bool FlacDecoder::readFrameHeader(size_t offset, FlacBitReader& reader, FrameHeader& header) const {
+    const uint8_t* frame = data + offset;
+    if (reader.read(14) != 0x3FFE || reader.read(1) != 0) {
+        return false;
+    }
+    bool variableBlocks = reader.read(1) != 0;
+
+    uint32_t blockSizeCode = reader.read(4);
+    uint32_t sampleRateCode = reader.read(4);
+    header.assignment = reader.read(4);
+    uint32_t sampleSizeCode = reader.read(3);
+    if (reader.read(1) != 0) {
+        return false;
+    }
+
+    // Frame or sample number, UTF-8 style
+    uint32_t lead = reader.read(8);
+    int extraBytes = 0;
+    while (extraBytes < 7 && (lead & (0x80 >> extraBytes))) extraBytes++;
+    if (extraBytes == 1) {
+        return false;
+    }
+    uint64_t number = lead & (0x7F >> extraBytes);
+    for (int i = 1; i < extraBytes; i++) {
+        uint32_t next = reader.read(8);
+        if ((next & 0xC0) != 0x80) {
+            return false;
+        }
+        number = (number << 6) | (next & 0x3F);
+    }
+
+    int count;
+    if (blockSizeCode == 1) count = 192;
+    else if (blockSizeCode >= 2 && blockSizeCode <= 5) count = 576 << (blockSizeCode - 2);
+    else if (blockSizeCode == 6) count = static_cast<int>(reader.read(8)) + 1;
+    else if (blockSizeCode == 7) count = static_cast<int>(reader.read(16)) + 1;
+    else if (blockSizeCode >= 8) count = 256 << (blockSizeCode - 8);
+    else count = 0;
+
+    if (sampleRateCode == 12) reader.read(8);
+    else if (sampleRateCode == 13 || sampleRateCode == 14) reader.read(16);
+
+    static const int SAMPLE_SIZES[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    header.count = count;
+    header.bitsPerSample = sampleSizeCode == 0 ? info.bitsPerSample : SAMPLE_SIZES[sampleSizeCode];
+    header.channels = header.assignment < 8 ? static_cast<int>(header.assignment) + 1 : 2;
+    // Fixed-size streams number their frames rather than their samples
+    header.firstFrame = variableBlocks ? number : number * info.maxBlockSize;
+
+    size_t headerBytes = reader.getBytePosition();
+    uint8_t headerCrc = static_cast<uint8_t>(reader.read(8));
+    header.bytes = reader.getBytePosition();
+    return count > 0 && static_cast<uint32_t>(count) <= info.maxBlockSize && header.bitsPerSample != 0 &&
+           header.assignment <= 10 && header.channels == info.channels && !reader.hasOverrun() &&
+           headerCrc == flacCrc8(frame, headerBytes);
+}
+
+bool FlacDecoder::findFrame(size_t from, size_t limit, size_t& offset, FrameHeader& header) const {
+    // Sync codes can turn up inside frame data too; the header checksum and
+    // its agreement with STREAMINFO rule those out
+    for (size_t i = from; i + 1 < std::min(limit, size); i++) {
+        if (data[i] != 0xFF || (data[i + 1] & 0xFE) != 0xF8) continue;
+        FlacBitReader reader(data + i, size - i);
+        if (readFrameHeader(i, reader, header) &&
+            (info.totalFrames == 0 || header.firstFrame < info.totalFrames)) {
+            offset = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FlacDecoder::seek(uint64_t frame, uint64_t& frameStart) {
+    if (data == nullptr) {
+        return false;
+    }
+    error = false;
+
+    // Bracket the target between two frame starts and narrow the bracket
+    // by where the target should fall at the average bit rate
+    size_t low = firstFrameOffset;
+    uint64_t lowFrame = 0;
+    size_t high = size;
+    uint64_t highFrame = info.totalFrames > 0 ? info.totalFrames : UINT64_MAX;
+    if (frame >= highFrame) {
+        return false;
+    }
+
+    FrameHeader header;
+    size_t offset = 0;
+    for (int probe = 0; probe < MAX_SEEK_PROBES && high - low > SEEK_LINEAR_BYTES && highFrame != UINT64_MAX; probe++) {
+        double fraction = static_cast<double>(frame - lowFrame) / static_cast<double>(highFrame - lowFrame);
+        size_t guess = low + static_cast<size_t>(fraction * static_cast<double>(high - low));
+        // Aim a little early, so the frame found tends to be at or before the target
+        guess = guess > low + info.maxBlockSize ? guess - info.maxBlockSize : low;
+        if (!findFrame(guess, high, offset, header)) {
+            // No frame starts between the guess and the upper bound, so the
+            // target's frame starts before the guess
+            high = guess;
+            continue;
+        }
+        if (header.firstFrame <= lowFrame) {
+            break;
+        }
+        if (header.firstFrame > frame) {
+            high = offset;
+            highFrame = header.firstFrame;
+        } else if (frame < header.firstFrame + static_cast<uint64_t>(header.count)) {
+            position = offset;
+            frameStart = header.firstFrame;
+            return true;
+        } else {
+            low = offset;
+            lowFrame = header.firstFrame;
+        }
+    }
+
+    // Walk forward from the last frame known to start at or before it
+    for (size_t from = low; findFrame(from, size, offset, header); from = offset + header.bytes) {
+        if (frame < header.firstFrame + static_cast<uint64_t>(header.count)) {
+            position = offset;
+            frameStart = header.firstFrame;
+            return header.firstFrame <= frame;
+        }
+    }
+    return false;
+}
+
+size_t FlacDecoder::decodeFrame(std::vector<short>& out) {
+    if (data == nullptr || error || position + 2 > size) {
+        return 0;
+    }
+
+    const uint8_t* frame = data + position;
+    FlacBitReader reader(frame, size - position);
+    FrameHeader header;
+    if (!readFrameHeader(position, reader, header)) {
+        LOGE("Corrupt frame header at byte %zu", position);
+        error = true;
+        return 0;
+    }
+    const int count = header.count;
+    const int channels = header.channels;
+    const int bitsPerSample = header.bitsPerSample;
+    const uint32_t assignment = header.assignment;
+
+    for (int c = 0; c < channels; c++) {
+        // The side channel carries one extra bit
+        bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1);
+        if (!decodeSubframe(reader, channelSamples[c].data(), count, bitsPerSample + (side ? 1 : 0))) {
+            LOGE("Corrupt subframe at byte %zu", position);
+            error = true;
+            return 0;
+        }
+    }
+
+    reader.alignToByte();
+    size_t frameBytes = reader.getBytePosition();
+    uint16_t crc = static_cast<uint16_t>(reader.read(16));
+    if (reader.hasOverrun() || crc != flacCrc16(frame, frameBytes)) {
+        LOGE("Frame CRC mismatch at byte %zu", position);
+        error = true;
+        return 0;
+    }
+    position += frameBytes + 2;
+
+    int32_t* first = channelSamples[0].data();
+    int32_t* second = channels > 1 ? channelSamples[1].data() : nullptr;
+    if (assignment == 8) {
+        for (int i = 0; i < count; i++) second[i] = first[i] - second[i];
+    } else if (assignment == 9) {
+        for (int i = 0; i < count; i++) first[i] += second[i];
+    } else if (assignment == 10) {
+        for (int i = 0; i < count; i++) {
+            int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(first[i]) << 1) | (second[i] & 1);
+            int32_t side = second[i];
+            first[i] = (mid + side) >> 1;
+            second[i] = (mid - side) >> 1;
+        }
+    }
+
+    out.resize(static_cast<size_t>(count) * channels);
+    int toSixteen = bitsPerSample - 16;
+    for (int c = 0; c < channels; c++) {
+        const int32_t* samples = channelSamples[c].data();
+        for (int i = 0; i < count; i++) {
+            int32_t sample = toSixteen >= 0 ? samples[i] >> toSixteen : samples[i] * (1 << -toSixteen);
+            out[static_cast<size_t>(i) * channels + c] = static_cast<short>(sample);
+        }
+    }
+    return static_cast<size_t>(count);
+}
@@ -0,0 +1,108 @@
+#ifndef AUDIORECORDINGAPP_FLAC_DECODER_H
+#define AUDIORECORDINGAPP_FLAC_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FlacBitReader;
+
+// Stream parameters from a FLAC file's STREAMINFO block
+struct FlacStreamInfo {
+    uint32_t minBlockSize = 0;
+    uint32_t maxBlockSize = 0;
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint16_t bitsPerSample = 0;
+    uint64_t totalFrames = 0;
+};
+
+// Reads the "fLaC" marker and metadata blocks at the start of |data|.
+// |firstFrameOffset| receives where the audio frames begin, which may be
+// beyond |available| if the metadata is larger than what was read.
+bool parseFlacStreamInfo(const uint8_t* data, size_t available, FlacStreamInfo& info,
+                         size_t& firstFrameOffset);
+
+// Frame-by-frame FLAC decoder over a memory-mapped file. Handles every
+// subframe type and both residual coding methods, and checks each frame's
+// CRC-16. Output is interleaved 16-bit; other bit depths are shifted to fit.
+class FlacDecoder {
+private:
+    static const int MAX_CHANNELS = 8;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    FlacStreamInfo info;
+    size_t firstFrameOffset = 0;
+    size_t position = 0;
+    bool error = false;
+
+    // Seeking gives up on interpolating and walks frame by frame once the
+    // window is this small, or after this many probes
+    static const size_t SEEK_LINEAR_BYTES = 64 * 1024;
+    static const int MAX_SEEK_PROBES = 16;
+
+    std::vector<int32_t> channelSamples[MAX_CHANNELS];
+
+    struct FrameHeader {
+        uint64_t firstFrame = 0;
+        int count = 0;
+        int bitsPerSample = 0;
+        uint32_t assignment = 0;
+        int channels = 0;
+        size_t bytes = 0;
+    };
+
+    bool start();
+    bool readFrameHeader(size_t offset, FlacBitReader& reader, FrameHeader& header) const;
+    bool findFrame(size_t from, size_t limit, size_t& offset, FrameHeader& header) const;
+    bool decodeSubframe(FlacBitReader& reader, int32_t* samples, int count, int bitsPerSample);
+
+public:
+    FlacDecoder() = default;
+    ~FlacDecoder();
+
+    FlacDecoder(const FlacDecoder&) = delete;
+    FlacDecoder& operator=(const FlacDecoder&) = delete;
+
+    bool open(const std::string& path);
+
+    // Decodes from caller-owned memory, which must outlive the decoder
+    bool openMemory(const uint8_t* bytes, size_t byteCount);
+
+    void close();
+
+    bool isOpen() const {
+        return data != nullptr;
+    }
+
+    const FlacStreamInfo& getStreamInfo() const {
+        return info;
+    }
+
+    // Decodes the next frame into |out|, interleaved. Returns the number of
+    // frames decoded; 0 at the end of the stream or on a corrupt frame.
+    // |out| keeps its capacity, so steady-state decoding does not allocate.
+    size_t decodeFrame(std::vector<short>& out);
+
+    void rewind() {
+        position = firstFrameOffset;
+        error = false;
+    }
+
+    // Moves to the frame holding |frame| and returns in |frameStart| where
+    // that frame begins, so the caller can drop the samples before its
+    // target. Interpolates between frame headers by byte offset, so a
+    // constant-ish bit rate takes a couple of probes whatever the length.
+    bool seek(uint64_t frame, uint64_t& frameStart);
+
+    bool hasError() const {
+        return error;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_FLAC_DECODER_H
@@ -0,0 +1,431 @@
+#include "flac_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "flac_bitstream.h"
+#include "sample_convert.h"
+
+enum {
+    SUBFRAME_CONSTANT = 0,
+    SUBFRAME_VERBATIM = 1,
+    SUBFRAME_FIXED = 2,
+    SUBFRAME_LPC = 3,
+};
+
+enum {
+    CHANNELS_LEFT_SIDE = 8,
+    CHANNELS_SIDE_RIGHT = 9,
+    CHANNELS_MID_SIDE = 10,
+};
+
+static const int SAMPLE_SIZE_CODE_16 = 4;
+static const int MAX_RICE_PARAMETER = 14;
+
+static const int32_t FIXED_COEFFICIENTS[5][4] = {
+        {0, 0, 0, 0},
+        {1, 0, 0, 0},
+        {2, -1, 0, 0},
+        {3, -3, 1, 0},
+        {4, -6, 4, -1},
+};
+
+static uint32_t foldResidual(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static int riceParameterFor(uint64_t sum, uint32_t count) {
+    int parameter = 0;
+    while (parameter < MAX_RICE_PARAMETER && (static_cast<uint64_t>(count) << (parameter + 1)) < sum) {
+        parameter++;
+    }
+    return parameter;
+}
+
+static uint64_t riceBits(uint64_t sum, uint32_t count, int parameter) {
+    return 4 + static_cast<uint64_t>(count) * (parameter + 1) + (sum >> parameter);
+}
+
+// Cheapest residual partitioning for a block of |count| samples whose first
+// |order| are warm-up samples. Returns the estimated bits and partition order.
+static uint64_t planResidual(const int32_t* residual, int count, int order, int maxPartitionOrder,
+                             int& bestPartitionOrder) {
+    // Largest usable order: partitions must divide the block evenly and the
+    // first one must be longer than the warm-up
+    int maxOrder = 0;
+    while (maxOrder < maxPartitionOrder && (count % (2 << maxOrder)) == 0 &&
+           (count >> (maxOrder + 1)) > order) {
+        maxOrder++;
+    }
+
+    // Folded sums at the finest partitioning, merged pairwise for coarser ones
+    int partitions = 1 << maxOrder;
+    int partitionSize = count >> maxOrder;
+    uint64_t sums[1 << 8];
+    for (int p = 0; p < partitions; p++) {
+        int start = p == 0 ? order : p * partitionSize;
+        int end = (p + 1) * partitionSize;
+        uint64_t sum = 0;
+        for (int i = start; i < end; i++) sum += foldResidual(residual[i]);
+        sums[p] = sum;
+    }
+
+    uint64_t bestBits = UINT64_MAX;
+    for (int partitionOrder = maxOrder; partitionOrder >= 0; partitionOrder--) {
+        int parts = 1 << partitionOrder;
+        int size = count >> partitionOrder;
+        uint64_t bits = 0;
+        for (int p = 0; p < parts; p++) {
+            uint32_t n = p == 0 ? size - order : size;
+            bits += riceBits(sums[p], n, riceParameterFor(sums[p], n));
+        }
+        if (bits < bestBits) {
+            bestBits = bits;
+            bestPartitionOrder = partitionOrder;
+        }
+        for (int p = 0; p < parts / 2; p++) sums[p] = sums[2 * p] + sums[2 * p + 1];
+    }
+
+    // Coding method and partition order fields
+    return bestBits + 2 + 4;
+}
+
+static void computeFixedResidual(const int32_t* samples, int count, int order, int32_t* residual) {
+    const int32_t* c = FIXED_COEFFICIENTS[order];
+    for (int i = order; i < count; i++) {
+        int64_t prediction = 0;
+        for (int j = 0; j < order; j++) prediction += static_cast<int64_t>(c[j]) * samples[i - 1 - j];
+        residual[i] = static_cast<int32_t>(samples[i] - prediction);
+    }
+}
+
+static void computeLpcResidual(const int32_t* samples, int count, const int32_t* coefficients,
+                               int order, int shift, int32_t* residual) {
+    for (int i = order; i < count; i++) {
+        int64_t sum = 0;
+        for (int j = 0; j < order; j++) sum += static_cast<int64_t>(coefficients[j]) * samples[i - 1 - j];
+        residual[i] = static_cast<int32_t>(samples[i] - (sum >> shift));
+    }
+}
+
+// Levinson-Durbin recursion; |lpc[k]| receives the order k+1 predictor
+static void computeLpc(const double* autocorrelation, int maxOrder,
+                       double lpc[FlacEncoder::MAX_LPC_ORDER][FlacEncoder::MAX_LPC_ORDER]) {
+    double a[FlacEncoder::MAX_LPC_ORDER + 1] = {1.0};
+    double error = autocorrelation[0];
+
+    for (int i = 1; i <= maxOrder; i++) {
+        double acc = autocorrelation[i];
+        for (int j = 1; j < i; j++) acc += a[j] * autocorrelation[i - j];
+        double reflection = error > 0.0 ? -acc / error : 0.0;
+
+        double previous[FlacEncoder::MAX_LPC_ORDER + 1];
+        std::copy(a, a + i, previous);
+        for (int j = 1; j < i; j++) a[j] = previous[j] + reflection * previous[i - j];
+        a[i] = reflection;
+        error *= 1.0 - reflection * reflection;
+
+        // FLAC adds the prediction, the recursion's polynomial subtracts it
+        for (int j = 1; j <= i; j++) lpc[i - 1][j - 1] = -a[j];
+    }
+}
+
+// Quantizes to LPC_PRECISION-bit coefficients with error feedback, so the
+// rounding error of one coefficient is carried into the next
+static bool quantizeLpc(const double* lpc, int order, int precision, int32_t* quantized, int& shift) {
+    double maxMagnitude = 0.0;
+    for (int i = 0; i < order; i++) maxMagnitude = std::max(maxMagnitude, std::fabs(lpc[i]));
+    if (maxMagnitude <= 0.0) return false;
+
+    int exponent;
+    std::frexp(maxMagnitude, &exponent);
+    shift = precision - 1 - exponent;
+    if (shift > 15) shift = 15;
+    if (shift < 0) return false;
+
+    const int32_t limit = (1 << (precision - 1)) - 1;
+    double error = 0.0;
+    for (int i = 0; i < order; i++) {
+        error += lpc[i] * (1 << shift);
+        long value = std::lround(error);
+        value = std::max<long>(-limit - 1, std::min<long>(limit, value));
+        quantized[i] = static_cast<int32_t>(value);
+        error -= value;
+    }
+    return true;
+}
+
+// Tukey window with a 50% taper, applied before autocorrelation
+static double tukeyWindow(int i, int count) {
+    const int taper = count / 4;
+    if (taper == 0) return 1.0;
+    if (i < taper) return 0.5 - 0.5 * std::cos(M_PI * i / taper);
+    if (i >= count - taper) return 0.5 - 0.5 * std::cos(M_PI * (count - 1 - i) / taper);
+    return 1.0;
+}
+
+static void writeUtf8Number(FlacBitWriter& writer, uint32_t value) {
+    if (value < 0x80) {
+        writer.write(value, 8);
+        return;
+    }
+    // Lead byte: one bit per byte in the sequence, then a zero
+    int extraBytes = value < 0x800 ? 1 : value < 0x10000 ? 2 : value < 0x200000 ? 3 : value < 0x4000000 ? 4 : 5;
+    uint32_t lead = (0xFF00u >> (extraBytes + 1)) & 0xFF;
+    writer.write(lead | (value >> (6 * extraBytes)), 8);
+    for (int i = extraBytes - 1; i >= 0; i--) {
+        writer.write(0x80 | ((value >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+FlacEncoder::FlacEncoder(int sampleRate, int channels, int blockSize)
+        : sampleRate(sampleRate), channels(channels), blockSize(blockSize) {
+    for (std::vector<int32_t>& samples : channelSamples) samples.resize(blockSize);
+    for (std::vector<short>& samples : planar) samples.resize(blockSize);
+    residual.resize(blockSize);
+    windowed.resize(blockSize);
+
+    window.resize(blockSize);
+    for (int i = 0; i < blockSize; i++) window[i] = tukeyWindow(i, blockSize);
+}
+
+void FlacEncoder::reset() {
+    frameNumber = 0;
+    totalFrames = 0;
+    minFrameBytes = 0;
+    maxFrameBytes = 0;
+}
+
+void FlacEncoder::writeStreamHeader(std::vector<uint8_t>& out) const {
+    out.insert(out.end(), {'f', 'L', 'a', 'C'});
+
+    FlacBitWriter writer(out);
+    // Last metadata block, type 0 (STREAMINFO), 34 bytes
+    writer.write(1, 1);
+    writer.write(0, 7);
+    writer.write(34, 24);
+
+    writer.write(blockSize, 16);
+    writer.write(blockSize, 16);
+    writer.write(minFrameBytes, 24);
+    writer.write(maxFrameBytes, 24);
+    writer.write(sampleRate, 20);
+    writer.write(channels - 1, 3);
+    writer.write(16 - 1, 5);
+    writer.write(static_cast<uint32_t>(totalFrames >> 32), 4);
+    writer.write(static_cast<uint32_t>(totalFrames), 32);
+    // MD5 left as zero, which FLAC defines as "not computed"
+    for (int i = 0; i < 4; i++) writer.write(0, 32);
+}
+
+FlacEncoder::SubframePlan FlacEncoder::planSubframe(const int32_t* samples, int count,
+                                                   int bitsPerSample) {
+    SubframePlan best;
+    best.type = SUBFRAME_VERBATIM;
+    best.bits = 8 + static_cast<uint64_t>(count) * bitsPerSample;
+
+    bool constant = true;
+    for (int i = 1; i < count && constant; i++) constant = samples[i] == samples[0];
+    if (constant) {
+        best.type = SUBFRAME_CONSTANT;
+        best.bits = 8 + bitsPerSample;
+        return best;
+    }
+
+    // Fixed polynomial predictors
+    for (int order = 0; order < FIXED_ORDERS && order < count; order++) {
+        computeFixedResidual(samples, count, order, residual.data());
+        int partitionOrder = 0;
+        uint64_t bits = 8 + static_cast<uint64_t>(order) * bitsPerSample +
+                        planResidual(residual.data(), count, order, MAX_PARTITION_ORDER, partitionOrder);
+        if (bits < best.bits) {
+            best.type = SUBFRAME_FIXED;
+            best.order = order;
+            best.partitionOrder = partitionOrder;
+            best.bits = bits;
+        }
+    }
+
+    // Quantized LPC from the windowed autocorrelation
+    int maxOrder = std::min(MAX_LPC_ORDER, count - 1);
+    if (maxOrder < 1) return best;
+
+    // The last block of a stream is usually short and gets its own window
+    for (int i = 0; i < count; i++) {
+        windowed[i] = samples[i] * (count == blockSize ? window[i] : tukeyWindow(i, count));
+    }
+    double autocorrelation[MAX_LPC_ORDER + 1];
+    for (int lag = 0; lag <= maxOrder; lag++) {
+        double sum = 0.0;
+        for (int i = lag; i < count; i++) sum += windowed[i] * windowed[i - lag];
+        autocorrelation[lag] = sum;
+    }
+    if (autocorrelation[0] <= 0.0) return best;
+
+    double lpc[MAX_LPC_ORDER][MAX_LPC_ORDER] = {};
+    computeLpc(autocorrelation, maxOrder, lpc);
+
+    for (int order = 1; order <= maxOrder; order++) {
+        int32_t coefficients[MAX_LPC_ORDER];
+        int shift;
+        if (!quantizeLpc(lpc[order - 1], order, LPC_PRECISION, coefficients, shift)) continue;
+
+        computeLpcResidual(samples, count, coefficients, order, shift, residual.data());
+        int partitionOrder = 0;
+        uint64_t bits = 8 + static_cast<uint64_t>(order) * bitsPerSample + 4 + 5 +
+                        static_cast<uint64_t>(order) * LPC_PRECISION +
+                        planResidual(residual.data(), count, order, MAX_PARTITION_ORDER, partitionOrder);
+        if (bits < best.bits) {
+            best.type = SUBFRAME_LPC;
+            best.order = order;
+            best.shift = shift;
+            std::copy(coefficients, coefficients + order, best.coefficients);
+            best.partitionOrder = partitionOrder;
+            best.bits = bits;
+        }
+    }
+    return best;
+}
+
+void FlacEncoder::writeSubframe(FlacBitWriter& writer, const int32_t* samples, int count,
+                                int bitsPerSample, const SubframePlan& plan) {
+    // Zero pad bit, 6-bit type, no wasted bits
+    switch (plan.type) {
+        case SUBFRAME_CONSTANT:
+            writer.write(0x00, 8);
+            writer.writeSigned(samples[0], bitsPerSample);
+            return;
+        case SUBFRAME_VERBATIM:
+            writer.write(0x02, 8);
+            for (int i = 0; i < count; i++) writer.writeSigned(samples[i], bitsPerSample);
+            return;
+        case SUBFRAME_FIXED:
+            writer.write((0x08 | plan.order) << 1, 8);
+            computeFixedResidual(samples, count, plan.order, residual.data());
+            break;
+        default:
+            writer.write((0x20 | (plan.order - 1)) << 1, 8);
+            computeLpcResidual(samples, count, plan.coefficients, plan.order, plan.shift,
+                               residual.data());
+            break;
+    }
+
+    for (int i = 0; i < plan.order; i++) writer.writeSigned(samples[i], bitsPerSample);
+    if (plan.type == SUBFRAME_LPC) {
+        writer.write(LPC_PRECISION - 1, 4);
+        writer.writeSigned(plan.shift, 5);
+        for (int i = 0; i < plan.order; i++) writer.writeSigned(plan.coefficients[i], LPC_PRECISION);
+    }
+
+    // Residual: Rice coding with 4-bit parameters, then the partitions
+    writer.write(0, 2);
+    writer.write(plan.partitionOrder, 4);
+    int partitions = 1 << plan.partitionOrder;
+    int partitionSize = count >> plan.partitionOrder;
+    for (int p = 0; p < partitions; p++) {
+        int start = p == 0 ? plan.order : p * partitionSize;
+        int end = (p + 1) * partitionSize;
+        uint64_t sum = 0;
+        for (int i = start; i < end; i++) sum += foldResidual(residual[i]);
+        int parameter = riceParameterFor(sum, end - start);
+        writer.write(parameter, 4);
+        for (int i = start; i < end; i++) writer.writeRice(residual[i], parameter);
+    }
+}
+
+void FlacEncoder::encodeBlock(const short* interleaved, size_t frames, std::vector<uint8_t>& out) {
+    if (frames == 0) return;
+    int count = static_cast<int>(std::min(frames, static_cast<size_t>(blockSize)));
+
+    // Split stereo with the SIMD kernel, then widen for prediction
+    if (channels == 2) {
+        deinterleaveStereo(interleaved, planar[0].data(), planar[1].data(), count);
+        for (int c = 0; c < 2; c++) std::copy(planar[c].begin(), planar[c].begin() + count, channelSamples[c].begin());
+    } else {
+        std::copy(interleaved, interleaved + count, channelSamples[0].begin());
+    }
+
+    // Stereo decorrelation: estimate each candidate signal's cost, then code
+    // the cheapest pair. Index 2 is mid, 3 is side.
+    int assignment = channels - 1;
+    const int32_t* coded[2] = {channelSamples[0].data(), channelSamples[1].data()};
+    int codedBits[2] = {16, 16};
+    SubframePlan plans[2];
+
+    if (channels == 2) {
+        int32_t* left = channelSamples[0].data();
+        int32_t* right = channelSamples[1].data();
+        int32_t* mid = channelSamples[2].data();
+        int32_t* side = channelSamples[3].data();
+        for (int i = 0; i < count; i++) {
+            mid[i] = (left[i] + right[i]) >> 1;
+            side[i] = left[i] - right[i];
+        }
+
+        SubframePlan candidates[4];
+        for (int c = 0; c < 4; c++) candidates[c] = planSubframe(channelSamples[c].data(), count, c == 3 ? 17 : 16);
+
+        uint64_t costs[4] = {
+                candidates[0].bits + candidates[1].bits,
+                candidates[0].bits + candidates[3].bits,
+                candidates[3].bits + candidates[1].bits,
+                candidates[2].bits + candidates[3].bits,
+        };
+        int choice = static_cast<int>(std::min_element(costs, costs + 4) - costs);
+        static const int pairs[4][2] = {{0, 1}, {0, 3}, {3, 1}, {2, 3}};
+        static const int assignments[4] = {1, CHANNELS_LEFT_SIDE, CHANNELS_SIDE_RIGHT, CHANNELS_MID_SIDE};
+
+        assignment = assignments[choice];
+        for (int c = 0; c < 2; c++) {
+            int source = pairs[choice][c];
+            coded[c] = channelSamples[source].data();
+            codedBits[c] = source == 3 ? 17 : 16;
+            plans[c] = candidates[source];
+        }
+    } else {
+        plans[0] = planSubframe(coded[0], count, 16);
+    }
+
+    size_t frameStart = out.size();
+    FlacBitWriter writer(out);
+
+    // Frame header: sync code, fixed-blocksize stream
+    writer.write(0x3FFE, 14);
+    writer.write(0, 1);
+    writer.write(0, 1);
+
+    int blockSizeCode;
+    int extraBlockSizeBits = 0;
+    if (count >= 256 && (count & (count - 1)) == 0 && count <= 32768) {
+        blockSizeCode = 8;
+        while ((256 << (blockSizeCode - 8)) != count) blockSizeCode++;
+    } else if (count <= 256) {
+        blockSizeCode = 6;
+        extraBlockSizeBits = 8;
+    } else {
+        blockSizeCode = 7;
+        extraBlockSizeBits = 16;
+    }
+    writer.write(blockSizeCode, 4);
+    // Sample rate and depth as in STREAMINFO
+    writer.write(0, 4);
+    writer.write(assignment, 4);
+    writer.write(SAMPLE_SIZE_CODE_16, 3);
+    writer.write(0, 1);
+    writeUtf8Number(writer, frameNumber);
+    if (extraBlockSizeBits) writer.write(count - 1, extraBlockSizeBits);
+    writer.write(flacCrc8(out.data() + frameStart, out.size() - frameStart), 8);
+
+    for (int c = 0; c < channels; c++) writeSubframe(writer, coded[c], count, codedBits[c], plans[c]);
+
+    writer.alignToByte();
+    uint16_t crc = flacCrc16(out.data() + frameStart, out.size() - frameStart);
+    writer.write(crc, 16);
+
+    uint32_t frameBytes = static_cast<uint32_t>(out.size() - frameStart);
+    minFrameBytes = minFrameBytes == 0 ? frameBytes : std::min(minFrameBytes, frameBytes);
+    maxFrameBytes = std::max(maxFrameBytes, frameBytes);
+    frameNumber++;
+    totalFrames += count;
+}
@@ -0,0 +1,79 @@
+#ifndef AUDIORECORDINGAPP_FLAC_ENCODER_H
+#define AUDIORECORDINGAPP_FLAC_ENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Encodes 16-bit PCM (mono or stereo) into FLAC frames, one block at a time.
+// Each channel is coded with whichever of constant, verbatim, fixed
+// (orders 0-4) or quantized LPC prediction (orders 1-MAX_LPC_ORDER) gives
+// the fewest bits, and residuals are Rice coded with a per-partition
+// parameter. Stereo blocks pick the cheapest of left/right, left/side,
+// side/right and mid/side.
+//
+// The caller owns the byte stream: writeStreamHeader() produces the
+// "fLaC" marker and STREAMINFO block, which can be written again over the
+// first one once the stream is complete to fill in the totals.
+class FlacEncoder {
+public:
+    static const int DEFAULT_BLOCK_SIZE = 4096;
+    static const int MAX_LPC_ORDER = 8;
+    static const size_t STREAM_HEADER_SIZE = 42;
+
+private:
+    static const int FIXED_ORDERS = 5;
+    static const int LPC_PRECISION = 12;
+    static const int MAX_PARTITION_ORDER = 8;
+
+    int sampleRate;
+    int channels;
+    int blockSize;
+
+    uint32_t frameNumber = 0;
+    uint64_t totalFrames = 0;
+    uint32_t minFrameBytes = 0;
+    uint32_t maxFrameBytes = 0;
+
+    // Per-block scratch, sized once for blockSize
+    std::vector<int32_t> channelSamples[4];
+    std::vector<short> planar[2];
+    std::vector<int32_t> residual;
+    std::vector<double> window;
+    std::vector<double> windowed;
+
+    struct SubframePlan {
+        int type = 0;            // one of the SUBFRAME_* values in the .cpp
+        int order = 0;
+        int shift = 0;
+        int32_t coefficients[MAX_LPC_ORDER] = {};
+        int partitionOrder = 0;
+        uint64_t bits = 0;
+    };
+
+    SubframePlan planSubframe(const int32_t* samples, int count, int bitsPerSample);
+    void writeSubframe(class FlacBitWriter& writer, const int32_t* samples, int count,
+                       int bitsPerSample, const SubframePlan& plan);
+
+public:
+    FlacEncoder(int sampleRate, int channels, int blockSize = DEFAULT_BLOCK_SIZE);
+
+    // Starts a new stream: frame numbering and totals go back to zero
+    void reset();
+
+    void writeStreamHeader(std::vector<uint8_t>& out) const;
+
+    // Appends one frame for |frames| interleaved frames, at most blockSize.
+    // Only the last block of a stream may be shorter than blockSize.
+    void encodeBlock(const short* interleaved, size_t frames, std::vector<uint8_t>& out);
+
+    int getBlockSize() const {
+        return blockSize;
+    }
+
+    uint64_t getTotalFrames() const {
+        return totalFrames;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_FLAC_ENCODER_H
@@ -0,0 +1,173 @@
+#include "flac_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "audio_trace.h"
+#include "pre_roll_buffer.h"
+
+#define LOG_TAG "FlacWriter"
+#include "audio_log.h"
+
+FlacWriter::FlacWriter(int sampleRate, int channels, int blockSize)
+        : channels(channels), encoder(sampleRate, channels, blockSize) {
+}
+
+FlacWriter::~FlacWriter() {
+    close();
+}
+
+bool FlacWriter::setFormat(int sampleRate, int newChannels) {
+    if (running) {
+        LOGE("Cannot change format while a file is open");
+        return false;
+    }
+
+    channels = newChannels;
+    encoder = FlacEncoder(sampleRate, newChannels, encoder.getBlockSize());
+    return true;
+}
+
+bool FlacWriter::open(const std::string& path) {
+    if (running) {
+        LOGE("Writer already open");
+        return false;
+    }
+
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOGE("Failed to open output file: %s", path.c_str());
+        return false;
+    }
+
+    filePath = path;
+    ring.reset();
+    encoder.reset();
+
+    block.assign(static_cast<size_t>(encoder.getBlockSize()) * channels, 0);
+    blockFill = 0;
+    encoded.clear();
+    encoded.reserve(2 * WRITE_CHUNK_BYTES);
+
+    samplesWritten = 0;
+    bytesWritten = 0;
+
+    // Placeholder STREAMINFO, totals are patched in close()
+    encoder.writeStreamHeader(encoded);
+
+    running = true;
+    writerThread = std::thread(&FlacWriter::writerLoop, this);
+    return true;
+}
+
+bool FlacWriter::write(const void* samples, size_t count) {
+    if (!running) return false;
+
+    return ring.write(static_cast<const short*>(samples), count);
+}
+
+bool FlacWriter::close() {
+    if (!running) return false;
+
+    running = false;
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    // Same size as the placeholder, so it overwrites it exactly
+    std::vector<uint8_t> header;
+    encoder.writeStreamHeader(header);
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.close();
+
+    if (samplesWritten == 0) {
+        LOGE("No audio data to save");
+        std::remove(filePath.c_str());
+        return false;
+    }
+
+    if (ring.getOverflowCount() > 0) {
+        LOGE("Dropped %llu samples in %llu blocks, encoder could not keep up",
+             static_cast<unsigned long long>(ring.getDroppedItems()),
+             static_cast<unsigned long long>(ring.getOverflowCount()));
+    }
+
+    LOGI("Audio saved to: %s (%.1f%% of PCM size)", filePath.c_str(),
+         100.0 * bytesWritten / (samplesWritten * sizeof(short)));
+    return true;
+}
+
+void FlacWriter::writerLoop() {
+    while (running) {
+        drainRing();
+        std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_POLL_MS));
+    }
+
+    // The tail of the take becomes the stream's one short block
+    drainRing();
+    encodeBlock();
+    flushEncoded();
+}
+
+void FlacWriter::drainRing() {
+    // Only what is in the ring now is known to have come after the prefix
+    size_t available = ring.availableToRead();
+    if (const PreRollBuffer* preRoll = takePrefix()) {
+        preRoll->read([this](const void* samples, const short*, size_t count) {
+            appendToBlock(static_cast<const short*>(samples), count);
+        });
+    }
+
+    while (available > 0) {
+        size_t count = ring.read(&block[blockFill], std::min(available, block.size() - blockFill));
+        available -= count;
+        blockFill += count;
+        if (blockFill == block.size()) {
+            encodeBlock();
+        }
+    }
+}
+
+void FlacWriter::appendToBlock(const short* samples, size_t count) {
+    while (count > 0) {
+        size_t run = std::min(count, block.size() - blockFill);
+        std::copy(samples, samples + run, &block[blockFill]);
+        blockFill += run;
+        samples += run;
+        count -= run;
+        if (blockFill == block.size()) {
+            encodeBlock();
+        }
+    }
+}
+
+void FlacWriter::encodeBlock() {
+    AUDIO_TRACE_SECTION("FlacWriter encode");
+    // Whole frames only; a stray partial frame can't be encoded
+    size_t frames = blockFill / channels;
+    if (frames > 0) {
+        encoder.encodeBlock(block.data(), frames, encoded);
+        samplesWritten += frames * channels;
+    }
+    blockFill = 0;
+
+    if (encoded.size() >= WRITE_CHUNK_BYTES) {
+        flushEncoded();
+    }
+}
+
+void FlacWriter::flushEncoded() {
+    if (encoded.empty()) return;
+
+    AUDIO_TRACE_SECTION("FlacWriter write");
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    if (!file) {
+        LOGE("Failed to write audio data to: %s", filePath.c_str());
+    }
+
+    bytesWritten += encoded.size();
+    encoded.clear();
+}
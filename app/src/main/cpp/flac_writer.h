@@ -0,0 +1,88 @@
+#ifndef AUDIORECORDINGAPP_FLAC_WRITER_H
+#define AUDIORECORDINGAPP_FLAC_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_file_writer.h"
+#include "flac_encoder.h"
+#include "spsc_ring_buffer.h"
+
+// Streams 16-bit PCM to a FLAC file while recording is in progress. Like
+// WavWriter, the capture callback only pushes samples into a lock-free ring;
+// a background thread encodes each block as soon as it is complete and
+// writes the frames out in large chunks. STREAMINFO is written up front and
+// rewritten with the final totals on close.
+class FlacWriter : public AudioFileWriter {
+private:
+    static const size_t WRITE_CHUNK_BYTES = 64 * 1024;
+    static const size_t RING_SAMPLES = 128 * 1024;
+    static const int WRITER_POLL_MS = 10;
+
+    int channels;
+    FlacEncoder encoder;
+
+    std::ofstream file;
+    std::string filePath;
+    std::thread writerThread;
+    std::atomic<bool> running{false};
+
+    SpscRingBuffer<short> ring{RING_SAMPLES};
+
+    // One encoder block of interleaved samples, and encoded frames waiting
+    // to be written
+    std::vector<short> block;
+    size_t blockFill = 0;
+    std::vector<uint8_t> encoded;
+
+    std::atomic<uint64_t> samplesWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+public:
+    FlacWriter(int sampleRate, int channels, int blockSize = FlacEncoder::DEFAULT_BLOCK_SIZE);
+    ~FlacWriter() override;
+
+    FlacWriter(const FlacWriter&) = delete;
+    FlacWriter& operator=(const FlacWriter&) = delete;
+
+    // Changes the format of the next file; fails while one is open
+    bool setFormat(int sampleRate, int channels);
+
+    bool open(const std::string& path) override;
+    bool write(const void* samples, size_t count) override;
+    bool close() override;
+
+    bool isOpen() const override {
+        return running;
+    }
+
+    uint64_t getSamplesWritten() const override {
+        return samplesWritten;
+    }
+
+    uint64_t getSamplesDropped() const override {
+        return ring.getDroppedItems();
+    }
+
+    uint64_t getSamplesPending() const override {
+        return ring.availableToRead();
+    }
+
+    uint64_t getBytesWritten() const {
+        return bytesWritten;
+    }
+
+private:
+    void writerLoop();
+    void drainRing();
+    void appendToBlock(const short* samples, size_t count);
+    void encodeBlock();
+    void flushEncoded();
+};
+
+#endif // AUDIORECORDINGAPP_FLAC_WRITER_H
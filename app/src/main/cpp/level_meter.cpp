@@ -0,0 +1,94 @@
+#include "level_meter.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#include "peak_kernels.h"
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+LevelMeter::LevelMeter() {
+    for (std::atomic<uint32_t>& word : words) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LevelMeter::publish(const short* samples, size_t count) {
+    if (count == 0) return;
+
+    PeakStats stats;
+    reducePeaks(samples, count, stats);
+
+    // Clipping is rare, so only blocks that reach full scale pay for a count
+    if (stats.min == SHRT_MIN || stats.max == SHRT_MAX) {
+        for (size_t i = 0; i < count; i++) {
+            clipCount += samples[i] == SHRT_MIN || samples[i] == SHRT_MAX;
+        }
+    }
+    blockCount++;
+
+    int peakSample = std::max(-static_cast<int>(stats.min), static_cast<int>(stats.max));
+    float peak = peakSample / 32768.0f;
+    float rms = static_cast<float>(std::sqrt(static_cast<double>(stats.sumSquares) / count) / 32768.0);
+
+    uint32_t sequence = words[SEQUENCE_WORD].load(std::memory_order_relaxed);
+    words[SEQUENCE_WORD].store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    words[PEAK_WORD].store(floatBits(peak), std::memory_order_relaxed);
+    words[RMS_WORD].store(floatBits(rms), std::memory_order_relaxed);
+    words[CLIP_COUNT_WORD].store(clipCount, std::memory_order_relaxed);
+    words[BLOCK_COUNT_WORD].store(blockCount, std::memory_order_relaxed);
+    words[SEQUENCE_WORD].store(sequence + 2, std::memory_order_release);
+}
+
+void LevelMeter::reset() {
+    clipCount = 0;
+    blockCount = 0;
+
+    uint32_t sequence = words[SEQUENCE_WORD].load(std::memory_order_relaxed);
+    words[SEQUENCE_WORD].store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = PEAK_WORD; i < WORD_COUNT; i++) {
+        words[i].store(0, std::memory_order_relaxed);
+    }
+    words[SEQUENCE_WORD].store(sequence + 2, std::memory_order_release);
+}
+
+bool LevelMeter::read(LevelSnapshot& snapshot) const {
+    return readShared(words, snapshot);
+}
+
+bool LevelMeter::readShared(const void* sharedWords, LevelSnapshot& snapshot) {
+    const std::atomic<uint32_t>* words = static_cast<const std::atomic<uint32_t>*>(sharedWords);
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        uint32_t before = words[SEQUENCE_WORD].load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        uint32_t peak = words[PEAK_WORD].load(std::memory_order_relaxed);
+        uint32_t rms = words[RMS_WORD].load(std::memory_order_relaxed);
+        uint32_t clips = words[CLIP_COUNT_WORD].load(std::memory_order_relaxed);
+        uint32_t blocks = words[BLOCK_COUNT_WORD].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (words[SEQUENCE_WORD].load(std::memory_order_relaxed) != before) continue;
+
+        snapshot.peak = bitsFloat(peak);
+        snapshot.rms = bitsFloat(rms);
+        snapshot.clipCount = clips;
+        snapshot.blockCount = blocks;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,75 @@
+#ifndef AUDIORECORDINGAPP_LEVEL_METER_H
+#define AUDIORECORDINGAPP_LEVEL_METER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Level of the most recent audio block, with running totals since reset()
+struct LevelSnapshot {
+    float peak = 0.0f;        // linear, 1.0 = full scale
+    float rms = 0.0f;         // linear, 1.0 = full-scale square wave
+    uint32_t clipCount = 0;   // samples at full scale since reset
+    uint32_t blockCount = 0;  // blocks published since reset
+};
+
+// Single-writer level meter for an audio thread. Each block's levels are
+// published under a sequence lock: the writer never waits, and readers
+// retry if they raced with a publish. The state is a block of 32-bit words
+// that can also be shared as-is with Java through a direct ByteBuffer:
+//
+//   [0] sequence, odd while a publish is in progress
+//   [1] peak, float bits   [2] rms, float bits
+//   [3] clip count         [4] block count
+class LevelMeter {
+public:
+    static const int SEQUENCE_WORD = 0;
+    static const int PEAK_WORD = 1;
+    static const int RMS_WORD = 2;
+    static const int CLIP_COUNT_WORD = 3;
+    static const int BLOCK_COUNT_WORD = 4;
+    static const int WORD_COUNT = 5;
+
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared meter words must be plain lock-free 32-bit values");
+
+    // Own cache line, away from whatever the owner writes on other threads
+    alignas(64) std::atomic<uint32_t> words[WORD_COUNT];
+
+    // Written only by the publishing thread
+    uint32_t clipCount = 0;
+    uint32_t blockCount = 0;
+
+    static const int MAX_READ_ATTEMPTS = 64;
+
+public:
+    LevelMeter();
+
+    LevelMeter(const LevelMeter&) = delete;
+    LevelMeter& operator=(const LevelMeter&) = delete;
+
+    // Audio thread: measures one block of samples and publishes it
+    void publish(const short* samples, size_t count);
+
+    // Clears levels and counters; call while the audio thread is idle
+    void reset();
+
+    // Any thread. Returns false if every attempt raced with a publish,
+    // leaving |snapshot| untouched.
+    bool read(LevelSnapshot& snapshot) const;
+
+    // The same, from a meter's shared words as getSharedWords() hands them out
+    static bool readShared(const void* sharedWords, LevelSnapshot& snapshot);
+
+    void* getSharedWords() {
+        return words;
+    }
+
+    static size_t getSharedSize() {
+        return WORD_COUNT * sizeof(uint32_t);
+    }
+};
+
+#endif // AUDIORECORDINGAPP_LEVEL_METER_H
@@ -0,0 +1,126 @@
+#include "loudness_meter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// BS.1770's offset, which puts a 0 dBFS 997 Hz sine in one channel at -3.01 LUFS
+static const double LOUDNESS_OFFSET = -0.691;
+
+static const int HISTOGRAM_BINS =
+        static_cast<int>((LoudnessMeter::HISTOGRAM_MAX_LUFS - LoudnessMeter::ABSOLUTE_GATE_LUFS) /
+                         LoudnessMeter::HISTOGRAM_STEP_LU + 0.5);
+
+static double toLoudness(double energy) {
+    return LOUDNESS_OFFSET + 10.0 * std::log10(energy);
+}
+
+LoudnessMeter::LoudnessMeter(int sampleRate, int channels)
+        : channels(std::min(std::max(channels, 1), MAX_CHANNELS)),
+          stepFrames(static_cast<size_t>(std::max(sampleRate, 1000)) * STEP_MS / 1000),
+          binCounts(HISTOGRAM_BINS), binEnergies(HISTOGRAM_BINS) {
+    // The standard gives both stages at 48 kHz; these are the analog
+    // prototypes behind them, bilinear-transformed for any rate
+    const double pi = 3.14159265358979323846;
+    double k = std::tan(pi * 1681.974450955533 / sampleRate);
+    double q = 0.7071752369554196;
+    double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf = {(vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+             2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+
+    k = std::tan(pi * 38.13547087602444 / sampleRate);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    highPass = {1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0};
+}
+
+void LoudnessMeter::reset() {
+    std::fill(&state[0][0][0], &state[0][0][0] + sizeof(state) / sizeof(double), 0.0);
+    stepFill = 0;
+    stepEnergy = 0.0;
+    std::fill(std::begin(recentSteps), std::end(recentSteps), 0.0);
+    stepCount = 0;
+    std::fill(binCounts.begin(), binCounts.end(), 0);
+    std::fill(binEnergies.begin(), binEnergies.end(), 0.0);
+    samplePeak = 0.0f;
+}
+
+void LoudnessMeter::process(const float* samples, size_t frames) {
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (int channel = 0; channel < channels; channel++) {
+            float sample = samples[frame * channels + channel];
+            samplePeak = std::max(samplePeak, std::fabs(sample));
+
+            double x = sample;
+            double* s = state[channel][0];
+            double y = shelf.b0 * x + s[0];
+            s[0] = shelf.b1 * x - shelf.a1 * y + s[1];
+            s[1] = shelf.b2 * x - shelf.a2 * y;
+
+            x = y;
+            s = state[channel][1];
+            y = highPass.b0 * x + s[0];
+            s[0] = highPass.b1 * x - highPass.a1 * y + s[1];
+            s[1] = highPass.b2 * x - highPass.a2 * y;
+
+            stepEnergy += y * y;
+        }
+
+        if (++stepFill == stepFrames) {
+            addStep();
+        }
+    }
+}
+
+void LoudnessMeter::addStep() {
+    recentSteps[stepCount % STEPS_PER_BLOCK] = stepEnergy / static_cast<double>(stepFrames);
+    stepCount++;
+    stepFill = 0;
+    stepEnergy = 0.0;
+    if (stepCount < STEPS_PER_BLOCK) {
+        return;
+    }
+
+    // Each block is the last four steps: 400 ms, overlapping by 75%
+    double energy = 0.0;
+    for (double step : recentSteps) {
+        energy += step;
+    }
+    energy /= STEPS_PER_BLOCK;
+
+    double loudness = toLoudness(energy);
+    if (!(loudness > ABSOLUTE_GATE_LUFS)) {
+        return;
+    }
+    int bin = std::min(static_cast<int>((loudness - ABSOLUTE_GATE_LUFS) / HISTOGRAM_STEP_LU), HISTOGRAM_BINS - 1);
+    binCounts[bin]++;
+    binEnergies[bin] += energy;
+}
+
+double LoudnessMeter::getIntegratedLoudness() const {
+    uint64_t count = 0;
+    double energy = 0.0;
+    for (int bin = 0; bin < HISTOGRAM_BINS; bin++) {
+        count += binCounts[bin];
+        energy += binEnergies[bin];
+    }
+    if (count == 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    // Second pass from the bin holding the relative gate up
+    double gate = toLoudness(energy / count) + RELATIVE_GATE_LU;
+    int first = std::max(0, static_cast<int>((gate - ABSOLUTE_GATE_LUFS) / HISTOGRAM_STEP_LU));
+    count = 0;
+    energy = 0.0;
+    for (int bin = first; bin < HISTOGRAM_BINS; bin++) {
+        count += binCounts[bin];
+        energy += binEnergies[bin];
+    }
+    if (count == 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return toLoudness(energy / count);
+}
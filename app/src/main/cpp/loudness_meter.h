@@ -0,0 +1,71 @@
+#ifndef AUDIORECORDINGAPP_LOUDNESS_METER_H
+#define AUDIORECORDINGAPP_LOUDNESS_METER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Integrated loudness of a whole programme as ITU-R BS.1770-4 / EBU R128
+// define it: the signal is K-weighted (a high shelf and a high pass), its
+// mean square taken over 400 ms blocks every 100 ms, and blocks below
+// -70 LUFS and then below 10 LU under the gated mean are left out.
+//
+// Samples stream through in any block size and memory stays the same
+// whatever the programme length: gated blocks are kept as a histogram of
+// HISTOGRAM_STEP_LU wide bins, each with its count and summed energy, so
+// the relative gate is only as coarse as one bin.
+class LoudnessMeter {
+public:
+    static const int BLOCK_MS = 400;
+    static const int STEP_MS = 100;
+    static constexpr double ABSOLUTE_GATE_LUFS = -70.0;
+    static constexpr double RELATIVE_GATE_LU = -10.0;
+    static constexpr double HISTOGRAM_STEP_LU = 0.01;
+    static constexpr double HISTOGRAM_MAX_LUFS = 6.0;
+    static const int MAX_CHANNELS = 2;
+
+private:
+    static const int STEPS_PER_BLOCK = BLOCK_MS / STEP_MS;
+
+    struct Biquad {
+        double b0, b1, b2, a1, a2;
+    };
+
+    int channels;
+    Biquad shelf;
+    Biquad highPass;
+    // Transposed direct form II state, per channel and stage
+    double state[MAX_CHANNELS][2][2] = {};
+
+    size_t stepFrames;
+    size_t stepFill = 0;
+    double stepEnergy = 0.0;
+    double recentSteps[STEPS_PER_BLOCK] = {};
+    uint64_t stepCount = 0;
+
+    std::vector<uint32_t> binCounts;
+    std::vector<double> binEnergies;
+    float samplePeak = 0.0f;
+
+    void addStep();
+
+public:
+    // Mono or stereo; both channels weigh the same
+    LoudnessMeter(int sampleRate, int channels);
+
+    void reset();
+
+    // Interleaved samples, full scale at +/-1.0
+    void process(const float* samples, size_t frames);
+
+    // Gated loudness in LUFS so far; -infinity until a block has passed
+    // the absolute gate
+    double getIntegratedLoudness() const;
+
+    // Largest absolute sample seen, 1.0 = full scale
+    float getSamplePeak() const {
+        return samplePeak;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_LOUDNESS_METER_H
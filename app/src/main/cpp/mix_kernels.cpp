@@ -0,0 +1,213 @@
+#include "mix_kernels.h"
+
+#include <climits>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIX_KERNELS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MIX_KERNELS_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define MIX_KERNELS_SSSE3 1
+#endif
+#endif
+
+int toMixGain(float gain) {
+    // Written so that NaN comes out silent
+    if (!(gain > 0.0f)) return 0;
+    if (gain >= 1.0f) return MIX_UNITY_GAIN;
+    return static_cast<int>(lrintf(gain * MIX_UNITY_GAIN));
+}
+
+static inline short mixSample(short mix, short in, int gain) {
+    int scaled = gain >= MIX_UNITY_GAIN ? in : (in * gain + 0x4000) >> 15;
+    int sum = mix + scaled;
+    if (sum > SHRT_MAX) sum = SHRT_MAX;
+    if (sum < SHRT_MIN) sum = SHRT_MIN;
+    return static_cast<short>(sum);
+}
+
+void mixSamplesScalar(short* mix, const short* in, size_t count, int gain) {
+    for (size_t i = 0; i < count; i++) {
+        mix[i] = mixSample(mix[i], in[i], gain);
+    }
+}
+
+void mixMonoToStereoScalar(short* mix, const short* in, size_t frames, int gain) {
+    for (size_t i = 0; i < frames; i++) {
+        mix[2 * i] = mixSample(mix[2 * i], in[i], gain);
+        mix[2 * i + 1] = mixSample(mix[2 * i + 1], in[i], gain);
+    }
+}
+
+void mixSamplesScalar(float* mix, const float* in, size_t count, float gain) {
+    for (size_t i = 0; i < count; i++) {
+        mix[i] += in[i] * gain;
+    }
+}
+
+void mixMonoToStereoScalar(float* mix, const float* in, size_t frames, float gain) {
+    for (size_t i = 0; i < frames; i++) {
+        float sample = in[i] * gain;
+        mix[2 * i] += sample;
+        mix[2 * i + 1] += sample;
+    }
+}
+
+#if MIX_KERNELS_NEON
+
+void mixSamples(short* mix, const short* in, size_t count, int gain) {
+    const bool unity = gain >= MIX_UNITY_GAIN;
+    const int16x8_t scale = vdupq_n_s16(static_cast<int16_t>(unity ? 0 : gain));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        int16x8_t a = vld1q_s16(in + i);
+        int16x8_t b = vld1q_s16(in + i + 8);
+        if (!unity) {
+            // (a * gain + 0x4000) >> 15, the scalar rounding
+            a = vqrdmulhq_s16(a, scale);
+            b = vqrdmulhq_s16(b, scale);
+        }
+        vst1q_s16(mix + i, vqaddq_s16(vld1q_s16(mix + i), a));
+        vst1q_s16(mix + i + 8, vqaddq_s16(vld1q_s16(mix + i + 8), b));
+    }
+    mixSamplesScalar(mix + i, in + i, count - i, gain);
+}
+
+void mixMonoToStereo(short* mix, const short* in, size_t frames, int gain) {
+    const bool unity = gain >= MIX_UNITY_GAIN;
+    const int16x8_t scale = vdupq_n_s16(static_cast<int16_t>(unity ? 0 : gain));
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8_t samples = vld1q_s16(in + i);
+        if (!unity) {
+            samples = vqrdmulhq_s16(samples, scale);
+        }
+        // Scaled once, then each sample paired with itself
+        int16x8x2_t stereo = vzipq_s16(samples, samples);
+        short* out = mix + 2 * i;
+        vst1q_s16(out, vqaddq_s16(vld1q_s16(out), stereo.val[0]));
+        vst1q_s16(out + 8, vqaddq_s16(vld1q_s16(out + 8), stereo.val[1]));
+    }
+    mixMonoToStereoScalar(mix + 2 * i, in + i, frames - i, gain);
+}
+
+void mixSamples(float* mix, const float* in, size_t count, float gain) {
+    const float32x4_t scale = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_f32(mix + i, vmlaq_f32(vld1q_f32(mix + i), vld1q_f32(in + i), scale));
+        vst1q_f32(mix + i + 4, vmlaq_f32(vld1q_f32(mix + i + 4), vld1q_f32(in + i + 4), scale));
+    }
+    mixSamplesScalar(mix + i, in + i, count - i, gain);
+}
+
+void mixMonoToStereo(float* mix, const float* in, size_t frames, float gain) {
+    const float32x4_t scale = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4_t samples = vmulq_f32(vld1q_f32(in + i), scale);
+        float32x4x2_t stereo = vzipq_f32(samples, samples);
+        float* out = mix + 2 * i;
+        vst1q_f32(out, vaddq_f32(vld1q_f32(out), stereo.val[0]));
+        vst1q_f32(out + 4, vaddq_f32(vld1q_f32(out + 4), stereo.val[1]));
+    }
+    mixMonoToStereoScalar(mix + 2 * i, in + i, frames - i, gain);
+}
+
+#elif MIX_KERNELS_SSE2
+
+static inline __m128i scaleSamples(__m128i samples, __m128i scale) {
+#if MIX_KERNELS_SSSE3
+    return _mm_mulhrs_epi16(samples, scale);
+#else
+    // Full 32-bit products from the low and high halves, rounded and
+    // shifted down as pmulhrsw would
+    __m128i low = _mm_mullo_epi16(samples, scale);
+    __m128i high = _mm_mulhi_epi16(samples, scale);
+    const __m128i round = _mm_set1_epi32(0x4000);
+    __m128i first = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(low, high), round), 15);
+    __m128i second = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(low, high), round), 15);
+    return _mm_packs_epi32(first, second);
+#endif
+}
+
+void mixSamples(short* mix, const short* in, size_t count, int gain) {
+    const bool unity = gain >= MIX_UNITY_GAIN;
+    const __m128i scale = _mm_set1_epi16(static_cast<short>(unity ? 0 : gain));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+        if (!unity) {
+            a = scaleSamples(a, scale);
+            b = scaleSamples(b, scale);
+        }
+        __m128i* out = reinterpret_cast<__m128i*>(mix + i);
+        _mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), a));
+        _mm_storeu_si128(out + 1, _mm_adds_epi16(_mm_loadu_si128(out + 1), b));
+    }
+    mixSamplesScalar(mix + i, in + i, count - i, gain);
+}
+
+void mixMonoToStereo(short* mix, const short* in, size_t frames, int gain) {
+    const bool unity = gain >= MIX_UNITY_GAIN;
+    const __m128i scale = _mm_set1_epi16(static_cast<short>(unity ? 0 : gain));
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        if (!unity) {
+            samples = scaleSamples(samples, scale);
+        }
+        __m128i* out = reinterpret_cast<__m128i*>(mix + 2 * i);
+        _mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi16(samples, samples)));
+        _mm_storeu_si128(out + 1, _mm_adds_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi16(samples, samples)));
+    }
+    mixMonoToStereoScalar(mix + 2 * i, in + i, frames - i, gain);
+}
+
+void mixSamples(float* mix, const float* in, size_t count, float gain) {
+    const __m128 scale = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(_mm_loadu_ps(in + i), scale)));
+        _mm_storeu_ps(mix + i + 4,
+                      _mm_add_ps(_mm_loadu_ps(mix + i + 4), _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale)));
+    }
+    mixSamplesScalar(mix + i, in + i, count - i, gain);
+}
+
+void mixMonoToStereo(float* mix, const float* in, size_t frames, float gain) {
+    const __m128 scale = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 samples = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        float* out = mix + 2 * i;
+        _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_unpacklo_ps(samples, samples)));
+        _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_unpackhi_ps(samples, samples)));
+    }
+    mixMonoToStereoScalar(mix + 2 * i, in + i, frames - i, gain);
+}
+
+#else
+
+void mixSamples(short* mix, const short* in, size_t count, int gain) {
+    mixSamplesScalar(mix, in, count, gain);
+}
+
+void mixMonoToStereo(short* mix, const short* in, size_t frames, int gain) {
+    mixMonoToStereoScalar(mix, in, frames, gain);
+}
+
+void mixSamples(float* mix, const float* in, size_t count, float gain) {
+    mixSamplesScalar(mix, in, count, gain);
+}
+
+void mixMonoToStereo(float* mix, const float* in, size_t frames, float gain) {
+    mixMonoToStereoScalar(mix, in, frames, gain);
+}
+
+#endif
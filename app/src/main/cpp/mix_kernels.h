@@ -0,0 +1,34 @@
+#ifndef AUDIORECORDINGAPP_MIX_KERNELS_H
+#define AUDIORECORDINGAPP_MIX_KERNELS_H
+
+#include <cstddef>
+
+// Gains are Q15 fixed point: MIX_UNITY_GAIN passes samples through
+// unscaled, anything below multiplies with rounding, as NEON vqrdmulh and
+// SSSE3 pmulhrsw do
+static const int MIX_UNITY_GAIN = 32768;
+
+// Q15 gain for a linear |gain|, clamped to [0, 1]
+int toMixGain(float gain);
+
+// Adds |count| samples of |in|, scaled by |gain|, into |mix|, saturating
+// at 16 bits. NEON or SSE2 (SSSE3 for the multiply) where available.
+void mixSamples(short* mix, const short* in, size_t count, int gain);
+
+// Same for a mono source into an interleaved stereo mix: each sample goes
+// into both channels of its frame
+void mixMonoToStereo(short* mix, const short* in, size_t frames, int gain);
+
+// The same for a float mix, with a linear |gain| and no saturation; the
+// device clamps what it is handed. NEON or SSE.
+void mixSamples(float* mix, const float* in, size_t count, float gain);
+void mixMonoToStereo(float* mix, const float* in, size_t frames, float gain);
+
+// Plain loops with the same results, kept as the reference for tests and
+// benchmarks and used for the tail of each SIMD pass
+void mixSamplesScalar(short* mix, const short* in, size_t count, int gain);
+void mixMonoToStereoScalar(short* mix, const short* in, size_t frames, int gain);
+void mixSamplesScalar(float* mix, const float* in, size_t count, float gain);
+void mixMonoToStereoScalar(float* mix, const float* in, size_t frames, float gain);
+
+#endif // AUDIORECORDINGAPP_MIX_KERNELS_H
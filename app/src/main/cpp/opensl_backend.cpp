@@ -0,0 +1,319 @@
+#include "opensl_backend.h"
+
+#include "audio_engine.h"
+#include "audio_trace.h"
+
+#define LOG_TAG "OpenSlBackend"
+#include "audio_log.h"
+
+OpenSlBackend::~OpenSlBackend() {
+    closeCapture();
+    closePlayback();
+
+    if (engineAcquired) {
+        AudioEngine::getInstance().release();
+    }
+}
+
+bool OpenSlBackend::initialize() {
+    if (engineAcquired) {
+        return true;
+    }
+
+    if (!AudioEngine::getInstance().acquire()) {
+        LOGE("Failed to initialize audio engine");
+        return false;
+    }
+
+    engineEngine = AudioEngine::getInstance().getEngine();
+    outputMixObject = AudioEngine::getInstance().getOutputMix();
+    engineAcquired = true;
+    return true;
+}
+
+bool OpenSlBackend::openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) {
+    if (engineEngine == nullptr) {
+        LOGE("Audio engine not initialized");
+        return false;
+    }
+
+    closeCapture();
+
+    SLresult result;
+    captureConfig = config;
+    captureCallback = callback;
+    capturePool.assign(static_cast<size_t>(config.bufferCount) * config.framesPerBuffer *
+                       config.getBytesPerFrame(), 0);
+
+    // Configure audio source
+    SLDataLocator_IODevice loc_dev = {SL_DATALOCATOR_IODEVICE, SL_IODEVICE_AUDIOINPUT,
+                                      SL_DEFAULTDEVICEID_AUDIOINPUT, nullptr};
+    SLDataSource audioSrc = {&loc_dev, nullptr};
+
+    // Configure audio sink
+    SLDataLocator_AndroidSimpleBufferQueue loc_bq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+                                                     static_cast<SLuint32>(config.bufferCount)};
+    SLAndroidDataFormat_PCM_EX format_pcm = makePcmFormat(config);
+    SLDataSink audioSnk = {&loc_bq, &format_pcm};
+
+    // Create audio recorder
+    const SLInterfaceID id[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
+    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
+    result = (*engineEngine)->CreateAudioRecorder(engineEngine, &recorderObject, &audioSrc,
+                                                   &audioSnk, 1, id, req);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to create audio recorder");
+        closeCapture();
+        return false;
+    }
+
+    // Realize the audio recorder
+    result = (*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to realize audio recorder");
+        closeCapture();
+        return false;
+    }
+
+    // Get the record interface
+    result = (*recorderObject)->GetInterface(recorderObject, SL_IID_RECORD, &recorderRecord);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to get record interface");
+        closeCapture();
+        return false;
+    }
+
+    // Get the buffer queue interface
+    result = (*recorderObject)->GetInterface(recorderObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE,
+                                              &recorderBufferQueue);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to get buffer queue interface");
+        closeCapture();
+        return false;
+    }
+
+    // Register callback
+    result = (*recorderBufferQueue)->RegisterCallback(recorderBufferQueue, bqRecorderCallback, this);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to register callback");
+        closeCapture();
+        return false;
+    }
+
+    return true;
+}
+
+bool OpenSlBackend::startCapture() {
+    if (recorderObject == nullptr) {
+        LOGE("Capture stream not open");
+        return false;
+    }
+
+    SLresult result;
+
+    // Fill the queue with the whole pool
+    nextCaptureBuffer = 0;
+    (*recorderBufferQueue)->Clear(recorderBufferQueue);
+    for (int i = 0; i < captureConfig.bufferCount; i++) {
+        result = (*recorderBufferQueue)->Enqueue(recorderBufferQueue, captureBuffer(i),
+                                                 captureBufferBytes());
+        if (SL_RESULT_SUCCESS != result) {
+            LOGE("Failed to enqueue buffer");
+            return false;
+        }
+    }
+
+    // Start recording
+    result = (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_RECORDING);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to start recording");
+        return false;
+    }
+
+    return true;
+}
+
+void OpenSlBackend::stopCapture() {
+    if (recorderRecord) {
+        (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED);
+    }
+    if (recorderBufferQueue) {
+        (*recorderBufferQueue)->Clear(recorderBufferQueue);
+    }
+}
+
+void OpenSlBackend::closeCapture() {
+    if (recorderObject) {
+        (*recorderObject)->Destroy(recorderObject);
+        recorderObject = nullptr;
+        recorderRecord = nullptr;
+        recorderBufferQueue = nullptr;
+    }
+    captureCallback = nullptr;
+}
+
+bool OpenSlBackend::openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) {
+    if (engineEngine == nullptr || outputMixObject == nullptr) {
+        LOGE("Player engine not initialized");
+        return false;
+    }
+
+    closePlayback();
+
+    SLresult result;
+    renderCallback = callback;
+    playbackConfig = config;
+
+    // Configure audio source
+    SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE,
+                                                       static_cast<SLuint32>(config.bufferCount)};
+    SLAndroidDataFormat_PCM_EX format_pcm = makePcmFormat(config);
+    SLDataSource audioSrc = {&loc_bufq, &format_pcm};
+
+    // Configure audio sink on the shared output mix
+    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX, outputMixObject};
+    SLDataSink audioSnk = {&loc_outmix, nullptr};
+
+    // Create audio player
+    const SLInterfaceID ids[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
+    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
+    result = (*engineEngine)->CreateAudioPlayer(engineEngine, &playerObject, &audioSrc, &audioSnk, 1, ids, req);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to create audio player");
+        closePlayback();
+        return false;
+    }
+
+    // Realize the player
+    result = (*playerObject)->Realize(playerObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to realize audio player");
+        closePlayback();
+        return false;
+    }
+
+    // Get the play interface
+    result = (*playerObject)->GetInterface(playerObject, SL_IID_PLAY, &playerPlay);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to get play interface");
+        closePlayback();
+        return false;
+    }
+
+    // Get the buffer queue interface
+    result = (*playerObject)->GetInterface(playerObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &playerBufferQueue);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to get player buffer queue interface");
+        closePlayback();
+        return false;
+    }
+
+    // Register callback
+    result = (*playerBufferQueue)->RegisterCallback(playerBufferQueue, bqPlayerCallback, this);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to register player callback");
+        closePlayback();
+        return false;
+    }
+
+    return true;
+}
+
+bool OpenSlBackend::startPlayback() {
+    if (playerObject == nullptr) {
+        LOGE("Playback stream not open");
+        return false;
+    }
+
+    // Start playback
+    SLresult result = (*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_PLAYING);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGE("Failed to start playback");
+        return false;
+    }
+
+    // Enqueue first buffer
+    enqueueRenderBuffer();
+    return true;
+}
+
+void OpenSlBackend::stopPlayback() {
+    if (playerPlay) {
+        (*playerPlay)->SetPlayState(playerPlay, SL_PLAYSTATE_STOPPED);
+    }
+    if (playerBufferQueue) {
+        (*playerBufferQueue)->Clear(playerBufferQueue);
+    }
+}
+
+void OpenSlBackend::closePlayback() {
+    if (playerObject) {
+        (*playerObject)->Destroy(playerObject);
+        playerObject = nullptr;
+        playerPlay = nullptr;
+        playerBufferQueue = nullptr;
+    }
+    renderCallback = nullptr;
+}
+
+SLAndroidDataFormat_PCM_EX OpenSlBackend::makePcmFormat(const AudioStreamConfig& config) {
+    // The extended descriptor is the only one that can express float; it
+    // describes the integer formats just as well
+    SLuint32 bits = static_cast<SLuint32>(getBitsPerSample(config.format));
+    SLuint32 channelMask = config.channels == 2
+                           ? SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT
+                           : SL_SPEAKER_FRONT_CENTER;
+    SLuint32 representation = config.format == SampleFormat::FLOAT32
+                              ? SL_ANDROID_PCM_REPRESENTATION_FLOAT
+                              : SL_ANDROID_PCM_REPRESENTATION_SIGNED_INT;
+    return {SL_ANDROID_DATAFORMAT_PCM_EX, static_cast<SLuint32>(config.channels),
+            static_cast<SLuint32>(config.sampleRate) * 1000, bits, bits, channelMask,
+            SL_BYTEORDER_LITTLEENDIAN, representation};
+}
+
+void OpenSlBackend::bqRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void *context) {
+    OpenSlBackend* backend = static_cast<OpenSlBackend*>(context);
+    backend->processCaptureBuffer();
+}
+
+void OpenSlBackend::bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *context) {
+    OpenSlBackend* backend = static_cast<OpenSlBackend*>(context);
+    backend->enqueueRenderBuffer();
+}
+
+void OpenSlBackend::processCaptureBuffer() {
+    AUDIO_TRACE_SECTION("capture callback");
+    // Buffers complete in the order they were queued
+    uint8_t* buffer = captureBuffer(nextCaptureBuffer);
+    nextCaptureBuffer = (nextCaptureBuffer + 1) % captureConfig.bufferCount;
+
+    if (captureCallback) {
+        captureCallback->onCaptureBlock(
+                buffer, static_cast<size_t>(captureConfig.framesPerBuffer) * captureConfig.channels);
+    }
+
+    // Hand the buffer straight back so the queue stays full
+    if (recorderBufferQueue) {
+        (*recorderBufferQueue)->Enqueue(recorderBufferQueue, buffer, captureBufferBytes());
+    }
+}
+
+void OpenSlBackend::enqueueRenderBuffer() {
+    AUDIO_TRACE_SECTION("render callback");
+    const void* samples = nullptr;
+    size_t sampleCount = 0;
+
+    if (renderCallback && playerBufferQueue &&
+        renderCallback->onRenderBuffer(samples, sampleCount) && sampleCount > 0) {
+        (*playerBufferQueue)->Enqueue(playerBufferQueue, samples,
+                                      sampleCount * getBytesPerSample(playbackConfig.format));
+    }
+}
+
+uint8_t* OpenSlBackend::captureBuffer(int index) {
+    return &capturePool[static_cast<size_t>(index) * captureBufferBytes()];
+}
+
+SLuint32 OpenSlBackend::captureBufferBytes() const {
+    return static_cast<SLuint32>(captureConfig.framesPerBuffer * captureConfig.getBytesPerFrame());
+}
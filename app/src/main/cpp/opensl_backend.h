@@ -0,0 +1,62 @@
+#ifndef AUDIORECORDINGAPP_OPENSL_BACKEND_H
+#define AUDIORECORDINGAPP_OPENSL_BACKEND_H
+
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+#include <vector>
+
+#include "audio_backend.h"
+
+// AudioBackend on top of OpenSL ES, using the shared AudioEngine. Capture
+// runs a rotating pool of buffers that keeps the device queue full;
+// playback enqueues whatever pointer the render callback hands back.
+class OpenSlBackend : public AudioBackend {
+private:
+    SLEngineItf engineEngine = nullptr;
+    SLObjectItf outputMixObject = nullptr;
+    bool engineAcquired = false;
+
+    SLObjectItf recorderObject = nullptr;
+    SLRecordItf recorderRecord = nullptr;
+    SLAndroidSimpleBufferQueueItf recorderBufferQueue = nullptr;
+    AudioCaptureCallback* captureCallback = nullptr;
+    AudioStreamConfig captureConfig;
+    std::vector<uint8_t> capturePool;
+    int nextCaptureBuffer = 0;
+
+    SLObjectItf playerObject = nullptr;
+    SLPlayItf playerPlay = nullptr;
+    SLAndroidSimpleBufferQueueItf playerBufferQueue = nullptr;
+    AudioRenderCallback* renderCallback = nullptr;
+    AudioStreamConfig playbackConfig;
+
+public:
+    OpenSlBackend() = default;
+    ~OpenSlBackend() override;
+
+    bool initialize() override;
+
+    bool openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) override;
+    bool startCapture() override;
+    void stopCapture() override;
+    void closeCapture() override;
+
+    bool openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) override;
+    bool startPlayback() override;
+    void stopPlayback() override;
+    void closePlayback() override;
+
+private:
+    static SLAndroidDataFormat_PCM_EX makePcmFormat(const AudioStreamConfig& config);
+
+    static void bqRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void *context);
+    static void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void *context);
+
+    void processCaptureBuffer();
+    void enqueueRenderBuffer();
+
+    uint8_t* captureBuffer(int index);
+    SLuint32 captureBufferBytes() const;
+};
+
+#endif // AUDIORECORDINGAPP_OPENSL_BACKEND_H
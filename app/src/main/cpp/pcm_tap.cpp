@@ -0,0 +1,76 @@
+#include "pcm_tap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+uint32_t PcmTap::roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value && result < MAX_CAPACITY) {
+        result <<= 1;
+    }
+    return static_cast<uint32_t>(result);
+}
+
+PcmTap::PcmTap(int sampleRate, int channels, SampleFormat format, size_t minSamples)
+        : capacity(roundUpToPowerOfTwo(std::max<size_t>(minSamples, 2))),
+          mask(capacity - 1),
+          bytesPerSample(getBytesPerSample(format)),
+          memory(new uint8_t[DATA_OFFSET + static_cast<size_t>(capacity) * getBytesPerSample(format)]()) {
+    words = reinterpret_cast<std::atomic<uint32_t>*>(memory.get());
+    for (int i = 0; i < HEADER_WORDS; i++) {
+        new (&words[i]) std::atomic<uint32_t>(0);
+    }
+    data = memory.get() + DATA_OFFSET;
+
+    words[CAPACITY_WORD].store(capacity, std::memory_order_relaxed);
+    words[BYTES_PER_SAMPLE_WORD].store(static_cast<uint32_t>(bytesPerSample), std::memory_order_relaxed);
+    words[CHANNELS_WORD].store(static_cast<uint32_t>(channels), std::memory_order_relaxed);
+    words[SAMPLE_RATE_WORD].store(static_cast<uint32_t>(sampleRate), std::memory_order_relaxed);
+    words[SAMPLE_FORMAT_WORD].store(static_cast<uint32_t>(format), std::memory_order_relaxed);
+}
+
+bool PcmTap::write(const void* samples, size_t sampleCount) {
+    const uint32_t head = words[WRITE_INDEX_WORD].load(std::memory_order_relaxed);
+    const uint32_t tail = words[READ_INDEX_WORD].load(std::memory_order_acquire);
+
+    // A reader that published nonsense only makes the ring look full
+    uint32_t used = head - tail;
+    if (used > capacity || capacity - used < sampleCount) {
+        std::atomic<uint32_t>& overflows = words[OVERFLOW_COUNT_WORD];
+        std::atomic<uint32_t>& dropped = words[DROPPED_SAMPLES_WORD];
+        overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        dropped.store(dropped.load(std::memory_order_relaxed) + static_cast<uint32_t>(sampleCount),
+                      std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t offset = head & mask;
+    const size_t firstPart = std::min<size_t>(sampleCount, capacity - offset);
+    const uint8_t* in = static_cast<const uint8_t*>(samples);
+    memcpy(data + offset * bytesPerSample, in, firstPart * bytesPerSample);
+    memcpy(data, in + firstPart * bytesPerSample, (sampleCount - firstPart) * bytesPerSample);
+
+    words[WRITE_INDEX_WORD].store(head + static_cast<uint32_t>(sampleCount), std::memory_order_release);
+    return true;
+}
+
+size_t PcmTap::read(void* out, size_t maxSamples) {
+    const uint32_t tail = words[READ_INDEX_WORD].load(std::memory_order_relaxed);
+    const uint32_t head = words[WRITE_INDEX_WORD].load(std::memory_order_acquire);
+    const size_t count = std::min<size_t>(head - tail, maxSamples);
+
+    const size_t offset = tail & mask;
+    const size_t firstPart = std::min<size_t>(count, capacity - offset);
+    uint8_t* dest = static_cast<uint8_t*>(out);
+    memcpy(dest, data + offset * bytesPerSample, firstPart * bytesPerSample);
+    memcpy(dest + firstPart * bytesPerSample, data, (count - firstPart) * bytesPerSample);
+
+    words[READ_INDEX_WORD].store(tail + static_cast<uint32_t>(count), std::memory_order_release);
+    return count;
+}
+
+size_t PcmTap::getAvailableSamples() const {
+    return words[WRITE_INDEX_WORD].load(std::memory_order_acquire) -
+           words[READ_INDEX_WORD].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,100 @@
+#ifndef AUDIORECORDINGAPP_PCM_TAP_H
+#define AUDIORECORDINGAPP_PCM_TAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "sample_format.h"
+
+// Live capture audio for a consumer outside the native code, in one block
+// of memory that Java can wrap in a direct ByteBuffer as-is: a header of
+// 32-bit words, then a ring of samples in the capture format. The audio
+// thread copies each block in once and publishes the write index; the
+// reader copies out of the same memory and publishes its read index, so
+// neither side calls the other. The writer never waits: a block that does
+// not fit is dropped whole and counted.
+//
+//   [0] write index        [16] read index (own cache line, reader only)
+//   [32] overflowed blocks [33] dropped samples
+//   [34] capacity          [35] bytes per sample
+//   [36] channels          [37] sample rate   [38] SampleFormat
+//
+// Indices count samples and wrap at 2^32; the capacity is a power of two,
+// so a sample's place in the ring is its index masked by capacity - 1.
+// Samples start DATA_OFFSET bytes in.
+class PcmTap {
+public:
+    static const int WRITE_INDEX_WORD = 0;
+    static const int READ_INDEX_WORD = 16;
+    static const int OVERFLOW_COUNT_WORD = 32;
+    static const int DROPPED_SAMPLES_WORD = 33;
+    static const int CAPACITY_WORD = 34;
+    static const int BYTES_PER_SAMPLE_WORD = 35;
+    static const int CHANNELS_WORD = 36;
+    static const int SAMPLE_RATE_WORD = 37;
+    static const int SAMPLE_FORMAT_WORD = 38;
+    static const int HEADER_WORDS = 48;
+    static const size_t DATA_OFFSET = HEADER_WORDS * sizeof(uint32_t);
+
+    // Largest ring, in samples
+    static const size_t MAX_CAPACITY = size_t(1) << 24;
+
+private:
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared tap words must be plain lock-free 32-bit values");
+
+    const uint32_t capacity;
+    const uint32_t mask;
+    const size_t bytesPerSample;
+    std::unique_ptr<uint8_t[]> memory;
+    std::atomic<uint32_t>* words;
+    uint8_t* data;
+
+    static uint32_t roundUpToPowerOfTwo(size_t value);
+
+public:
+    // Room for at least |minSamples| samples, up to MAX_CAPACITY
+    PcmTap(int sampleRate, int channels, SampleFormat format, size_t minSamples);
+
+    PcmTap(const PcmTap&) = delete;
+    PcmTap& operator=(const PcmTap&) = delete;
+
+    // Audio thread: copies all of |sampleCount| samples in, or drops them
+    // and counts the overflow
+    bool write(const void* samples, size_t sampleCount);
+
+    // Reader side, for native consumers and tests; Java does the same on
+    // the shared memory. Copies out up to |maxSamples| samples.
+    size_t read(void* out, size_t maxSamples);
+
+    size_t getAvailableSamples() const;
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    size_t getSampleSize() const {
+        return bytesPerSample;
+    }
+
+    uint32_t getOverflowCount() const {
+        return words[OVERFLOW_COUNT_WORD].load(std::memory_order_relaxed);
+    }
+
+    uint32_t getDroppedSamples() const {
+        return words[DROPPED_SAMPLES_WORD].load(std::memory_order_relaxed);
+    }
+
+    void* getSharedMemory() {
+        return memory.get();
+    }
+
+    size_t getSharedSize() const {
+        return DATA_OFFSET + static_cast<size_t>(capacity) * bytesPerSample;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_PCM_TAP_H
@@ -0,0 +1,194 @@
+#include "peak_kernels.h"
+
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PEAK_KERNELS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PEAK_KERNELS_SSE2 1
+#endif
+
+void reducePeaksScalar(const short* samples, size_t count, PeakStats& stats) {
+    short min = stats.min;
+    short max = stats.max;
+    int64_t sumSquares = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        short sample = samples[i];
+        if (sample < min) min = sample;
+        if (sample > max) max = sample;
+        sumSquares += static_cast<int32_t>(sample) * sample;
+    }
+
+    stats.min = min;
+    stats.max = max;
+    stats.sumSquares += sumSquares;
+    stats.sampleCount += count;
+}
+
+size_t countZeroCrossingsScalar(const short* samples, size_t count, size_t stride) {
+    size_t crossings = 0;
+    for (size_t i = 0; i + stride < count; i++) {
+        crossings += (samples[i] ^ samples[i + stride]) < 0;
+    }
+    return crossings;
+}
+
+// 16-bit counters in the SIMD loops are emptied this often
+static const size_t CROSSING_CHUNK = 8 * 4096;
+
+#if PEAK_KERNELS_NEON
+
+void reducePeaks(const short* samples, size_t count, PeakStats& stats) {
+    const size_t vectorCount = count & ~static_cast<size_t>(15);
+    int16x8_t min0 = vdupq_n_s16(stats.min), min1 = min0;
+    int16x8_t max0 = vdupq_n_s16(stats.max), max1 = max0;
+    int64x2_t sum0 = vdupq_n_s64(0), sum1 = sum0;
+
+    // Two independent accumulator sets hide the min/max and multiply latency
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        int16x8_t a = vld1q_s16(samples + i);
+        int16x8_t b = vld1q_s16(samples + i + 8);
+        min0 = vminq_s16(min0, a);
+        max0 = vmaxq_s16(max0, a);
+        min1 = vminq_s16(min1, b);
+        max1 = vmaxq_s16(max1, b);
+        // Each square fits in 31 bits; pairwise add-accumulate widens to 64
+        sum0 = vpadalq_s32(sum0, vmull_s16(vget_low_s16(a), vget_low_s16(a)));
+        sum0 = vpadalq_s32(sum0, vmull_s16(vget_high_s16(a), vget_high_s16(a)));
+        sum1 = vpadalq_s32(sum1, vmull_s16(vget_low_s16(b), vget_low_s16(b)));
+        sum1 = vpadalq_s32(sum1, vmull_s16(vget_high_s16(b), vget_high_s16(b)));
+    }
+
+    int16x8_t minAll = vminq_s16(min0, min1);
+    int16x8_t maxAll = vmaxq_s16(max0, max1);
+    int64x2_t sumAll = vaddq_s64(sum0, sum1);
+#if defined(__aarch64__)
+    stats.min = vminvq_s16(minAll);
+    stats.max = vmaxvq_s16(maxAll);
+    stats.sumSquares += vaddvq_s64(sumAll);
+#else
+    int16x4_t min4 = vmin_s16(vget_low_s16(minAll), vget_high_s16(minAll));
+    int16x4_t max4 = vmax_s16(vget_low_s16(maxAll), vget_high_s16(maxAll));
+    min4 = vpmin_s16(min4, min4);
+    min4 = vpmin_s16(min4, min4);
+    max4 = vpmax_s16(max4, max4);
+    max4 = vpmax_s16(max4, max4);
+    stats.min = vget_lane_s16(min4, 0);
+    stats.max = vget_lane_s16(max4, 0);
+    stats.sumSquares += vgetq_lane_s64(sumAll, 0) + vgetq_lane_s64(sumAll, 1);
+#endif
+    stats.sampleCount += vectorCount;
+
+    reducePeaksScalar(samples + vectorCount, count - vectorCount, stats);
+}
+
+size_t countZeroCrossings(const short* samples, size_t count, size_t stride) {
+    size_t pairs = count > stride ? count - stride : 0;
+    size_t vectorPairs = pairs & ~static_cast<size_t>(7);
+    size_t crossings = 0;
+
+    // The sign bit of a ^ b is set where the pair straddles zero; shifted
+    // down it is -1, so subtracting counts it
+    for (size_t start = 0; start < vectorPairs; start += CROSSING_CHUNK) {
+        size_t end = std::min(vectorPairs, start + CROSSING_CHUNK);
+        int16x8_t counts = vdupq_n_s16(0);
+        for (size_t i = start; i < end; i += 8) {
+            int16x8_t changed = veorq_s16(vld1q_s16(samples + i), vld1q_s16(samples + i + stride));
+            counts = vsubq_s16(counts, vshrq_n_s16(changed, 15));
+        }
+        int32x4_t wide = vpaddlq_s16(counts);
+        crossings += static_cast<size_t>(vgetq_lane_s32(wide, 0) + vgetq_lane_s32(wide, 1) +
+                                         vgetq_lane_s32(wide, 2) + vgetq_lane_s32(wide, 3));
+    }
+
+    return crossings + countZeroCrossingsScalar(samples + vectorPairs, count - vectorPairs, stride);
+}
+
+#elif PEAK_KERNELS_SSE2
+
+static short horizontalMin(__m128i v) {
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<short>(_mm_cvtsi128_si32(v));
+}
+
+static short horizontalMax(__m128i v) {
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_max_epi16(v, _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<short>(_mm_cvtsi128_si32(v));
+}
+
+void reducePeaks(const short* samples, size_t count, PeakStats& stats) {
+    const size_t vectorCount = count & ~static_cast<size_t>(15);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i min0 = _mm_set1_epi16(stats.min), min1 = min0;
+    __m128i max0 = _mm_set1_epi16(stats.max), max1 = max0;
+    __m128i sum0 = zero, sum1 = zero;
+
+    for (size_t i = 0; i < vectorCount; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 8));
+        min0 = _mm_min_epi16(min0, a);
+        max0 = _mm_max_epi16(max0, a);
+        min1 = _mm_min_epi16(min1, b);
+        max1 = _mm_max_epi16(max1, b);
+
+        // madd sums pairs of squares; at most 2 * 32768^2 = 2^31, which only
+        // fits unsigned, so zero-extend to 64-bit lanes before accumulating
+        __m128i squaresA = _mm_madd_epi16(a, a);
+        __m128i squaresB = _mm_madd_epi16(b, b);
+        sum0 = _mm_add_epi64(sum0, _mm_unpacklo_epi32(squaresA, zero));
+        sum0 = _mm_add_epi64(sum0, _mm_unpackhi_epi32(squaresA, zero));
+        sum1 = _mm_add_epi64(sum1, _mm_unpacklo_epi32(squaresB, zero));
+        sum1 = _mm_add_epi64(sum1, _mm_unpackhi_epi32(squaresB, zero));
+    }
+
+    stats.min = horizontalMin(_mm_min_epi16(min0, min1));
+    stats.max = horizontalMax(_mm_max_epi16(max0, max1));
+
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(sum0, sum1));
+    stats.sumSquares += lanes[0] + lanes[1];
+    stats.sampleCount += vectorCount;
+
+    reducePeaksScalar(samples + vectorCount, count - vectorCount, stats);
+}
+
+size_t countZeroCrossings(const short* samples, size_t count, size_t stride) {
+    size_t pairs = count > stride ? count - stride : 0;
+    size_t vectorPairs = pairs & ~static_cast<size_t>(7);
+    size_t crossings = 0;
+
+    for (size_t start = 0; start < vectorPairs; start += CROSSING_CHUNK) {
+        size_t end = std::min(vectorPairs, start + CROSSING_CHUNK);
+        __m128i counts = _mm_setzero_si128();
+        for (size_t i = start; i < end; i += 8) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + stride));
+            counts = _mm_sub_epi16(counts, _mm_srai_epi16(_mm_xor_si128(a, b), 15));
+        }
+        // madd against ones widens the eight counters to four 32-bit sums
+        int32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_madd_epi16(counts, _mm_set1_epi16(1)));
+        crossings += static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+
+    return crossings + countZeroCrossingsScalar(samples + vectorPairs, count - vectorPairs, stride);
+}
+
+#else
+
+void reducePeaks(const short* samples, size_t count, PeakStats& stats) {
+    reducePeaksScalar(samples, count, stats);
+}
+
+size_t countZeroCrossings(const short* samples, size_t count, size_t stride) {
+    return countZeroCrossingsScalar(samples, count, stride);
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef AUDIORECORDINGAPP_PEAK_KERNELS_H
+#define AUDIORECORDINGAPP_PEAK_KERNELS_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+// Running min, max and sum of squares over a stretch of 16-bit samples.
+// A default-constructed value is the identity, so partial results from
+// consecutive blocks can be merged.
+struct PeakStats {
+    short min = SHRT_MAX;
+    short max = SHRT_MIN;
+    int64_t sumSquares = 0;
+    size_t sampleCount = 0;
+
+    void merge(const PeakStats& other) {
+        if (other.min < min) min = other.min;
+        if (other.max > max) max = other.max;
+        sumSquares += other.sumSquares;
+        sampleCount += other.sampleCount;
+    }
+};
+
+// Folds |count| samples into |stats|, using NEON or SSE2 where available
+void reducePeaks(const short* samples, size_t count, PeakStats& stats);
+
+// Plain loop with the same result, kept as the reference for tests and
+// benchmarks and used for the tail of each SIMD pass
+void reducePeaksScalar(const short* samples, size_t count, PeakStats& stats);
+
+// Counts sign changes between each sample and the one |stride| samples
+// later; with the channel count as the stride, interleaved channels are
+// each compared with themselves. Zero counts as positive.
+size_t countZeroCrossings(const short* samples, size_t count, size_t stride);
+size_t countZeroCrossingsScalar(const short* samples, size_t count, size_t stride);
+
+#endif // AUDIORECORDINGAPP_PEAK_KERNELS_H
@@ -0,0 +1,290 @@
+#include "playback_stream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "audio_trace.h"
+#include "wav_probe.h"
+
+#define LOG_TAG "PlaybackStream"
+#include "audio_log.h"
+
+PlaybackStream::~PlaybackStream() {
+    close();
+}
+
+bool PlaybackStream::open(const std::string& path) {
+    close();
+
+    if (flacDecoder.open(path)) {
+        const FlacStreamInfo& info = flacDecoder.getStreamInfo();
+        if (info.channels < 1 || info.channels > 2) {
+            LOGE("Unsupported FLAC format in %s: %u channels", path.c_str(), info.channels);
+            flacDecoder.close();
+            return false;
+        }
+        isFlac = true;
+        format = SampleFormat::INT16;
+        channels = info.channels;
+        frameCount = info.totalFrames;
+        // A whole frame goes into one block; sized up front so decoding
+        // never allocates
+        blockSamples = std::max(BLOCK_SAMPLES, static_cast<size_t>(info.maxBlockSize) * channels);
+        decodeBuffer.reserve(static_cast<size_t>(info.maxBlockSize) * channels);
+        sampleRate = info.sampleRate;
+    } else {
+        if (!probeWavFile(path, wavInfo) || !getWavSampleFormat(wavInfo, format) || wavInfo.channels < 1 ||
+            wavInfo.channels > 2 || wavInfo.blockAlign == 0) {
+            LOGE("Unsupported WAV format in %s: format %u, %u channels, %u bits", path.c_str(),
+                 wavInfo.audioFormat, wavInfo.channels, wavInfo.bitsPerSample);
+            return false;
+        }
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            LOGE("Failed to open audio file: %s", path.c_str());
+            return false;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        channels = wavInfo.channels;
+        frameCount = wavInfo.dataSize / wavInfo.blockAlign;
+        blockSamples = BLOCK_SAMPLES;
+        sampleRate = wavInfo.sampleRate;
+    }
+
+    for (PlaybackBlock& block : blocks) {
+        block.data.resize(blockSamples * getBytesPerSample(format));
+    }
+    return true;
+}
+
+bool PlaybackStream::open(const EditList& list) {
+    close();
+
+    if (list.getFrameCount() == 0) {
+        LOGE("Empty edit list");
+        return false;
+    }
+    editList = list;
+    isEditList = true;
+    format = list.getFormat();
+    channels = list.getChannels();
+    frameCount = list.getFrameCount();
+    blockSamples = BLOCK_SAMPLES;
+    sampleRate = list.getSampleRate();
+
+    for (PlaybackBlock& block : blocks) {
+        block.data.resize(blockSamples * getBytesPerSample(format));
+    }
+    return true;
+}
+
+void PlaybackStream::close() {
+    stop();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    flacDecoder.close();
+    isFlac = false;
+    editList.clear();
+    isEditList = false;
+    wavInfo = WavInfo();
+    sampleRate = 0;
+    channels = 0;
+    frameCount = 0;
+}
+
+bool PlaybackStream::start(uint64_t frame) {
+    stop();
+    if (!isOpen()) {
+        return false;
+    }
+
+    writeCount.store(0, std::memory_order_relaxed);
+    releaseCount.store(0, std::memory_order_relaxed);
+    nextRead = 0;
+    readGeneration = seekGeneration.load(std::memory_order_relaxed);
+    finishedGeneration.store(readGeneration - 1, std::memory_order_relaxed);
+
+    // Playback can start as soon as there is one block to hand out
+    if (!reposition(frame) || !fillBlock(blocks[0])) {
+        return false;
+    }
+    writeCount.store(1, std::memory_order_release);
+
+    running = true;
+    prefetchThread = std::thread(&PlaybackStream::prefetchLoop, this);
+    return true;
+}
+
+void PlaybackStream::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+    }
+    wake.notify_one();
+    if (prefetchThread.joinable()) {
+        prefetchThread.join();
+    }
+}
+
+void PlaybackStream::seek(uint64_t frame) {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        seekFrame.store(frame, std::memory_order_relaxed);
+        seekGeneration.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_one();
+}
+
+void PlaybackStream::prefetchLoop() {
+    while (running) {
+        uint32_t generation = seekGeneration.load(std::memory_order_acquire);
+        if (generation != readGeneration) {
+            readGeneration = generation;
+            seeking = true;
+            if (!reposition(seekFrame.load(std::memory_order_relaxed))) {
+                finishedGeneration.store(readGeneration, std::memory_order_release);
+            }
+        }
+
+        // Nothing more to read until a seek: sleep until one comes along
+        if (finishedGeneration.load(std::memory_order_relaxed) == readGeneration) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [this, generation] {
+                return !running || seekGeneration.load(std::memory_order_relaxed) != generation;
+            });
+            continue;
+        }
+
+        // The render thread releases without waking us, so a full ring is
+        // polled; at BLOCK_COUNT blocks ahead there is plenty of slack. A
+        // seek still wakes it at once.
+        uint64_t written = writeCount.load(std::memory_order_relaxed);
+        if (written - releaseCount.load(std::memory_order_acquire) >= BLOCK_COUNT) {
+            int pollMs = seeking ? SEEK_POLL_MS : PREFETCH_POLL_MS;
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(pollMs), [this, generation] {
+                return !running || seekGeneration.load(std::memory_order_relaxed) != generation;
+            });
+            continue;
+        }
+
+        if (fillBlock(blocks[written % BLOCK_COUNT])) {
+            writeCount.store(written + 1, std::memory_order_release);
+            seeking = false;
+        } else {
+            finishedGeneration.store(readGeneration, std::memory_order_release);
+        }
+    }
+}
+
+bool PlaybackStream::reposition(uint64_t frame) {
+    // FLAC streams may leave the length out; those can only be read through
+    readFrame = frameCount > 0 ? std::min(frame, frameCount) : frame;
+    skipSamples = 0;
+    if (!isFlac || (frameCount > 0 && readFrame == frameCount)) {
+        return true;
+    }
+
+    if (readFrame == 0) {
+        flacDecoder.rewind();
+        return true;
+    }
+    uint64_t frameStart = 0;
+    if (!flacDecoder.seek(readFrame, frameStart)) {
+        LOGE("Seek to frame %llu failed", static_cast<unsigned long long>(readFrame));
+        return false;
+    }
+    skipSamples = static_cast<size_t>(readFrame - frameStart) * channels;
+    return true;
+}
+
+bool PlaybackStream::fillBlock(PlaybackBlock& block) {
+    AUDIO_TRACE_SECTION("PlaybackStream read");
+    block.generation = readGeneration;
+    block.startFrame = readFrame;
+
+    if (isFlac) {
+        while (true) {
+            if (flacDecoder.decodeFrame(decodeBuffer) == 0) {
+                return false;
+            }
+            if (skipSamples < decodeBuffer.size()) break;
+            skipSamples -= decodeBuffer.size();
+        }
+
+        block.sampleCount = decodeBuffer.size() - skipSamples;
+        std::copy(decodeBuffer.begin() + skipSamples, decodeBuffer.end(),
+                  reinterpret_cast<short*>(block.data.data()));
+        skipSamples = 0;
+        readFrame += block.sampleCount / channels;
+        return true;
+    }
+
+    uint64_t frames = std::min<uint64_t>(blockSamples / channels, frameCount - readFrame);
+    if (isEditList) {
+        frames = editList.read(readFrame, block.data.data(), static_cast<size_t>(frames));
+        if (frames == 0) {
+            return false;
+        }
+        block.sampleCount = static_cast<size_t>(frames) * channels;
+        readFrame += frames;
+        return true;
+    }
+
+    size_t wanted = static_cast<size_t>(frames) * wavInfo.blockAlign;
+    off_t offset = static_cast<off_t>(wavInfo.dataOffset + readFrame * wavInfo.blockAlign);
+    size_t have = 0;
+    while (have < wanted) {
+        ssize_t got = pread(fd, block.data.data() + have, wanted - have, offset + static_cast<off_t>(have));
+        if (got <= 0) break;
+        have += static_cast<size_t>(got);
+    }
+
+    // A short read means the file was cut short under us; play what arrived
+    frames = have / wavInfo.blockAlign;
+    if (frames == 0) {
+        return false;
+    }
+    block.sampleCount = static_cast<size_t>(frames) * channels;
+    readFrame += frames;
+    return true;
+}
+
+const PlaybackBlock* PlaybackStream::acquire() {
+    uint32_t generation = seekGeneration.load(std::memory_order_acquire);
+    uint64_t written = writeCount.load(std::memory_order_acquire);
+    while (nextRead < written) {
+        const PlaybackBlock& block = blocks[nextRead % BLOCK_COUNT];
+        nextRead++;
+        if (block.generation == generation) {
+            return &block;
+        }
+        // Read ahead of a position that has since been left; give it back
+        // at once if nothing older is still held
+        if (releaseCount.load(std::memory_order_relaxed) == nextRead - 1) {
+            releaseCount.store(nextRead, std::memory_order_release);
+        }
+    }
+    return nullptr;
+}
+
+void PlaybackStream::release() {
+    uint64_t released = releaseCount.load(std::memory_order_relaxed);
+    if (released < nextRead) {
+        releaseCount.store(released + 1, std::memory_order_release);
+    }
+}
+
+bool PlaybackStream::isFinished() const {
+    // Every block is published before the generation is marked finished
+    uint32_t generation = seekGeneration.load(std::memory_order_acquire);
+    return finishedGeneration.load(std::memory_order_acquire) == generation &&
+           nextRead == writeCount.load(std::memory_order_acquire);
+}
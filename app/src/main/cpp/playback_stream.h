@@ -0,0 +1,156 @@
+#ifndef AUDIORECORDINGAPP_PLAYBACK_STREAM_H
+#define AUDIORECORDINGAPP_PLAYBACK_STREAM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "edit_list.h"
+#include "flac_decoder.h"
+#include "sample_format.h"
+#include "wav_file.h"
+
+// One block of a file, ready for the render thread: samples in the
+// source's own format (16-bit for FLAC), starting at |startFrame|
+struct PlaybackBlock {
+    std::vector<uint8_t> data;
+    size_t sampleCount = 0;
+    uint64_t startFrame = 0;
+    uint32_t generation = 0;
+};
+
+// Reads a WAV or FLAC file, or an EditList over WAV takes, ahead of
+// playback on its own thread, into a fixed ring of blocks the render
+// thread takes without locking. WAV data is read with pread() and FLAC is
+// decoded here, so the render thread never waits on a page fault or a
+// decoder, and memory stays the same whatever the file length.
+//
+// Seeking only records the target; the prefetch thread repositions and
+// tags the blocks it reads from there with a new generation, and the
+// render thread skips any block tagged with an older one.
+class PlaybackStream {
+public:
+    static const size_t BLOCK_COUNT = 8;
+    static const size_t BLOCK_SAMPLES = 4096;
+
+private:
+    // How often a full ring is checked for room; faster right after a
+    // seek, while the render thread is still giving back stale blocks
+    static const int PREFETCH_POLL_MS = 10;
+    static const int SEEK_POLL_MS = 1;
+
+    int fd = -1;
+    WavInfo wavInfo;
+    FlacDecoder flacDecoder;
+    bool isFlac = false;
+    // A copy, so the list can go on being edited while this one plays
+    EditList editList;
+    bool isEditList = false;
+
+    SampleFormat format = SampleFormat::INT16;
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint64_t frameCount = 0;
+    size_t blockSamples = BLOCK_SAMPLES;
+
+    PlaybackBlock blocks[BLOCK_COUNT];
+    // Blocks written by the prefetch thread and released by the render
+    // thread; the render thread has handed out those up to |nextRead|
+    std::atomic<uint64_t> writeCount{0};
+    std::atomic<uint64_t> releaseCount{0};
+    uint64_t nextRead = 0;
+
+    std::thread prefetchThread;
+    std::atomic<bool> running{false};
+    // Wakes the prefetch thread for a seek or stop once it has read to the end
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+
+    // Latest seek target, and a generation bumped with every seek
+    std::atomic<uint64_t> seekFrame{0};
+    std::atomic<uint32_t> seekGeneration{0};
+    // Generation the prefetch thread is reading for, and the last one it
+    // read to the end of the file
+    uint32_t readGeneration = 0;
+    std::atomic<uint32_t> finishedGeneration{UINT32_MAX};
+
+    // Next frame to read, and samples to drop from the front of the next
+    // FLAC frame after a seek landed inside it
+    uint64_t readFrame = 0;
+    size_t skipSamples = 0;
+    bool seeking = false;
+    std::vector<short> decodeBuffer;
+
+    void prefetchLoop();
+    bool reposition(uint64_t frame);
+    bool fillBlock(PlaybackBlock& block);
+
+public:
+    PlaybackStream() = default;
+    ~PlaybackStream();
+
+    PlaybackStream(const PlaybackStream&) = delete;
+    PlaybackStream& operator=(const PlaybackStream&) = delete;
+
+    bool open(const std::string& path);
+    bool open(const EditList& list);
+    void close();
+
+    bool isOpen() const {
+        return sampleRate > 0;
+    }
+
+    // Reads the first block from |frame| on the calling thread, then
+    // leaves the rest to the prefetch thread
+    bool start(uint64_t frame);
+    void stop();
+
+    // Constant time on any thread but the render thread
+    void seek(uint64_t frame);
+
+    // Render thread: the next block of the current generation, or null if
+    // the prefetch thread has not caught up. Blocks stay valid until
+    // released, oldest first; stale ones skipped on the way are released
+    // here when nothing older is held.
+    const PlaybackBlock* acquire();
+    void release();
+
+    size_t getHeldCount() const {
+        return static_cast<size_t>(nextRead - releaseCount.load(std::memory_order_relaxed));
+    }
+
+    uint32_t getGeneration() const {
+        return seekGeneration.load(std::memory_order_acquire);
+    }
+
+    // Render thread: every block of the current generation is handed out
+    bool isFinished() const;
+
+    SampleFormat getFormat() const {
+        return format;
+    }
+
+    uint32_t getSampleRate() const {
+        return sampleRate;
+    }
+
+    uint16_t getChannels() const {
+        return channels;
+    }
+
+    uint64_t getFrameCount() const {
+        return frameCount;
+    }
+
+    // Largest block the render thread can be handed, in samples
+    size_t getMaxBlockSamples() const {
+        return blockSamples;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_PLAYBACK_STREAM_H
@@ -0,0 +1,38 @@
+#include "pre_roll_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void PreRollBuffer::configure(size_t frames, int channelCount, size_t bytesPerSample) {
+    capacityFrames = frames;
+    channels = static_cast<size_t>(channelCount);
+    bytesPerFrame = bytesPerSample * channels;
+    samples.assign(capacityFrames * bytesPerFrame, 0);
+    preview.assign(capacityFrames * channels, 0);
+    clear();
+}
+
+void PreRollBuffer::push(const void* source, const short* sourcePreview, size_t frames) {
+    if (capacityFrames == 0) {
+        return;
+    }
+
+    // Only the newest capacityFrames of a long block can survive
+    const uint8_t* bytes = static_cast<const uint8_t*>(source);
+    if (frames > capacityFrames) {
+        bytes += (frames - capacityFrames) * bytesPerFrame;
+        sourcePreview += (frames - capacityFrames) * channels;
+        frames = capacityFrames;
+    }
+
+    while (frames > 0) {
+        size_t run = std::min(frames, capacityFrames - head);
+        memcpy(samples.data() + head * bytesPerFrame, bytes, run * bytesPerFrame);
+        memcpy(preview.data() + head * channels, sourcePreview, run * channels * sizeof(short));
+        bytes += run * bytesPerFrame;
+        sourcePreview += run * channels;
+        frames -= run;
+        head = (head + run) % capacityFrames;
+        frameCount = std::min(frameCount + run, capacityFrames);
+    }
+}
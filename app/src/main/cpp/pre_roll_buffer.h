@@ -0,0 +1,68 @@
+#ifndef AUDIORECORDINGAPP_PRE_ROLL_BUFFER_H
+#define AUDIORECORDINGAPP_PRE_ROLL_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The most recent captured frames, held in the capture format alongside
+// the 16-bit preview of them, so audio from just before a kept stretch or
+// a take starts can still be written to the file and the waveform index.
+// Oldest frames are overwritten once it is full.
+class PreRollBuffer {
+private:
+    size_t capacityFrames = 0;
+    size_t bytesPerFrame = 0;
+    size_t channels = 1;
+
+    std::vector<uint8_t> samples;
+    std::vector<short> preview;
+    // Slot the next frame goes into, and how many frames are held
+    size_t head = 0;
+    size_t frameCount = 0;
+
+public:
+    // Allocates room for |frames| frames; not for the audio thread
+    void configure(size_t frames, int channels, size_t bytesPerSample);
+
+    void clear() {
+        head = 0;
+        frameCount = 0;
+    }
+
+    // Appends |frames| interleaved frames; never allocates
+    void push(const void* samples, const short* preview, size_t frames);
+
+    size_t getFrameCount() const {
+        return frameCount;
+    }
+
+    size_t getCapacityFrames() const {
+        return capacityFrames;
+    }
+
+    // Hands the held frames to |sink(samples, preview, sampleCount)| oldest
+    // first, in at most two pieces, and keeps them
+    template <typename Sink>
+    void read(Sink&& sink) const {
+        if (frameCount == 0) {
+            return;
+        }
+        size_t start = (head + capacityFrames - frameCount) % capacityFrames;
+        size_t first = std::min(frameCount, capacityFrames - start);
+        sink(samples.data() + start * bytesPerFrame, preview.data() + start * channels, first * channels);
+        if (frameCount > first) {
+            sink(samples.data(), preview.data(), (frameCount - first) * channels);
+        }
+    }
+
+    // Like read(), then empties the buffer
+    template <typename Sink>
+    void drain(Sink&& sink) {
+        read(sink);
+        clear();
+    }
+};
+
+#endif // AUDIORECORDINGAPP_PRE_ROLL_BUFFER_H
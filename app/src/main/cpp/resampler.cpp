@@ -0,0 +1,268 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+#include "sample_convert.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2 1
+#endif
+
+#define LOG_TAG "Resampler"
+#include "audio_log.h"
+
+float dotProductScalar(const float* a, const float* b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if RESAMPLER_NEON
+
+float dotProduct(const float* a, const float* b, size_t count) {
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t sum = vaddq_f32(sum0, sum1);
+#if defined(__aarch64__)
+    float total = vaddvq_f32(sum);
+#else
+    float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    float total = vget_lane_f32(vpadd_f32(pair, pair), 0);
+#endif
+    return total + dotProductScalar(a + i, b + i, count - i);
+}
+
+#elif RESAMPLER_SSE2
+
+float dotProduct(const float* a, const float* b, size_t count) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(sum) + dotProductScalar(a + i, b + i, count - i);
+}
+
+#else
+
+float dotProduct(const float* a, const float* b, size_t count) {
+    return dotProductScalar(a, b, count);
+}
+
+#endif
+
+// Zeroth-order modified Bessel function of the first kind, by its series
+static double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double quarterSquare = x * x / 4.0;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++) {
+        term *= quarterSquare / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+bool Resampler::configure(int inputRate, int outputRate, int channels) {
+    this->channels = 0;
+    if (inputRate <= 0 || outputRate <= 0 || channels < 1 || channels > MAX_CHANNELS) {
+        LOGE("Unsupported conversion: %d Hz to %d Hz, %d channels", inputRate, outputRate, channels);
+        return false;
+    }
+
+    int divisor = std::gcd(inputRate, outputRate);
+    if (outputRate / divisor > MAX_PHASES) {
+        LOGE("Ratio %d:%d needs too many filter phases", outputRate / divisor, inputRate / divisor);
+        return false;
+    }
+
+    upFactor = outputRate / divisor;
+    downFactor = inputRate / divisor;
+
+    // Downsampling needs a proportionally longer filter for the same
+    // transition width at the lower rate; kept a multiple of 8 for the
+    // SIMD loops
+    int taps = BASE_TAPS_PER_PHASE;
+    if (downFactor > upFactor) {
+        taps = static_cast<int>((static_cast<int64_t>(BASE_TAPS_PER_PHASE) * downFactor + upFactor - 1) / upFactor);
+        taps = (taps + 7) & ~7;
+    }
+    if (taps > MAX_TAPS_PER_PHASE) {
+        LOGE("Ratio %d:%d downsamples too far", upFactor, downFactor);
+        return false;
+    }
+
+    this->inputRate = inputRate;
+    this->outputRate = outputRate;
+    this->channels = channels;
+    tapsPerPhase = taps;
+
+    designFilter();
+    // Room for the history, the initial look-ahead and a block of input
+    for (int c = 0; c < channels; c++) {
+        history[c].assign(2 * static_cast<size_t>(tapsPerPhase) + BLOCK_FRAMES, 0.0f);
+    }
+    reset();
+    return true;
+}
+
+void Resampler::designFilter() {
+    const size_t length = static_cast<size_t>(upFactor) * tapsPerPhase;
+    const double upsampledRate = static_cast<double>(inputRate) * upFactor;
+
+    // Kaiser's estimates for the window shape and the transition width it
+    // gives at this length; the transition ends at the lower Nyquist rate
+    const double beta = 0.1102 * (STOPBAND_DB - 8.7);
+    const double transitionHz = (STOPBAND_DB - 7.95) * inputRate / (14.36 * tapsPerPhase);
+    const double cutoffHz = std::min(inputRate, outputRate) / 2.0 - transitionHz / 2.0;
+    const double cutoff = cutoffHz / upsampledRate;
+
+    // Centered on a whole upsampled sample rather than between two, so the
+    // delay is exactly tapsPerPhase / 2 input frames and reset() can start
+    // the output in step with the input; the window's last tap is left out
+    std::vector<double> prototype(length);
+    const double center = length / 2.0;
+    const double windowScale = 1.0 / besselI0(beta);
+    for (size_t n = 0; n < length; n++) {
+        double t = n - center;
+        double x = 2.0 * cutoff * t;
+        double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+        double ratio = t / center;
+        double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) * windowScale;
+        prototype[n] = 2.0 * cutoff * sinc * window;
+    }
+
+    // Each phase gets unit gain at DC on its own, so the phases of a
+    // constant signal agree and no ripple appears at the phase rate
+    coefficients.assign(length, 0.0f);
+    for (int p = 0; p < upFactor; p++) {
+        double sum = 0.0;
+        for (int k = 0; k < tapsPerPhase; k++) {
+            sum += prototype[p + static_cast<size_t>(k) * upFactor];
+        }
+        float* phaseTaps = &coefficients[static_cast<size_t>(p) * tapsPerPhase];
+        for (int k = 0; k < tapsPerPhase; k++) {
+            phaseTaps[tapsPerPhase - 1 - k] = static_cast<float>(prototype[p + static_cast<size_t>(k) * upFactor] / sum);
+        }
+    }
+}
+
+void Resampler::reset() {
+    // Silence before the stream, and the first output waits for the filter
+    // delay's worth of input, so output frame n lines up with time n / out
+    historyFrames = static_cast<size_t>(tapsPerPhase - 1);
+    for (int c = 0; c < channels; c++) {
+        std::fill(history[c].begin(), history[c].begin() + historyFrames, 0.0f);
+    }
+    position = historyFrames + getDelayFrames();
+    phase = 0;
+}
+
+size_t Resampler::refill(const float* input, size_t frames) {
+    // Only the last tapsPerPhase - 1 frames before the next output's
+    // newest frame are needed again
+    size_t first = position - static_cast<size_t>(tapsPerPhase - 1);
+    size_t drop = std::min(first, historyFrames);
+    if (drop > 0) {
+        for (int c = 0; c < channels; c++) {
+            memmove(history[c].data(), history[c].data() + drop, (historyFrames - drop) * sizeof(float));
+        }
+        historyFrames -= drop;
+        position -= drop;
+    }
+
+    frames = std::min(frames, history[0].size() - historyFrames);
+    if (channels == 2) {
+        deinterleaveStereo(input, history[0].data() + historyFrames, history[1].data() + historyFrames, frames);
+    } else {
+        memcpy(history[0].data() + historyFrames, input, frames * sizeof(float));
+    }
+    historyFrames += frames;
+    return frames;
+}
+
+size_t Resampler::process(const float* input, size_t inputFrames, size_t& inputUsed,
+                          float* output, size_t maxOutputFrames) {
+    inputUsed = 0;
+    if (!isConfigured()) {
+        return 0;
+    }
+
+    size_t produced = 0;
+    const size_t span = static_cast<size_t>(tapsPerPhase - 1);
+    while (true) {
+        while (position < historyFrames && produced < maxOutputFrames) {
+            const float* taps = &coefficients[static_cast<size_t>(phase) * tapsPerPhase];
+            for (int c = 0; c < channels; c++) {
+                output[produced * channels + c] = dotProduct(taps, history[c].data() + position - span, tapsPerPhase);
+            }
+            produced++;
+
+            phase += downFactor;
+            position += static_cast<size_t>(phase / upFactor);
+            phase %= upFactor;
+        }
+
+        if (produced == maxOutputFrames || inputUsed == inputFrames) {
+            break;
+        }
+
+        inputUsed += refill(input + inputUsed * channels, inputFrames - inputUsed);
+    }
+    return produced;
+}
+
+bool resampleBuffer(const float* input, size_t frames, int channels, int inputRate,
+                    int outputRate, std::vector<float>& output) {
+    Resampler resampler;
+    if (!resampler.configure(inputRate, outputRate, channels)) {
+        return false;
+    }
+
+    const size_t outputFrames = static_cast<size_t>(
+            (static_cast<uint64_t>(frames) * outputRate + inputRate - 1) / inputRate);
+    output.assign(outputFrames * channels, 0.0f);
+
+    const size_t SCRATCH_FRAMES = 1024;
+    std::vector<float> scratch(SCRATCH_FRAMES * channels);
+    std::vector<float> silence(resampler.getDelayFrames() * channels, 0.0f);
+
+    size_t consumed = 0;
+    size_t written = 0;
+    while (written < outputFrames) {
+        bool flushing = consumed >= frames;
+        const float* source = flushing ? silence.data() : input + consumed * channels;
+        size_t available = flushing ? silence.size() / channels : frames - consumed;
+
+        size_t used = 0;
+        size_t produced = resampler.process(source, available, used, scratch.data(), SCRATCH_FRAMES);
+        if (!flushing) {
+            consumed += used;
+        }
+
+        size_t count = std::min(produced, outputFrames - written);
+        memcpy(output.data() + written * channels, scratch.data(), count * channels * sizeof(float));
+        written += count;
+    }
+    return true;
+}
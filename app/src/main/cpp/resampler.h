@@ -0,0 +1,113 @@
+#ifndef AUDIORECORDINGAPP_RESAMPLER_H
+#define AUDIORECORDINGAPP_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+// Sum of a[i] * b[i], the resampler's inner loop; NEON or SSE where
+// available, with the plain loop kept as the reference for tests and
+// benchmarks and used for the tail of each SIMD pass
+float dotProduct(const float* a, const float* b, size_t count);
+float dotProductScalar(const float* a, const float* b, size_t count);
+
+// Band-limited polyphase sample-rate converter for interleaved float audio,
+// mono or stereo. The ratio of the two rates is reduced to up/down factors
+// L/M; a Kaiser-windowed sinc designed at L times the input rate is split
+// into L phases, and each output frame is one phase's dot product with the
+// most recent input frames (NEON or SSE where available).
+//
+// The filter cuts off at the Nyquist frequency of the lower of the two
+// rates, with at least STOPBAND_DB of attenuation from there up and a
+// passband that is flat to about 0.8 of it. Taps per phase grow with the
+// downsampling ratio so the transition band stays the same width.
+class Resampler {
+public:
+    static const int MAX_CHANNELS = 2;
+    // Rates whose ratio needs more phases than this are rejected; enough
+    // for 11025 Hz to 192 kHz, the widest pair of standard rates
+    static const int MAX_PHASES = 4096;
+    static const int BASE_TAPS_PER_PHASE = 64;
+    // Limits downsampling to 64:1
+    static const int MAX_TAPS_PER_PHASE = 4096;
+    static constexpr double STOPBAND_DB = 90.0;
+
+private:
+    // Input frames held beyond the filter's history, per refill
+    static const size_t BLOCK_FRAMES = 1024;
+
+    int inputRate = 0;
+    int outputRate = 0;
+    int channels = 0;
+    int upFactor = 1;
+    int downFactor = 1;
+    int tapsPerPhase = 0;
+
+    // Phase-major, each phase's taps reversed so the dot product runs
+    // forwards over the input history
+    std::vector<float> coefficients;
+
+    // Planar input: up to tapsPerPhase - 1 frames of history then new ones
+    std::vector<float> history[MAX_CHANNELS];
+    size_t historyFrames = 0;
+
+    // Newest input frame (index into history) and phase of the next output
+    size_t position = 0;
+    int phase = 0;
+
+    void designFilter();
+    // Drops history no longer needed and appends up to |frames| frames;
+    // returns how many were taken
+    size_t refill(const float* input, size_t frames);
+
+public:
+    Resampler() = default;
+
+    // Sets up conversion between the two rates and clears all state.
+    // Fails for unsupported channel counts, non-positive rates, or a ratio
+    // that needs more than MAX_PHASES phases or MAX_TAPS_PER_PHASE taps.
+    bool configure(int inputRate, int outputRate, int channels);
+
+    // Drops buffered input, so the next process() starts a new stream
+    void reset();
+
+    bool isConfigured() const {
+        return channels > 0;
+    }
+
+    int getInputRate() const {
+        return inputRate;
+    }
+
+    int getOutputRate() const {
+        return outputRate;
+    }
+
+    int getChannels() const {
+        return channels;
+    }
+
+    int getTapsPerPhase() const {
+        return tapsPerPhase;
+    }
+
+    // Input frames the filter looks ahead of each output, so also how many
+    // frames of silence flush the last real input through. Output is not
+    // delayed: frame n of the output is at time n / outputRate.
+    size_t getDelayFrames() const {
+        return static_cast<size_t>(tapsPerPhase / 2);
+    }
+
+    // Consumes up to |inputFrames| interleaved frames and writes up to
+    // |maxOutputFrames|. Stops when either runs out; |inputUsed| receives
+    // how many input frames were taken, and the return value how many
+    // frames were written. Does not allocate.
+    size_t process(const float* input, size_t inputFrames, size_t& inputUsed,
+                   float* output, size_t maxOutputFrames);
+};
+
+// Converts a whole interleaved buffer in one go, flushing the tail, so
+// |output| holds ceil(frames * out / in) frames aligned with the input
+bool resampleBuffer(const float* input, size_t frames, int channels, int inputRate,
+                    int outputRate, std::vector<float>& output);
+
+#endif // AUDIORECORDINGAPP_RESAMPLER_H
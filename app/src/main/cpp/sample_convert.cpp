@@ -0,0 +1,480 @@
+#include "sample_convert.h"
+
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SAMPLE_CONVERT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SAMPLE_CONVERT_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define SAMPLE_CONVERT_SSSE3 1
+#endif
+#endif
+
+static const float INT16_SCALE = 32768.0f;
+static const float INT24_SCALE = 8388608.0f;
+
+void convertSamplesScalar(const float* in, short* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float value = in[i] * INT16_SCALE;
+        // Written so that NaN saturates low, as the SSE min/max do
+        if (!(value > -32768.0f)) value = -32768.0f;
+        if (value > 32767.0f) value = 32767.0f;
+        out[i] = static_cast<short>(lrintf(value));
+    }
+}
+
+void convertSamplesScalar(const short* in, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = in[i] * (1.0f / INT16_SCALE);
+    }
+}
+
+void convertSamplesScalar(const Int24* in, short* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<short>(in[i].get() >> 8);
+    }
+}
+
+void convertSamplesScalar(const short* in, Int24* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i].set(static_cast<int32_t>(in[i]) * 256);
+    }
+}
+
+void convertSamplesScalar(const Int24* in, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(in[i].get()) * (1.0f / INT24_SCALE);
+    }
+}
+
+void convertSamplesScalar(const float* in, Int24* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float value = in[i] * INT24_SCALE;
+        if (!(value > -8388608.0f)) value = -8388608.0f;
+        if (value > 8388607.0f) value = 8388607.0f;
+        out[i].set(static_cast<int32_t>(lrintf(value)));
+    }
+}
+
+void deinterleaveStereoScalar(const short* in, short* left, short* right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void deinterleaveStereoScalar(const float* in, float* left, float* right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void interleaveStereoScalar(const short* left, const short* right, short* out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void interleaveStereoScalar(const float* left, const float* right, float* out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+#if SAMPLE_CONVERT_NEON
+
+void convertSamples(const float* in, short* out, size_t count) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    // 32-bit ARM has no round-to-nearest conversion, so it takes the loop
+    const float32x4_t low = vdupq_n_f32(-32768.0f);
+    const float32x4_t high = vdupq_n_f32(32767.0f);
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(in + i), INT16_SCALE);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(in + i + 4), INT16_SCALE);
+        a = vminq_f32(vmaxq_f32(a, low), high);
+        b = vminq_f32(vmaxq_f32(b, low), high);
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+#endif
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const short* in, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t samples = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), 1.0f / INT16_SCALE));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), 1.0f / INT16_SCALE));
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const Int24* in, short* out, size_t count) {
+    size_t i = 0;
+    // The structured load splits 16 samples into low, middle and high
+    // bytes; the top two are stored back interleaved as 16-bit samples
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t bytes = vld3q_u8(reinterpret_cast<const uint8_t*>(in + i));
+        uint8x16x2_t words = {{bytes.val[1], bytes.val[2]}};
+        vst2q_u8(reinterpret_cast<uint8_t*>(out + i), words);
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const short* in, Int24* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t words = vld2q_u8(reinterpret_cast<const uint8_t*>(in + i));
+        uint8x16x3_t bytes = {{vdupq_n_u8(0), words.val[0], words.val[1]}};
+        vst3q_u8(reinterpret_cast<uint8_t*>(out + i), bytes);
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const Int24* in, float* out, size_t count) {
+    // Zips the three byte planes back under a zero low byte, giving each
+    // sample in the top 24 bits of a 32-bit lane
+    const float scale = 1.0f / (INT24_SCALE * 256.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t bytes = vld3q_u8(reinterpret_cast<const uint8_t*>(in + i));
+        uint8x16x2_t low = vzipq_u8(vdupq_n_u8(0), bytes.val[0]);
+        uint8x16x2_t high = vzipq_u8(bytes.val[1], bytes.val[2]);
+        for (int half = 0; half < 2; half++) {
+            uint16x8x2_t words = vzipq_u16(vreinterpretq_u16_u8(low.val[half]), vreinterpretq_u16_u8(high.val[half]));
+            for (int quarter = 0; quarter < 2; quarter++) {
+                float32x4_t values = vcvtq_f32_s32(vreinterpretq_s32_u16(words.val[quarter]));
+                vst1q_f32(out + i + 8 * half + 4 * quarter, vmulq_n_f32(values, scale));
+            }
+        }
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void deinterleaveStereo(const short* in, short* left, short* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t channels = vld2q_s16(in + 2 * i);
+        vst1q_s16(left + i, channels.val[0]);
+        vst1q_s16(right + i, channels.val[1]);
+    }
+    deinterleaveStereoScalar(in + 2 * i, left + i, right + i, frames - i);
+}
+
+void deinterleaveStereo(const float* in, float* left, float* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t channels = vld2q_f32(in + 2 * i);
+        vst1q_f32(left + i, channels.val[0]);
+        vst1q_f32(right + i, channels.val[1]);
+    }
+    deinterleaveStereoScalar(in + 2 * i, left + i, right + i, frames - i);
+}
+
+void interleaveStereo(const short* left, const short* right, short* out, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t channels = {{vld1q_s16(left + i), vld1q_s16(right + i)}};
+        vst2q_s16(out + 2 * i, channels);
+    }
+    interleaveStereoScalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+void interleaveStereo(const float* left, const float* right, float* out, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t channels = {{vld1q_f32(left + i), vld1q_f32(right + i)}};
+        vst2q_f32(out + 2 * i, channels);
+    }
+    interleaveStereoScalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+#elif SAMPLE_CONVERT_SSE2
+
+void convertSamples(const float* in, short* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(INT16_SCALE);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+        a = _mm_min_ps(_mm_max_ps(a, low), high);
+        b = _mm_min_ps(_mm_max_ps(b, low), high);
+        // cvtps rounds to nearest even, like lrintf in the default mode
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const short* in, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(1.0f / INT16_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Each sample into the top half of a 32-bit lane, then shifted down
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+#if SAMPLE_CONVERT_SSSE3
+
+// pshufb masks for moving 16 samples at a time between 48 packed bytes
+// (three registers) and 32 bytes of 16-bit samples (two registers).
+// unpack[out][in] picks the bytes of input register |in| that land in
+// output register |out|, and likewise for pack; -1 lanes come out zero,
+// so OR-ing the shuffles of every input gives the output register.
+struct Int24ShuffleMasks {
+    __m128i unpack[2][3];
+    __m128i pack[3][2];
+    // To the top 24 bits of 32-bit lanes: 16 samples over four registers
+    __m128i widen[4][3];
+    // From the low 24 bits of 32-bit lanes, four registers back to three
+    __m128i narrow[3][4];
+
+    Int24ShuffleMasks() {
+        alignas(16) int8_t lanes[16];
+        for (int out = 0; out < 2; out++) {
+            for (int in = 0; in < 3; in++) {
+                for (int lane = 0; lane < 16; lane++) {
+                    int outByte = out * 16 + lane;
+                    int inByte = 3 * (outByte / 2) + 1 + outByte % 2;
+                    lanes[lane] = static_cast<int8_t>(inByte / 16 == in ? inByte % 16 : -1);
+                }
+                unpack[out][in] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+            }
+        }
+        for (int out = 0; out < 3; out++) {
+            for (int in = 0; in < 2; in++) {
+                for (int lane = 0; lane < 16; lane++) {
+                    int outByte = out * 16 + lane;
+                    int inByte = 2 * (outByte / 3) + outByte % 3 - 1;
+                    bool used = outByte % 3 != 0 && inByte / 16 == in;
+                    lanes[lane] = static_cast<int8_t>(used ? inByte % 16 : -1);
+                }
+                pack[out][in] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+            }
+        }
+        for (int out = 0; out < 4; out++) {
+            for (int in = 0; in < 3; in++) {
+                for (int lane = 0; lane < 16; lane++) {
+                    int outByte = out * 16 + lane;
+                    int inByte = 3 * (outByte / 4) + outByte % 4 - 1;
+                    bool used = outByte % 4 != 0 && inByte / 16 == in;
+                    lanes[lane] = static_cast<int8_t>(used ? inByte % 16 : -1);
+                }
+                widen[out][in] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+            }
+        }
+        for (int out = 0; out < 3; out++) {
+            for (int in = 0; in < 4; in++) {
+                for (int lane = 0; lane < 16; lane++) {
+                    int outByte = out * 16 + lane;
+                    int inByte = 4 * (outByte / 3) + outByte % 3;
+                    lanes[lane] = static_cast<int8_t>(inByte / 16 == in ? inByte % 16 : -1);
+                }
+                narrow[out][in] = _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+            }
+        }
+    }
+};
+
+static const Int24ShuffleMasks int24Masks;
+
+void convertSamples(const Int24* in, short* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i* source = reinterpret_cast<const __m128i*>(in + i);
+        __m128i packed[3] = {_mm_loadu_si128(source), _mm_loadu_si128(source + 1),
+                             _mm_loadu_si128(source + 2)};
+        for (int r = 0; r < 2; r++) {
+            __m128i words = _mm_or_si128(_mm_shuffle_epi8(packed[0], int24Masks.unpack[r][0]),
+                                         _mm_shuffle_epi8(packed[1], int24Masks.unpack[r][1]));
+            words = _mm_or_si128(words, _mm_shuffle_epi8(packed[2], int24Masks.unpack[r][2]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8 * r), words);
+        }
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const short* in, Int24* out, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i words[2] = {_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8))};
+        __m128i* target = reinterpret_cast<__m128i*>(out + i);
+        for (int r = 0; r < 3; r++) {
+            _mm_storeu_si128(target + r,
+                             _mm_or_si128(_mm_shuffle_epi8(words[0], int24Masks.pack[r][0]),
+                                          _mm_shuffle_epi8(words[1], int24Masks.pack[r][1])));
+        }
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const Int24* in, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(1.0f / (INT24_SCALE * 256.0f));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i* source = reinterpret_cast<const __m128i*>(in + i);
+        __m128i packed[3] = {_mm_loadu_si128(source), _mm_loadu_si128(source + 1),
+                             _mm_loadu_si128(source + 2)};
+        for (int r = 0; r < 4; r++) {
+            __m128i lanes = _mm_or_si128(_mm_shuffle_epi8(packed[0], int24Masks.widen[r][0]),
+                                         _mm_shuffle_epi8(packed[1], int24Masks.widen[r][1]));
+            lanes = _mm_or_si128(lanes, _mm_shuffle_epi8(packed[2], int24Masks.widen[r][2]));
+            _mm_storeu_ps(out + i + 4 * r, _mm_mul_ps(_mm_cvtepi32_ps(lanes), scale));
+        }
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+void convertSamples(const float* in, Int24* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(INT24_SCALE);
+    const __m128 low = _mm_set1_ps(-8388608.0f);
+    const __m128 high = _mm_set1_ps(8388607.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i lanes[4];
+        for (int r = 0; r < 4; r++) {
+            __m128 values = _mm_mul_ps(_mm_loadu_ps(in + i + 4 * r), scale);
+            lanes[r] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(values, low), high));
+        }
+        __m128i* target = reinterpret_cast<__m128i*>(out + i);
+        for (int r = 0; r < 3; r++) {
+            __m128i packed = _mm_or_si128(_mm_shuffle_epi8(lanes[0], int24Masks.narrow[r][0]),
+                                          _mm_shuffle_epi8(lanes[1], int24Masks.narrow[r][1]));
+            packed = _mm_or_si128(packed, _mm_shuffle_epi8(lanes[2], int24Masks.narrow[r][2]));
+            packed = _mm_or_si128(packed, _mm_shuffle_epi8(lanes[3], int24Masks.narrow[r][3]));
+            _mm_storeu_si128(target + r, packed);
+        }
+    }
+    convertSamplesScalar(in + i, out + i, count - i);
+}
+
+#else
+
+// Byte shuffles need SSSE3; plain SSE2 builds take the loops
+void convertSamples(const Int24* in, short* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const short* in, Int24* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const Int24* in, float* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const float* in, Int24* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+#endif
+
+void deinterleaveStereo(const short* in, short* left, short* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i + 8));
+        // Each 32-bit lane holds one frame: left in the low half, right in
+        // the high half. Sign-extend each half, then pack the lanes back.
+        __m128i leftA = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        __m128i leftB = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(left + i), _mm_packs_epi32(leftA, leftB));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(right + i),
+                         _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16)));
+    }
+    deinterleaveStereoScalar(in + 2 * i, left + i, right + i, frames - i);
+}
+
+void deinterleaveStereo(const float* in, float* left, float* right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(in + 2 * i);
+        __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleaveStereoScalar(in + 2 * i, left + i, right + i, frames - i);
+}
+
+void interleaveStereo(const short* left, const short* right, short* out, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+    }
+    interleaveStereoScalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+void interleaveStereo(const float* left, const float* right, float* out, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+    interleaveStereoScalar(left + i, right + i, out + 2 * i, frames - i);
+}
+
+#else
+
+void convertSamples(const float* in, short* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const short* in, float* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const Int24* in, short* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const short* in, Int24* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const Int24* in, float* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void convertSamples(const float* in, Int24* out, size_t count) {
+    convertSamplesScalar(in, out, count);
+}
+
+void deinterleaveStereo(const short* in, short* left, short* right, size_t frames) {
+    deinterleaveStereoScalar(in, left, right, frames);
+}
+
+void deinterleaveStereo(const float* in, float* left, float* right, size_t frames) {
+    deinterleaveStereoScalar(in, left, right, frames);
+}
+
+void interleaveStereo(const short* left, const short* right, short* out, size_t frames) {
+    interleaveStereoScalar(left, right, out, frames);
+}
+
+void interleaveStereo(const float* left, const float* right, float* out, size_t frames) {
+    interleaveStereoScalar(left, right, out, frames);
+}
+
+#endif
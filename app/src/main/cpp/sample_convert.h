@@ -0,0 +1,42 @@
+#ifndef AUDIORECORDINGAPP_SAMPLE_CONVERT_H
+#define AUDIORECORDINGAPP_SAMPLE_CONVERT_H
+
+#include <cstddef>
+
+#include "sample_format.h"
+
+// Conversions between the capture/playback sample formats and the 16-bit
+// samples the level meter, waveform index and FLAC encoder work on, plus
+// stereo interleave/deinterleave. NEON, SSE2 or SSSE3 where available.
+//
+// Float is full scale at +/-1.0. Float to 16-bit or 24-bit rounds to
+// nearest and saturates; 24-bit to 16-bit drops the low byte. 24-bit to
+// float is exact, so 24-bit to float and back is too.
+
+void convertSamples(const float* in, short* out, size_t count);
+void convertSamples(const short* in, float* out, size_t count);
+void convertSamples(const Int24* in, short* out, size_t count);
+void convertSamples(const short* in, Int24* out, size_t count);
+void convertSamples(const Int24* in, float* out, size_t count);
+void convertSamples(const float* in, Int24* out, size_t count);
+
+void deinterleaveStereo(const short* in, short* left, short* right, size_t frames);
+void deinterleaveStereo(const float* in, float* left, float* right, size_t frames);
+void interleaveStereo(const short* left, const short* right, short* out, size_t frames);
+void interleaveStereo(const float* left, const float* right, float* out, size_t frames);
+
+// Plain loops with the same results, kept as the reference for tests and
+// benchmarks and used for the tail of each SIMD pass
+void convertSamplesScalar(const float* in, short* out, size_t count);
+void convertSamplesScalar(const short* in, float* out, size_t count);
+void convertSamplesScalar(const Int24* in, short* out, size_t count);
+void convertSamplesScalar(const short* in, Int24* out, size_t count);
+void convertSamplesScalar(const Int24* in, float* out, size_t count);
+void convertSamplesScalar(const float* in, Int24* out, size_t count);
+
+void deinterleaveStereoScalar(const short* in, short* left, short* right, size_t frames);
+void deinterleaveStereoScalar(const float* in, float* left, float* right, size_t frames);
+void interleaveStereoScalar(const short* left, const short* right, short* out, size_t frames);
+void interleaveStereoScalar(const float* left, const float* right, float* out, size_t frames);
+
+#endif // AUDIORECORDINGAPP_SAMPLE_CONVERT_H
@@ -0,0 +1,79 @@
+#ifndef AUDIORECORDINGAPP_SAMPLE_FORMAT_H
+#define AUDIORECORDINGAPP_SAMPLE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Sample encodings the capture and playback pipeline can carry end to end.
+// Values are shared with the Kotlin side.
+enum class SampleFormat {
+    INT16 = 0,
+    INT24_PACKED = 1,
+    FLOAT32 = 2,
+};
+
+// Signed 24-bit sample stored in three little-endian bytes, as in a 24-bit
+// WAV data chunk. No padding, so arrays of it are tightly packed.
+struct Int24 {
+    uint8_t bytes[3];
+
+    int32_t get() const {
+        // Assemble in the top 24 bits so the shift back sign-extends
+        return static_cast<int32_t>((static_cast<uint32_t>(bytes[0]) << 8) |
+                                    (static_cast<uint32_t>(bytes[1]) << 16) |
+                                    (static_cast<uint32_t>(bytes[2]) << 24)) >> 8;
+    }
+
+    void set(int32_t value) {
+        bytes[0] = static_cast<uint8_t>(value);
+        bytes[1] = static_cast<uint8_t>(value >> 8);
+        bytes[2] = static_cast<uint8_t>(value >> 16);
+    }
+};
+
+static_assert(sizeof(Int24) == 3, "Int24 must be packed");
+
+// Compile-time description of each sample type, used to specialize the
+// recorder and player paths
+template <typename Sample>
+struct SampleTraits;
+
+template <>
+struct SampleTraits<short> {
+    static const SampleFormat FORMAT = SampleFormat::INT16;
+    static const int BITS = 16;
+    static const bool IS_FLOAT = false;
+};
+
+template <>
+struct SampleTraits<Int24> {
+    static const SampleFormat FORMAT = SampleFormat::INT24_PACKED;
+    static const int BITS = 24;
+    static const bool IS_FLOAT = false;
+};
+
+template <>
+struct SampleTraits<float> {
+    static const SampleFormat FORMAT = SampleFormat::FLOAT32;
+    static const int BITS = 32;
+    static const bool IS_FLOAT = true;
+};
+
+inline int getBitsPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::INT24_PACKED: return 24;
+        case SampleFormat::FLOAT32: return 32;
+        default: return 16;
+    }
+}
+
+inline size_t getBytesPerSample(SampleFormat format) {
+    return static_cast<size_t>(getBitsPerSample(format)) / 8;
+}
+
+inline bool isValidSampleFormat(int value) {
+    return value >= static_cast<int>(SampleFormat::INT16) &&
+           value <= static_cast<int>(SampleFormat::FLOAT32);
+}
+
+#endif // AUDIORECORDINGAPP_SAMPLE_FORMAT_H
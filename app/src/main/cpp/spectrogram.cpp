@@ -0,0 +1,183 @@
+#include "spectrogram.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "audio_file_reader.h"
+
+#define LOG_TAG "Spectrogram"
+#include "audio_log.h"
+
+static const size_t MAX_SPECTROGRAM_COLUMNS = 16384;
+
+StftAnalyzer::StftAnalyzer(size_t fftSize, size_t hopSize, int channels)
+    : fftSize(fftSize), hopSize(hopSize), channels(std::min(std::max(channels, 1), MAX_CHANNELS)), fft(fftSize),
+      window(fftSize), history(fftSize), windowed(fftSize), re(fftSize / 2 + 1), im(fftSize / 2 + 1),
+      power(fftSize / 2) {
+    // A sine of amplitude A in a bin gives A * sum(window) / 2 there
+    const double pi = 3.14159265358979323846;
+    const double scale = 2.0 / (fftSize / 2.0);
+    for (size_t i = 0; i < fftSize; i++) {
+        window[i] = static_cast<float>(scale * (0.5 - 0.5 * std::cos(2.0 * pi * i / fftSize)));
+    }
+}
+
+bool StftAnalyzer::isValid(size_t fftSize, size_t hopSize) {
+    return fftSize >= MIN_FFT_SIZE && fftSize <= MAX_FFT_SIZE && RealFft::isValidSize(fftSize) && hopSize > 0 &&
+           hopSize <= fftSize;
+}
+
+void StftAnalyzer::reset() {
+    fill = 0;
+    fresh = 0;
+}
+
+size_t StftAnalyzer::append(const short* samples, size_t frames) {
+    size_t take = std::min(frames, fftSize - fill);
+    float* out = history.data() + fill;
+    if (channels == 2) {
+        for (size_t i = 0; i < take; i++) {
+            out[i] = (static_cast<float>(samples[2 * i]) + samples[2 * i + 1]) * (0.5f / 32768.0f);
+        }
+    } else {
+        for (size_t i = 0; i < take; i++) {
+            out[i] = samples[i] * (1.0f / 32768.0f);
+        }
+    }
+    fill += take;
+    fresh += take;
+    return take;
+}
+
+size_t StftAnalyzer::append(const float* samples, size_t frames) {
+    size_t take = std::min(frames, fftSize - fill);
+    float* out = history.data() + fill;
+    if (channels == 2) {
+        for (size_t i = 0; i < take; i++) {
+            out[i] = (samples[2 * i] + samples[2 * i + 1]) * 0.5f;
+        }
+    } else {
+        std::copy(samples, samples + take, out);
+    }
+    fill += take;
+    fresh += take;
+    return take;
+}
+
+void StftAnalyzer::analyzeFrame() {
+    for (size_t i = 0; i < fftSize; i++) {
+        windowed[i] = history[i] * window[i];
+    }
+    fft.forward(windowed.data(), re.data(), im.data());
+    for (size_t k = 0; k < fftSize / 2; k++) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
+    }
+
+    // Keep the overlap for the next window
+    std::memmove(history.data(), history.data() + hopSize, (fftSize - hopSize) * sizeof(float));
+    fill = fftSize - hopSize;
+    fresh = 0;
+}
+
+// Cubic fit of log2 over the mantissa's [1, 2), good to 0.0014
+static inline float approximateLog2(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+    bits = (bits & 0x7FFFFF) | 0x3F800000;
+    float t;
+    memcpy(&t, &bits, sizeof(t));
+    t -= 1.0f;
+    return exponent + (0.0013306212f + t * (1.4135082f + t * (-0.56778445f + t * 0.15392465f)));
+}
+
+void quantizeSpectrum(const float* power, uint8_t* out, size_t count) {
+    // Everything in log2 of power: the floor at 0, full scale at 255
+    const float floorLog2 = SPECTROGRAM_FLOOR_DB / 10.0f * 3.32192809f;
+    const float floorPower = std::pow(10.0f, SPECTROGRAM_FLOOR_DB / 10.0f);
+    const float scale = 255.0f / -floorLog2;
+    for (size_t i = 0; i < count; i++) {
+        // Also sends NaN to the floor
+        float value = power[i] > floorPower ? power[i] : floorPower;
+        float level = (approximateLog2(value) - floorLog2) * scale + 0.5f;
+        out[i] = static_cast<uint8_t>(std::min(std::max(level, 0.0f), 255.0f));
+    }
+}
+
+LiveSpectrogram::LiveSpectrogram(size_t fftSize, size_t hopSize, int channels, size_t capacityFrames)
+    : analyzer(fftSize, hopSize, channels), frames(capacityFrames * (fftSize / 2)), frame(fftSize / 2) {
+}
+
+void LiveSpectrogram::write(const short* samples, size_t count) {
+    analyzer.process(samples, count / analyzer.getChannels(), [this](const float* power) {
+        quantizeSpectrum(power, frame.data(), frame.size());
+        frames.write(frame.data(), frame.size());
+    });
+}
+
+size_t LiveSpectrogram::read(uint8_t* out, size_t maxFrames) {
+    // Frames go in whole, so whole frames are all there is to read
+    return frames.read(out, maxFrames * frame.size()) / frame.size();
+}
+
+bool analyzeSpectrogram(const std::string& path, size_t fftSize, size_t columns, std::vector<uint8_t>& out) {
+    if (!StftAnalyzer::isValid(fftSize, fftSize / 2) || columns == 0 || columns > MAX_SPECTROGRAM_COLUMNS) {
+        LOGE("Invalid spectrogram: FFT size %zu, %zu columns", fftSize, columns);
+        return false;
+    }
+
+    AudioFileReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    uint64_t total = reader.getFrameCount();
+    if (total == 0) {
+        LOGE("No length to spread the spectrogram over: %s", path.c_str());
+        return false;
+    }
+
+    // No longer than a column, so windows start in every column; columns
+    // past the last window repeat the one before
+    size_t hop = static_cast<size_t>(std::min<uint64_t>(std::max<uint64_t>(total / columns, 1), fftSize / 2));
+    StftAnalyzer analyzer(fftSize, hop, reader.getChannels());
+    const size_t bins = analyzer.getBinCount();
+    out.assign(columns * bins, 0);
+
+    std::vector<float> sum(bins, 0.0f);
+    size_t summed = 0;
+    size_t column = 0;
+    uint64_t windowStart = 0;
+    auto finishColumn = [&] {
+        uint8_t* target = out.data() + column * bins;
+        if (summed > 0) {
+            for (float& value : sum) value /= static_cast<float>(summed);
+            quantizeSpectrum(sum.data(), target, bins);
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            summed = 0;
+        } else if (column > 0) {
+            std::copy(target - bins, target, target);
+        }
+        column++;
+    };
+    auto onFrame = [&](const float* power) {
+        size_t target = static_cast<size_t>(std::min<uint64_t>(columns - 1, windowStart * columns / total));
+        while (column < target) {
+            finishColumn();
+        }
+        for (size_t k = 0; k < bins; k++) {
+            sum[k] += power[k];
+        }
+        summed++;
+        windowStart += hop;
+    };
+
+    std::vector<float> samples(AudioFileReader::READ_FRAMES * reader.getChannels());
+    while (size_t frames = reader.read(samples.data(), AudioFileReader::READ_FRAMES)) {
+        analyzer.process(samples.data(), frames, onFrame);
+    }
+    analyzer.flush(onFrame);
+    while (column < columns) {
+        finishColumn();
+    }
+    return true;
+}
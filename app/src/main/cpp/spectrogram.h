@@ -0,0 +1,153 @@
+#ifndef AUDIORECORDINGAPP_SPECTROGRAM_H
+#define AUDIORECORDINGAPP_SPECTROGRAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fft.h"
+#include "spsc_ring_buffer.h"
+
+// Short-time Fourier transform over a stream of interleaved samples, mixed
+// down to mono: a Hann window of fftSize samples every hopSize samples,
+// through a RealFft. Samples go in as they come, in any block size; each
+// complete window gives a frame of fftSize / 2 bin powers, DC up to just
+// under Nyquist, scaled so a full-scale sine reads 1.0 in its bin.
+//
+// Does not allocate once constructed, so it can run on the audio thread.
+class StftAnalyzer {
+public:
+    static const size_t MIN_FFT_SIZE = 64;
+    static const size_t MAX_FFT_SIZE = 8192;
+    static const int MAX_CHANNELS = 2;
+
+private:
+    size_t fftSize;
+    size_t hopSize;
+    int channels;
+    RealFft fft;
+    // Hann, with the scale that puts a full-scale sine at 1.0 folded in
+    std::vector<float> window;
+
+    // The last fftSize mono samples, oldest first; |fresh| of them came
+    // after the last frame
+    std::vector<float> history;
+    size_t fill = 0;
+    size_t fresh = 0;
+
+    std::vector<float> windowed;
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<float> power;
+
+    size_t append(const short* samples, size_t frames);
+    size_t append(const float* samples, size_t frames);
+    void analyzeFrame();
+
+public:
+    StftAnalyzer(size_t fftSize, size_t hopSize, int channels);
+
+    // A power-of-two FFT size in range, and a hop no longer than it
+    static bool isValid(size_t fftSize, size_t hopSize);
+
+    size_t getFftSize() const {
+        return fftSize;
+    }
+
+    size_t getHopSize() const {
+        return hopSize;
+    }
+
+    int getChannels() const {
+        return channels;
+    }
+
+    size_t getBinCount() const {
+        return fftSize / 2;
+    }
+
+    void reset();
+
+    // Calls |onFrame(const float* power)| for every window completed by
+    // |frames| more frames of 16-bit or float samples
+    template <typename Sample, typename Sink>
+    void process(const Sample* samples, size_t frames, Sink&& onFrame) {
+        while (frames > 0) {
+            size_t taken = append(samples, frames);
+            samples += taken * channels;
+            frames -= taken;
+            if (fill == fftSize) {
+                analyzeFrame();
+                onFrame(static_cast<const float*>(power.data()));
+            }
+        }
+    }
+
+    // Emits one last frame, padded out with silence, if any samples came
+    // after the last one
+    template <typename Sink>
+    void flush(Sink&& onFrame) {
+        if (fresh == 0) {
+            return;
+        }
+        std::fill(history.begin() + fill, history.end(), 0.0f);
+        fill = fftSize;
+        analyzeFrame();
+        onFrame(static_cast<const float*>(power.data()));
+    }
+};
+
+// Spectrogram frames are quantized to a byte per bin, linear in dB:
+// 255 for a full-scale sine's bin, 0 at SPECTROGRAM_FLOOR_DB and under
+static constexpr float SPECTROGRAM_FLOOR_DB = -100.0f;
+
+// Bin powers from StftAnalyzer to bytes, through a polynomial log2 that
+// is within 0.01 dB of the real thing
+void quantizeSpectrum(const float* power, uint8_t* out, size_t count);
+
+// Quantized frames of live capture, for a reader on another thread. The
+// audio thread analyzes each block as it arrives and pushes whole frames;
+// a frame that does not fit is dropped and counted.
+class LiveSpectrogram {
+private:
+    StftAnalyzer analyzer;
+    SpscRingBuffer<uint8_t> frames;
+    std::vector<uint8_t> frame;
+
+public:
+    LiveSpectrogram(size_t fftSize, size_t hopSize, int channels, size_t capacityFrames);
+
+    LiveSpectrogram(const LiveSpectrogram&) = delete;
+    LiveSpectrogram& operator=(const LiveSpectrogram&) = delete;
+
+    // Audio thread
+    void write(const short* samples, size_t count);
+
+    // Reader: copies out up to |maxFrames| whole frames of getBinCount()
+    // bytes each, oldest first, and returns how many
+    size_t read(uint8_t* out, size_t maxFrames);
+
+    size_t getBinCount() const {
+        return analyzer.getBinCount();
+    }
+
+    size_t getHopSize() const {
+        return analyzer.getHopSize();
+    }
+
+    uint64_t getDroppedFrames() const {
+        return frames.getOverflowCount();
+    }
+};
+
+// Spectrogram of a whole WAV or FLAC file squeezed into |columns| frames,
+// each the mean power of the windows that start in its share of the file,
+// for a preview across the width of a screen. The file streams through
+// with 50% overlap, or closer for files too short to fill every column;
+// beyond the output, memory is one read buffer and one window whatever
+// the length. |out| gets |columns| frames of fftSize / 2 bytes.
+bool analyzeSpectrogram(const std::string& path, size_t fftSize, size_t columns, std::vector<uint8_t>& out);
+
+#endif // AUDIORECORDINGAPP_SPECTROGRAM_H
@@ -0,0 +1,148 @@
+#ifndef AUDIORECORDINGAPP_SPSC_RING_BUFFER_H
+#define AUDIORECORDINGAPP_SPSC_RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// Fixed-capacity, wait-free ring buffer for exactly one producer thread and
+// one consumer thread. All storage is allocated in the constructor, so
+// write() and read() never allocate, lock or block and are safe to call
+// from an audio callback. Writes are all-or-nothing: if a block does not
+// fit it is rejected and counted as an overflow instead of being split.
+template <typename T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SpscRingBuffer only holds trivially copyable types");
+
+private:
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<T[]> storage;
+
+    // Each side owns one index and keeps a cached copy of the other one, so
+    // the shared cache lines are only touched when the cache runs out
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> writeIndex{0};
+    size_t cachedReadIndex = 0;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> readIndex{0};
+    size_t cachedWriteIndex = 0;
+
+    // Producer-side statistics, read from any thread
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> overflowCount{0};
+    std::atomic<uint64_t> droppedItems{0};
+    std::atomic<size_t> highWaterMark{0};
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+public:
+    explicit SpscRingBuffer(size_t minCapacity)
+            : capacity(roundUpToPowerOfTwo(std::max<size_t>(minCapacity, 2))),
+              mask(capacity - 1),
+              storage(new T[capacity]()) {
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // Producer: copies all of |count| items in, or none of them
+    bool write(const T* data, size_t count) {
+        const size_t head = writeIndex.load(std::memory_order_relaxed);
+
+        if (capacity - (head - cachedReadIndex) < count) {
+            cachedReadIndex = readIndex.load(std::memory_order_acquire);
+            if (capacity - (head - cachedReadIndex) < count) {
+                overflowCount.fetch_add(1, std::memory_order_relaxed);
+                droppedItems.fetch_add(count, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        const size_t offset = head & mask;
+        const size_t firstPart = std::min(count, capacity - offset);
+        memcpy(&storage[offset], data, firstPart * sizeof(T));
+        memcpy(&storage[0], data + firstPart, (count - firstPart) * sizeof(T));
+
+        writeIndex.store(head + count, std::memory_order_release);
+
+        // One extra relaxed load per block keeps the statistic exact
+        const size_t fill = head + count - readIndex.load(std::memory_order_relaxed);
+        if (fill > highWaterMark.load(std::memory_order_relaxed)) {
+            highWaterMark.store(fill, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Consumer: copies out up to |maxCount| items, returns how many
+    size_t read(T* data, size_t maxCount) {
+        const size_t tail = readIndex.load(std::memory_order_relaxed);
+
+        size_t available = cachedWriteIndex - tail;
+        if (available < maxCount) {
+            cachedWriteIndex = writeIndex.load(std::memory_order_acquire);
+            available = cachedWriteIndex - tail;
+        }
+
+        const size_t count = std::min(available, maxCount);
+        const size_t offset = tail & mask;
+        const size_t firstPart = std::min(count, capacity - offset);
+        memcpy(data, &storage[offset], firstPart * sizeof(T));
+        memcpy(data + firstPart, &storage[0], (count - firstPart) * sizeof(T));
+
+        readIndex.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: number of items that read() can return right now
+    size_t availableToRead() const {
+        return writeIndex.load(std::memory_order_acquire) -
+               readIndex.load(std::memory_order_relaxed);
+    }
+
+    // Producer: number of items that write() can accept right now
+    size_t availableToWrite() const {
+        return capacity - (writeIndex.load(std::memory_order_relaxed) -
+                           readIndex.load(std::memory_order_acquire));
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    uint64_t getOverflowCount() const {
+        return overflowCount.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getDroppedItems() const {
+        return droppedItems.load(std::memory_order_relaxed);
+    }
+
+    size_t getHighWaterMark() const {
+        return highWaterMark.load(std::memory_order_relaxed);
+    }
+
+    // Only valid while neither side is running
+    void reset() {
+        writeIndex.store(0, std::memory_order_relaxed);
+        readIndex.store(0, std::memory_order_relaxed);
+        cachedReadIndex = 0;
+        cachedWriteIndex = 0;
+        overflowCount.store(0, std::memory_order_relaxed);
+        droppedItems.store(0, std::memory_order_relaxed);
+        highWaterMark.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // AUDIORECORDINGAPP_SPSC_RING_BUFFER_H
@@ -0,0 +1,58 @@
+#ifndef AUDIORECORDINGAPP_START_LATENCY_PROBE_H
+#define AUDIORECORDINGAPP_START_LATENCY_PROBE_H
+
+#include <atomic>
+#include <chrono>
+
+// Times one start call: how long the call itself took and how long until
+// the first buffer callback arrived, tagged with whether the call had to
+// build its device objects (cold) or reused existing ones (warm).
+class StartLatencyProbe {
+private:
+    std::chrono::steady_clock::time_point callStart;
+    std::atomic<bool> awaitingCallback{false};
+    std::atomic<bool> cold{false};
+    std::atomic<float> setupMs{0.0f};
+    std::atomic<float> firstCallbackMs{0.0f};
+
+    float elapsedMs() const {
+        return std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - callStart).count();
+    }
+
+public:
+    void begin() {
+        callStart = std::chrono::steady_clock::now();
+        firstCallbackMs = 0.0f;
+        awaitingCallback = true;
+    }
+
+    void endSetup(bool wasCold) {
+        cold = wasCold;
+        setupMs = elapsedMs();
+    }
+
+    // Called from the audio thread on every callback, cheap after the first
+    void onCallback() {
+        if (awaitingCallback.load(std::memory_order_relaxed) && awaitingCallback.exchange(false)) {
+            firstCallbackMs = elapsedMs();
+        }
+    }
+
+    // {cold ? 1 : 0, setup ms, first callback ms}
+    void snapshot(float out[3]) const {
+        out[0] = cold ? 1.0f : 0.0f;
+        out[1] = setupMs;
+        out[2] = firstCallbackMs;
+    }
+
+    bool wasCold() const {
+        return cold;
+    }
+
+    float getSetupMs() const {
+        return setupMs;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_START_LATENCY_PROBE_H
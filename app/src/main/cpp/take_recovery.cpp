@@ -0,0 +1,111 @@
+#include "take_recovery.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wav_file.h"
+
+#define LOG_TAG "TakeRecovery"
+#include "audio_log.h"
+
+static const char OPEN_TAKE_SUFFIX[] = ".open";
+
+std::string getOpenTakeMarkerPath(const std::string& takePath) {
+    return takePath + OPEN_TAKE_SUFFIX;
+}
+
+bool syncParentDirectory(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+bool recoverWavTake(const std::string& path, uint64_t& frames) {
+    frames = 0;
+    std::string markerPath = getOpenTakeMarkerPath(path);
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        // Died before the take was created; only the marker is left
+        std::remove(markerPath.c_str());
+        return false;
+    }
+
+    struct stat st{};
+    uint8_t header[WAV_HEADER_SIZE];
+    WavInfo info;
+    SampleFormat format;
+    bool readable = fstat(fd, &st) == 0 &&
+                    pread(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                    parseWavHeader(header, sizeof(header), static_cast<size_t>(st.st_size), info) &&
+                    getWavSampleFormat(info, format) && info.blockAlign > 0 && info.dataOffset == WAV_HEADER_SIZE;
+    if (!readable) {
+        // Too short for a header means nothing was recorded; anything
+        // else is not ours to touch, so it is left as is and not retried
+        ::close(fd);
+        if (st.st_size < static_cast<off_t>(WAV_HEADER_SIZE)) {
+            std::remove(path.c_str());
+        } else {
+            LOGE("Cannot recover %s: not a WAV this app wrote", path.c_str());
+        }
+        std::remove(markerPath.c_str());
+        return false;
+    }
+
+    // The data chunk runs to the end of the file, less any torn frame
+    uint64_t dataBytes = static_cast<uint64_t>(st.st_size) - WAV_HEADER_SIZE;
+    frames = dataBytes / info.blockAlign;
+    dataBytes = frames * info.blockAlign;
+    buildWavHeader(static_cast<int>(info.sampleRate), info.channels, format, dataBytes, header);
+    bool recovered = ftruncate(fd, static_cast<off_t>(WAV_HEADER_SIZE + dataBytes)) == 0 &&
+                     pwrite(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                     fdatasync(fd) == 0;
+    ::close(fd);
+    if (!recovered) {
+        LOGE("Failed to recover %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::remove(markerPath.c_str());
+    if (frames == 0) {
+        std::remove(path.c_str());
+        return false;
+    }
+    LOGI("Recovered %s: %llu frames", path.c_str(), static_cast<unsigned long long>(frames));
+    return true;
+}
+
+void recoverTakes(const std::string& directory, std::vector<std::string>& recovered) {
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+
+    // Collected first, as recovering removes entries
+    std::vector<std::string> takes;
+    const size_t suffixLength = sizeof(OPEN_TAKE_SUFFIX) - 1;
+    while (dirent* entry = readdir(dir)) {
+        size_t length = strlen(entry->d_name);
+        if (length > suffixLength && strcmp(entry->d_name + length - suffixLength, OPEN_TAKE_SUFFIX) == 0) {
+            takes.push_back(directory + "/" + std::string(entry->d_name, length - suffixLength));
+        }
+    }
+    closedir(dir);
+
+    for (const std::string& take : takes) {
+        uint64_t frames;
+        if (recoverWavTake(take, frames)) {
+            recovered.push_back(take);
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef AUDIORECORDINGAPP_TAKE_RECOVERY_H
+#define AUDIORECORDINGAPP_TAKE_RECOVERY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Takes written with commits on (see WavWriter) can be finished after the
+// process dies mid-take. An empty marker, "take.wav" -> "take.wav.open",
+// sits next to each take from when it is opened until it is closed
+// cleanly, so any still there on the next launch belong to takes that
+// were cut short.
+std::string getOpenTakeMarkerPath(const std::string& takePath);
+
+// Makes the directory entries of |path| and its siblings durable
+bool syncParentDirectory(const std::string& path);
+
+// Finishes a WAV take left open: the header is rewritten to cover every
+// whole frame that reached the file, a torn last frame is cut off, and
+// the marker goes once that is on disk. Everything up to the last commit
+// survives a power cut; after a process kill the kernel still has the
+// rest, so that is kept too. Costs a header read and a stat whatever the
+// length. A take with no audio is deleted, as a clean close would.
+bool recoverWavTake(const std::string& path, uint64_t& frames);
+
+// Every take left open in |directory|, finished; paths of the ones that
+// came back go in |recovered|
+void recoverTakes(const std::string& directory, std::vector<std::string>& recovered);
+
+#endif // AUDIORECORDINGAPP_TAKE_RECOVERY_H
@@ -0,0 +1,247 @@
+#include "time_stretch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIME_STRETCH_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TIME_STRETCH_SSE2 1
+#endif
+
+#define LOG_TAG "TimeStretch"
+#include "audio_log.h"
+
+void crossCorrelateScalar(const float* signal, const float* pattern, size_t length, size_t lags, float* out) {
+    for (size_t k = 0; k < lags; k++) {
+        float sum = 0.0f;
+        for (size_t i = 0; i < length; i++) {
+            sum += signal[k + i] * pattern[i];
+        }
+        out[k] = sum;
+    }
+}
+
+#if TIME_STRETCH_NEON
+
+void crossCorrelate(const float* signal, const float* pattern, size_t length, size_t lags, float* out) {
+    size_t k = 0;
+    for (; k + 8 <= lags; k += 8) {
+        const float* lane = signal + k;
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        for (size_t i = 0; i < length; i++) {
+            float32x4_t p = vdupq_n_f32(pattern[i]);
+            sum0 = vmlaq_f32(sum0, vld1q_f32(lane + i), p);
+            sum1 = vmlaq_f32(sum1, vld1q_f32(lane + i + 4), p);
+        }
+        vst1q_f32(out + k, sum0);
+        vst1q_f32(out + k + 4, sum1);
+    }
+    crossCorrelateScalar(signal + k, pattern, length, lags - k, out + k);
+}
+
+#elif TIME_STRETCH_SSE2
+
+void crossCorrelate(const float* signal, const float* pattern, size_t length, size_t lags, float* out) {
+    size_t k = 0;
+    for (; k + 8 <= lags; k += 8) {
+        const float* lane = signal + k;
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (size_t i = 0; i < length; i++) {
+            __m128 p = _mm_set1_ps(pattern[i]);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(lane + i), p));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(lane + i + 4), p));
+        }
+        _mm_storeu_ps(out + k, sum0);
+        _mm_storeu_ps(out + k + 4, sum1);
+    }
+    crossCorrelateScalar(signal + k, pattern, length, lags - k, out + k);
+}
+
+#else
+
+void crossCorrelate(const float* signal, const float* pattern, size_t length, size_t lags, float* out) {
+    crossCorrelateScalar(signal, pattern, length, lags, out);
+}
+
+#endif
+
+bool TimeStretch::configure(int sampleRate, int channels) {
+    this->channels = 0;
+    if (sampleRate <= 0 || channels < 1 || channels > MAX_CHANNELS) {
+        LOGE("Unsupported time stretch: %d Hz, %d channels", sampleRate, channels);
+        return false;
+    }
+
+    this->sampleRate = sampleRate;
+    hopFrames = std::max<size_t>(1, static_cast<size_t>(sampleRate) * SEGMENT_MS / 2000);
+    segmentFrames = 2 * hopFrames;
+    searchFrames = static_cast<size_t>(sampleRate) * SEARCH_MS / 1000;
+
+    window.resize(segmentFrames);
+    for (size_t n = 0; n < segmentFrames; n++) {
+        window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * n / segmentFrames));
+    }
+
+    // The widest span a hop reads, measured from the oldest frame kept,
+    // plus as much again for new input
+    capacityFrames = 4 * segmentFrames + 2 * searchFrames;
+    held.assign(capacityFrames * channels, 0.0f);
+    mixdown.assign(channels > 1 ? capacityFrames : 0, 0.0f);
+    overlap.assign(hopFrames * channels, 0.0f);
+    hop.assign(hopFrames * channels, 0.0f);
+    correlation.assign(2 * searchFrames + 1, 0.0f);
+
+    this->channels = channels;
+    reset();
+    return true;
+}
+
+void TimeStretch::reset() {
+    heldFrames = 0;
+    nominal = 0.0;
+    follow = 0;
+    primed = false;
+    hopOffset = 0;
+    hopReady = 0;
+}
+
+void TimeStretch::setSpeed(float speed) {
+    if (std::isnan(speed)) return;
+    this->speed = std::min(std::max(speed, MIN_SPEED), MAX_SPEED);
+}
+
+size_t TimeStretch::getFlushFrames() const {
+    // The last hop can start this far short of the end of its input
+    return 2 * (segmentFrames + searchFrames) + 2;
+}
+
+size_t TimeStretch::append(const float* samples, size_t frames) {
+    size_t taken = std::min(frames, capacityFrames - heldFrames);
+    std::copy(samples, samples + taken * channels, held.begin() + heldFrames * channels);
+    if (channels > 1) {
+        for (size_t i = 0; i < taken; i++) {
+            mixdown[heldFrames + i] = 0.5f * (samples[2 * i] + samples[2 * i + 1]);
+        }
+    }
+    heldFrames += taken;
+    return taken;
+}
+
+size_t TimeStretch::findSegment(size_t first, size_t last, size_t centre) {
+    const float* search = channels > 1 ? mixdown.data() : held.data();
+    size_t lags = last - first + 1;
+    crossCorrelate(search + first, search + follow, hopFrames, lags, correlation.data());
+
+    // Correlation over the candidate's level, so a loud stretch does not
+    // win on volume alone. Its energy slides along a frame per lag.
+    double energy = 0.0;
+    for (size_t i = 0; i < hopFrames; i++) {
+        energy += static_cast<double>(search[first + i]) * search[first + i];
+    }
+    size_t best = centre;
+    double bestScore = -INFINITY;
+    for (size_t k = 0; k < lags; k++) {
+        double score = correlation[k] / std::sqrt(energy + 1e-9);
+        if (score > bestScore || (score == bestScore && first + k == centre)) {
+            best = first + k;
+            bestScore = score;
+        }
+        double out = search[first + k];
+        double in = search[first + k + hopFrames];
+        energy = std::max(0.0, energy + in * in - out * out);
+    }
+    return best;
+}
+
+void TimeStretch::windowTail(size_t start) {
+    const float* segment = held.data() + (start + hopFrames) * channels;
+    for (size_t i = 0; i < hopFrames; i++) {
+        float w = window[hopFrames + i];
+        for (int c = 0; c < channels; c++) {
+            overlap[i * channels + c] = w * segment[i * channels + c];
+        }
+    }
+}
+
+bool TimeStretch::nextHop() {
+    size_t start = 0;
+    if (!primed) {
+        if (heldFrames < segmentFrames) return false;
+        // As if a segment had ended here, so the stream starts unfaded
+        std::copy(held.begin(), held.begin() + hopFrames * channels, hop.begin());
+        nominal = 0.0;
+        primed = true;
+    } else {
+        if (speed == 1.0f) {
+            // The segment that follows on is its own best match
+            if (heldFrames < follow + segmentFrames) return false;
+            start = follow;
+            nominal = static_cast<double>(follow);
+        } else {
+            size_t centre = static_cast<size_t>(std::llround(nominal));
+            size_t first = centre > searchFrames ? centre - searchFrames : 0;
+            size_t last = centre + searchFrames;
+            if (heldFrames < last + segmentFrames) return false;
+            start = findSegment(first, last, centre);
+        }
+
+        const float* segment = held.data() + start * channels;
+        for (size_t i = 0; i < hopFrames; i++) {
+            float w = window[i];
+            for (int c = 0; c < channels; c++) {
+                size_t sample = i * channels + c;
+                hop[sample] = overlap[sample] + w * segment[sample];
+            }
+        }
+    }
+    windowTail(start);
+    follow = start + hopFrames;
+    nominal += static_cast<double>(hopFrames) * speed;
+
+    // Drop what neither the next match nor the next search can reach
+    double reach = std::floor(nominal) - static_cast<double>(searchFrames);
+    size_t drop = std::min(follow, reach > 0.0 ? static_cast<size_t>(reach) : size_t(0));
+    if (drop > 0) {
+        std::memmove(held.data(), held.data() + drop * channels, (heldFrames - drop) * channels * sizeof(float));
+        if (channels > 1) {
+            std::memmove(mixdown.data(), mixdown.data() + drop, (heldFrames - drop) * sizeof(float));
+        }
+        heldFrames -= drop;
+        follow -= drop;
+        nominal -= static_cast<double>(drop);
+    }
+    return true;
+}
+
+size_t TimeStretch::process(const float* input, size_t inputFrames, size_t& inputUsed,
+                            float* output, size_t maxOutputFrames) {
+    inputUsed = 0;
+    if (!isConfigured()) {
+        return 0;
+    }
+
+    size_t produced = 0;
+    while (produced < maxOutputFrames) {
+        if (hopOffset < hopReady) {
+            size_t frames = std::min(hopReady - hopOffset, maxOutputFrames - produced);
+            std::copy(hop.begin() + hopOffset * channels, hop.begin() + (hopOffset + frames) * channels,
+                      output + produced * channels);
+            hopOffset += frames;
+            produced += frames;
+        } else if (nextHop()) {
+            hopOffset = 0;
+            hopReady = hopFrames;
+        } else {
+            size_t taken = append(input + inputUsed * channels, inputFrames - inputUsed);
+            if (taken == 0) break;
+            inputUsed += taken;
+        }
+    }
+    return produced;
+}
@@ -0,0 +1,121 @@
+#ifndef AUDIORECORDINGAPP_TIME_STRETCH_H
+#define AUDIORECORDINGAPP_TIME_STRETCH_H
+
+#include <cstddef>
+#include <vector>
+
+// out[k] = sum of signal[k + i] * pattern[i] over |length| samples, for
+// each of |lags| offsets k. The SIMD versions work across lags, eight at a
+// time with NEON or SSE, so each pattern sample is broadcast once per
+// pass and nothing is summed horizontally; the plain loop is kept as the
+// reference for tests and benchmarks and takes the lags left over.
+void crossCorrelate(const float* signal, const float* pattern, size_t length, size_t lags, float* out);
+void crossCorrelateScalar(const float* signal, const float* pattern, size_t length, size_t lags, float* out);
+
+// Changes the speed of interleaved float audio, mono or stereo, without
+// changing its pitch, by waveform-similarity overlap-add (WSOLA). Output
+// is built from Hann-windowed segments of SEGMENT_MS overlapping by half.
+// Each hop moves through the input by half a segment times the speed, and
+// the segment taken there is shifted by up to SEARCH_MS either way to
+// where it best matches what would have followed the last one, so the
+// overlap adds in phase. At speed 1 segments follow on exactly and the
+// output is the input.
+//
+// The speed can change between any two calls and applies from the next
+// hop; every hop is a crossfade, so a change leaves no seam. Output starts
+// with the first input frame, with no delay.
+class TimeStretch {
+public:
+    static const int MAX_CHANNELS = 2;
+    static constexpr float MIN_SPEED = 0.5f;
+    static constexpr float MAX_SPEED = 3.0f;
+    // Long enough to hold a couple of periods of a low voice
+    static const int SEGMENT_MS = 20;
+    // Either way, so the search spans a period down to 80 Hz
+    static const int SEARCH_MS = 6;
+
+private:
+    int sampleRate = 0;
+    int channels = 0;
+    size_t segmentFrames = 0;
+    size_t hopFrames = 0;
+    size_t searchFrames = 0;
+    float speed = 1.0f;
+
+    // Periodic Hann over a segment, so its two halves sum to one
+    std::vector<float> window;
+
+    // Input not yet used up, interleaved, and for stereo its mono mixdown
+    // the search runs on. |nominal| is where the next segment would start
+    // at the current speed and |follow| where the audio that followed the
+    // last one starts, both counted from the oldest frame held.
+    std::vector<float> held;
+    std::vector<float> mixdown;
+    size_t heldFrames = 0;
+    size_t capacityFrames = 0;
+    double nominal = 0.0;
+    size_t follow = 0;
+    bool primed = false;
+
+    // Second half of the last windowed segment, waiting for the next one
+    // to overlap it, and the finished hop being handed out
+    std::vector<float> overlap;
+    std::vector<float> hop;
+    size_t hopOffset = 0;
+    size_t hopReady = 0;
+
+    std::vector<float> correlation;
+
+    // Start of the segment from |first| to |last| that best continues
+    // from |follow|; |centre| wins a tie, as in silence
+    size_t findSegment(size_t first, size_t last, size_t centre);
+    // Builds the next hop from the input held; false if it needs more
+    bool nextHop();
+    void windowTail(size_t start);
+    size_t append(const float* samples, size_t frames);
+
+public:
+    TimeStretch() = default;
+
+    // Sets up for the rate and channel count and clears all state; fails
+    // for unsupported channel counts or a non-positive rate
+    bool configure(int sampleRate, int channels);
+
+    // Drops buffered input, so the next process() starts a new stream
+    void reset();
+
+    // Clamped to MIN_SPEED..MAX_SPEED
+    void setSpeed(float speed);
+
+    float getSpeed() const {
+        return speed;
+    }
+
+    bool isConfigured() const {
+        return channels > 0;
+    }
+
+    int getChannels() const {
+        return channels;
+    }
+
+    size_t getSegmentFrames() const {
+        return segmentFrames;
+    }
+
+    size_t getSearchFrames() const {
+        return searchFrames;
+    }
+
+    // Frames of silence that push the last real input out at any speed
+    size_t getFlushFrames() const;
+
+    // Consumes up to |inputFrames| interleaved frames and writes up to
+    // |maxOutputFrames|. Stops when either runs out; |inputUsed| receives
+    // how many input frames were taken, and the return value how many
+    // frames were written. Does not allocate.
+    size_t process(const float* input, size_t inputFrames, size_t& inputUsed,
+                   float* output, size_t maxOutputFrames);
+};
+
+#endif // AUDIORECORDINGAPP_TIME_STRETCH_H
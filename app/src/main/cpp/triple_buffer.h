@@ -0,0 +1,58 @@
+#ifndef AUDIORECORDINGAPP_TRIPLE_BUFFER_H
+#define AUDIORECORDINGAPP_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// Hands the latest value of T from one writer thread to one reader thread
+// without either ever waiting: the writer fills a slot of its own and
+// swaps it into the middle, the reader swaps the middle for its own slot
+// when there is something new there. Values the reader never got to are
+// overwritten, so it always sees the most recent complete one. Neither
+// side allocates, so the reader may be an audio callback.
+template <typename T>
+class TripleBuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "TripleBuffer only holds trivially copyable types");
+
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    // Set on the middle slot when the writer published it and the reader
+    // has not taken it yet
+    static const uint8_t FRESH = 0x4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 2;   // writer's
+    uint8_t front = 0;  // reader's
+
+public:
+    explicit TripleBuffer(const T& initial = T()) : slots{initial, initial, initial} {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer
+    void write(const T& value) {
+        slots[back] = value;
+        back = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader: takes the latest value if there is a new one, true if so
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // Reader: the value taken by the last update()
+    const T& read() const {
+        return slots[front];
+    }
+};
+
+#endif // AUDIORECORDINGAPP_TRIPLE_BUFFER_H
@@ -0,0 +1,133 @@
+#include "voice_activity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "audio_file_writer.h"
+
+#define LOG_TAG "VoiceActivity"
+#include "audio_log.h"
+
+static const char SEGMENTS_MAGIC[4] = {'V', 'S', 'G', '1'};
+static const char* SEGMENTS_EXTENSION = ".cues";
+
+static double fromDb(double db) {
+    return std::pow(10.0, db / 10.0);
+}
+
+VoiceActivityDetector::VoiceActivityDetector(int sampleRate, int channels)
+    : sampleRate(sampleRate), channels(channels),
+      frameSamples(static_cast<size_t>(sampleRate) * FRAME_MS / 1000 * channels) {
+    configure(VoiceActivityConfig());
+}
+
+void VoiceActivityDetector::configure(const VoiceActivityConfig& config) {
+    // Everything the per-frame test needs as a plain power ratio
+    thresholdRatio = fromDb(config.thresholdDb);
+    fricativeRatio = fromDb(config.thresholdDb / 2.0);
+    floorRise = fromDb(FLOOR_RISE_DB * FRAME_MS / 1000.0);
+    minSpeechPower = fromDb(MIN_SPEECH_DBFS);
+    alwaysKeepPower = fromDb(ALWAYS_KEEP_DBFS);
+    hangoverFrames = static_cast<uint64_t>(std::max(config.hangoverMs, 0)) * sampleRate / 1000;
+    reset();
+}
+
+void VoiceActivityDetector::reset() {
+    // Starting low keeps anything clearly audible until quiet frames have
+    // shown where the floor really is
+    noiseFloor = minSpeechPower / thresholdRatio;
+    framesSinceSpeech = hangoverFrames;
+    pending = PeakStats();
+    pendingCrossings = 0;
+}
+
+bool VoiceActivityDetector::classifyFrame(const PeakStats& stats, size_t crossings) {
+    double power = static_cast<double>(stats.sumSquares) / stats.sampleCount / (32768.0 * 32768.0);
+    double crossingRate = static_cast<double>(crossings) / stats.sampleCount;
+
+    bool speech = power > alwaysKeepPower ||
+                  (power > minSpeechPower && (power > noiseFloor * thresholdRatio ||
+                   (power > noiseFloor * fricativeRatio && crossingRate > FRICATIVE_CROSSING_RATE)));
+
+    if (power < noiseFloor) {
+        noiseFloor = std::max(power, minSpeechPower / thresholdRatio);
+    } else {
+        noiseFloor *= floorRise;
+    }
+    return speech;
+}
+
+bool VoiceActivityDetector::process(const short* samples, size_t count) {
+    bool keep = framesSinceSpeech < hangoverFrames;
+    bool speech = false;
+
+    size_t offset = 0;
+    while (offset < count) {
+        size_t take = std::min(frameSamples - pending.sampleCount, count - offset);
+        reducePeaks(samples + offset, take, pending);
+        pendingCrossings += countZeroCrossings(samples + offset, take, static_cast<size_t>(channels));
+        offset += take;
+
+        if (pending.sampleCount == frameSamples) {
+            if (classifyFrame(pending, pendingCrossings)) {
+                speech = true;
+                framesSinceSpeech = 0;
+            } else if (framesSinceSpeech < hangoverFrames) {
+                framesSinceSpeech += frameSamples / channels;
+            }
+            pending = PeakStats();
+            pendingCrossings = 0;
+        }
+    }
+    return keep || speech;
+}
+
+bool saveVoiceSegments(const std::string& path, int sampleRate, const std::vector<VoiceSegment>& segments) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOGE("Failed to open segment sidecar: %s", path.c_str());
+        return false;
+    }
+
+    uint32_t rate = sampleRate;
+    uint32_t count = segments.size();
+    out.write(SEGMENTS_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&rate), 4);
+    out.write(reinterpret_cast<const char*>(&count), 4);
+    for (const VoiceSegment& segment : segments) {
+        uint64_t fields[3] = {segment.captureFrame, segment.fileFrame, segment.frameCount};
+        out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+    }
+    return out.good();
+}
+
+bool loadVoiceSegments(const std::string& path, std::vector<VoiceSegment>& segments) {
+    segments.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t rate = 0;
+    uint32_t count = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&rate), 4);
+    in.read(reinterpret_cast<char*>(&count), 4);
+    if (!in.good() || memcmp(magic, SEGMENTS_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t fields[3];
+        if (!in.read(reinterpret_cast<char*>(fields), sizeof(fields))) {
+            segments.clear();
+            return false;
+        }
+        segments.push_back({fields[0], fields[1], fields[2]});
+    }
+    return true;
+}
+
+std::string getVoiceSegmentsPath(const std::string& audioPath) {
+    return replaceFileExtension(audioPath, SEGMENTS_EXTENSION);
+}
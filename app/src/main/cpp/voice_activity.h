@@ -0,0 +1,97 @@
+#ifndef AUDIORECORDINGAPP_VOICE_ACTIVITY_H
+#define AUDIORECORDINGAPP_VOICE_ACTIVITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "peak_kernels.h"
+
+// Settings for dropping silence from a take
+struct VoiceActivityConfig {
+    bool enabled = false;
+    // How far above the tracked noise floor a frame must be to count as speech
+    float thresholdDb = 12.0f;
+    // Silence kept after speech, so word endings and short pauses survive
+    int hangoverMs = 400;
+    // Silence kept before speech, so soft onsets are not clipped
+    int preRollMs = 200;
+};
+
+// One kept stretch of a take, in frames
+struct VoiceSegment {
+    uint64_t captureFrame;  // start in the original input
+    uint64_t fileFrame;     // start in the file
+    uint64_t frameCount;
+};
+
+// Energy and zero-crossing voice activity detector for 16-bit capture
+// blocks. Each 10 ms frame is compared with a noise floor that follows
+// quiet frames down at once and drifts up slowly; a frame is speech if it
+// is loud, stands the configured threshold above the floor, or half as
+// far with a crossing rate typical of fricatives. A block is kept when it
+// holds speech or starts within the hangover of the last speech.
+//
+// Works on power ratios only, with no logarithms on the audio thread.
+class VoiceActivityDetector {
+public:
+    static const int FRAME_MS = 10;
+
+private:
+    // Noise floor rise while no quieter frame comes along, dB per second
+    static constexpr double FLOOR_RISE_DB = 3.0;
+    // Below this nothing is speech, however quiet the room (full scale 1.0)
+    static constexpr double MIN_SPEECH_DBFS = -60.0;
+    // Above this a frame is kept whatever the floor has learned, so steady
+    // music is not mistaken for a noisy room
+    static constexpr double ALWAYS_KEEP_DBFS = -30.0;
+    // Crossings per sample pair above which a quieter frame may be speech
+    static constexpr double FRICATIVE_CROSSING_RATE = 0.3;
+
+    int sampleRate;
+    int channels;
+    size_t frameSamples;
+
+    double thresholdRatio = 1.0;
+    double fricativeRatio = 1.0;
+    double floorRise = 1.0;
+    double minSpeechPower = 0.0;
+    double alwaysKeepPower = 0.0;
+    uint64_t hangoverFrames = 0;
+
+    double noiseFloor = 0.0;
+    uint64_t framesSinceSpeech = 0;
+
+    // Frame straddling the end of the last block
+    PeakStats pending;
+    size_t pendingCrossings = 0;
+
+    bool classifyFrame(const PeakStats& stats, size_t crossings);
+
+public:
+    VoiceActivityDetector(int sampleRate, int channels);
+
+    void configure(const VoiceActivityConfig& config);
+    void reset();
+
+    // Runs the detector over one interleaved block; true if it should be
+    // kept. Does not allocate.
+    bool process(const short* samples, size_t count);
+
+    // Linear noise floor estimate, 1.0 = full-scale power
+    double getNoiseFloor() const {
+        return noiseFloor;
+    }
+};
+
+// Kept segments of a take, saved next to the audio as a sidecar:
+//   "VSG1", sampleRate u32, segmentCount u32,
+//   then {captureFrame, fileFrame, frameCount} u64 triples
+bool saveVoiceSegments(const std::string& path, int sampleRate, const std::vector<VoiceSegment>& segments);
+bool loadVoiceSegments(const std::string& path, std::vector<VoiceSegment>& segments);
+
+// "take.wav" -> "take.cues"
+std::string getVoiceSegmentsPath(const std::string& audioPath);
+
+#endif // AUDIORECORDINGAPP_VOICE_ACTIVITY_H
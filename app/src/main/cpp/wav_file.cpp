@@ -0,0 +1,171 @@
+#include "wav_file.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const size_t RIFF_HEADER_SIZE = 12;
+static const size_t CHUNK_HEADER_SIZE = 8;
+static const size_t FMT_CHUNK_MIN_SIZE = 16;
+static const size_t PREFETCH_BYTES = 1024 * 1024;
+
+static uint16_t readLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool parseWavHeader(const uint8_t* data, size_t available, size_t fileSize, WavInfo& info) {
+    info = WavInfo();
+
+    if (available < RIFF_HEADER_SIZE || memcmp(data, "RIFF", 4) != 0 ||
+        memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool haveFormat = false;
+    size_t offset = RIFF_HEADER_SIZE;
+
+    while (offset + CHUNK_HEADER_SIZE <= available) {
+        const uint8_t* chunk = data + offset;
+        size_t chunkSize = readLe32(chunk + 4);
+        size_t bodyOffset = offset + CHUNK_HEADER_SIZE;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (chunkSize < FMT_CHUNK_MIN_SIZE || bodyOffset + FMT_CHUNK_MIN_SIZE > available) {
+                return false;
+            }
+            const uint8_t* body = data + bodyOffset;
+            info.audioFormat = readLe16(body);
+            info.channels = readLe16(body + 2);
+            info.sampleRate = readLe32(body + 4);
+            info.blockAlign = readLe16(body + 12);
+            info.bitsPerSample = readLe16(body + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE carries the real format in its sub-format GUID
+            if (info.audioFormat == WAV_FORMAT_EXTENSIBLE && chunkSize >= 40 &&
+                bodyOffset + 26 <= available) {
+                info.audioFormat = readLe16(body + 24);
+            }
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat || info.channels == 0 || info.blockAlign == 0) {
+                return false;
+            }
+            info.dataOffset = bodyOffset;
+            info.dataSize = bodyOffset < fileSize ? fileSize - bodyOffset : 0;
+            if (chunkSize < info.dataSize) {
+                info.dataSize = chunkSize;
+            }
+            info.dataSize -= info.dataSize % info.blockAlign;
+            info.frameCount = info.dataSize / info.blockAlign;
+            return true;
+        }
+
+        // Chunks are word aligned: odd sizes are followed by a pad byte
+        offset = bodyOffset + chunkSize + (chunkSize & 1);
+    }
+
+    return false;
+}
+
+bool getWavSampleFormat(const WavInfo& info, SampleFormat& format) {
+    if (info.audioFormat == WAV_FORMAT_PCM && info.bitsPerSample == 16) {
+        format = SampleFormat::INT16;
+    } else if (info.audioFormat == WAV_FORMAT_PCM && info.bitsPerSample == 24) {
+        format = SampleFormat::INT24_PACKED;
+    } else if (info.audioFormat == WAV_FORMAT_IEEE_FLOAT && info.bitsPerSample == 32) {
+        format = SampleFormat::FLOAT32;
+    } else {
+        return false;
+    }
+    // Packed samples only: a 24-bit sample in a 4-byte container won't do
+    return info.blockAlign == info.channels * getBytesPerSample(format);
+}
+
+static void writeLe16(uint8_t* p, uint16_t value) {
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void writeLe32(uint8_t* p, uint32_t value) {
+    writeLe16(p, static_cast<uint16_t>(value));
+    writeLe16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+void buildWavHeader(int sampleRate, int channels, SampleFormat format, uint64_t dataBytes, uint8_t* out) {
+    uint32_t bytesPerSample = static_cast<uint32_t>(getBytesPerSample(format));
+    uint32_t dataSize = static_cast<uint32_t>(dataBytes);
+
+    memcpy(out, "RIFF", 4);
+    writeLe32(out + 4, static_cast<uint32_t>(WAV_HEADER_SIZE - CHUNK_HEADER_SIZE) + dataSize);
+    memcpy(out + 8, "WAVE", 4);
+
+    memcpy(out + 12, "fmt ", 4);
+    writeLe32(out + 16, FMT_CHUNK_MIN_SIZE);
+    writeLe16(out + 20, format == SampleFormat::FLOAT32 ? WAV_FORMAT_IEEE_FLOAT : WAV_FORMAT_PCM);
+    writeLe16(out + 22, static_cast<uint16_t>(channels));
+    writeLe32(out + 24, static_cast<uint32_t>(sampleRate));
+    writeLe32(out + 28, static_cast<uint32_t>(sampleRate) * channels * bytesPerSample);
+    writeLe16(out + 32, static_cast<uint16_t>(channels * bytesPerSample));
+    writeLe16(out + 34, static_cast<uint16_t>(bytesPerSample * 8));
+
+    memcpy(out + 36, "data", 4);
+    writeLe32(out + 40, dataSize);
+}
+
+MappedWavFile::~MappedWavFile() {
+    close();
+}
+
+bool MappedWavFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    if (!parseWavHeader(static_cast<const uint8_t*>(mapped), size, size, info)) {
+        munmap(mapped, size);
+        info = WavInfo();
+        return false;
+    }
+
+    mapping = mapped;
+    mappingSize = size;
+
+    // Playback reads front to back: ask for aggressive readahead and start
+    // paging in the first blocks now, without waiting for them here
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    madvise(mapping, mappingSize < PREFETCH_BYTES ? mappingSize : PREFETCH_BYTES, MADV_WILLNEED);
+    return true;
+}
+
+void MappedWavFile::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+    info = WavInfo();
+}
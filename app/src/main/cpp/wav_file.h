@@ -0,0 +1,86 @@
+#ifndef AUDIORECORDINGAPP_WAV_FILE_H
+#define AUDIORECORDINGAPP_WAV_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sample_format.h"
+
+// Format and layout of a RIFF/WAVE file, as found by walking its chunks
+struct WavInfo {
+    uint16_t audioFormat = 0;
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bitsPerSample = 0;
+    uint16_t blockAlign = 0;
+    size_t dataOffset = 0;
+    size_t dataSize = 0;
+    size_t frameCount = 0;
+};
+
+static const uint16_t WAV_FORMAT_PCM = 1;
+static const uint16_t WAV_FORMAT_IEEE_FLOAT = 3;
+static const uint16_t WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+
+// Size of the header buildWavHeader() writes
+static const size_t WAV_HEADER_SIZE = 44;
+
+// Walks the RIFF chunks in |data|, which holds the first |available| bytes
+// of a file that is |fileSize| bytes long, and fills in |info| from the
+// "fmt " and "data" chunks. Unknown chunks (LIST, fact, ...) are skipped.
+// The data chunk size is clamped to the end of the file, so a truncated
+// take still yields every sample that made it to disk.
+bool parseWavHeader(const uint8_t* data, size_t available, size_t fileSize, WavInfo& info);
+
+// Maps the header's format onto the formats the pipeline can play: 16-bit
+// or packed 24-bit integer PCM, or 32-bit float. False for anything else.
+bool getWavSampleFormat(const WavInfo& info, SampleFormat& format);
+
+// The WAV_HEADER_SIZE bytes in front of |dataBytes| of samples: RIFF, a
+// plain 16-byte "fmt " chunk and the data chunk header. Float uses the
+// 16-byte form too; readers take the format tag from it.
+void buildWavHeader(int sampleRate, int channels, SampleFormat format, uint64_t dataBytes, uint8_t* out);
+
+// Read-only memory mapping of a WAV file. Loading costs the same whatever
+// the file length: the sample data is never copied, callers read it
+// straight from the mapped pages and the kernel pages it in on demand.
+class MappedWavFile {
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    WavInfo info;
+
+public:
+    MappedWavFile() = default;
+    ~MappedWavFile();
+
+    MappedWavFile(const MappedWavFile&) = delete;
+    MappedWavFile& operator=(const MappedWavFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const {
+        return mapping != nullptr;
+    }
+
+    const WavInfo& getInfo() const {
+        return info;
+    }
+
+    const uint8_t* getData() const {
+        return static_cast<const uint8_t*>(mapping) + info.dataOffset;
+    }
+
+    // Only meaningful for 16-bit files; other formats read getData()
+    const short* getSamples() const {
+        return reinterpret_cast<const short*>(getData());
+    }
+
+    size_t getSampleCount() const {
+        return info.bitsPerSample >= 8 ? info.dataSize / (info.bitsPerSample / 8) : 0;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_WAV_FILE_H
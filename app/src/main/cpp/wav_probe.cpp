@@ -0,0 +1,108 @@
+#include "wav_probe.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include "flac_decoder.h"
+
+// Our own recordings have a 44-byte header; the first read also covers
+// files from other encoders with a modest LIST/INFO chunk. Larger metadata
+// (embedded artwork, long BEXT chunks) is handled by re-reading a bigger
+// window, up to a limit past which the file is not worth treating as audio.
+static const size_t INITIAL_READ_BYTES = 4096;
+static const size_t MAX_READ_BYTES = 1024 * 1024;
+
+// FLAC takes report their STREAMINFO in WavInfo terms; there is no data
+// chunk, so the offset and size fields stay zero
+static bool probeFlacHeader(const std::vector<uint8_t>& header, WavInfo& info) {
+    FlacStreamInfo flac;
+    size_t firstFrameOffset;
+    info = WavInfo();
+    if (!parseFlacStreamInfo(header.data(), header.size(), flac, firstFrameOffset)) {
+        return false;
+    }
+
+    info.channels = flac.channels;
+    info.sampleRate = flac.sampleRate;
+    info.bitsPerSample = flac.bitsPerSample;
+    info.frameCount = static_cast<size_t>(flac.totalFrames);
+    return true;
+}
+
+bool probeWavFile(const std::string& path, WavInfo& info) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    std::vector<uint8_t> header;
+    size_t window = INITIAL_READ_BYTES;
+    bool parsed = false;
+
+    while (!parsed) {
+        size_t wanted = std::min(window, fileSize);
+        size_t have = header.size();
+        header.resize(wanted);
+        while (have < wanted) {
+            ssize_t got = pread(fd, header.data() + have, wanted - have, have);
+            if (got <= 0) break;
+            have += static_cast<size_t>(got);
+        }
+        header.resize(have);
+
+        if (have >= 4 && memcmp(header.data(), "fLaC", 4) == 0) {
+            parsed = probeFlacHeader(header, info);
+        } else {
+            parsed = parseWavHeader(header.data(), header.size(), fileSize, info);
+            if (have < 12 || memcmp(header.data(), "RIFF", 4) != 0) break;
+        }
+        if (have < wanted || wanted == fileSize || window >= MAX_READ_BYTES) break;
+        window *= 4;
+    }
+
+    ::close(fd);
+    return parsed;
+}
+
+std::vector<WavProbeResult> probeWavFiles(const std::vector<std::string>& paths, int maxThreads) {
+    std::vector<WavProbeResult> results(paths.size());
+    std::atomic<size_t> nextIndex{0};
+
+    // Each worker claims the next unprobed path until none are left, so a
+    // slow file (cold storage, large metadata) doesn't hold up the others
+    auto worker = [&]() {
+        for (size_t i = nextIndex.fetch_add(1); i < paths.size(); i = nextIndex.fetch_add(1)) {
+            results[i].valid = probeWavFile(paths[i], results[i].info);
+        }
+    };
+
+    size_t threadCount = std::min(paths.size(), static_cast<size_t>(std::max(1, maxThreads)));
+    if (threadCount <= 1) {
+        worker();
+        return results;
+    }
+
+    // The calling thread works too, so one fewer helper is needed
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
@@ -0,0 +1,33 @@
+#ifndef AUDIORECORDINGAPP_WAV_PROBE_H
+#define AUDIORECORDINGAPP_WAV_PROBE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "wav_file.h"
+
+// Outcome of probing one file; |info| is only meaningful when |valid|
+struct WavProbeResult {
+    bool valid = false;
+    WavInfo info;
+};
+
+static const int DEFAULT_PROBE_THREADS = 4;
+
+// Reads just enough of |path| to walk its RIFF header. Only the first few
+// kilobytes are read, unless metadata chunks push "data" further back.
+// FLAC files are recognised too and described from their STREAMINFO.
+bool probeWavFile(const std::string& path, WavInfo& info);
+
+// Probes every path on up to |maxThreads| worker threads. Results come back
+// in the same order as |paths|.
+std::vector<WavProbeResult> probeWavFiles(const std::vector<std::string>& paths,
+                                          int maxThreads = DEFAULT_PROBE_THREADS);
+
+inline int64_t getWavDurationMs(const WavInfo& info) {
+    if (info.sampleRate == 0) return 0;
+    return static_cast<int64_t>(info.frameCount) * 1000 / info.sampleRate;
+}
+
+#endif // AUDIORECORDINGAPP_WAV_PROBE_H
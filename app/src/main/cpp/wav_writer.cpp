@@ -0,0 +1,233 @@
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "audio_trace.h"
+#include "pre_roll_buffer.h"
+#include "take_recovery.h"
+#include "wav_file.h"
+
+#define LOG_TAG "WavWriter"
+#include "audio_log.h"
+
+WavWriter::WavWriter(int sampleRate, int channels, SampleFormat format)
+        : sampleRate(sampleRate), channels(channels), format(format),
+          bytesPerSample(getBytesPerSample(format)) {
+}
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::setFormat(int newSampleRate, int newChannels, SampleFormat newFormat) {
+    if (running) {
+        LOGE("Cannot change format while a file is open");
+        return false;
+    }
+
+    sampleRate = newSampleRate;
+    channels = newChannels;
+    format = newFormat;
+    bytesPerSample = getBytesPerSample(newFormat);
+    return true;
+}
+
+bool WavWriter::setCommitInterval(int intervalMs) {
+    if (running) {
+        LOGE("Cannot change commit interval while a file is open");
+        return false;
+    }
+
+    commitIntervalMs = std::max(intervalMs, 0);
+    return true;
+}
+
+bool WavWriter::open(const std::string& path) {
+    if (running) {
+        LOGE("Writer already open");
+        return false;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Failed to open output file: %s", path.c_str());
+        return false;
+    }
+
+    filePath = path;
+    ring.reset();
+
+    chunk.assign(WRITE_CHUNK_BYTES, 0);
+    chunkFill = 0;
+    chunkLimit = WRITE_CHUNK_BYTES - WAV_HEADER_SIZE;
+
+    bytesWritten = 0;
+    committedBytes = 0;
+    commitCount = 0;
+    commitBytes = static_cast<uint64_t>(sampleRate) * channels * bytesPerSample * commitIntervalMs / 1000;
+
+    // Placeholder header, sizes are patched by each commit and in close()
+    writeWavHeader(0);
+    if (commitBytes > 0) {
+        int marker = ::open(getOpenTakeMarkerPath(path).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (marker < 0) {
+            LOGE("Failed to mark %s as open, it cannot be recovered after a crash", path.c_str());
+        } else {
+            ::close(marker);
+        }
+    }
+
+    running = true;
+    writerThread = std::thread(&WavWriter::writerLoop, this);
+    return true;
+}
+
+bool WavWriter::write(const void* samples, size_t count) {
+    if (!running) return false;
+
+    return ring.write(static_cast<const uint8_t*>(samples), count * bytesPerSample);
+}
+
+bool WavWriter::close() {
+    if (!running) return false;
+
+    running = false;
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    // Patch the RIFF and data chunk sizes now that the length is known.
+    // A committed take is synced once more, so the tail is as safe as the
+    // rest before the marker goes.
+    writeWavHeader(bytesWritten);
+    if (commitBytes > 0) {
+        fdatasync(fd);
+    }
+    ::close(fd);
+    fd = -1;
+    if (commitBytes > 0) {
+        std::remove(getOpenTakeMarkerPath(filePath).c_str());
+    }
+
+    if (bytesWritten == 0) {
+        LOGE("No audio data to save");
+        std::remove(filePath.c_str());
+        return false;
+    }
+
+    if (ring.getOverflowCount() > 0) {
+        LOGE("Dropped %llu samples in %llu blocks, writer could not keep up",
+             static_cast<unsigned long long>(getSamplesDropped()),
+             static_cast<unsigned long long>(ring.getOverflowCount()));
+    }
+
+    LOGI("Audio saved to: %s (ring high-water mark %zu of %zu bytes)",
+         filePath.c_str(), ring.getHighWaterMark(), ring.getCapacity());
+    return true;
+}
+
+void WavWriter::writerLoop() {
+    // The capture callback never signals us, so poll at a rate that keeps
+    // the ring far from full: it holds over a second of audio even for
+    // 48 kHz stereo float
+    while (running) {
+        drainRing();
+        std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_POLL_MS));
+    }
+
+    // Recording has stopped: whatever is left goes out in one final pass
+    drainRing();
+    flushChunk();
+}
+
+void WavWriter::drainRing() {
+    // Only what is in the ring now is known to have come after the prefix
+    size_t available = ring.availableToRead();
+    if (const PreRollBuffer* preRoll = takePrefix()) {
+        preRoll->read([this](const void* samples, const short*, size_t count) {
+            appendToChunk(static_cast<const uint8_t*>(samples), count * bytesPerSample);
+        });
+    }
+
+    while (available > 0) {
+        size_t count = ring.read(&chunk[chunkFill], std::min(available, chunkLimit - chunkFill));
+        available -= count;
+        chunkFill += count;
+        if (chunkFill == chunkLimit) {
+            flushChunk();
+        }
+    }
+}
+
+void WavWriter::appendToChunk(const uint8_t* bytes, size_t count) {
+    while (count > 0) {
+        size_t run = std::min(count, chunkLimit - chunkFill);
+        memcpy(&chunk[chunkFill], bytes, run);
+        chunkFill += run;
+        bytes += run;
+        count -= run;
+        if (chunkFill == chunkLimit) {
+            flushChunk();
+        }
+    }
+}
+
+void WavWriter::flushChunk() {
+    if (chunkFill == 0) return;
+
+    AUDIO_TRACE_SECTION("WavWriter write");
+    size_t done = 0;
+    while (done < chunkFill) {
+        off_t offset = static_cast<off_t>(WAV_HEADER_SIZE + bytesWritten + done);
+        ssize_t count = pwrite(fd, chunk.data() + done, chunkFill - done, offset);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            LOGE("Failed to write audio data to: %s", filePath.c_str());
+            break;
+        }
+        done += static_cast<size_t>(count);
+    }
+
+    bytesWritten += done;
+    chunkFill = 0;
+    chunkLimit = chunk.size();
+
+    if (commitBytes > 0 && bytesWritten - committedBytes >= commitBytes) {
+        commit();
+    }
+}
+
+void WavWriter::commit() {
+    AUDIO_TRACE_SECTION("WavWriter commit");
+    // The first commit also makes the file and its marker durable
+    if (commitCount == 0) {
+        syncParentDirectory(filePath);
+    }
+
+    // Samples first, so the sizes never run ahead of what is on disk
+    uint64_t bytes = bytesWritten;
+    if (fdatasync(fd) != 0) {
+        LOGE("Failed to sync %s: %s", filePath.c_str(), strerror(errno));
+        return;
+    }
+    if (writeWavHeader(bytes)) {
+        committedBytes = bytes;
+        commitCount++;
+    }
+}
+
+bool WavWriter::writeWavHeader(uint64_t dataBytes) {
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(sampleRate, channels, format, dataBytes, header);
+    if (pwrite(fd, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        LOGE("Failed to write WAV header to: %s", filePath.c_str());
+        return false;
+    }
+    return true;
+}
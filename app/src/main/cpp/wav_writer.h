@@ -0,0 +1,124 @@
+#ifndef AUDIORECORDINGAPP_WAV_WRITER_H
+#define AUDIORECORDINGAPP_WAV_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_file_writer.h"
+#include "sample_format.h"
+#include "spsc_ring_buffer.h"
+
+// Streams PCM (16-bit, packed 24-bit or 32-bit float) to a WAV file while
+// recording is in progress.
+// The header is written up front with zero sizes, samples are handed off
+// from the capture callback into a lock-free fixed-size ring and flushed to
+// disk by a background thread in large chunks, and the RIFF/data sizes are
+// patched when the file is closed. Memory use is constant regardless of
+// take length.
+//
+// With commits on, the file also survives the process dying mid-take:
+// every commit interval's worth of audio, the writer thread syncs the
+// chunks written so far and then patches the header sizes to match, so
+// the file on disk is always a valid WAV up to the last commit. A marker
+// next to it (see take_recovery.h) flags the take as unfinished until
+// close(); recoverTakes() finishes any that are left.
+class WavWriter : public AudioFileWriter {
+private:
+    static const size_t WRITE_CHUNK_BYTES = 64 * 1024;
+    static const size_t RING_BYTES = 512 * 1024;
+    static const int WRITER_POLL_MS = 10;
+
+    int sampleRate;
+    int channels;
+    SampleFormat format;
+    size_t bytesPerSample;
+
+    int fd = -1;
+    std::string filePath;
+    std::thread writerThread;
+    std::atomic<bool> running{false};
+
+    // Ring between the capture callback (producer) and the writer thread.
+    // It carries raw bytes so one ring serves every sample format; writes
+    // are all-or-nothing, so only whole samples ever go in.
+    SpscRingBuffer<uint8_t> ring{RING_BYTES};
+
+    // Staging buffer for disk writes, sized so that every write after the
+    // first one starts on a WRITE_CHUNK_BYTES boundary of the file
+    std::vector<uint8_t> chunk;
+    size_t chunkFill = 0;
+    size_t chunkLimit = 0;
+
+    std::atomic<uint64_t> bytesWritten{0};
+
+    // Audio bytes between commits, 0 for none; the header sizes on disk
+    // cover |committedBytes|
+    int commitIntervalMs = 0;
+    uint64_t commitBytes = 0;
+    std::atomic<uint64_t> committedBytes{0};
+    std::atomic<uint32_t> commitCount{0};
+
+public:
+    WavWriter(int sampleRate, int channels, SampleFormat format);
+    ~WavWriter() override;
+
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    // Changes the format of the next file; fails while one is open
+    bool setFormat(int sampleRate, int channels, SampleFormat format);
+    // Commits every |intervalMs| of audio from the next file on, or never
+    // for 0; fails while a file is open
+    bool setCommitInterval(int intervalMs);
+
+    bool open(const std::string& path) override;
+    bool write(const void* samples, size_t count) override;
+    bool close() override;
+
+    bool isOpen() const override {
+        return running;
+    }
+
+    uint64_t getSamplesWritten() const override {
+        return bytesWritten / bytesPerSample;
+    }
+
+    uint64_t getSamplesDropped() const override {
+        return ring.getDroppedItems() / bytesPerSample;
+    }
+
+    uint64_t getSamplesPending() const override {
+        return ring.availableToRead() / bytesPerSample;
+    }
+
+    uint64_t getOverflowCount() const {
+        return ring.getOverflowCount();
+    }
+
+    size_t getRingHighWaterMark() const {
+        return ring.getHighWaterMark() / bytesPerSample;
+    }
+
+    // What a crash now would keep for certain
+    uint64_t getSamplesCommitted() const {
+        return committedBytes / bytesPerSample;
+    }
+
+    uint32_t getCommitCount() const {
+        return commitCount;
+    }
+
+private:
+    void writerLoop();
+    void drainRing();
+    void appendToChunk(const uint8_t* bytes, size_t count);
+    void flushChunk();
+    void commit();
+    bool writeWavHeader(uint64_t dataBytes);
+};
+
+#endif // AUDIORECORDINGAPP_WAV_WRITER_H
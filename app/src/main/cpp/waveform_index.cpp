@@ -0,0 +1,172 @@
+#include "waveform_index.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "audio_file_writer.h"
+
+#define LOG_TAG "WaveformIndex"
+#include "audio_log.h"
+
+static const char SIDECAR_MAGIC[4] = {'W', 'P', 'K', '1'};
+static const char* SIDECAR_EXTENSION = ".peaks";
+
+static PeakBin makeBin(const PeakStats& stats) {
+    double rms = std::sqrt(static_cast<double>(stats.sumSquares) / stats.sampleCount);
+    PeakBin bin;
+    bin.min = stats.min;
+    bin.max = stats.max;
+    // A full-scale negative square wave has an RMS of 32768
+    bin.rms = static_cast<short>(rms < SHRT_MAX ? std::lround(rms) : SHRT_MAX);
+    return bin;
+}
+
+WaveformIndex::WaveformIndex(int sampleRate, int channels)
+    : sampleRate(sampleRate), channels(channels) {
+}
+
+int WaveformIndex::getFramesPerBin(int level) {
+    int frames = BASE_FRAMES_PER_BIN;
+    for (int i = 0; i < level; i++) frames *= LEVEL_FACTOR;
+    return frames;
+}
+
+size_t WaveformIndex::getSamplesPerBin(int level) const {
+    return static_cast<size_t>(getFramesPerBin(level)) * channels;
+}
+
+void WaveformIndex::reset() {
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        levels[level].clear();
+        pending[level] = PeakStats();
+    }
+}
+
+void WaveformIndex::addSamples(const short* samples, size_t count) {
+    const size_t samplesPerBin = getSamplesPerBin(0);
+
+    while (count > 0) {
+        size_t take = samplesPerBin - pending[0].sampleCount;
+        if (take > count) take = count;
+
+        reducePeaks(samples, take, pending[0]);
+        samples += take;
+        count -= take;
+
+        if (pending[0].sampleCount == samplesPerBin) {
+            completeBin(0);
+        }
+    }
+}
+
+void WaveformIndex::completeBin(int level) {
+    levels[level].push_back(makeBin(pending[level]));
+
+    if (level + 1 < LEVEL_COUNT) {
+        pending[level + 1].merge(pending[level]);
+        pending[level] = PeakStats();
+        if (pending[level + 1].sampleCount == getSamplesPerBin(level + 1)) {
+            completeBin(level + 1);
+        }
+    } else {
+        pending[level] = PeakStats();
+    }
+}
+
+void WaveformIndex::finish() {
+    // Finest first, so each partial bin is folded into the one above it
+    // before that one is closed in turn
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+        if (pending[level].sampleCount == 0) continue;
+        levels[level].push_back(makeBin(pending[level]));
+        if (level + 1 < LEVEL_COUNT) {
+            pending[level + 1].merge(pending[level]);
+        }
+        pending[level] = PeakStats();
+    }
+}
+
+bool WaveformIndex::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        LOGE("Failed to open waveform sidecar: %s", path.c_str());
+        return false;
+    }
+
+    uint32_t rate = sampleRate;
+    uint16_t channelCount = channels;
+    uint16_t levelCount = LEVEL_COUNT;
+    uint32_t baseFrames = BASE_FRAMES_PER_BIN;
+    uint32_t factor = LEVEL_FACTOR;
+
+    out.write(SIDECAR_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&rate), 4);
+    out.write(reinterpret_cast<const char*>(&channelCount), 2);
+    out.write(reinterpret_cast<const char*>(&levelCount), 2);
+    out.write(reinterpret_cast<const char*>(&baseFrames), 4);
+    out.write(reinterpret_cast<const char*>(&factor), 4);
+    for (const std::deque<PeakBin>& level : levels) {
+        uint32_t binCount = level.size();
+        out.write(reinterpret_cast<const char*>(&binCount), 4);
+    }
+
+    for (const std::deque<PeakBin>& level : levels) {
+        for (const PeakBin& bin : level) {
+            short triple[3] = {bin.min, bin.max, bin.rms};
+            out.write(reinterpret_cast<const char*>(triple), sizeof(triple));
+        }
+    }
+
+    if (!out.good()) {
+        LOGE("Failed to write waveform sidecar: %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool WaveformIndex::loadLevel(const std::string& path, int level, std::vector<PeakBin>& bins) {
+    bins.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t rate = 0;
+    uint16_t channelCount = 0;
+    uint16_t levelCount = 0;
+    uint32_t baseFrames = 0;
+    uint32_t factor = 0;
+
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&rate), 4);
+    in.read(reinterpret_cast<char*>(&channelCount), 2);
+    in.read(reinterpret_cast<char*>(&levelCount), 2);
+    in.read(reinterpret_cast<char*>(&baseFrames), 4);
+    in.read(reinterpret_cast<char*>(&factor), 4);
+    if (!in.good() || memcmp(magic, SIDECAR_MAGIC, 4) != 0 || level < 0 || level >= levelCount) {
+        return false;
+    }
+
+    std::vector<uint32_t> binCounts(levelCount);
+    in.read(reinterpret_cast<char*>(binCounts.data()), levelCount * sizeof(uint32_t));
+
+    // Skip the finer levels
+    std::streamoff offset = 0;
+    for (int i = 0; i < level; i++) offset += binCounts[i] * 3 * sizeof(short);
+    in.seekg(offset, std::ios::cur);
+
+    std::vector<short> triples(binCounts[level] * 3);
+    in.read(reinterpret_cast<char*>(triples.data()), triples.size() * sizeof(short));
+    if (!in.good()) {
+        return false;
+    }
+
+    bins.resize(binCounts[level]);
+    for (size_t i = 0; i < bins.size(); i++) {
+        bins[i] = {triples[3 * i], triples[3 * i + 1], triples[3 * i + 2]};
+    }
+    return true;
+}
+
+std::string WaveformIndex::getSidecarPath(const std::string& wavPath) {
+    return replaceFileExtension(wavPath, SIDECAR_EXTENSION);
+}
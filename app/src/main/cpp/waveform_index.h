@@ -0,0 +1,74 @@
+#ifndef AUDIORECORDINGAPP_WAVEFORM_INDEX_H
+#define AUDIORECORDINGAPP_WAVEFORM_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "peak_kernels.h"
+
+// One summary bin of a waveform preview
+struct PeakBin {
+    short min;
+    short max;
+    short rms;
+};
+
+// Multi-resolution min/max/RMS summary of a recording, built incrementally
+// as capture blocks arrive. Level 0 summarises BASE_FRAMES_PER_BIN frames
+// per bin and each level above is LEVEL_FACTOR times coarser; coarser bins
+// are folded from finer ones, so their RMS is exact rather than averaged.
+//
+// Saved next to the WAV as a sidecar:
+//   "WPK1", sampleRate u32, channels u16, levelCount u16,
+//   baseFramesPerBin u32, levelFactor u32, binCount u32 x levelCount,
+//   then each level's bins as {min, max, rms} int16 triples
+class WaveformIndex {
+public:
+    static const int BASE_FRAMES_PER_BIN = 256;
+    static const int LEVEL_FACTOR = 4;
+    static const int LEVEL_COUNT = 6;
+
+private:
+    int sampleRate;
+    int channels;
+
+    // Bins are appended from the capture callback; a deque grows in fixed
+    // blocks and never moves what it already holds
+    std::deque<PeakBin> levels[LEVEL_COUNT];
+    PeakStats pending[LEVEL_COUNT];
+
+    size_t getSamplesPerBin(int level) const;
+    void completeBin(int level);
+
+public:
+    WaveformIndex(int sampleRate, int channels);
+
+    void reset();
+    void addSamples(const short* samples, size_t count);
+
+    // Closes the partial bin at every level; call once the take has ended
+    void finish();
+
+    bool save(const std::string& path) const;
+
+    size_t getBinCount(int level) const {
+        return levels[level].size();
+    }
+
+    const std::deque<PeakBin>& getLevel(int level) const {
+        return levels[level];
+    }
+
+    static int getFramesPerBin(int level);
+
+    // Reads one level of a saved sidecar without loading the others
+    static bool loadLevel(const std::string& path, int level, std::vector<PeakBin>& bins);
+
+    // "take.wav" -> "take.peaks"
+    static std::string getSidecarPath(const std::string& wavPath);
+};
+
+#endif // AUDIORECORDINGAPP_WAVEFORM_INDEX_H
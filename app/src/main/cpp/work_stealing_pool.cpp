@@ -0,0 +1,109 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+// Which pool and queue the current thread works for, so a task that
+// submits more work can put it on its own queue
+static thread_local const WorkStealingPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+WorkStealingPool::WorkStealingPool(int threadCount) {
+    size_t count = threadCount > 0 ? static_cast<size_t>(threadCount)
+                                   : std::max(1u, std::thread::hardware_concurrency());
+    workers.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        workers.emplace_back(new Worker());
+    }
+    // Every queue exists before any worker looks for one to steal from
+    for (size_t i = 0; i < count; i++) {
+        workers[i]->thread = std::thread(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::unique_ptr<Worker>& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    size_t index = currentPool == this ? currentWorker
+                                       : nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted before it is queued, so a sleeping worker that wakes for it
+    // at worst looks once too early
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(idleMutex);
+    allDone.wait(lock, [this] {
+        return unfinished.load(std::memory_order_acquire) == 0;
+    });
+}
+
+bool WorkStealingPool::takeTask(size_t index, Task& task) {
+    {
+        Worker& own = *workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < workers.size(); offset++) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            stealCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+
+    Task task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        workAvailable.wait(lock, [this] {
+            return stopping || queued.load(std::memory_order_relaxed) > 0;
+        });
+        if (stopping && queued.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef AUDIORECORDINGAPP_WORK_STEALING_POOL_H
+#define AUDIORECORDINGAPP_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for offline jobs, each with its own queue.
+// A worker runs its newest task first, so work a task submits from inside
+// the pool follows it on the same core while its data is still in cache;
+// a worker that runs dry takes the oldest task from another's queue.
+// Submissions from outside are dealt round-robin across the queues.
+//
+// Tasks are whole-file passes, milliseconds at least, so each queue is a
+// deque behind its own mutex rather than a lock-free one; workers only
+// contend when stealing.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<size_t> nextQueue{0};
+
+    // Tasks sitting in a queue, and tasks submitted but not yet finished
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> unfinished{0};
+    std::atomic<uint64_t> stealCount{0};
+
+    // Idle workers sleep here until a submit or shutdown
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    bool takeTask(size_t index, Task& task);
+
+public:
+    // |threadCount| of 0 or less uses every core
+    explicit WorkStealingPool(int threadCount);
+
+    // Runs whatever is still queued, then joins the workers
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Any thread, including a task running in this pool
+    void submit(Task task);
+
+    // Blocks until every task submitted so far, and every task those
+    // submit, has finished. Not from inside a task.
+    void wait();
+
+    bool isIdle() const {
+        return unfinished.load(std::memory_order_acquire) == 0;
+    }
+
+    size_t getThreadCount() const {
+        return workers.size();
+    }
+
+    // Tasks a worker took from another's queue
+    uint64_t getStealCount() const {
+        return stealCount.load(std::memory_order_relaxed);
+    }
+};
+
+#endif // AUDIORECORDINGAPP_WORK_STEALING_POOL_H
@@ -1,25 +1,450 @@
 package com.example.audiorecordingapp
 
+import android.os.Build
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
 class AudioRecorderNative {
     
     companion object {
         init {
             System.loadLibrary("audiorecordingapp")
         }
+        
+        // Output formats for startRecording
+        const val FORMAT_WAV = 0
+        const val FORMAT_FLAC = 1
+        
+        // Sample formats for configureRecorderFormat
+        const val SAMPLE_FORMAT_INT16 = 0
+        const val SAMPLE_FORMAT_INT24 = 1
+        const val SAMPLE_FORMAT_FLOAT = 2
+        
+        // Layout of each file's entry in the probeWavFiles result
+        const val PROBE_FIELDS = 5
+        const val PROBE_SAMPLE_RATE = 0
+        const val PROBE_CHANNELS = 1
+        const val PROBE_BITS_PER_SAMPLE = 2
+        const val PROBE_FRAME_COUNT = 3
+        const val PROBE_DURATION_MS = 4
+        
+        // Waveform sidecar: level 0 has 256 frames per bin, each level above is 4x coarser
+        const val WAVEFORM_LEVELS = 6
+        const val WAVEFORM_BASE_FRAMES_PER_BIN = 256
+        const val WAVEFORM_LEVEL_FACTOR = 4
+        
+        // Level meter values: linear peak and RMS (1.0 = full scale), clipped
+        // samples and blocks measured since the take or playback started
+        const val LEVEL_FIELDS = 4
+        const val LEVEL_PEAK = 0
+        const val LEVEL_RMS = 1
+        const val LEVEL_CLIP_COUNT = 2
+        const val LEVEL_BLOCK_COUNT = 3
+        
+        // Players mixed at once, each created with createPlayer()
+        const val MAX_PLAYERS = 8
+        
+        // Layout of getStats(): STATS_FIELDS longs for the recorder, then as
+        // many for the mixer's device stream, counted since the take started
+        // or the device stream last did
+        const val STATS_FIELDS = 39
+        const val STATS_CALLBACKS = 0
+        const val STATS_MAX_CALLBACK_US = 1
+        const val STATS_MAX_JITTER_US = 2
+        const val STATS_DROPPED_BLOCKS = 3
+        const val STATS_STARVED_BLOCKS = 4
+        const val STATS_WRITER_LAG_US = 5
+        const val STATS_MAX_WRITER_LAG_US = 6
+        // Callback duration and jitter histograms: bucket 0 counts values under
+        // 64 us, bucket i those in [32 << i, 64 << i) us, the last everything above
+        const val STATS_DURATION_BUCKETS = 7
+        const val STATS_JITTER_BUCKETS = 23
+        const val STATS_HISTOGRAM_BUCKETS = 16
+        
+        // Layout of each file's entry in getBatchResults(): BATCH_STATUS_*,
+        // integrated loudness in LUFS, gain applied in dB and the source's
+        // sample peak in dBFS; silence measures as negative infinity
+        const val BATCH_FIELDS = 4
+        const val BATCH_STATUS = 0
+        const val BATCH_LOUDNESS = 1
+        const val BATCH_GAIN_DB = 2
+        const val BATCH_PEAK_DB = 3
+        const val BATCH_STATUS_PENDING = 0
+        const val BATCH_STATUS_DONE = 1
+        const val BATCH_STATUS_FAILED = 2
+        const val BATCH_STATUS_CANCELLED = 3
+        // EBU R128 broadcast target; streaming services sit nearer -14 to -16
+        const val DEFAULT_TARGET_LUFS = -23.0f
+        
+        // Byte offsets into the openPcmTap() buffer: 32-bit header fields,
+        // then a ring of PCM_TAP_CAPACITY samples in the capture format from
+        // PCM_TAP_DATA on. Indices count samples and wrap at 2^32.
+        const val PCM_TAP_WRITE_INDEX = 0
+        const val PCM_TAP_READ_INDEX = 64
+        const val PCM_TAP_OVERFLOWS = 128
+        const val PCM_TAP_DROPPED_SAMPLES = 132
+        const val PCM_TAP_CAPACITY = 136
+        const val PCM_TAP_BYTES_PER_SAMPLE = 140
+        const val PCM_TAP_CHANNELS = 144
+        const val PCM_TAP_SAMPLE_RATE = 148
+        const val PCM_TAP_SAMPLE_FORMAT = 152
+        const val PCM_TAP_DATA = 192
+        
+        // Spectrogram frames are fftSize / 2 bytes, one per bin from DC up,
+        // linear in dB: 255 is a full-scale sine's bin, 0 is
+        // SPECTROGRAM_FLOOR_DB or below
+        const val SPECTROGRAM_FLOOR_DB = -100.0f
+        
+        @JvmStatic
+        private external fun readLevelWords(buffer: ByteBuffer, out: FloatArray): Boolean
+        
+        @JvmStatic
+        private external fun readPcmTapSamples(out: ByteArray): Int
+        
+        // The one tap open, so it can be closed before its memory goes
+        private var openTap: PcmTap? = null
+        
+        // Level buffers handed out, closed the same way: the recorder's, and
+        // each player's by handle - 1
+        private var recordLevels: LevelBuffer? = null
+        private val playLevels = arrayOfNulls<LevelBuffer>(MAX_PLAYERS)
+    }
+    
+    // Reader over a meter's memory from get*LevelBuffer(), without a JNI
+    // call. Like PcmTap, reads hold its lock, and releasing the player or
+    // cleanup() closes it under the same lock before the meter is freed.
+    class LevelBuffer internal constructor(buffer: ByteBuffer) {
+        private var buffer: ByteBuffer? = buffer.order(ByteOrder.nativeOrder())
+        
+        val isOpen: Boolean
+            @Synchronized get() = buffer != null
+        
+        // Fills LEVEL_FIELDS floats of out; false once closed or when the
+        // meter kept updating. The native side publishes under a sequence
+        // lock, so retry whenever the sequence was odd or changed while
+        // reading. The fences keep the payload reads between the two
+        // sequence reads; they need API 33, so older devices take the same
+        // snapshot through JNI.
+        @Synchronized
+        fun read(out: FloatArray): Boolean {
+            val words = buffer ?: return false
+            if (Build.VERSION.SDK_INT < Build.VERSION_CODES.TIRAMISU) {
+                return readLevelWords(words, out)
+            }
+            repeat(8) {
+                val before = words.getInt(0)
+                VarHandle.acquireFence()
+                if (before and 1 == 0) {
+                    val peak = words.getFloat(4)
+                    val rms = words.getFloat(8)
+                    val clips = words.getInt(12)
+                    val blocks = words.getInt(16)
+                    VarHandle.acquireFence()
+                    if (words.getInt(0) == before) {
+                        out[LEVEL_PEAK] = peak
+                        out[LEVEL_RMS] = rms
+                        out[LEVEL_CLIP_COUNT] = clips.toFloat()
+                        out[LEVEL_BLOCK_COUNT] = blocks.toFloat()
+                        return true
+                    }
+                }
+            }
+            return false
+        }
+        
+        @Synchronized
+        internal fun close() {
+            buffer = null
+        }
+    }
+    
+    // Reader over the openPcmTap() memory. Reads hold its lock, and
+    // closePcmTap(), a second openPcmTap() and cleanup() close it under the
+    // same lock before the native side frees the memory, so no read is in
+    // flight then and none reaches the memory after. Read header fields as
+    // PCM_TAP_* offsets with header().
+    class PcmTap internal constructor(buffer: ByteBuffer) {
+        private var buffer: ByteBuffer? = buffer.order(ByteOrder.nativeOrder())
+        
+        val isOpen: Boolean
+            @Synchronized get() = buffer != null
+        
+        // 0 once closed
+        @Synchronized
+        fun header(field: Int): Int = buffer?.getInt(field) ?: 0
+        
+        // Moves whatever the tap holds, up to out.size bytes of whole samples,
+        // into out and hands the space back to the audio thread. Returns the
+        // byte count, 0 once closed; allocates nothing, so it can run on every
+        // frame of a visualizer or an encoder's input loop. The indices are
+        // read with acquire and published with release fences, which need
+        // API 33; older devices do the same copy through JNI.
+        @Synchronized
+        fun read(out: ByteArray): Int {
+            val buffer = this.buffer ?: return 0
+            if (Build.VERSION.SDK_INT < Build.VERSION_CODES.TIRAMISU) {
+                return readPcmTapSamples(out)
+            }
+            
+            val bytesPerSample = buffer.getInt(PCM_TAP_BYTES_PER_SAMPLE)
+            val capacity = buffer.getInt(PCM_TAP_CAPACITY)
+            val read = buffer.getInt(PCM_TAP_READ_INDEX)
+            val written = buffer.getInt(PCM_TAP_WRITE_INDEX)
+            // No sample is read before the index that published it
+            VarHandle.acquireFence()
+            val count = minOf(written - read, out.size / bytesPerSample)
+            if (count <= 0) {
+                return 0
+            }
+            
+            val offset = read and (capacity - 1)
+            val firstPart = minOf(count, capacity - offset)
+            buffer.position(PCM_TAP_DATA + offset * bytesPerSample)
+            buffer.get(out, 0, firstPart * bytesPerSample)
+            buffer.position(PCM_TAP_DATA)
+            buffer.get(out, firstPart * bytesPerSample, (count - firstPart) * bytesPerSample)
+            // Nor is the space handed back before the copy is done
+            VarHandle.releaseFence()
+            buffer.putInt(PCM_TAP_READ_INDEX, read + count)
+            return count * bytesPerSample
+        }
+        
+        @Synchronized
+        internal fun close() {
+            buffer = null
+        }
     }
     
     // Recording functions
     external fun initializeRecorder(): Boolean
-    external fun startRecording(filePath: String): Boolean
+    // Capture queue depth and block size; more buffers tolerate longer stalls,
+    // smaller buffers lower latency. Only takes effect between recordings.
+    external fun configureRecorder(bufferCount: Int, framesPerBuffer: Int): Boolean
+    // Capture rate, channel count (1 or 2) and SAMPLE_FORMAT_*. FLAC output
+    // needs SAMPLE_FORMAT_INT16. Only takes effect between recordings.
+    external fun configureRecorderFormat(sampleRate: Int, channels: Int, sampleFormat: Int): Boolean
+    // Drops silent blocks before they are written: a block is kept when it is
+    // thresholdDb above the tracked noise floor or within hangoverMs of speech,
+    // with preRollMs of the audio before it. Only takes effect between recordings.
+    external fun configureVoiceActivity(enabled: Boolean, thresholdDb: Float, hangoverMs: Int, preRollMs: Int): Boolean
+    // Effects run on every captured block before it is metered, tapped or
+    // written: a high-pass at highPassHz (0 for none, else 10-1000 Hz), a
+    // noise gate, automatic gain toward agcTargetDb RMS and a peak limiter,
+    // in that order. Levels in dBFS. Takes effect at once, mid-take included.
+    external fun setCaptureEffects(highPassHz: Float, gateEnabled: Boolean, gateThresholdDb: Float,
+                                   agcEnabled: Boolean, agcTargetDb: Float, agcMaxGainDb: Float,
+                                   limiterEnabled: Boolean, limiterCeilingDb: Float): Boolean
+    // Keeps the microphone running between takes, holding the last preRollMs
+    // (up to 30 s) of input; the next startRecording() begins with it, with no
+    // gap and no device startup. Format and capture config are fixed while armed.
+    external fun armRecorder(preRollMs: Int): Boolean
+    external fun disarmRecorder()
+    external fun isRecorderArmed(): Boolean
+    external fun getInputLatencyMs(): Float
+    // Last start call as [cold (1) or warm (0), setup ms, ms until first buffer callback]
+    external fun getRecordStartLatency(): FloatArray
+    // Fills LEVEL_FIELDS floats with the latest capture level; never blocks the audio thread
+    external fun getRecordLevels(levels: FloatArray): Boolean
+    // Reader over the same meter; reads nothing once cleanup() has run
+    fun getRecordLevelBuffer(): LevelBuffer? {
+        recordLevels?.let { if (it.isOpen) return it }
+        val buffer = getRecordLevelWords() ?: return null
+        return LevelBuffer(buffer).also { recordLevels = it }
+    }
+    
+    private external fun getRecordLevelWords(): ByteBuffer?
+    // Live copy of the captured samples while armed or recording, for
+    // visualizers and streaming encoders. Holds capacityMs (up to 60 s) of
+    // audio, and blocks that do not fit are dropped and counted in
+    // PCM_TAP_OVERFLOWS. The tap reads nothing once closePcmTap(), another
+    // openPcmTap() or cleanup() has closed it, and the format is fixed while
+    // it is open.
+    fun openPcmTap(capacityMs: Int): PcmTap? {
+        closePcmTap()
+        val buffer = openPcmTapBuffer(capacityMs) ?: return null
+        return PcmTap(buffer).also { openTap = it }
+    }
+    
+    fun closePcmTap() {
+        openTap?.close()
+        openTap = null
+        closePcmTapBuffer()
+    }
+    
+    private external fun openPcmTapBuffer(capacityMs: Int): ByteBuffer?
+    private external fun closePcmTapBuffer()
+    // Live spectrogram of the capture while armed or recording, mixed down to
+    // mono: a Hann window of fftSize frames (a power of two, 64-8192) every
+    // hopSize frames. Frames not read within about 2 s are dropped. The format
+    // is fixed while it is open.
+    external fun openSpectrogram(fftSize: Int, hopSize: Int): Boolean
+    // Copies as many whole frames as are ready and fit into out, oldest
+    // first, and returns how many; allocates nothing
+    external fun readSpectrogram(out: ByteArray): Int
+    external fun closeSpectrogram()
+    // format is FORMAT_WAV or FORMAT_FLAC (lossless, roughly half the size)
+    external fun startRecording(filePath: String, format: Int): Boolean
     external fun stopRecording(): Boolean
     external fun isRecording(): Boolean
     
-    // Playback functions
+    // Playback functions. Every player is a session in one native mixer, so
+    // up to MAX_PLAYERS files can play at once, each with its own gain.
+    // Call initializePlayer() first, then createPlayer() for a handle that
+    // the per-player calls take; 0 means no player could be created.
     external fun initializePlayer(): Boolean
-    external fun loadAudioFile(filePath: String): Boolean
-    external fun startPlayback(): Boolean
-    external fun stopPlayback(): Boolean
-    external fun isPlaying(): Boolean
+    external fun createPlayer(): Int
+    // Stops the player and frees its slot; the handle is invalid afterwards,
+    // and its level buffer reads nothing
+    fun releasePlayer(player: Int) {
+        if (player in 1..MAX_PLAYERS) {
+            playLevels[player - 1]?.close()
+            playLevels[player - 1] = null
+        }
+        releasePlayerNative(player)
+    }
+    
+    private external fun releasePlayerNative(player: Int)
+    external fun loadAudioFile(player: Int, filePath: String): Boolean
+    // Device mixer rate; every player resamples natively to it. Only while
+    // nothing is playing.
+    external fun setPlaybackSampleRate(sampleRate: Int): Boolean
+    // Linear, 0 to 1; takes effect within one mixer buffer
+    external fun setPlayerGain(player: Int, gain: Float): Boolean
+    // 0.5 to 3, at the same pitch; any time, playing or not. Changes while
+    // playing follow within about 10 ms with no break, except the first
+    // away from 1, which restarts the playback where it is.
+    external fun setPlaybackSpeed(player: Int, speed: Float): Boolean
+    external fun startPlayback(player: Int): Boolean
+    external fun stopPlayback(player: Int): Boolean
+    // Constant time for any file length. While stopped, sets where the next
+    // startPlayback() begins; playback otherwise starts from the top.
+    external fun seekTo(player: Int, positionMs: Long): Boolean
+    // Position of the audio last handed to the mixer; 0 once playback ends
+    external fun getPositionMs(player: Int): Long
+    external fun getDurationMs(player: Int): Long
+    external fun isPlaying(player: Int): Boolean
+    external fun getPlayStartLatency(player: Int): FloatArray
+    external fun getPlayLevels(player: Int, levels: FloatArray): Boolean
+    // Reader over the player's meter; reads nothing once the player is
+    // released or cleanup() has run
+    fun getPlayLevelBuffer(player: Int): LevelBuffer? {
+        if (player !in 1..MAX_PLAYERS) {
+            return null
+        }
+        playLevels[player - 1]?.let { if (it.isOpen) return it }
+        val buffer = getPlayLevelWords(player) ?: return null
+        return LevelBuffer(buffer).also { playLevels[player - 1] = it }
+    }
+    
+    private external fun getPlayLevelWords(player: Int): ByteBuffer?
+    
+    // Plays filePaths back to back with no gap: the next file is opened and
+    // read ahead while one plays, and the player moves into it at the exact
+    // sample. A file in another format restarts the device in between, and
+    // unreadable files are skipped. Call startPlayback() to begin; loading
+    // anything else or stopping ends the queue. The listener is called on a
+    // native thread and must not release the player.
+    external fun setPlayQueue(player: Int, filePaths: Array<String>, listener: PlaybackQueueListener?): Boolean
+    // Index in filePaths of the file playing
+    external fun getPlayQueueIndex(player: Int): Int
+    
+    interface PlaybackQueueListener {
+        // From the file's first sample, within about 10 ms
+        fun onTrackStarted(index: Int)
+        fun onQueueFinished()
+    }
+    
+    // Audio path counters and callback histograms for the recorder and the
+    // mixer's device stream, laid out as STATS_*; lock-free, safe to poll
+    // while running
+    external fun getStats(): LongArray
+    // STATS_FIELDS longs for one player's own render calls and starved blocks
+    external fun getPlayerStats(player: Int): LongArray
+    
+    // Finishes WAV takes in directory that were cut short by the app dying
+    // mid-recording, keeping everything up to the last commit (every 2 s of
+    // audio) and usually all of it; call it on launch, before recording, off
+    // the main thread. Returns the paths of the takes that came back.
+    external fun recoverRecordings(directory: String): Array<String>
+    
+    // Non-destructive editing: an edit list is an ordered set of ranges over
+    // WAV takes of one rate, channel count and sample format. Edits only
+    // change the list, whatever the take lengths. Handles are 0 on failure
+    // and positions are on the list's own timeline.
+    external fun createEditList(): Int
+    external fun releaseEditList(editList: Int)
+    // Adds durationMs of filePath from startMs to the end; a negative
+    // duration runs to the end of the take
+    external fun editListAppend(editList: Int, filePath: String, startMs: Long, durationMs: Long): Boolean
+    // Adds every range of another list to the end
+    external fun editListJoin(editList: Int, other: Int): Boolean
+    // Removes a stretch and closes the gap
+    external fun editListCut(editList: Int, startMs: Long, durationMs: Long): Boolean
+    // Keeps only the given stretch
+    external fun editListTrim(editList: Int, startMs: Long, durationMs: Long): Boolean
+    // Moves everything from positionMs on into a new list and returns it
+    external fun editListSplit(editList: Int, positionMs: Long): Int
+    // Equal-power fade centred on each join, into audio the edit cut away;
+    // 0 for hard cuts
+    external fun setEditListCrossfade(editList: Int, crossfadeMs: Int)
+    external fun getEditListDurationMs(editList: Int): Long
+    external fun saveEditList(editList: Int, filePath: String): Boolean
+    // Fails if a source take is gone or shorter than the list needs
+    external fun loadEditList(filePath: String): Int
+    // Writes the list out as a new WAV, which must not be one of its
+    // sources. Off the main thread; ranges are copied as they are and only
+    // the crossfades are processed, so it takes about as long as a file copy.
+    external fun renderEditList(editList: Int, outputPath: String): Boolean
+    // Plays the list as it stands, straight from its sources; later edits
+    // need another load
+    external fun loadPlayerEditList(player: Int, editList: Int): Boolean
+    
+    // Header probe for WAV and FLAC: reads only the start of each file, in parallel.
+    // Returns PROBE_FIELDS longs per path; all zero for unreadable files.
+    external fun probeWavFiles(filePaths: Array<String>): LongArray
+    
+    // Library batch job on every core: each input's EBU R128 integrated
+    // loudness is measured and, with outputPaths, it is rewritten at the
+    // gain that brings it to targetLufs (held 1 dB under full scale) when
+    // normalize is set, as outputFormat (FORMAT_*) in sampleFormat
+    // (SAMPLE_FORMAT_*, or -1 to keep the source's). An output path may be
+    // its input; it is only replaced once complete. Files stream through
+    // with fixed memory whatever their length. One job at a time; returns
+    // at once, then poll getBatchProgress() (0 to 1, -1 without a job).
+    external fun startBatchJob(inputPaths: Array<String>, outputPaths: Array<String>?, normalize: Boolean,
+                               targetLufs: Float, outputFormat: Int, sampleFormat: Int): Boolean
+    external fun getBatchProgress(): Float
+    external fun isBatchJobFinished(): Boolean
+    // Skips files not yet started and abandons those in progress at their
+    // next block, leaving their originals alone
+    external fun cancelBatchJob()
+    // BATCH_FIELDS floats per input, in order
+    external fun getBatchResults(): FloatArray?
+    
+    // Waveform preview saved at the end of a take, as [min, max, rms] per bin
+    external fun getWaveform(filePath: String, level: Int): ShortArray
+    
+    // Spectrogram of a whole WAV or FLAC file in columns frames, each the mean
+    // of its share of the file, for a preview across the screen; streams the
+    // file through in fixed memory. Blocks, so call it off the main thread.
+    external fun analyzeSpectrogram(filePath: String, fftSize: Int, columns: Int): ByteArray?
+    
+    // Kept stretches of a take recorded with voice activity on, as
+    // [captureFrame, fileFrame, frameCount] per segment; empty otherwise
+    external fun getVoiceSegments(filePath: String): LongArray
+    
+    fun cleanup() {
+        openTap?.close()
+        openTap = null
+        recordLevels?.close()
+        recordLevels = null
+        for (index in playLevels.indices) {
+            playLevels[index]?.close()
+            playLevels[index] = null
+        }
+        cleanupNative()
+    }
     
-    external fun cleanup()
+    private external fun cleanupNative()
 }
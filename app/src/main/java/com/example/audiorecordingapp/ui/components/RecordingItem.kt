@@ -1,5 +1,6 @@
 package com.example.audiorecordingapp.ui.components
 
+import androidx.compose.foundation.Canvas
 import androidx.compose.foundation.layout.*
 import androidx.compose.material.icons.Icons
 import androidx.compose.material.icons.filled.Delete
@@ -9,6 +10,7 @@ import androidx.compose.material3.*
 import androidx.compose.runtime.*
 import androidx.compose.ui.Alignment
 import androidx.compose.ui.Modifier
+import androidx.compose.ui.geometry.Offset
 import androidx.compose.ui.graphics.Color
 import androidx.compose.ui.text.font.FontWeight
 import androidx.compose.ui.text.style.TextOverflow
@@ -21,8 +23,11 @@ import java.util.*
 @Composable
 fun RecordingItem(
     recording: Recording,
+    waveform: ShortArray,
     isPlaying: Boolean,
+    positionMs: Long,
     onPlayClick: () -> Unit,
+    onSeek: (Long) -> Unit,
     onDeleteClick: () -> Unit,
     formatDuration: (Long) -> String,
     formatFileSize: (Long) -> String,
@@ -85,6 +90,36 @@ fun RecordingItem(
                     )
                 }
                 
+                if (waveform.isNotEmpty()) {
+                    Spacer(modifier = Modifier.height(6.dp))
+                    
+                    WaveformPreview(
+                        waveform = waveform,
+                        color = MaterialTheme.colorScheme.primary,
+                        modifier = Modifier
+                            .fillMaxWidth()
+                            .height(24.dp)
+                    )
+                }
+                
+                // Follows playback, and seeks where it is let go
+                if (isPlaying && recording.duration > 0) {
+                    var dragPosition by remember { mutableStateOf<Float?>(null) }
+                    val duration = recording.duration.toFloat()
+                    Slider(
+                        value = dragPosition ?: positionMs.toFloat().coerceIn(0f, duration),
+                        onValueChange = { dragPosition = it },
+                        onValueChangeFinished = {
+                            dragPosition?.let { onSeek(it.toLong()) }
+                            dragPosition = null
+                        },
+                        valueRange = 0f..duration,
+                        modifier = Modifier
+                            .fillMaxWidth()
+                            .height(24.dp)
+                    )
+                }
+                
                 Spacer(modifier = Modifier.height(2.dp))
                 
                 Text(
@@ -138,6 +173,33 @@ fun RecordingItem(
     }
 }
 
+// One vertical line per bin from its min to its max sample
+@Composable
+private fun WaveformPreview(
+    waveform: ShortArray,
+    color: Color,
+    modifier: Modifier = Modifier
+) {
+    Canvas(modifier = modifier) {
+        val bins = waveform.size / 3
+        val step = size.width / bins
+        val middle = size.height / 2
+        val scale = middle / 32768f
+        
+        for (i in 0 until bins) {
+            val x = i * step + step / 2
+            val top = middle - waveform[3 * i + 1] * scale
+            val bottom = middle - waveform[3 * i] * scale
+            drawLine(
+                color = color,
+                start = Offset(x, top),
+                end = Offset(x, bottom),
+                strokeWidth = maxOf(1f, step * 0.6f)
+            )
+        }
+    }
+}
+
 private fun formatDate(date: Date): String {
     val formatter = SimpleDateFormat("MMM dd, yyyy 'at' HH:mm", Locale.getDefault())
     return formatter.format(date)
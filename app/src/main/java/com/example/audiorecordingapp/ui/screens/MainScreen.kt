@@ -32,8 +32,13 @@ fun MainScreen(
     val isRecording by viewModel.isRecording.collectAsState()
     val recordings by viewModel.recordings.collectAsState()
     val recordingTime by viewModel.recordingTime.collectAsState()
+    val inputLevel by viewModel.inputLevel.collectAsState()
     val isPlaying by viewModel.isPlaying.collectAsState()
     val currentPlayingId by viewModel.currentPlayingId.collectAsState()
+    val playbackPosition by viewModel.playbackPosition.collectAsState()
+    val playbackSpeed by viewModel.playbackSpeed.collectAsState()
+    val skipSilence by viewModel.skipSilence.collectAsState()
+    val preRollSeconds by viewModel.preRollSeconds.collectAsState()
     
     LaunchedEffect(Unit) {
         if (!permissionsState.allPermissionsGranted) {
@@ -66,8 +71,13 @@ fun MainScreen(
             RecordingControls(
                 isRecording = isRecording,
                 recordingTime = recordingTime,
+                inputLevel = inputLevel,
+                skipSilence = skipSilence,
+                preRollSeconds = preRollSeconds,
                 onStartRecording = { viewModel.startRecording() },
                 onStopRecording = { viewModel.stopRecording() },
+                onSkipSilenceChange = { enabled -> viewModel.setSkipSilence(enabled) },
+                onPreRollChange = { seconds -> viewModel.setPreRollSeconds(seconds) },
                 modifier = Modifier.padding(bottom = 32.dp)
             )
             
@@ -76,9 +86,15 @@ fun MainScreen(
                 recordings = recordings,
                 isPlaying = isPlaying,
                 currentPlayingId = currentPlayingId,
+                playbackPosition = playbackPosition,
+                playbackSpeed = playbackSpeed,
                 onPlayRecording = { recording -> viewModel.playRecording(recording) },
+                onPlayAll = { viewModel.playAll(recordings) },
                 onStopPlayback = { viewModel.stopPlayback() },
+                onSeek = { positionMs -> viewModel.seekPlayback(positionMs) },
+                onSpeedChange = { speed -> viewModel.setPlaybackSpeed(speed) },
                 onDeleteRecording = { recording -> viewModel.deleteRecording(recording) },
+                loadWaveform = { recording -> viewModel.loadWaveform(recording) },
                 formatDuration = { duration -> viewModel.formatDuration(duration) },
                 formatFileSize = { size -> viewModel.formatFileSize(size) }
             )
@@ -125,8 +141,13 @@ fun PermissionRequestCard(
 fun RecordingControls(
     isRecording: Boolean,
     recordingTime: Long,
+    inputLevel: Float,
+    skipSilence: Boolean,
+    preRollSeconds: Int,
     onStartRecording: () -> Unit,
     onStopRecording: () -> Unit,
+    onSkipSilenceChange: (Boolean) -> Unit,
+    onPreRollChange: (Int) -> Unit,
     modifier: Modifier = Modifier
 ) {
     Card(
@@ -144,7 +165,16 @@ fun RecordingControls(
                     fontSize = 32.sp,
                     fontWeight = FontWeight.Bold,
                     color = MaterialTheme.colorScheme.primary,
-                    modifier = Modifier.padding(bottom = 16.dp)
+                    modifier = Modifier.padding(bottom = 8.dp)
+                )
+                
+                // Input level meter, red once the signal reaches full scale
+                LinearProgressIndicator(
+                    progress = { inputLevel.coerceIn(0f, 1f) },
+                    color = if (inputLevel >= 1f) Color.Red else MaterialTheme.colorScheme.primary,
+                    modifier = Modifier
+                        .fillMaxWidth()
+                        .padding(bottom = 16.dp)
                 )
             }
             
@@ -173,28 +203,115 @@ fun RecordingControls(
                 fontSize = 16.sp,
                 modifier = Modifier.padding(top = 16.dp)
             )
+            
+            // Take options, fixed while a take is running
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                modifier = Modifier
+                    .fillMaxWidth()
+                    .padding(top = 16.dp)
+            ) {
+                Text(
+                    text = "Skip silence",
+                    fontSize = 14.sp,
+                    modifier = Modifier.weight(1f)
+                )
+                Switch(
+                    checked = skipSilence,
+                    onCheckedChange = onSkipSilenceChange,
+                    enabled = !isRecording
+                )
+            }
+            
+            // Seconds from before the tap that a take starts with
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                horizontalArrangement = Arrangement.spacedBy(8.dp),
+                modifier = Modifier.fillMaxWidth()
+            ) {
+                Text(
+                    text = "Pre-roll",
+                    fontSize = 14.sp,
+                    modifier = Modifier.weight(1f)
+                )
+                PRE_ROLL_CHOICES.forEach { seconds ->
+                    FilterChip(
+                        selected = preRollSeconds == seconds,
+                        onClick = { onPreRollChange(seconds) },
+                        enabled = !isRecording,
+                        label = { Text(if (seconds == 0) "Off" else "$seconds s") }
+                    )
+                }
+            }
         }
     }
 }
 
+private val PRE_ROLL_CHOICES = listOf(0, 5, 10)
+
+private val SPEED_CHOICES = listOf(0.75f, 1.0f, 1.5f, 2.0f)
+
 @Composable
 fun RecordingsList(
     recordings: List<Recording>,
     isPlaying: Boolean,
     currentPlayingId: Long?,
+    playbackPosition: Long,
+    playbackSpeed: Float,
     onPlayRecording: (Recording) -> Unit,
+    onPlayAll: () -> Unit,
     onStopPlayback: () -> Unit,
+    onSeek: (Long) -> Unit,
+    onSpeedChange: (Float) -> Unit,
     onDeleteRecording: (Recording) -> Unit,
+    loadWaveform: suspend (Recording) -> ShortArray,
     formatDuration: (Long) -> String,
     formatFileSize: (Long) -> String
 ) {
     Column {
-        Text(
-            text = "Recordings (${recordings.size})",
-            fontSize = 20.sp,
-            fontWeight = FontWeight.Bold,
-            modifier = Modifier.padding(bottom = 16.dp)
-        )
+        Row(
+            verticalAlignment = Alignment.CenterVertically,
+            modifier = Modifier
+                .fillMaxWidth()
+                .padding(bottom = 8.dp)
+        ) {
+            Text(
+                text = "Recordings (${recordings.size})",
+                fontSize = 20.sp,
+                fontWeight = FontWeight.Bold,
+                modifier = Modifier.weight(1f)
+            )
+            // Back to back with no gap between takes
+            if (recordings.isNotEmpty()) {
+                TextButton(onClick = if (isPlaying) onStopPlayback else onPlayAll) {
+                    Text(if (isPlaying) "Stop" else "Play all")
+                }
+            }
+        }
+        
+        // Same pitch at any speed; kept for later playbacks
+        if (recordings.isNotEmpty()) {
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                horizontalArrangement = Arrangement.spacedBy(8.dp),
+                modifier = Modifier
+                    .fillMaxWidth()
+                    .padding(bottom = 8.dp)
+            ) {
+                Text(
+                    text = "Speed",
+                    fontSize = 14.sp,
+                    modifier = Modifier.weight(1f)
+                )
+                SPEED_CHOICES.forEach { speed ->
+                    FilterChip(
+                        selected = playbackSpeed == speed,
+                        onClick = { onSpeedChange(speed) },
+                        label = { Text("${speed}x") }
+                    )
+                }
+            }
+        }
         
         if (recordings.isEmpty()) {
             Card(
@@ -213,9 +330,15 @@ fun RecordingsList(
                 verticalArrangement = Arrangement.spacedBy(8.dp)
             ) {
                 items(recordings) { recording ->
+                    val waveform by produceState(ShortArray(0), recording.id) {
+                        value = loadWaveform(recording)
+                    }
                     RecordingItem(
                         recording = recording,
+                        waveform = waveform,
                         isPlaying = isPlaying && currentPlayingId == recording.id,
+                        positionMs = playbackPosition,
+                        onSeek = onSeek,
                         onPlayClick = {
                             if (isPlaying && currentPlayingId == recording.id) {
                                 onStopPlayback()
@@ -2,7 +2,7 @@ package com.example.audiorecordingapp.viewmodel
 
 import android.app.Application
 import android.content.Context
-import android.media.MediaMetadataRetriever
+import android.media.AudioManager
 import android.util.Log
 import androidx.lifecycle.AndroidViewModel
 import androidx.lifecycle.viewModelScope
@@ -10,10 +10,12 @@ import com.example.audiorecordingapp.AudioRecorderNative
 import com.example.audiorecordingapp.data.Recording
 import com.example.audiorecordingapp.data.RecordingDatabase
 import com.example.audiorecordingapp.repository.RecordingRepository
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.flow.MutableStateFlow
 import kotlinx.coroutines.flow.StateFlow
 import kotlinx.coroutines.flow.asStateFlow
 import kotlinx.coroutines.launch
+import kotlinx.coroutines.withContext
 import java.io.File
 import java.text.SimpleDateFormat
 import java.util.*
@@ -35,9 +37,40 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
     private val _currentPlayingId = MutableStateFlow<Long?>(null)
     val currentPlayingId: StateFlow<Long?> = _currentPlayingId.asStateFlow()
     
+    // Position of the playing recording, in ms
+    private val _playbackPosition = MutableStateFlow(0L)
+    val playbackPosition: StateFlow<Long> = _playbackPosition.asStateFlow()
+    
+    private val _playbackSpeed = MutableStateFlow(1.0f)
+    val playbackSpeed: StateFlow<Float> = _playbackSpeed.asStateFlow()
+    
     private val _recordingTime = MutableStateFlow(0L)
     val recordingTime: StateFlow<Long> = _recordingTime.asStateFlow()
     
+    // Peak input level of the latest capture block, 0..1
+    private val _inputLevel = MutableStateFlow(0f)
+    val inputLevel: StateFlow<Float> = _inputLevel.asStateFlow()
+    
+    // Output format for new takes, AudioRecorderNative.FORMAT_WAV or FORMAT_FLAC
+    var outputFormat = AudioRecorderNative.FORMAT_WAV
+    
+    // Leaves silence between speech out of new takes; kept stretches are
+    // listed in a .cues file next to the recording
+    private val _skipSilence = MutableStateFlow(false)
+    val skipSilence: StateFlow<Boolean> = _skipSilence.asStateFlow()
+    
+    // Seconds from before record was pressed that each new take starts
+    // with; 0 when off
+    private val _preRollSeconds = MutableStateFlow(0)
+    val preRollSeconds: StateFlow<Int> = _preRollSeconds.asStateFlow()
+    
+    // Device's native rate, used for new takes and playback
+    private val nativeSampleRate = getNativeSampleRate(application)
+    
+    // Native player session for the recordings list; others can share the
+    // mixer alongside it
+    private var player = 0
+    
     private var recordingStartTime = 0L
     private var currentRecordingPath: String? = null
     
@@ -49,8 +82,37 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         audioRecorder.initializeRecorder()
         audioRecorder.initializePlayer()
         
+        // Capture and play at the device's native rate so the system
+        // mixer doesn't resample; playback converts other files itself
+        audioRecorder.configureRecorderFormat(
+            nativeSampleRate, 1, AudioRecorderNative.SAMPLE_FORMAT_INT16
+        )
+        audioRecorder.setPlaybackSampleRate(nativeSampleRate)
+        player = audioRecorder.createPlayer()
+        
         // Load existing recordings
         loadRecordings()
+        recoverInterruptedRecordings()
+    }
+    
+    private fun getNativeSampleRate(context: Context): Int {
+        val audioManager = context.getSystemService(Context.AUDIO_SERVICE) as AudioManager
+        return audioManager.getProperty(AudioManager.PROPERTY_OUTPUT_SAMPLE_RATE)?.toIntOrNull() ?: 44100
+    }
+    
+    // Takes left unfinished when the app was killed mid-recording never
+    // reached the database; finish them and add them now
+    private fun recoverInterruptedRecordings() {
+        viewModelScope.launch {
+            val recordingsDir = File(getApplication<Application>().filesDir, "recordings")
+            val recovered = withContext(Dispatchers.IO) {
+                audioRecorder.recoverRecordings(recordingsDir.absolutePath)
+            }
+            recovered.forEach { path ->
+                Log.d("RecordingViewModel", "Recovered interrupted recording: $path")
+                saveRecordingToDatabase(path)
+            }
+        }
     }
     
     private fun loadRecordings() {
@@ -66,7 +128,8 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         
         try {
             val timestamp = SimpleDateFormat("yyyyMMdd_HHmmss", Locale.getDefault()).format(Date())
-            val fileName = "recording_$timestamp.wav"
+            val extension = if (outputFormat == AudioRecorderNative.FORMAT_FLAC) "flac" else "wav"
+            val fileName = "recording_$timestamp.$extension"
             val recordingsDir = File(getApplication<Application>().filesDir, "recordings")
             if (!recordingsDir.exists()) {
                 recordingsDir.mkdirs()
@@ -75,10 +138,11 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
             val filePath = File(recordingsDir, fileName).absolutePath
             currentRecordingPath = filePath
             
-            if (audioRecorder.startRecording(filePath)) {
+            if (audioRecorder.startRecording(filePath, outputFormat)) {
                 _isRecording.value = true
                 recordingStartTime = System.currentTimeMillis()
                 startRecordingTimer()
+                startLevelMeter()
                 Log.d("RecordingViewModel", "Recording started: $filePath")
             } else {
                 Log.e("RecordingViewModel", "Failed to start recording")
@@ -109,6 +173,25 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         }
     }
     
+    // Only between takes
+    fun setSkipSilence(enabled: Boolean) {
+        if (!_isRecording.value && audioRecorder.configureVoiceActivity(enabled, 12f, 400, 200)) {
+            _skipSilence.value = enabled
+        }
+    }
+    
+    // Keeps the microphone listening between takes; 0 turns it off. Only
+    // between takes.
+    fun setPreRollSeconds(seconds: Int) {
+        if (_isRecording.value) return
+        if (seconds > 0 && audioRecorder.armRecorder(seconds * 1000)) {
+            _preRollSeconds.value = seconds
+        } else {
+            audioRecorder.disarmRecorder()
+            _preRollSeconds.value = 0
+        }
+    }
+    
     private fun startRecordingTimer() {
         viewModelScope.launch {
             while (_isRecording.value) {
@@ -118,6 +201,19 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         }
     }
     
+    private fun startLevelMeter() {
+        viewModelScope.launch {
+            val levels = FloatArray(AudioRecorderNative.LEVEL_FIELDS)
+            while (_isRecording.value) {
+                if (audioRecorder.getRecordLevels(levels)) {
+                    _inputLevel.value = levels[AudioRecorderNative.LEVEL_PEAK]
+                }
+                kotlinx.coroutines.delay(50)
+            }
+            _inputLevel.value = 0f
+        }
+    }
+    
     private fun saveRecordingToDatabase(filePath: String) {
         viewModelScope.launch {
             try {
@@ -147,11 +243,8 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
     
     private fun getAudioDuration(filePath: String): Long {
         return try {
-            val retriever = MediaMetadataRetriever()
-            retriever.setDataSource(filePath)
-            val duration = retriever.extractMetadata(MediaMetadataRetriever.METADATA_KEY_DURATION)
-            retriever.release()
-            duration?.toLongOrNull() ?: 0L
+            val probe = audioRecorder.probeWavFiles(arrayOf(filePath))
+            probe[AudioRecorderNative.PROBE_DURATION_MS]
         } catch (e: Exception) {
             Log.e("RecordingViewModel", "Error getting audio duration", e)
             0L
@@ -166,6 +259,8 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
                 if (file.exists()) {
                     file.delete()
                 }
+                File(file.parentFile, "${file.nameWithoutExtension}.peaks").delete()
+                File(file.parentFile, "${file.nameWithoutExtension}.cues").delete()
                 
                 // Delete from database
                 repository.deleteRecording(recording)
@@ -176,6 +271,21 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         }
     }
     
+    // Picks the finest zoom level that still fits in about maxBins bins; older
+    // takes may be at another rate, which only shifts the level choice
+    suspend fun loadWaveform(recording: Recording, maxBins: Int = 96): ShortArray {
+        val frames = recording.duration * nativeSampleRate / 1000
+        var level = 0
+        var framesPerBin = AudioRecorderNative.WAVEFORM_BASE_FRAMES_PER_BIN.toLong()
+        while (level < AudioRecorderNative.WAVEFORM_LEVELS - 1 && frames / framesPerBin > maxBins) {
+            level++
+            framesPerBin *= AudioRecorderNative.WAVEFORM_LEVEL_FACTOR
+        }
+        return withContext(Dispatchers.IO) {
+            audioRecorder.getWaveform(recording.filePath, level)
+        }
+    }
+    
     fun formatDuration(duration: Long): String {
         val seconds = (duration / 1000) % 60
         val minutes = (duration / (1000 * 60)) % 60
@@ -196,8 +306,8 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
                     stopPlayback()
                 }
                 
-                if (audioRecorder.loadAudioFile(recording.filePath)) {
-                    if (audioRecorder.startPlayback()) {
+                if (audioRecorder.loadAudioFile(player, recording.filePath)) {
+                    if (audioRecorder.startPlayback(player)) {
                         _isPlaying.value = true
                         _currentPlayingId.value = recording.id
                         Log.d("RecordingViewModel", "Started playing: ${recording.name}")
@@ -216,9 +326,51 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         }
     }
     
+    // Plays the recordings one after another with no gap between them
+    fun playAll(recordings: List<Recording>) {
+        viewModelScope.launch {
+            try {
+                if (_isPlaying.value) {
+                    stopPlayback()
+                }
+                
+                // Called on a native thread; the state flows take that
+                val listener = object : AudioRecorderNative.PlaybackQueueListener {
+                    override fun onTrackStarted(index: Int) {
+                        _currentPlayingId.value = recordings[index].id
+                    }
+                    
+                    override fun onQueueFinished() {
+                        _isPlaying.value = false
+                        _currentPlayingId.value = null
+                    }
+                }
+                
+                val paths = recordings.map { it.filePath }.toTypedArray()
+                if (audioRecorder.setPlayQueue(player, paths, listener) && audioRecorder.startPlayback(player)) {
+                    _isPlaying.value = true
+                    _currentPlayingId.value = recordings[audioRecorder.getPlayQueueIndex(player)].id
+                    Log.d("RecordingViewModel", "Started playing ${recordings.size} recordings")
+                    
+                    // The end comes from the listener, since the player can
+                    // pause between files of different formats
+                    while (_isPlaying.value) {
+                        _playbackPosition.value = audioRecorder.getPositionMs(player)
+                        kotlinx.coroutines.delay(100)
+                    }
+                    _playbackPosition.value = 0
+                } else {
+                    Log.e("RecordingViewModel", "Failed to start the play queue")
+                }
+            } catch (e: Exception) {
+                Log.e("RecordingViewModel", "Error playing recordings", e)
+            }
+        }
+    }
+    
     fun stopPlayback() {
         try {
-            if (audioRecorder.stopPlayback()) {
+            if (audioRecorder.stopPlayback(player)) {
                 _isPlaying.value = false
                 _currentPlayingId.value = null
                 Log.d("RecordingViewModel", "Playback stopped")
@@ -228,10 +380,25 @@ class RecordingViewModel(application: Application) : AndroidViewModel(applicatio
         }
     }
     
+    // Faster or slower at the same pitch, carried over to later playbacks
+    fun setPlaybackSpeed(speed: Float) {
+        if (audioRecorder.setPlaybackSpeed(player, speed)) {
+            _playbackSpeed.value = speed
+        }
+    }
+    
+    fun seekPlayback(positionMs: Long) {
+        if (audioRecorder.seekTo(player, positionMs)) {
+            _playbackPosition.value = positionMs
+        }
+    }
+    
     private fun monitorPlayback() {
         viewModelScope.launch {
             while (_isPlaying.value) {
-                if (!audioRecorder.isPlaying()) {
+                _playbackPosition.value = audioRecorder.getPositionMs(player)
+                if (!audioRecorder.isPlaying(player)) {
+                    _playbackPosition.value = 0
                     _isPlaying.value = false
                     _currentPlayingId.value = null
                     Log.d("RecordingViewModel", "Playback completed")
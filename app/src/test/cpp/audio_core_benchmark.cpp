@@ -0,0 +1,197 @@
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "audio_stats.h"
+#include "fake_audio_backend.h"
+#include "test_util.h"
+#include "wav_file.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Host benchmarks for the portable audio core, driven by the fake backend:
+// capture throughput through the recorder and WAV writer, raw WAV write and
+// read speed, the cost of individual capture and render callbacks, what
+// the callback instrumentation adds to each one, and starting a take from
+// standby with the held input.
+
+static const int SAMPLE_RATE = 44100;
+static const char* BENCH_FILE = "audio_core_benchmark.wav";
+
+static void printCallbackTimes(const char* name, std::vector<double> seconds) {
+    if (seconds.empty()) return;
+    std::sort(seconds.begin(), seconds.end());
+    auto percentile = [&](double p) {
+        return seconds[std::min(seconds.size() - 1, static_cast<size_t>(p * seconds.size()))] * 1e6;
+    };
+    printf("  %-22s n=%-7zu p50 %7.2f us   p99 %7.2f us   max %8.2f us\n", name, seconds.size(),
+           percentile(0.50), percentile(0.99), seconds.back() * 1e6);
+}
+
+static void benchmarkCaptureThroughput() {
+    printf("Capture through recorder + WavWriter (120 s of audio per run)\n");
+    const uint64_t frames = 120ull * SAMPLE_RATE;
+    const double speeds[] = {50, 200, 800, 3200};
+
+    for (double speed : speeds) {
+        FakeAudioBackend backend;
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        recorder.startRecording(BENCH_FILE);
+
+        Stopwatch stopwatch;
+        backend.runCaptureAtSpeed(frames, speed);
+        double captureSeconds = stopwatch.elapsedSeconds();
+        recorder.stopRecording();
+
+        printf("  target %6.0fx realtime: achieved %7.0fx, dropped %llu of %llu samples\n", speed,
+               frames / static_cast<double>(SAMPLE_RATE) / captureSeconds,
+               static_cast<unsigned long long>(recorder.getFileWriter().getSamplesDropped()),
+               static_cast<unsigned long long>(backend.getCapturedSampleCount()));
+    }
+    remove(BENCH_FILE);
+}
+
+static void benchmarkCaptureCallbackTiming() {
+    printf("Capture callback cost (recorder -> ring), 100x realtime\n");
+    const int bufferSizes[] = {256, 1024, 4096};
+
+    for (int framesPerBuffer : bufferSizes) {
+        FakeAudioBackend backend;
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        recorder.configureCapture(4, framesPerBuffer);
+        recorder.startRecording(BENCH_FILE);
+
+        backend.setRecordTimings(true);
+        backend.runCaptureAtSpeed(30ull * SAMPLE_RATE, 100);
+        recorder.stopRecording();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%d frames", framesPerBuffer);
+        printCallbackTimes(name, backend.getCallbackSeconds());
+    }
+    remove(BENCH_FILE);
+}
+
+static void benchmarkStatsOverhead() {
+    printf("Callback instrumentation (timer, jitter and duration histograms)\n");
+    const size_t calls = 1000000;
+    AudioStats stats;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < calls; i++) {
+        AudioStats::CallbackTimer timer(stats, 1000);
+    }
+    printf("  %.1f ns per callback over %zu callbacks\n", stopwatch.elapsedSeconds() * 1e9 / calls,
+           static_cast<size_t>(stats.getCallbackCount()));
+}
+
+static void benchmarkArmedStart() {
+    printf("Take start from standby (48 kHz stereo float): startRecording() and the first\n"
+           "callback, which hands the held input to the writer\n");
+    for (int preRollMs : {1000, 10000, 30000}) {
+        FakeAudioBackend backend;
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        recorder.configureFormat(48000, 2, SampleFormat::FLOAT32);
+        recorder.arm(preRollMs);
+        backend.advanceCapture(static_cast<uint64_t>(preRollMs) * 48 + 48000);
+
+        Stopwatch stopwatch;
+        recorder.startRecording(BENCH_FILE);
+        double startMs = stopwatch.elapsedSeconds() * 1000.0;
+        backend.setRecordTimings(true);
+        backend.advanceCapture(1024);
+        double firstMs = backend.getCallbackSeconds().empty() ? 0.0 : backend.getCallbackSeconds()[0] * 1000.0;
+        backend.runCaptureAtSpeed(48000, 20.0);
+        recorder.stopRecording();
+
+        printf("  %5d ms held: start %6.3f ms, first callback %6.3f ms, dropped %llu samples\n", preRollMs,
+               startMs, firstMs, static_cast<unsigned long long>(recorder.getFileWriter().getSamplesDropped()));
+    }
+    remove(BENCH_FILE);
+}
+
+static void benchmarkPcmTap() {
+    printf("Live PCM tap on the capture callback (48 kHz stereo float, armed, 1024 frames)\n");
+    for (bool tapped : {false, true}) {
+        FakeAudioBackend backend;
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        recorder.configureFormat(48000, 2, SampleFormat::FLOAT32);
+        PcmTap* tap = tapped ? recorder.openPcmTap(1000) : nullptr;
+        recorder.arm(1000);
+
+        // A reader that keeps up, between callbacks
+        std::vector<float> out(2 * 1024);
+        backend.setRecordTimings(true);
+        for (int i = 0; i < 20000; i++) {
+            backend.advanceCapture(1024);
+            if (tap != nullptr) tap->read(out.data(), out.size());
+        }
+        std::vector<double> seconds = backend.getCallbackSeconds();
+        std::sort(seconds.begin(), seconds.end());
+        printf("  %-9s median %6.2f us per callback%s\n", tapped ? "tapped" : "untapped",
+               seconds[seconds.size() / 2] * 1e6,
+               tap != nullptr && tap->getOverflowCount() > 0 ? ", overflowed" : "");
+        recorder.disarm();
+    }
+}
+
+static void benchmarkWavWriteAndRead() {
+    printf("WAV write / read (30 minutes of 44.1 kHz mono)\n");
+    const size_t totalSamples = 30ull * 60 * SAMPLE_RATE;
+    std::vector<short> block(4096);
+    for (size_t i = 0; i < block.size(); i++) block[i] = static_cast<short>(i);
+
+    // The producer retries when the ring is full, so this measures how
+    // fast the writer thread drains to disk
+    WavWriter writer(SAMPLE_RATE, 1, SampleFormat::INT16);
+    Stopwatch writeTimer;
+    writer.open(BENCH_FILE);
+    for (size_t written = 0; written < totalSamples; written += block.size()) {
+        while (!writer.write(block.data(), block.size())) {
+            std::this_thread::yield();
+        }
+    }
+    writer.close();
+    double writeSeconds = writeTimer.elapsedSeconds();
+    double megabytes = totalSamples * sizeof(short) / 1e6;
+    printf("  write: %8.1f MB/s (%.0fx realtime)\n", megabytes / writeSeconds,
+           totalSamples / static_cast<double>(SAMPLE_RATE) / writeSeconds);
+
+    Stopwatch readTimer;
+    MappedWavFile file;
+    file.open(BENCH_FILE);
+    long long sum = 0;
+    const short* samples = file.getSamples();
+    for (size_t i = 0; i < file.getSampleCount(); i++) sum += samples[i];
+    double readSeconds = readTimer.elapsedSeconds();
+    printf("  read:  %8.1f MB/s (map + touch every sample, checksum %lld)\n",
+           megabytes / readSeconds, sum);
+
+    // Render callbacks for the whole file through the player
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    player.loadAudioFile(BENCH_FILE);
+    player.startPlayback();
+    backend.setKeepRendered(false);
+    backend.setRecordTimings(true);
+    backend.renderBuffers(SIZE_MAX);
+    printCallbackTimes("render callback", backend.getCallbackSeconds());
+
+    remove(BENCH_FILE);
+}
+
+int main() {
+    benchmarkCaptureThroughput();
+    benchmarkCaptureCallbackTiming();
+    benchmarkStatsOverhead();
+    benchmarkArmedStart();
+    benchmarkPcmTap();
+    benchmarkWavWriteAndRead();
+    return 0;
+}
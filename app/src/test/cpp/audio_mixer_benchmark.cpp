@@ -0,0 +1,125 @@
+#include "audio_mixer.h"
+#include "fake_audio_backend.h"
+#include "mix_kernels.h"
+#include "sample_convert.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Software mixing: the gain and saturating-add kernels against the scalar
+// loops, then the whole device callback as the number of streams grows.
+// Sources hand out 960-frame buffers that never line up with the mixer's
+// 1024, so every callback also splits and carries over a source buffer.
+
+static const size_t SOURCE_FRAMES = 960;
+static const size_t RENDER_BUFFERS = 20000;
+
+static volatile int g_sink = 0;
+
+// Hands out the same buffer forever, so only the mixer is measured
+class LoopSource : public AudioRenderCallback {
+private:
+    std::vector<uint8_t> data;
+    size_t sampleCount;
+
+public:
+    LoopSource(const AudioStreamConfig& config, const std::vector<short>& samples)
+            : sampleCount(SOURCE_FRAMES * config.channels) {
+        data.resize(sampleCount * getBytesPerSample(config.format));
+        if (config.format == SampleFormat::FLOAT32) {
+            convertSamples(samples.data(), reinterpret_cast<float*>(data.data()), sampleCount);
+        } else {
+            std::copy(samples.begin(), samples.begin() + sampleCount, reinterpret_cast<short*>(data.data()));
+        }
+    }
+
+    bool onRenderBuffer(const void*& samples, size_t& count) override {
+        samples = data.data();
+        count = sampleCount;
+        return true;
+    }
+};
+
+static double measureKernel(void (*kernel)(short*, const short*, size_t, int),
+                            const std::vector<short>& in, int gain) {
+    const size_t totalSamples = 1ull << 27;
+    const size_t blockSize = 2048;
+    // Room for the mono kernel's stereo output
+    std::vector<short> mix(2 * blockSize, 0);
+    Stopwatch stopwatch;
+    for (size_t done = 0; done < totalSamples; done += blockSize) {
+        kernel(mix.data(), in.data() + done % (in.size() - blockSize), blockSize, gain);
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    g_sink = g_sink + mix[0];
+    return totalSamples / seconds;
+}
+
+static double measureMix(size_t streams, const AudioStreamConfig& config, const std::vector<short>& samples) {
+    FakeAudioBackend backend;
+    backend.setKeepRendered(false);
+    AudioMixer mixer(backend);
+    mixer.setOutputSampleRate(config.sampleRate);
+
+    std::vector<std::unique_ptr<LoopSource>> sources;
+    std::vector<std::unique_ptr<AudioMixer::Input>> inputs;
+    for (size_t i = 0; i < streams; i++) {
+        sources.emplace_back(new LoopSource(config, samples));
+        inputs.push_back(mixer.createInput());
+        inputs.back()->setGain(0.7f);
+        inputs.back()->openPlayback(config, sources.back().get());
+        inputs.back()->startPlayback();
+    }
+
+    Stopwatch stopwatch;
+    backend.renderBuffers(RENDER_BUFFERS);
+    double seconds = stopwatch.elapsedSeconds();
+    inputs.clear();
+    return seconds * 1e6 / RENDER_BUFFERS;
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> sampleDist(SHRT_MIN / 4, SHRT_MAX / 4);
+    std::vector<short> samples(1 << 20);
+    for (short& sample : samples) sample = static_cast<short>(sampleDist(random));
+
+    printf("%-18s %14s %14s %8s\n", "kernel", "scalar", "simd", "speedup");
+    for (int gain : {MIX_UNITY_GAIN, toMixGain(0.7f)}) {
+        double scalar = measureKernel(mixSamplesScalar, samples, gain);
+        double simd = measureKernel(mixSamples, samples, gain);
+        printf("%-18s %9.0f Ms/s %9.0f Ms/s %7.1fx\n", gain == MIX_UNITY_GAIN ? "add, unity" : "add, gain 0.7",
+               scalar / 1e6, simd / 1e6, simd / scalar);
+        scalar = measureKernel(mixMonoToStereoScalar, samples, gain);
+        simd = measureKernel(mixMonoToStereo, samples, gain);
+        printf("%-18s %9.0f Ms/s %9.0f Ms/s %7.1fx\n", gain == MIX_UNITY_GAIN ? "mono, unity" : "mono, gain 0.7",
+               scalar / 1e6, simd / 1e6, simd / scalar);
+    }
+
+    // The device's budget for each 1024-frame buffer at 48 kHz is 21.3 ms
+    printf("\nDevice callback, %d frames of 48 kHz stereo, us per buffer (per stream)\n",
+           AudioMixer::FRAMES_PER_BUFFER);
+    printf("%-8s %18s %18s %18s\n", "streams", "16-bit stereo", "16-bit mono", "float stereo");
+    AudioStreamConfig stereo;
+    stereo.sampleRate = 48000;
+    stereo.channels = 2;
+    AudioStreamConfig mono = stereo;
+    mono.channels = 1;
+    AudioStreamConfig floats = stereo;
+    floats.format = SampleFormat::FLOAT32;
+
+    for (size_t streams : {1, 2, 4, 8}) {
+        printf("%-8zu", streams);
+        for (const AudioStreamConfig& config : {stereo, mono, floats}) {
+            double us = measureMix(streams, config, samples);
+            printf(" %9.2f (%5.2f)", us, us / streams);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,315 @@
+#include "audio_mixer.h"
+#include "audio_player.h"
+#include "fake_audio_backend.h"
+#include "mix_kernels.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+static const char* MONO_FILE = "audio_mixer_test_mono.wav";
+static const char* STEREO_FILE = "audio_mixer_test_stereo.wav";
+static const int MIX_RATE = 48000;
+
+// Every length from 0 to 40 covers the SIMD bodies and all tail lengths
+static const size_t MAX_COUNT = 40;
+
+static std::vector<short> makeShorts(size_t count, int seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> dist(SHRT_MIN, SHRT_MAX);
+    std::vector<short> samples(count);
+    for (short& sample : samples) sample = static_cast<short>(dist(random));
+    return samples;
+}
+
+// A file holding |value| in every sample
+template <typename Sample>
+static void writeConstantFile(const char* path, int sampleRate, int channels, SampleFormat format,
+                              Sample value, size_t frames) {
+    std::vector<Sample> data(frames * channels, value);
+    WavWriter writer(sampleRate, channels, format);
+    writer.open(path);
+    writer.write(data.data(), data.size());
+    writer.close();
+}
+
+// Frames of the interleaved stereo mix from |first| on where both channels
+// hold |value|
+static size_t countFrames(const std::vector<short>& mix, size_t first, short value) {
+    size_t frames = 0;
+    for (size_t i = first * 2; i + 1 < mix.size() && mix[i] == value && mix[i + 1] == value; i += 2) {
+        frames++;
+    }
+    return frames;
+}
+
+static void testKernelsMatchScalar() {
+    for (int gain : {0, 1, 12345, 16384, 32767, MIX_UNITY_GAIN}) {
+        for (size_t count = 0; count <= MAX_COUNT; count++) {
+            std::vector<short> in = makeShorts(count, static_cast<int>(count));
+            std::vector<short> mix = makeShorts(count * 2, static_cast<int>(count) + 100);
+
+            std::vector<short> simd(mix.begin(), mix.begin() + count), scalar = simd;
+            mixSamples(simd.data(), in.data(), count, gain);
+            mixSamplesScalar(scalar.data(), in.data(), count, gain);
+            CHECK(simd == scalar);
+
+            std::vector<short> stereo = mix, stereoScalar = mix;
+            mixMonoToStereo(stereo.data(), in.data(), count, gain);
+            mixMonoToStereoScalar(stereoScalar.data(), in.data(), count, gain);
+            CHECK(stereo == stereoScalar);
+        }
+    }
+
+    short mix[4] = {30000, -30000, 100, -32768};
+    const short in[4] = {30000, -30000, -300, -32768};
+    mixSamples(mix, in, 4, MIX_UNITY_GAIN);
+    CHECK_EQ(32767, mix[0]);
+    CHECK_EQ(-32768, mix[1]);
+    CHECK_EQ(-200, mix[2]);
+    CHECK_EQ(-32768, mix[3]);
+
+    // Halves round up, as pmulhrsw and vqrdmulh do
+    short half[4] = {0, 0, 0, 0};
+    const short odd[4] = {1001, -1001, 3, 32767};
+    mixSamples(half, odd, 4, toMixGain(0.5f));
+    CHECK_EQ(501, half[0]);
+    CHECK_EQ(-500, half[1]);
+    CHECK_EQ(2, half[2]);
+    CHECK_EQ(16384, half[3]);
+
+    for (float gain : {0.0f, 0.3f, 1.0f}) {
+        for (size_t count = 0; count <= MAX_COUNT; count++) {
+            std::vector<float> in(count), mix(count * 2);
+            for (size_t i = 0; i < count; i++) in[i] = 0.01f * static_cast<float>(i) - 0.2f;
+            for (size_t i = 0; i < count * 2; i++) mix[i] = 0.5f - 0.02f * static_cast<float>(i);
+
+            std::vector<float> simd(mix.begin(), mix.begin() + count), scalar = simd;
+            mixSamples(simd.data(), in.data(), count, gain);
+            mixSamplesScalar(scalar.data(), in.data(), count, gain);
+            for (size_t i = 0; i < count; i++) CHECK_NEAR(scalar[i], simd[i], 1e-6);
+
+            std::vector<float> stereo = mix, stereoScalar = mix;
+            mixMonoToStereo(stereo.data(), in.data(), count, gain);
+            mixMonoToStereoScalar(stereoScalar.data(), in.data(), count, gain);
+            for (size_t i = 0; i < count * 2; i++) CHECK_NEAR(stereoScalar[i], stereo[i], 1e-6);
+        }
+    }
+
+    CHECK_EQ(0, toMixGain(-1.0f));
+    CHECK_EQ(0, toMixGain(NAN));
+    CHECK_EQ(16384, toMixGain(0.5f));
+    CHECK_EQ(MIX_UNITY_GAIN, toMixGain(1.0f));
+    CHECK_EQ(MIX_UNITY_GAIN, toMixGain(4.0f));
+}
+
+static void testMixesPlayersInDifferentFormats() {
+    // One second of mono 16-bit and half a second of stereo float
+    writeConstantFile<short>(MONO_FILE, MIX_RATE, 1, SampleFormat::INT16, 1000, MIX_RATE);
+    writeConstantFile<float>(STEREO_FILE, MIX_RATE, 2, SampleFormat::FLOAT32, 0.25f, MIX_RATE / 2);
+
+    FakeAudioBackend backend;
+    AudioMixer mixer(backend);
+    CHECK(mixer.initialize());
+    CHECK(mixer.setOutputSampleRate(MIX_RATE));
+    std::unique_ptr<AudioMixer::Input> monoInput = mixer.createInput();
+    std::unique_ptr<AudioMixer::Input> stereoInput = mixer.createInput();
+    AudioPlayer mono(*monoInput);
+    AudioPlayer stereo(*stereoInput);
+    CHECK(mono.setOutputSampleRate(MIX_RATE));
+    CHECK(stereo.setOutputSampleRate(MIX_RATE));
+
+    CHECK(mono.loadAudioFile(MONO_FILE));
+    CHECK(stereo.loadAudioFile(STEREO_FILE));
+    CHECK(mono.startPlayback());
+    CHECK(stereo.startPlayback());
+    CHECK_EQ(2u, mixer.getActiveInputCount());
+    CHECK(backend.isPlaybackRunning());
+
+    // Both at once, then the mono file alone, then the device stream ends
+    backend.renderBuffers(1000);
+    CHECK(!backend.isPlaybackRunning());
+    CHECK(!mono.isCurrentlyPlaying());
+    CHECK(!stereo.isCurrentlyPlaying());
+    CHECK_EQ(0u, mixer.getActiveInputCount());
+
+    // The float input puts the whole mix in float, reopening the device
+    // stream the mono one started
+    const std::vector<short>& mix = backend.getRendered();
+    CHECK_EQ(2, backend.getPlaybackOpenCount());
+    CHECK_EQ(AudioMixer::OUTPUT_CHANNELS, backend.getPlaybackConfig().channels);
+    CHECK(SampleFormat::FLOAT32 == backend.getPlaybackConfig().format);
+    CHECK_EQ(static_cast<size_t>(MIX_RATE / 2), countFrames(mix, 0, 1000 + 8192));
+    CHECK_EQ(static_cast<size_t>(MIX_RATE / 2), countFrames(mix, MIX_RATE / 2, 1000));
+    // Whatever is left of the last buffer is silent
+    CHECK_EQ(mix.size() / 2 - MIX_RATE, countFrames(mix, MIX_RATE, 0));
+    CHECK(mixer.getStats().getCallbackCount() > 0);
+
+    remove(MONO_FILE);
+    remove(STEREO_FILE);
+}
+
+static void testGainAndStopApplyPerInput() {
+    writeConstantFile<short>(MONO_FILE, MIX_RATE, 1, SampleFormat::INT16, 1000, MIX_RATE);
+    writeConstantFile<short>(STEREO_FILE, MIX_RATE, 2, SampleFormat::INT16, 300, MIX_RATE);
+
+    FakeAudioBackend backend;
+    AudioMixer mixer(backend);
+    CHECK(mixer.setOutputSampleRate(MIX_RATE));
+    std::unique_ptr<AudioMixer::Input> firstInput = mixer.createInput();
+    std::unique_ptr<AudioMixer::Input> secondInput = mixer.createInput();
+    AudioPlayer first(*firstInput);
+    AudioPlayer second(*secondInput);
+    first.setOutputSampleRate(MIX_RATE);
+    second.setOutputSampleRate(MIX_RATE);
+    first.loadAudioFile(MONO_FILE);
+    second.loadAudioFile(STEREO_FILE);
+
+    firstInput->setGain(0.5f);
+    CHECK_NEAR(0.5, firstInput->getGain(), 1e-6);
+    CHECK(first.startPlayback());
+    CHECK(second.startPlayback());
+    CHECK_EQ(4u, backend.renderBuffers(4));
+    CHECK_EQ(4u * AudioMixer::FRAMES_PER_BUFFER, countFrames(backend.getRendered(), 0, 500 + 300));
+
+    // Stopping one leaves the other playing; a muted input still advances
+    CHECK(first.stopPlayback());
+    secondInput->setGain(0.0f);
+    CHECK_EQ(2u, backend.renderBuffers(2));
+    CHECK_EQ(2u * AudioMixer::FRAMES_PER_BUFFER, countFrames(backend.getRendered(), 4 * AudioMixer::FRAMES_PER_BUFFER, 0));
+    CHECK(second.isCurrentlyPlaying());
+    CHECK(second.getPositionMs() > 0);
+
+    // Once the last input stops the device stream ends at the next buffer,
+    // and the next start brings it back without reopening it
+    CHECK(second.stopPlayback());
+    CHECK_EQ(0u, backend.renderBuffers(10));
+    CHECK(!backend.isPlaybackRunning());
+    secondInput->setGain(1.0f);
+    CHECK(second.startPlayback());
+    CHECK(backend.isPlaybackRunning());
+    size_t before = backend.getRendered().size() / 2;
+    CHECK_EQ(1u, backend.renderBuffers(1));
+    CHECK_EQ(static_cast<size_t>(AudioMixer::FRAMES_PER_BUFFER), countFrames(backend.getRendered(), before, 300));
+    CHECK_EQ(1, backend.getPlaybackOpenCount());
+
+    remove(MONO_FILE);
+    remove(STEREO_FILE);
+}
+
+static void testOutputFormatFollowsInputs() {
+    Int24 wideValue;
+    wideValue.set(-600 * 256);
+    writeConstantFile<short>(MONO_FILE, MIX_RATE, 1, SampleFormat::INT16, 1000, MIX_RATE);
+    writeConstantFile<Int24>(STEREO_FILE, MIX_RATE, 2, SampleFormat::INT24_PACKED, wideValue, MIX_RATE);
+
+    FakeAudioBackend backend;
+    AudioMixer mixer(backend);
+    CHECK(mixer.setOutputSampleRate(MIX_RATE));
+    std::unique_ptr<AudioMixer::Input> shortInput = mixer.createInput();
+    std::unique_ptr<AudioMixer::Input> wideInput = mixer.createInput();
+    AudioPlayer shorts(*shortInput);
+    AudioPlayer wide(*wideInput);
+    shorts.setOutputSampleRate(MIX_RATE);
+    wide.setOutputSampleRate(MIX_RATE);
+
+    // 16-bit alone mixes in 16-bit
+    CHECK(shorts.loadAudioFile(MONO_FILE));
+    CHECK(shorts.startPlayback());
+    CHECK(SampleFormat::INT16 == mixer.getOutputFormat());
+    CHECK_EQ(2u, backend.renderBuffers(2));
+
+    // A 24-bit input joining moves the device to float, and the 16-bit
+    // one plays on through it
+    CHECK(wide.loadAudioFile(STEREO_FILE));
+    CHECK(wide.startPlayback());
+    CHECK(SampleFormat::FLOAT32 == mixer.getOutputFormat());
+    CHECK(SampleFormat::FLOAT32 == backend.getPlaybackConfig().format);
+    CHECK_EQ(2, backend.getPlaybackOpenCount());
+    size_t before = backend.getRendered().size() / 2;
+    CHECK_EQ(2u, backend.renderBuffers(2));
+    CHECK_EQ(2u * AudioMixer::FRAMES_PER_BUFFER, countFrames(backend.getRendered(), before, 1000 - 600));
+
+    // Stays float while the 16-bit one plays on alone
+    CHECK(wide.stopPlayback());
+    CHECK_EQ(1u, backend.renderBuffers(1));
+    CHECK(SampleFormat::FLOAT32 == mixer.getOutputFormat());
+    CHECK(shorts.isCurrentlyPlaying());
+
+    // and goes back to 16-bit when it next starts with nothing playing
+    CHECK(shorts.stopPlayback());
+    CHECK(shorts.startPlayback());
+    CHECK(SampleFormat::INT16 == mixer.getOutputFormat());
+    CHECK(SampleFormat::INT16 == backend.getPlaybackConfig().format);
+    CHECK_EQ(3, backend.getPlaybackOpenCount());
+
+    remove(MONO_FILE);
+    remove(STEREO_FILE);
+}
+
+static void testResampledInputAndRateChecks() {
+    writeConstantFile<short>(MONO_FILE, 44100, 1, SampleFormat::INT16, 2000, 44100);
+
+    FakeAudioBackend backend;
+    AudioMixer mixer(backend);
+    CHECK(mixer.setOutputSampleRate(MIX_RATE));
+    std::unique_ptr<AudioMixer::Input> input = mixer.createInput();
+    AudioPlayer player(*input);
+    CHECK(player.loadAudioFile(MONO_FILE));
+
+    // At its own rate the file does not fit the mix
+    CHECK(!player.startPlayback());
+
+    CHECK(player.setOutputSampleRate(MIX_RATE));
+    CHECK(player.startPlayback());
+    CHECK(!mixer.setOutputSampleRate(44100));
+    backend.renderBuffers(1000);
+    CHECK(!player.isCurrentlyPlaying());
+
+    // One second at the mixer's rate, give or take the filter's edges
+    const std::vector<short>& mix = backend.getRendered();
+    size_t loud = 0;
+    for (size_t i = 0; i < mix.size(); i += 2) {
+        if (mix[i] > 1900 && mix[i] < 2100 && mix[i] == mix[i + 1]) loud++;
+    }
+    CHECK(loud > static_cast<size_t>(MIX_RATE) - 200);
+    CHECK(loud <= static_cast<size_t>(MIX_RATE));
+
+    remove(MONO_FILE);
+}
+
+static void testInputsAreLimited() {
+    FakeAudioBackend backend;
+    AudioMixer mixer(backend);
+    std::vector<std::unique_ptr<AudioMixer::Input>> inputs;
+    for (size_t i = 0; i < AudioMixer::MAX_INPUTS; i++) {
+        inputs.push_back(mixer.createInput());
+        CHECK(inputs.back() != nullptr);
+    }
+    CHECK(mixer.createInput() == nullptr);
+
+    // Releasing one frees its slot, at unity gain again
+    inputs[3]->setGain(0.25f);
+    inputs[3].reset();
+    inputs[3] = mixer.createInput();
+    CHECK(inputs[3] != nullptr);
+    CHECK_NEAR(1.0, inputs[3]->getGain(), 1e-6);
+
+    // Inputs only play
+    AudioStreamConfig config;
+    CHECK(!inputs[0]->openCapture(config, nullptr));
+}
+
+int main() {
+    RUN_TEST(testKernelsMatchScalar);
+    RUN_TEST(testMixesPlayersInDifferentFormats);
+    RUN_TEST(testGainAndStopApplyPerInput);
+    RUN_TEST(testOutputFormatFollowsInputs);
+    RUN_TEST(testResampledInputAndRateChecks);
+    RUN_TEST(testInputsAreLimited);
+    return TEST_RESULT();
+}
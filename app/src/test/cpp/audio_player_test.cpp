@@ -0,0 +1,463 @@
+#include "audio_player.h"
+#include "fake_audio_backend.h"
+#include "resampler.h"
+#include "sample_convert.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* MONO_FILE = "audio_player_test_mono.wav";
+static const char* STEREO_FILE = "audio_player_test_stereo.wav";
+
+static std::vector<short> writeTestFile(const char* path, int sampleRate, int channels,
+                                        size_t samples) {
+    std::vector<short> data(samples);
+    for (size_t i = 0; i < samples; i++) data[i] = static_cast<short>(i * 7);
+
+    // Longer files go in pieces the writer's ring can take
+    WavWriter writer(sampleRate, channels, SampleFormat::INT16);
+    writer.open(path);
+    for (size_t done = 0; done < samples; done += 65536) {
+        if (done > 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        writer.write(data.data() + done, std::min<size_t>(65536, samples - done));
+    }
+    writer.close();
+    return data;
+}
+
+static void testPlaysWholeFile() {
+    std::vector<short> data = writeTestFile(MONO_FILE, 44100, 1, 10000);
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    CHECK(player.initialize());
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(player.isCurrentlyPlaying());
+
+    // 4096 + 4096 + 1808 samples, then the stream ends
+    CHECK_EQ(3u, backend.renderBuffers(100));
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK(!backend.isPlaybackRunning());
+    CHECK(backend.getRendered() == data);
+    remove(MONO_FILE);
+}
+
+static void testStreamIsReusedWhileFormatMatches() {
+    writeTestFile(MONO_FILE, 44100, 1, 5000);
+    writeTestFile(STEREO_FILE, 48000, 2, 5000);
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(player.getStartLatency().wasCold());
+    backend.renderBuffers(100);
+
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(!player.getStartLatency().wasCold());
+    CHECK_EQ(1, backend.getPlaybackOpenCount());
+    backend.renderBuffers(100);
+
+    CHECK(player.loadAudioFile(STEREO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(player.getStartLatency().wasCold());
+    CHECK_EQ(2, backend.getPlaybackOpenCount());
+    CHECK_EQ(48000, backend.getPlaybackConfig().sampleRate);
+    CHECK_EQ(2, backend.getPlaybackConfig().channels);
+
+    remove(MONO_FILE);
+    remove(STEREO_FILE);
+}
+
+static void testStopPlayback() {
+    writeTestFile(MONO_FILE, 44100, 1, 100000);
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    player.loadAudioFile(MONO_FILE);
+
+    CHECK(!player.stopPlayback());
+    CHECK(player.startPlayback());
+    CHECK(!player.startPlayback());
+    CHECK_EQ(2u, backend.renderBuffers(2));
+    CHECK(player.stopPlayback());
+    CHECK(!backend.isPlaybackRunning());
+    CHECK_EQ(0u, backend.renderBuffers(100));
+    remove(MONO_FILE);
+}
+
+static void testSeekAndPosition() {
+    std::vector<short> data = writeTestFile(MONO_FILE, 44100, 1, 10 * 44100);
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    CHECK(!player.seekTo(1000));
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK_EQ(10000, player.getDurationMs());
+    CHECK_EQ(0, player.getPositionMs());
+
+    // Seeking while stopped sets where playback starts
+    CHECK(player.seekTo(5000));
+    CHECK_EQ(5000, player.getPositionMs());
+    CHECK(player.startPlayback());
+    CHECK_EQ(1u, backend.renderBuffers(1));
+    CHECK_EQ(data[5 * 44100], backend.getRendered()[0]);
+
+    // While playing, blocks read ahead of the old position are dropped
+    CHECK(player.seekTo(1000));
+    CHECK_EQ(1000, player.getPositionMs());
+    size_t before = backend.getRenderedSampleCount();
+    CHECK_EQ(1u, backend.renderBuffers(1));
+    CHECK_EQ(data[44100], backend.getRendered()[before]);
+    CHECK_EQ(1000, player.getPositionMs());
+    CHECK_EQ(1u, backend.renderBuffers(1));
+    CHECK_EQ(1000 + 4096 * 1000 / 44100, player.getPositionMs());
+    CHECK_EQ(data[44100 + 4096], backend.getRendered()[before + 4096]);
+
+    // Past the end, playback finishes and the next one starts over
+    CHECK(player.seekTo(60000));
+    CHECK_EQ(0u, backend.renderBuffers(10));
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK_EQ(0, player.getPositionMs());
+    CHECK(player.startPlayback());
+    before = backend.getRenderedSampleCount();
+    backend.renderBuffers(SIZE_MAX);
+    CHECK_EQ(data.size(), backend.getRenderedSampleCount() - before);
+    remove(MONO_FILE);
+}
+
+static void testPlaysEveryFormatInItsOwnFormat() {
+    std::vector<short> data(10000);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<short>(i * 7);
+    std::vector<Int24> packed(data.size());
+    std::vector<float> floats(data.size());
+    convertSamples(data.data(), packed.data(), data.size());
+    convertSamples(data.data(), floats.data(), data.size());
+
+    const SampleFormat formats[] = {SampleFormat::INT24_PACKED, SampleFormat::FLOAT32};
+    for (SampleFormat format : formats) {
+        for (int channels = 1; channels <= 2; channels++) {
+            WavWriter writer(48000, channels, format);
+            writer.open(STEREO_FILE);
+            writer.write(format == SampleFormat::FLOAT32 ? static_cast<const void*>(floats.data()) : packed.data(),
+                         data.size());
+            writer.close();
+
+            FakeAudioBackend backend;
+            AudioPlayer player(backend);
+            player.initialize();
+            CHECK(player.loadAudioFile(STEREO_FILE));
+            CHECK(player.startPlayback());
+            CHECK(backend.getPlaybackConfig().format == format);
+            CHECK_EQ(48000, backend.getPlaybackConfig().sampleRate);
+            CHECK_EQ(channels, backend.getPlaybackConfig().channels);
+            backend.renderBuffers(100);
+            CHECK(backend.getRendered() == data);
+
+            LevelSnapshot levels;
+            CHECK(player.getLevelMeter().read(levels));
+            CHECK(levels.blockCount == 3u);
+            remove(STEREO_FILE);
+        }
+    }
+}
+
+static void testResamplesToOutputRate() {
+    const SampleFormat formats[] = {SampleFormat::INT16, SampleFormat::INT24_PACKED, SampleFormat::FLOAT32};
+    for (SampleFormat format : formats) {
+        for (int channels = 1; channels <= 2; channels++) {
+            // One second of a 1 kHz tone at 44.1 kHz
+            std::vector<float> tone(44100 * channels);
+            for (size_t i = 0; i < tone.size(); i++) {
+                tone[i] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 1000.0 * (i / channels) / 44100));
+            }
+            std::vector<short> shorts(tone.size());
+            std::vector<Int24> packed(tone.size());
+            convertSamples(tone.data(), shorts.data(), tone.size());
+            convertSamples(shorts.data(), packed.data(), shorts.size());
+            if (format != SampleFormat::FLOAT32) convertSamples(shorts.data(), tone.data(), shorts.size());
+
+            WavWriter writer(44100, channels, format);
+            writer.open(STEREO_FILE);
+            const void* source = format == SampleFormat::INT16 ? static_cast<const void*>(shorts.data())
+                                 : format == SampleFormat::INT24_PACKED ? static_cast<const void*>(packed.data())
+                                                                        : tone.data();
+            writer.write(source, tone.size());
+            writer.close();
+
+            FakeAudioBackend backend;
+            AudioPlayer player(backend);
+            player.initialize();
+            CHECK(player.setOutputSampleRate(48000));
+            CHECK(player.loadAudioFile(STEREO_FILE));
+
+            // Played twice: a warm restart starts the filter afresh
+            std::vector<float> expected;
+            CHECK(resampleBuffer(tone.data(), tone.size() / channels, channels, 44100, 48000, expected));
+            std::vector<short> expectedShorts(expected.size());
+            convertSamples(expected.data(), expectedShorts.data(), expected.size());
+            for (int pass = 0; pass < 2; pass++) {
+                CHECK(player.startPlayback());
+                CHECK(backend.getPlaybackConfig().format == SampleFormat::FLOAT32);
+                CHECK_EQ(48000, backend.getPlaybackConfig().sampleRate);
+                CHECK_EQ(channels, backend.getPlaybackConfig().channels);
+                backend.renderBuffers(1000);
+                CHECK(!player.isCurrentlyPlaying());
+                // Rendered samples pile up across passes
+                const std::vector<short>& rendered = backend.getRendered();
+                CHECK_EQ((pass + 1) * expectedShorts.size(), rendered.size());
+                CHECK(std::equal(expectedShorts.begin(), expectedShorts.end(), rendered.end() - expectedShorts.size()));
+            }
+            CHECK_EQ(1, backend.getPlaybackOpenCount());
+
+            // The meter still sees the file's own samples
+            LevelSnapshot levels;
+            CHECK(player.getLevelMeter().read(levels));
+            CHECK_NEAR(0.5, levels.peak, 0.01);
+            remove(STEREO_FILE);
+        }
+    }
+
+    // Files already at the output rate go straight through
+    std::vector<short> data = writeTestFile(MONO_FILE, 48000, 1, 10000);
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    CHECK(player.setOutputSampleRate(48000));
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(backend.getPlaybackConfig().format == SampleFormat::INT16);
+    backend.renderBuffers(100);
+    CHECK(backend.getRendered() == data);
+
+    // Changing the rate after loading takes effect on the next start
+    CHECK(player.setOutputSampleRate(44100));
+    CHECK(player.startPlayback());
+    CHECK_EQ(44100, backend.getPlaybackConfig().sampleRate);
+    CHECK(backend.getPlaybackConfig().format == SampleFormat::FLOAT32);
+    CHECK(!player.setOutputSampleRate(48000));
+    player.stopPlayback();
+    remove(MONO_FILE);
+}
+
+static void testRejectsMissingAndUnsupportedFiles() {
+    writeTestFile(MONO_FILE, 44100, 1, 100);
+    {
+        // Re-label the file as 8-bit
+        FILE* file = fopen(MONO_FILE, "r+b");
+        fseek(file, 34, SEEK_SET);
+        unsigned short bits = 8;
+        fwrite(&bits, 2, 1, file);
+        fclose(file);
+    }
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    CHECK(!player.loadAudioFile("does_not_exist.wav"));
+    CHECK(!player.loadAudioFile(MONO_FILE));
+    CHECK(!player.startPlayback());
+    remove(MONO_FILE);
+}
+
+static void testPlaybackSpeedKeepsPitch() {
+    // Three seconds of 441 Hz, whole cycles every second
+    std::vector<short> tone(3 * 44100);
+    for (size_t i = 0; i < tone.size(); i++) {
+        tone[i] = static_cast<short>(8000.0 * std::sin(2.0 * M_PI * 441.0 * i / 44100));
+    }
+    WavWriter writer(44100, 1, SampleFormat::INT16);
+    writer.open(MONO_FILE);
+    for (size_t done = 0; done < tone.size(); done += 65536) {
+        if (done > 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        writer.write(tone.data() + done, std::min<size_t>(65536, tone.size() - done));
+    }
+    writer.close();
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    CHECK(!player.setPlaybackSpeed(5.0f));
+    CHECK(!player.setPlaybackSpeed(NAN));
+    CHECK(player.setPlaybackSpeed(2.0f));
+    CHECK_EQ(2.0f, player.getPlaybackSpeed());
+
+    // Twice as fast, in float at the file's rate, at the same pitch
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK(player.startPlayback());
+    CHECK(backend.getPlaybackConfig().format == SampleFormat::FLOAT32);
+    CHECK_EQ(44100, backend.getPlaybackConfig().sampleRate);
+    backend.renderBuffers(1000);
+    CHECK(!player.isCurrentlyPlaying());
+    std::vector<short> rendered = backend.getRendered();
+    CHECK(rendered.size() >= tone.size() / 2 - 2000);
+    CHECK(rendered.size() <= tone.size() / 2 + 8000);
+    std::vector<float> samples(rendered.begin(), rendered.begin() + 44100);
+    std::complex<double> sum = 0.0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        sum += static_cast<double>(samples[i]) * std::polar(1.0, -2.0 * M_PI * 441.0 * i / 44100);
+    }
+    CHECK_NEAR(8000.0, 2.0 * std::abs(sum) / 44100, 400.0);
+
+    // Started at normal speed in the file's own format, the player moves
+    // over to float where it is
+    FakeAudioBackend direct;
+    AudioPlayer other(direct);
+    other.initialize();
+    CHECK(other.loadAudioFile(MONO_FILE));
+    CHECK(other.startPlayback());
+    CHECK(direct.getPlaybackConfig().format == SampleFormat::INT16);
+    direct.renderBuffers(5);
+    CHECK(other.setPlaybackSpeed(1.5f));
+    CHECK(other.isCurrentlyPlaying());
+    CHECK(direct.getPlaybackConfig().format == SampleFormat::FLOAT32);
+    CHECK(other.getPositionMs() > 300);
+    direct.renderBuffers(1000);
+    CHECK(!other.isCurrentlyPlaying());
+    std::vector<short> carried = direct.getRendered();
+    CHECK(carried.size() < tone.size());
+
+    // It carries on after the last block the device had, none of it twice
+    const size_t handedOver = 5 * 4096;
+    CHECK(carried.size() > handedOver + 64);
+    for (size_t i = 0; i < 64; i++) {
+        CHECK_NEAR(tone[handedOver + i], carried[handedOver + i], 200);
+    }
+
+    remove(MONO_FILE);
+}
+
+// Queue transitions as the queue thread reports them
+class QueueEvents : public AudioPlayer::QueueListener {
+public:
+    void onTrackStarted(size_t index) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        started.push_back(index);
+        changed.notify_all();
+    }
+
+    void onQueueFinished() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        changed.notify_all();
+    }
+
+    // Until |tracks| items have started, and the queue has finished if
+    // |untilFinished|
+    std::vector<size_t> wait(size_t tracks, bool untilFinished) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_for(lock, std::chrono::seconds(5), [&] {
+            return started.size() >= tracks && (finished || !untilFinished);
+        });
+        return started;
+    }
+
+    bool isFinished() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return finished;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<size_t> started;
+    bool finished = false;
+};
+
+static void testQueuePlaysGapless() {
+    static const char* SECOND_FILE = "audio_player_test_second.wav";
+    std::vector<short> expected = writeTestFile(MONO_FILE, 44100, 1, 10000);
+    std::vector<short> second = writeTestFile(SECOND_FILE, 44100, 1, 7000);
+    expected.insert(expected.end(), second.begin(), second.end());
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    auto events = std::make_shared<QueueEvents>();
+    CHECK(!player.setQueue({"does_not_exist.wav"}, events));
+    CHECK(player.setQueue({"does_not_exist.wav", MONO_FILE, "does_not_exist.wav", SECOND_FILE}, events));
+    CHECK_EQ(1u, player.getQueueIndex());
+    CHECK(player.startPlayback());
+
+    // One device start, and the second file's first sample straight after
+    // the first's last, with no silence between
+    backend.renderBuffers(100);
+    CHECK(events->wait(1, true) == std::vector<size_t>{3});
+    CHECK(events->isFinished());
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK_EQ(1, backend.getPlaybackOpenCount());
+    CHECK(backend.getRendered() == expected);
+    CHECK_EQ(0u, player.getStats().getStarvedBlocks());
+
+    // Loading anything else ends the queue without a word
+    auto dropped = std::make_shared<QueueEvents>();
+    CHECK(player.setQueue({MONO_FILE, SECOND_FILE}, dropped));
+    CHECK(player.loadAudioFile(MONO_FILE));
+    CHECK_EQ(0u, player.getQueueIndex());
+    CHECK(player.startPlayback());
+    backend.renderBuffers(100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(dropped->wait(0, false).empty() && !dropped->isFinished());
+
+    remove(SECOND_FILE);
+    remove(MONO_FILE);
+}
+
+static void testQueueRestartsOnFormatChange() {
+    std::vector<short> expected = writeTestFile(MONO_FILE, 44100, 1, 5000);
+    std::vector<short> stereo = writeTestFile(STEREO_FILE, 48000, 2, 6000);
+    expected.insert(expected.end(), stereo.begin(), stereo.end());
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    player.initialize();
+    auto events = std::make_shared<QueueEvents>();
+    CHECK(player.setQueue({MONO_FILE, STEREO_FILE}, events));
+    CHECK(player.startPlayback());
+
+    // The first file ends the device stream; the queue thread opens one in
+    // the next file's format and carries on
+    backend.renderBuffers(100);
+    CHECK(events->wait(1, false) == std::vector<size_t>{1});
+    CHECK_EQ(1u, player.getQueueIndex());
+    CHECK_EQ(2, backend.getPlaybackOpenCount());
+    CHECK_EQ(48000, backend.getPlaybackConfig().sampleRate);
+    backend.renderBuffers(100);
+    events->wait(1, true);
+    CHECK(events->isFinished());
+    CHECK(backend.getRendered() == expected);
+
+    remove(MONO_FILE);
+    remove(STEREO_FILE);
+}
+
+int main() {
+    RUN_TEST(testPlaysWholeFile);
+    RUN_TEST(testStreamIsReusedWhileFormatMatches);
+    RUN_TEST(testStopPlayback);
+    RUN_TEST(testSeekAndPosition);
+    RUN_TEST(testPlaysEveryFormatInItsOwnFormat);
+    RUN_TEST(testResamplesToOutputRate);
+    RUN_TEST(testRejectsMissingAndUnsupportedFiles);
+    RUN_TEST(testQueuePlaysGapless);
+    RUN_TEST(testQueueRestartsOnFormatChange);
+    RUN_TEST(testPlaybackSpeedKeepsPitch);
+    return TEST_RESULT();
+}
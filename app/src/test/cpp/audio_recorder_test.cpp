@@ -0,0 +1,305 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "flac_decoder.h"
+#include "sample_convert.h"
+#include "test_util.h"
+#include "wav_file.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static const char* TEST_FILE = "audio_recorder_test.wav";
+static const char* FLAC_TEST_FILE = "audio_recorder_test.flac";
+
+static bool fileExists(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file) fclose(file);
+    return file != nullptr;
+}
+
+static void testRecordsCaptureStreamToWav() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    CHECK(recorder.initialize());
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(recorder.isCurrentlyRecording());
+    CHECK(backend.isCaptureRunning());
+
+    // Two seconds at 44.1 kHz in 1024-frame buffers
+    size_t callbacks = backend.advanceCapture(2 * 44100);
+    CHECK_EQ(86u, callbacks);
+    CHECK(recorder.stopRecording());
+    CHECK(!backend.isCaptureRunning());
+
+    MappedWavFile file;
+    CHECK(file.open(TEST_FILE));
+    CHECK_EQ(44100u, file.getInfo().sampleRate);
+    CHECK_EQ(1, file.getInfo().channels);
+    CHECK_EQ(callbacks * 1024, file.getSampleCount());
+
+    bool isRamp = true;
+    for (size_t i = 0; i < file.getSampleCount(); i++) {
+        isRamp = isRamp && file.getSamples()[i] == static_cast<short>(i & 0xFFFF);
+    }
+    CHECK(isRamp);
+    CHECK_EQ(0u, recorder.getFileWriter().getSamplesDropped());
+    remove(TEST_FILE);
+}
+
+static void testSecondTakeReusesCaptureStream() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(recorder.getStartLatency().wasCold());
+    backend.advanceCapture(4096);
+    recorder.stopRecording();
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(!recorder.getStartLatency().wasCold());
+    backend.advanceCapture(4096);
+    recorder.stopRecording();
+
+    CHECK_EQ(1, backend.getCaptureOpenCount());
+    remove(TEST_FILE);
+}
+
+static void testConfigureCapture() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    CHECK_NEAR(1000.0 * 1024 / 44100, recorder.getInputLatencyMs(), 0.01);
+    CHECK(!recorder.configureCapture(1, 1024));
+    CHECK(!recorder.configureCapture(4, 16));
+    CHECK(recorder.configureCapture(8, 256));
+    CHECK_NEAR(1000.0 * 256 / 44100, recorder.getInputLatencyMs(), 0.01);
+    CHECK_NEAR(1000.0 * 7 * 256 / 44100, recorder.getCaptureHeadroomMs(), 0.01);
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK_EQ(8, backend.getCaptureConfig().bufferCount);
+    CHECK_EQ(256, backend.getCaptureConfig().framesPerBuffer);
+    CHECK(!recorder.configureCapture(4, 1024));
+    recorder.stopRecording();
+
+    // A new config rebuilds the stream on the next take
+    CHECK(recorder.configureCapture(4, 512));
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(recorder.getStartLatency().wasCold());
+    CHECK_EQ(2, backend.getCaptureOpenCount());
+    CHECK_EQ(512, backend.getCaptureConfig().framesPerBuffer);
+    recorder.stopRecording();
+    remove(TEST_FILE);
+}
+
+static void testRecordsEveryFormat() {
+    const SampleFormat formats[] = {SampleFormat::INT16, SampleFormat::INT24_PACKED, SampleFormat::FLOAT32};
+    for (SampleFormat format : formats) {
+        for (int channels = 1; channels <= 2; channels++) {
+            FakeAudioBackend backend;
+            AudioRecorder recorder(backend);
+            recorder.initialize();
+            CHECK(recorder.configureFormat(48000, channels, format));
+            CHECK(recorder.startRecording(TEST_FILE));
+            CHECK(backend.getCaptureConfig().format == format);
+            CHECK_EQ(48000, backend.getCaptureConfig().sampleRate);
+            backend.advanceCapture(48000);
+            CHECK(recorder.stopRecording());
+
+            MappedWavFile file;
+            SampleFormat fileFormat = SampleFormat::INT16;
+            CHECK(file.open(TEST_FILE));
+            CHECK(getWavSampleFormat(file.getInfo(), fileFormat));
+            CHECK(fileFormat == format);
+            CHECK_EQ(48000u, file.getInfo().sampleRate);
+            CHECK_EQ(channels, file.getInfo().channels);
+            CHECK_EQ(backend.getCapturedSampleCount(), file.getSampleCount());
+
+            // The ramp survives in every format: 24-bit and float hold
+            // 16-bit values exactly
+            std::vector<short> samples(file.getSampleCount());
+            if (format == SampleFormat::INT24_PACKED) {
+                convertSamples(reinterpret_cast<const Int24*>(file.getData()), samples.data(), samples.size());
+            } else if (format == SampleFormat::FLOAT32) {
+                convertSamples(reinterpret_cast<const float*>(file.getData()), samples.data(), samples.size());
+            } else {
+                samples.assign(file.getSamples(), file.getSamples() + file.getSampleCount());
+            }
+            bool isRamp = true;
+            for (size_t i = 0; i < samples.size(); i++) {
+                isRamp = isRamp && samples[i] == static_cast<short>(i & 0xFFFF);
+            }
+            CHECK(isRamp);
+
+            // The preview sees the same 16-bit signal
+            LevelSnapshot levels;
+            CHECK(recorder.getLevelMeter().read(levels));
+            CHECK(levels.peak > 0.5f);
+            CHECK(recorder.getWaveformIndex().getBinCount(0) > 0);
+            file.close();
+            remove(TEST_FILE);
+            remove("audio_recorder_test.peaks");
+        }
+    }
+}
+
+static void testConfigureFormat() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    CHECK(!recorder.configureFormat(4000, 1, SampleFormat::INT16));
+    CHECK(!recorder.configureFormat(48000, 3, SampleFormat::INT16));
+    CHECK(recorder.configureFormat(48000, 1, SampleFormat::FLOAT32));
+    CHECK_NEAR(1000.0 * 1024 / 48000, recorder.getInputLatencyMs(), 0.01);
+
+    // The FLAC encoder only takes 16-bit samples
+    CHECK(!recorder.startRecording("audio_recorder_test.flac", AudioFileFormat::FLAC));
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(!recorder.configureFormat(44100, 1, SampleFormat::INT16));
+    backend.advanceCapture(4096);
+    recorder.stopRecording();
+
+    // Same format keeps the stream; a new one rebuilds it
+    CHECK(recorder.configureFormat(48000, 1, SampleFormat::FLOAT32));
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK_EQ(1, backend.getCaptureOpenCount());
+    recorder.stopRecording();
+    CHECK(recorder.configureFormat(48000, 2, SampleFormat::INT16));
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK_EQ(2, backend.getCaptureOpenCount());
+    recorder.stopRecording();
+    remove(TEST_FILE);
+    remove("audio_recorder_test.peaks");
+}
+
+static void testEmptyTakeLeavesNoFile() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(recorder.stopRecording());
+    CHECK(!fileExists(TEST_FILE));
+    CHECK(!recorder.stopRecording());
+}
+
+// Whole take as 16-bit samples, whichever format it was saved in
+static std::vector<short> readTake(const char* path) {
+    std::vector<short> samples;
+    FlacDecoder decoder;
+    if (decoder.open(path)) {
+        std::vector<short> frame;
+        while (decoder.decodeFrame(frame) > 0) samples.insert(samples.end(), frame.begin(), frame.end());
+        return samples;
+    }
+    MappedWavFile file;
+    if (file.open(path)) {
+        samples.assign(file.getSamples(), file.getSamples() + file.getSampleCount());
+    }
+    return samples;
+}
+
+// Every sample continues the fake backend's ramp from |first|
+static bool continuesRamp(const std::vector<short>& samples, uint64_t first) {
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (samples[i] != static_cast<short>((first + i) & 0xFFFF)) return false;
+    }
+    return true;
+}
+
+static void testArmedTakeStartsWithPreRoll() {
+    const struct {
+        const char* path;
+        AudioFileFormat format;
+    } takes[] = {{TEST_FILE, AudioFileFormat::WAV}, {FLAC_TEST_FILE, AudioFileFormat::FLAC}};
+
+    for (const auto& take : takes) {
+        FakeAudioBackend backend;
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        CHECK(recorder.arm(1000));
+        CHECK(recorder.isArmed());
+        CHECK(backend.isCaptureRunning());
+        CHECK(!recorder.configureFormat(48000, 1, SampleFormat::INT16));
+        CHECK(!recorder.configureCapture(4, 512));
+
+        // Three seconds of standby; only the last one is kept
+        backend.advanceCapture(3 * 44100);
+        uint64_t armedSamples = backend.getCapturedSampleCount();
+        CHECK(recorder.startRecording(take.path, take.format));
+        CHECK(!recorder.getStartLatency().wasCold());
+        size_t callbacks = backend.advanceCapture(44100);
+        CHECK(recorder.stopRecording());
+
+        // Armed, the stream stays up for the next take
+        CHECK(backend.isCaptureRunning());
+        CHECK_EQ(1, backend.getCaptureOpenCount());
+
+        std::vector<short> samples = readTake(take.path);
+        CHECK_EQ(44100 + callbacks * 1024, samples.size());
+        CHECK(continuesRamp(samples, armedSamples - 44100));
+        CHECK_EQ(0u, recorder.getFileWriter().getSamplesDropped());
+
+        // The next take holds what came after this one, not this one again
+        uint64_t stoppedAt = backend.getCapturedSampleCount();
+        backend.advanceCapture(22050);
+        armedSamples = backend.getCapturedSampleCount();
+        CHECK(recorder.startRecording(take.path, take.format));
+        callbacks = backend.advanceCapture(4096);
+        CHECK(recorder.stopRecording());
+        samples = readTake(take.path);
+        CHECK_EQ(armedSamples - stoppedAt + callbacks * 1024, samples.size());
+        CHECK(continuesRamp(samples, stoppedAt));
+
+        recorder.disarm();
+        CHECK(!recorder.isArmed());
+        CHECK(!backend.isCaptureRunning());
+        remove(take.path);
+    }
+    remove("audio_recorder_test.peaks");
+}
+
+static void testArmedTakeStoppedBeforeFirstBlock() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+    CHECK(recorder.arm(500));
+    backend.advanceCapture(44100);
+
+    // No callback reaches the take, but the held input still goes in
+    uint64_t armedSamples = backend.getCapturedSampleCount();
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(recorder.stopRecording());
+    std::vector<short> samples = readTake(TEST_FILE);
+    CHECK_EQ(22050u, samples.size());
+    CHECK(continuesRamp(samples, armedSamples - 22050));
+
+    // Disarmed mid-take, the stream stops with the take
+    CHECK(recorder.startRecording(TEST_FILE));
+    backend.advanceCapture(4096);
+    recorder.disarm();
+    CHECK(backend.isCaptureRunning());
+    CHECK(recorder.stopRecording());
+    CHECK(!backend.isCaptureRunning());
+
+    CHECK(!recorder.arm(0));
+    CHECK(!recorder.arm(60000));
+    remove(TEST_FILE);
+    remove("audio_recorder_test.peaks");
+}
+
+int main() {
+    RUN_TEST(testRecordsCaptureStreamToWav);
+    RUN_TEST(testSecondTakeReusesCaptureStream);
+    RUN_TEST(testConfigureCapture);
+    RUN_TEST(testRecordsEveryFormat);
+    RUN_TEST(testConfigureFormat);
+    RUN_TEST(testEmptyTakeLeavesNoFile);
+    RUN_TEST(testArmedTakeStartsWithPreRoll);
+    RUN_TEST(testArmedTakeStoppedBeforeFirstBlock);
+    return TEST_RESULT();
+}
@@ -0,0 +1,150 @@
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "audio_stats.h"
+#include "fake_audio_backend.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static const char* TEST_FILE = "audio_stats_test.wav";
+
+static uint64_t sumBuckets(const int64_t* packed, size_t first) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) total += packed[first + i];
+    return total;
+}
+
+static void testHistogramBuckets() {
+    CHECK_EQ(0u, LatencyHistogram::bucketFor(0));
+    CHECK_EQ(0u, LatencyHistogram::bucketFor(63));
+    CHECK_EQ(1u, LatencyHistogram::bucketFor(64));
+    CHECK_EQ(1u, LatencyHistogram::bucketFor(127));
+    CHECK_EQ(2u, LatencyHistogram::bucketFor(128));
+    CHECK_EQ(14u, LatencyHistogram::bucketFor(1048575));
+    CHECK_EQ(15u, LatencyHistogram::bucketFor(1048576));
+    CHECK_EQ(15u, LatencyHistogram::bucketFor(UINT32_MAX));
+
+    // Every bucket's limit is the first value of the next one
+    for (size_t bucket = 0; bucket + 1 < LatencyHistogram::BUCKET_COUNT; bucket++) {
+        uint32_t limit = LatencyHistogram::getBucketLimitUs(bucket);
+        CHECK_EQ(bucket, LatencyHistogram::bucketFor(limit - 1));
+        CHECK_EQ(bucket + 1, LatencyHistogram::bucketFor(limit));
+    }
+
+    LatencyHistogram histogram;
+    histogram.add(10);
+    histogram.add(20);
+    histogram.add(5000);
+    CHECK_EQ(2u, histogram.getCount(0));
+    CHECK_EQ(1u, histogram.getCount(LatencyHistogram::bucketFor(5000)));
+    CHECK_EQ(5000u, histogram.getMaxUs());
+
+    histogram.reset();
+    CHECK_EQ(0u, histogram.getCount(0));
+    CHECK_EQ(0u, histogram.getMaxUs());
+}
+
+static void testTimesCallbacksAndJitter() {
+    AudioStats stats;
+
+    // Due 5 ms after the first but arriving about 20 ms later
+    { AudioStats::CallbackTimer timer(stats, 5000); }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    { AudioStats::CallbackTimer timer(stats, 5000); }
+    // Nothing to compare against
+    { AudioStats::CallbackTimer timer(stats, 0); }
+
+    stats.onDroppedBlock();
+    stats.onStarvedBlock();
+    stats.onStarvedBlock();
+    stats.setWriterLag(3000);
+    stats.setWriterLag(1000);
+
+    int64_t packed[AudioStats::PACKED_SIZE];
+    stats.snapshot(packed);
+    CHECK_EQ(3, packed[AudioStats::CALLBACKS]);
+    CHECK_EQ(3u, sumBuckets(packed, AudioStats::DURATION_BUCKETS));
+    // The first callback has no predecessor and the last was not due
+    CHECK_EQ(1u, sumBuckets(packed, AudioStats::JITTER_BUCKETS));
+    CHECK(packed[AudioStats::MAX_JITTER_US] >= 14000);
+    CHECK(packed[AudioStats::MAX_CALLBACK_US] < 14000);
+    CHECK_EQ(1, packed[AudioStats::DROPPED_BLOCKS]);
+    CHECK_EQ(2, packed[AudioStats::STARVED_BLOCKS]);
+    CHECK_EQ(1000, packed[AudioStats::WRITER_LAG_US]);
+    CHECK_EQ(3000, packed[AudioStats::MAX_WRITER_LAG_US]);
+
+    stats.reset();
+    stats.snapshot(packed);
+    for (size_t i = 0; i < AudioStats::PACKED_SIZE; i++) {
+        CHECK_EQ(0, packed[i]);
+    }
+}
+
+static void testRecorderCountsDroppedBlocks() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    CHECK(recorder.initialize());
+    CHECK(recorder.configureFormat(48000, 2, SampleFormat::FLOAT32));
+
+    // Thirty seconds in one burst is far more than the writer's ring holds
+    CHECK(recorder.startRecording(TEST_FILE));
+    size_t callbacks = backend.advanceCapture(30 * 48000);
+    CHECK(recorder.stopRecording());
+
+    const AudioStats& stats = recorder.getStats();
+    const size_t blockSamples = 1024 * 2;
+    CHECK_EQ(callbacks, stats.getCallbackCount());
+    CHECK(stats.getDroppedBlocks() > 0);
+    CHECK_EQ(stats.getDroppedBlocks() * blockSamples, recorder.getFileWriter().getSamplesDropped());
+    // The writer was behind by most of its ring: 512 KB is about 1.4 s here
+    CHECK(stats.getMaxWriterLagUs() > 500000);
+    CHECK(stats.getMaxWriterLagUs() <= 1400000);
+
+    // A take the writer can keep up with starts from zero
+    CHECK(recorder.startRecording(TEST_FILE));
+    callbacks = backend.runCaptureAtSpeed(48000, 50.0);
+    CHECK(recorder.stopRecording());
+    CHECK_EQ(callbacks, stats.getCallbackCount());
+    CHECK_EQ(0u, stats.getDroppedBlocks());
+    CHECK_EQ(0u, recorder.getFileWriter().getSamplesDropped());
+
+    remove(TEST_FILE);
+    remove("audio_stats_test.peaks");
+}
+
+static void testPlayerCountsCallbacks() {
+    std::vector<short> data(44100);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<short>(i * 3);
+    WavWriter writer(44100, 1, SampleFormat::INT16);
+    writer.open(TEST_FILE);
+    writer.write(data.data(), data.size());
+    writer.close();
+
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    CHECK(player.initialize());
+    CHECK(player.loadAudioFile(TEST_FILE));
+    CHECK(player.startPlayback());
+    size_t rendered = backend.renderBuffers(100);
+
+    // Every buffer plus the request that found the end of the file; the
+    // fake backend waits for the prefetch thread rather than starving
+    const AudioStats& stats = player.getStats();
+    CHECK_EQ(rendered + 1, stats.getCallbackCount());
+    CHECK_EQ(0u, stats.getStarvedBlocks());
+    CHECK_EQ(0u, stats.getDroppedBlocks());
+
+    remove(TEST_FILE);
+}
+
+int main() {
+    RUN_TEST(testHistogramBuckets);
+    RUN_TEST(testTimesCallbacksAndJitter);
+    RUN_TEST(testRecorderCountsDroppedBlocks);
+    RUN_TEST(testPlayerCountsCallbacks);
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+#include "batch_job.h"
+#include "loudness_meter.h"
+#include "test_util.h"
+#include "waveform_index.h"
+#include "wav_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Library normalization: the loudness meter alone, then whole batch jobs
+// across thread counts. The files are uneven on purpose, from a few
+// seconds to a couple of minutes, so a static split across threads would
+// leave some idle while work stealing keeps them all busy. Files are in
+// the page cache, so this is the CPU side; storage only adds to it.
+
+static const int FILE_COUNT = 24;
+static const int SAMPLE_RATE = 48000;
+
+static void writeNoiseFile(const std::string& path, double seconds, std::mt19937& random) {
+    std::normal_distribution<float> noise(0.0f, 3000.0f);
+    std::vector<short> samples(static_cast<size_t>(SAMPLE_RATE * seconds) * 2);
+    for (short& sample : samples) sample = static_cast<short>(std::max(-32768.0f, std::min(32767.0f, noise(random))));
+
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(SAMPLE_RATE, 2, SampleFormat::INT16, samples.size() * sizeof(short), header);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size() * sizeof(short)));
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::vector<float> block(2 * 4096);
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    for (float& sample : block) sample = dist(random);
+    LoudnessMeter meter(SAMPLE_RATE, 2);
+    const size_t meterFrames = SAMPLE_RATE * 600;
+    Stopwatch meterWatch;
+    for (size_t done = 0; done < meterFrames; done += 4096) {
+        meter.process(block.data(), 4096);
+    }
+    double meterSeconds = meterWatch.elapsedSeconds();
+    printf("LoudnessMeter: %.0fx realtime for 48 kHz stereo (%.1f LUFS)\n",
+           meterFrames / static_cast<double>(SAMPLE_RATE) / meterSeconds, meter.getIntegratedLoudness());
+
+    std::vector<std::string> inputs, outputs;
+    double totalSeconds = 0.0;
+    std::uniform_real_distribution<double> lengths(2.0, 120.0);
+    for (int i = 0; i < FILE_COUNT; i++) {
+        inputs.push_back("batch_job_benchmark_" + std::to_string(i) + ".wav");
+        outputs.push_back("batch_job_benchmark_" + std::to_string(i) + "_out.wav");
+        double seconds = i % 6 == 0 ? 120.0 : lengths(random);
+        writeNoiseFile(inputs.back(), seconds, random);
+        totalSeconds += seconds;
+    }
+    printf("%d files, %.0f s of 48 kHz stereo 16-bit\n\n", FILE_COUNT, totalSeconds);
+
+    printf("%-8s %14s %14s %10s\n", "threads", "measure", "normalize", "steals");
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> threadCounts = {1, 2, 4};
+    if (cores > 4) threadCounts.push_back(static_cast<int>(cores));
+    for (int threads : threadCounts) {
+        BatchJob measure(inputs, {}, BatchOptions());
+        Stopwatch measureWatch;
+        measure.start(threads);
+        measure.wait();
+        double measureSeconds = measureWatch.elapsedSeconds();
+
+        BatchJob normalize(inputs, outputs, BatchOptions());
+        Stopwatch normalizeWatch;
+        normalize.start(threads);
+        normalize.wait();
+        double normalizeSeconds = normalizeWatch.elapsedSeconds();
+
+        printf("%-8d %9.0fx rt %9.0fx rt %10llu\n", threads, totalSeconds / measureSeconds,
+               totalSeconds / normalizeSeconds, static_cast<unsigned long long>(normalize.getStealCount()));
+    }
+
+    for (int i = 0; i < FILE_COUNT; i++) {
+        remove(inputs[i].c_str());
+        remove(outputs[i].c_str());
+        remove(WaveformIndex::getSidecarPath(outputs[i]).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include "audio_file_reader.h"
+#include "batch_job.h"
+#include "loudness_meter.h"
+#include "test_util.h"
+#include "wav_file.h"
+#include "wav_probe.h"
+#include "waveform_index.h"
+#include "work_stealing_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// |seconds| of a 1 kHz sine at |dbfs| peak in every channel, written in
+// |format|
+static void writeSineFile(const std::string& path, int sampleRate, int channels, SampleFormat format,
+                          double dbfs, double seconds) {
+    const double pi = 3.14159265358979323846;
+    double amplitude = std::pow(10.0, dbfs / 20.0);
+    size_t count = static_cast<size_t>(sampleRate * seconds) * channels;
+    std::vector<uint8_t> data(count * getBytesPerSample(format));
+    for (size_t i = 0; i < count; i++) {
+        double value = amplitude * std::sin(2.0 * pi * 1000.0 * static_cast<double>(i / channels) / sampleRate);
+        if (format == SampleFormat::FLOAT32) {
+            reinterpret_cast<float*>(data.data())[i] = static_cast<float>(value);
+        } else if (format == SampleFormat::INT24_PACKED) {
+            reinterpret_cast<Int24*>(data.data())[i].set(static_cast<int32_t>(std::lround(value * 8388607.0)));
+        } else {
+            reinterpret_cast<short*>(data.data())[i] = static_cast<short>(std::lround(value * 32767.0));
+        }
+    }
+
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(sampleRate, channels, format, data.size(), header);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+static double measureFile(const std::string& path) {
+    AudioFileReader reader;
+    if (!reader.open(path)) {
+        return NAN;
+    }
+    LoudnessMeter meter(static_cast<int>(reader.getSampleRate()), reader.getChannels());
+    std::vector<float> samples(AudioFileReader::READ_FRAMES * reader.getChannels());
+    while (size_t frames = reader.read(samples.data(), AudioFileReader::READ_FRAMES)) {
+        meter.process(samples.data(), frames);
+    }
+    return meter.getIntegratedLoudness();
+}
+
+static bool fileExists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+static void removeOutput(const std::string& path) {
+    remove(path.c_str());
+    remove(WaveformIndex::getSidecarPath(path).c_str());
+}
+
+static void testPoolStealsNestedWork() {
+    WorkStealingPool pool(4);
+    CHECK_EQ(4u, pool.getThreadCount());
+
+    // Every child lands on the parent's queue; the other workers only get
+    // any by stealing
+    std::atomic<int> ran{0};
+    pool.submit([&] {
+        for (int i = 0; i < 200; i++) {
+            pool.submit([&] {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                ran++;
+            });
+        }
+        ran++;
+    });
+    pool.wait();
+    CHECK_EQ(201, ran.load());
+    CHECK(pool.isIdle());
+    CHECK(pool.getStealCount() > 0);
+
+    // Outside submissions, and a pool that is reused after waiting
+    for (int i = 0; i < 100; i++) {
+        pool.submit([&] { ran++; });
+    }
+    pool.wait();
+    CHECK_EQ(301, ran.load());
+}
+
+static void testNormalizesEveryFormat() {
+    const std::vector<std::string> inputs = {"batch_job_test_16.wav", "batch_job_test_24.wav",
+                                             "batch_job_test_float.wav", "batch_job_test_missing.wav"};
+    const std::vector<std::string> outputs = {"batch_job_test_16_out.wav", "batch_job_test_24_out.wav",
+                                              "batch_job_test_float_out.wav", "batch_job_test_missing_out.wav"};
+    writeSineFile(inputs[0], 48000, 2, SampleFormat::INT16, -35.0, 5.0);
+    writeSineFile(inputs[1], 44100, 1, SampleFormat::INT24_PACKED, -30.0, 5.0);
+    writeSineFile(inputs[2], 48000, 2, SampleFormat::FLOAT32, -30.0, 5.0);
+
+    BatchOptions options;
+    options.targetLufs = -16.0;
+    options.maxPeakDbfs = -14.0;
+    BatchJob job(inputs, outputs, options);
+    CHECK(job.start(3));
+    job.wait();
+    CHECK(job.isFinished());
+    CHECK_EQ(4u, job.getFinishedCount());
+    CHECK_NEAR(1.0, job.getProgress(), 1e-6);
+
+    BatchFileResult stereo = job.getResult(0);
+    CHECK(stereo.status == BatchStatus::DONE);
+    CHECK_NEAR(-35.0, stereo.loudness, 0.1);
+    CHECK_NEAR(19.0, stereo.gainDb, 0.1);
+    CHECK_NEAR(-16.0, measureFile(outputs[0]), 0.1);
+
+    // Mono reads 3 LU under the same sine in stereo, so its peak is what
+    // holds the gain back: 16 dB rather than the 17 wanted
+    BatchFileResult mono = job.getResult(1);
+    CHECK(mono.status == BatchStatus::DONE);
+    CHECK_NEAR(-33.0, mono.loudness, 0.1);
+    CHECK_NEAR(-30.0, 20.0 * std::log10(mono.samplePeak), 0.01);
+    CHECK_NEAR(16.0, mono.gainDb, 0.01);
+    CHECK_NEAR(-17.0, measureFile(outputs[1]), 0.1);
+
+    BatchFileResult floats = job.getResult(2);
+    CHECK(floats.status == BatchStatus::DONE);
+    CHECK_NEAR(14.0, floats.gainDb, 0.1);
+    CHECK_NEAR(-16.0, measureFile(outputs[2]), 0.1);
+
+    CHECK(job.getResult(3).status == BatchStatus::FAILED);
+    CHECK(!fileExists(outputs[3]));
+
+    // Each output keeps its source's format and gets a waveform sidecar
+    WavInfo info;
+    CHECK(probeWavFile(outputs[1], info));
+    CHECK_EQ(24, info.bitsPerSample);
+    CHECK_EQ(44100u, info.sampleRate);
+    CHECK_EQ(44100u * 5, info.frameCount);
+    CHECK(probeWavFile(outputs[2], info));
+    CHECK_EQ(WAV_FORMAT_IEEE_FLOAT, info.audioFormat);
+    std::vector<PeakBin> bins;
+    CHECK(WaveformIndex::loadLevel(WaveformIndex::getSidecarPath(outputs[0]), 0, bins));
+    CHECK_EQ(48000u * 5 / WaveformIndex::BASE_FRAMES_PER_BIN + 1, bins.size());
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        remove(inputs[i].c_str());
+        removeOutput(outputs[i]);
+    }
+}
+
+static void testConvertsInPlaceAndToFlac() {
+    const std::string wavPath = "batch_job_test_convert.wav";
+    const std::string flacPath = "batch_job_test_convert.flac";
+    writeSineFile(wavPath, 48000, 2, SampleFormat::FLOAT32, -20.0, 3.0);
+
+    // Straight conversion, no gain
+    BatchOptions options;
+    options.normalize = false;
+    options.outputFormat = AudioFileFormat::FLAC;
+    BatchJob flacJob({wavPath}, {flacPath}, options);
+    CHECK(flacJob.start(0));
+    flacJob.wait();
+    CHECK(flacJob.getResult(0).status == BatchStatus::DONE);
+    CHECK_EQ(0.0, flacJob.getResult(0).gainDb);
+
+    AudioFileReader source, converted;
+    CHECK(source.open(wavPath));
+    CHECK(converted.open(flacPath));
+    CHECK_EQ(48000u * 3, converted.getFrameCount());
+    std::vector<float> expected(2 * 4096), actual(2 * 4096);
+    size_t frames = 0;
+    bool matches = true;
+    while (size_t got = source.read(expected.data(), 4096)) {
+        size_t decoded = 0;
+        while (decoded < got) {
+            size_t more = converted.read(actual.data() + decoded * 2, got - decoded);
+            if (more == 0) break;
+            decoded += more;
+        }
+        matches = matches && decoded == got;
+        for (size_t i = 0; i < got * 2 && matches; i++) {
+            matches = std::fabs(expected[i] - actual[i]) <= 1.0f / 32768.0f;
+        }
+        frames += got;
+    }
+    CHECK(matches);
+    CHECK_EQ(48000u * 3, frames);
+
+    // Normalized over itself, as 16-bit
+    options.normalize = true;
+    options.outputFormat = AudioFileFormat::WAV;
+    options.convertSampleFormat = true;
+    options.sampleFormat = SampleFormat::INT16;
+    BatchJob inPlace({wavPath}, {wavPath}, options);
+    CHECK(inPlace.start(1));
+    inPlace.wait();
+    CHECK(inPlace.getResult(0).status == BatchStatus::DONE);
+    CHECK(!fileExists(wavPath + ".part"));
+    CHECK_NEAR(-23.0, measureFile(wavPath), 0.1);
+    WavInfo info;
+    CHECK(probeWavFile(wavPath, info));
+    CHECK_EQ(16, info.bitsPerSample);
+
+    removeOutput(wavPath);
+    removeOutput(flacPath);
+}
+
+static void testMeasureOnlyAndCancel() {
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 12; i++) {
+        inputs.push_back("batch_job_test_library_" + std::to_string(i) + ".wav");
+        writeSineFile(inputs.back(), 48000, 2, SampleFormat::INT16, -20.0 - i, 4.0);
+    }
+
+    // No outputs: measure, leave the files alone
+    BatchJob measure(inputs, {}, BatchOptions());
+    CHECK(measure.start(0));
+    measure.wait();
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BatchFileResult result = measure.getResult(i);
+        CHECK(result.status == BatchStatus::DONE);
+        CHECK_NEAR(-20.0 - i, result.loudness, 0.1);
+        CHECK(!fileExists(WaveformIndex::getSidecarPath(inputs[i])));
+    }
+
+    // Cancelled at once: whatever did not finish left nothing behind
+    std::vector<std::string> outputs;
+    for (const std::string& input : inputs) outputs.push_back(input + ".out.wav");
+    BatchJob cancelled(inputs, outputs, BatchOptions());
+    CHECK(cancelled.start(2));
+    cancelled.cancel();
+    cancelled.wait();
+    CHECK(cancelled.isFinished());
+    size_t cancelledCount = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BatchStatus status = cancelled.getResult(i).status;
+        CHECK(status == BatchStatus::DONE || status == BatchStatus::CANCELLED);
+        CHECK_EQ(status == BatchStatus::DONE, fileExists(outputs[i]));
+        CHECK(!fileExists(outputs[i] + ".part"));
+        if (status == BatchStatus::CANCELLED) cancelledCount++;
+        removeOutput(outputs[i]);
+        remove(inputs[i].c_str());
+    }
+    CHECK(cancelledCount > 0);
+
+    // Mismatched outputs, or nothing to do
+    BatchJob mismatched({"a.wav", "b.wav"}, {"c.wav"}, BatchOptions());
+    CHECK(!mismatched.start(1));
+    BatchOptions nothing;
+    nothing.normalize = false;
+    BatchJob idle({"a.wav"}, {}, nothing);
+    CHECK(!idle.start(1));
+}
+
+int main() {
+    RUN_TEST(testPoolStealsNestedWork);
+    RUN_TEST(testNormalizesEveryFormat);
+    RUN_TEST(testConvertsInPlaceAndToFlac);
+    RUN_TEST(testMeasureOnlyAndCancel);
+    return TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+#include "edit_list.h"
+#include "sample_convert.h"
+#include "test_util.h"
+#include "wav_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+// What editing a long 48 kHz stereo take costs. Each edit only rewrites
+// the list, so its time depends on the number of ranges alone. Rendering
+// copies range interiors as they are and mixes only the crossfades; it is
+// set against an editor that decodes every sample to float and back on
+// its way to the new file, for takes of several lengths with a few edits
+// and for one take with many.
+
+static const int SAMPLE_RATE = 48000;
+static const int CHANNELS = 2;
+static const size_t BLOCK_ALIGN = CHANNELS * sizeof(short);
+static const char* TAKE = "edit_list_benchmark_take.wav";
+static const char* RENDERED = "edit_list_benchmark_render.wav";
+static const uint64_t CROSSFADE_FRAMES = SAMPLE_RATE / 100;
+
+static volatile uint8_t g_sink = 0;
+
+// A take of |minutes| filled with a pattern, so every page is real data
+static bool writeTake(size_t minutes) {
+    uint64_t frames = static_cast<uint64_t>(minutes) * 60 * SAMPLE_RATE;
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(SAMPLE_RATE, CHANNELS, SampleFormat::INT16, frames * BLOCK_ALIGN, header);
+    int fd = open(TAKE, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool written = write(fd, header, sizeof(header)) == static_cast<ssize_t>(sizeof(header));
+    std::vector<short> block(1 << 20);
+    for (size_t i = 0; i < block.size(); i++) block[i] = static_cast<short>(i * 31);
+    uint64_t bytes = frames * BLOCK_ALIGN;
+    for (uint64_t done = 0; written && done < bytes; done += block.size() * sizeof(short)) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(block.size() * sizeof(short), bytes - done));
+        written = write(fd, block.data(), chunk) == static_cast<ssize_t>(chunk);
+    }
+    close(fd);
+    return written;
+}
+
+// |edits| cuts of a second each, spread evenly over the take
+static double makeEdits(EditList& list, size_t edits) {
+    list.clear();
+    int source = list.addSource(TAKE);
+    list.append(static_cast<size_t>(source), 0, list.getSourceFrameCount(static_cast<size_t>(source)));
+    list.setCrossfade(CROSSFADE_FRAMES);
+    Stopwatch stopwatch;
+    uint64_t step = list.getFrameCount() / (edits + 1);
+    for (size_t i = edits; i > 0; i--) {
+        list.cut(i * step, SAMPLE_RATE);
+    }
+    return stopwatch.elapsedSeconds() * 1000.0 / edits;
+}
+
+static double measureRender(const EditList& list) {
+    remove(RENDERED);
+    Stopwatch stopwatch;
+    list.render(RENDERED);
+    return stopwatch.elapsedSeconds() * 1000.0;
+}
+
+// The whole timeline through float, 1 MiB at a time
+static double measureRewrite(const EditList& list) {
+    remove(RENDERED);
+    Stopwatch stopwatch;
+    int fd = open(RENDERED, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    std::vector<uint8_t> buffer(1 << 20);
+    size_t bufferFrames = buffer.size() / BLOCK_ALIGN;
+    std::vector<float> samples(bufferFrames * CHANNELS);
+    short* pcm = reinterpret_cast<short*>(buffer.data());
+    bool written = true;
+    for (uint64_t frame = 0; written && frame < list.getFrameCount();) {
+        size_t got = list.read(frame, buffer.data(), bufferFrames);
+        convertSamples(pcm, samples.data(), got * CHANNELS);
+        convertSamples(samples.data(), pcm, got * CHANNELS);
+        written = got > 0 && write(fd, buffer.data(), got * BLOCK_ALIGN) == static_cast<ssize_t>(got * BLOCK_ALIGN);
+        frame += got;
+    }
+    close(fd);
+    g_sink = g_sink + buffer[0];
+    return stopwatch.elapsedSeconds() * 1000.0;
+}
+
+// Best of a few rounds of each, alternating, so neither gets a colder
+// page cache
+static void measureBoth(const EditList& list, double& renderMs, double& rewriteMs) {
+    renderMs = 1e9;
+    rewriteMs = 1e9;
+    for (int round = 0; round < 3; round++) {
+        rewriteMs = std::min(rewriteMs, measureRewrite(list));
+        renderMs = std::min(renderMs, measureRender(list));
+    }
+}
+
+int main() {
+    printf("48 kHz stereo 16-bit, 1 s cuts, %llu-frame crossfades\n",
+           static_cast<unsigned long long>(CROSSFADE_FRAMES));
+    printf("%-8s %6s %10s %10s %10s %8s\n", "take", "edits", "edit ms", "render ms", "decode ms", "speedup");
+
+    EditList list;
+    for (size_t minutes : {1, 10, 30}) {
+        if (!writeTake(minutes)) {
+            printf("Could not write a %zu minute take\n", minutes);
+            break;
+        }
+        double editMs = makeEdits(list, 10);
+        double renderMs, rewriteMs;
+        measureBoth(list, renderMs, rewriteMs);
+        printf("%3zu min  %6d %10.4f %10.1f %10.1f %7.1fx\n", minutes, 10, editMs, renderMs, rewriteMs,
+               rewriteMs / renderMs);
+    }
+
+    for (size_t edits : {1, 100, 1000}) {
+        double editMs = makeEdits(list, edits);
+        double renderMs, rewriteMs;
+        measureBoth(list, renderMs, rewriteMs);
+        printf("%3d min  %6zu %10.4f %10.1f %10.1f %7.1fx\n", 30, edits, editMs, renderMs, rewriteMs,
+               rewriteMs / renderMs);
+    }
+
+    remove(TAKE);
+    remove(RENDERED);
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "audio_player.h"
+#include "edit_list.h"
+#include "fake_audio_backend.h"
+#include "test_util.h"
+#include "wav_file.h"
+#include "wav_probe.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static const char* TAKE_A = "edit_list_test_a.wav";
+static const char* TAKE_B = "edit_list_test_b.wav";
+static const char* OTHER_RATE = "edit_list_test_other.wav";
+static const char* RENDERED = "edit_list_test_render.wav";
+static const char* SAVED = "edit_list_test.edl";
+
+static void writeWav(const char* path, int sampleRate, int channels, const std::vector<short>& samples) {
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(sampleRate, channels, SampleFormat::INT16, samples.size() * sizeof(short), header);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size() * sizeof(short)));
+}
+
+// Stereo take whose every sample says where it came from: |base| plus
+// the frame index on the left, minus it on the right
+static std::vector<short> writeTake(const char* path, size_t frames, short base) {
+    std::vector<short> samples(frames * 2);
+    for (size_t i = 0; i < frames; i++) {
+        samples[2 * i] = static_cast<short>(base + i);
+        samples[2 * i + 1] = static_cast<short>(base - i);
+    }
+    writeWav(path, 8000, 2, samples);
+    return samples;
+}
+
+static void appendFrames(std::vector<short>& out, const std::vector<short>& take, size_t start, size_t frames) {
+    out.insert(out.end(), take.begin() + 2 * start, take.begin() + 2 * (start + frames));
+}
+
+static std::vector<short> readAll(const EditList& list) {
+    std::vector<short> samples(list.getFrameCount() * 2);
+    // In odd-sized pieces, so reads start and stop inside ranges
+    size_t done = 0;
+    while (done < list.getFrameCount()) {
+        size_t got = list.read(done, reinterpret_cast<uint8_t*>(&samples[done * 2]), 333);
+        if (got == 0) break;
+        done += got;
+    }
+    samples.resize(done * 2);
+    return samples;
+}
+
+static void testEditsOnlyTheList() {
+    std::vector<short> a = writeTake(TAKE_A, 5000, 0);
+    std::vector<short> b = writeTake(TAKE_B, 3000, 10000);
+
+    EditList list;
+    CHECK_EQ(0, list.addSource(TAKE_A));
+    CHECK_EQ(1, list.addSource(TAKE_B));
+    CHECK_EQ(0, list.addSource(TAKE_A));
+    CHECK(list.append(0, 0, 5000));
+    CHECK(list.append(1, 500, 2000));
+    CHECK(!list.append(1, 2000, 1001));
+    CHECK(!list.append(2, 0, 10));
+    CHECK_EQ(7000u, list.getFrameCount());
+
+    // A cut spanning the join, then one inside a range
+    CHECK(list.cut(4000, 1500));
+    CHECK(list.cut(1000, 500));
+    std::vector<short> expected;
+    appendFrames(expected, a, 0, 1000);
+    appendFrames(expected, a, 1500, 2500);
+    appendFrames(expected, b, 1000, 1500);
+    CHECK_EQ(5000u, list.getFrameCount());
+    CHECK_EQ(3u, list.getRanges().size());
+    CHECK(readAll(list) == expected);
+    CHECK(!list.cut(4000, 1001));
+
+    // Trimming off both ends
+    CHECK(list.trim(200, 4000));
+    expected = std::vector<short>(expected.begin() + 400, expected.begin() + 8400);
+    CHECK(readAll(list) == expected);
+
+    // Putting back what was cut runs on from the range before, so the
+    // list goes back to one range
+    EditList whole;
+    whole.addSource(TAKE_A);
+    CHECK(whole.append(0, 0, 1000));
+    CHECK(whole.append(0, 1000, 4000));
+    CHECK_EQ(1u, whole.getRanges().size());
+
+    // Takes of another rate cannot join
+    std::vector<short> other(200);
+    writeWav(OTHER_RATE, 44100, 2, other);
+    CHECK_EQ(-1, list.addSource(OTHER_RATE));
+    CHECK_EQ(-1, list.addSource("edit_list_test_missing.wav"));
+    remove(OTHER_RATE);
+}
+
+static void testSplitJoinSaveAndLoad() {
+    writeTake(TAKE_A, 5000, 0);
+    writeTake(TAKE_B, 3000, 10000);
+
+    EditList list;
+    list.append(list.addSource(TAKE_A), 1000, 3000);
+    list.append(list.addSource(TAKE_B), 0, 3000);
+    std::vector<short> expected = readAll(list);
+
+    EditList tail;
+    CHECK(list.split(2000, tail));
+    CHECK_EQ(2000u, list.getFrameCount());
+    CHECK_EQ(4000u, tail.getFrameCount());
+    CHECK(readAll(tail) == std::vector<short>(expected.begin() + 4000, expected.end()));
+    CHECK(!list.split(0, tail) && !list.split(2000, tail));
+
+    // Joined back, the split closes up again
+    CHECK(list.append(tail));
+    CHECK_EQ(2u, list.getRanges().size());
+    CHECK(readAll(list) == expected);
+
+    list.setCrossfade(100);
+    CHECK(list.save(SAVED));
+    EditList loaded;
+    CHECK(loaded.load(SAVED));
+    CHECK_EQ(100u, loaded.getCrossfade());
+    CHECK_EQ(2u, loaded.getRanges().size());
+    CHECK(loaded.getSourcePath(1) == TAKE_B);
+    CHECK(readAll(loaded) == readAll(list));
+
+    // A source cut shorter than the list needs fails the load
+    writeTake(TAKE_B, 1000, 10000);
+    CHECK(!loaded.load(SAVED));
+    CHECK_EQ(0u, loaded.getFrameCount());
+    remove(SAVED);
+}
+
+static void testCrossfadeIsCentredOnTheJoin() {
+    std::vector<short> a(2 * 4000, 8000);
+    std::vector<short> b(2 * 4000, 16000);
+    writeWav(TAKE_A, 8000, 2, a);
+    writeWav(TAKE_B, 8000, 2, b);
+
+    // Both sides have material beyond the join to fade through
+    EditList list;
+    list.append(list.addSource(TAKE_A), 0, 1000);
+    list.append(list.addSource(TAKE_B), 1000, 1000);
+    list.setCrossfade(200);
+    CHECK_EQ(2000u, list.getFrameCount());
+    std::vector<short> samples = readAll(list);
+    CHECK_EQ(4000u, samples.size());
+    CHECK_EQ(8000, samples[2 * 899]);
+    CHECK_EQ(16000, samples[2 * 1100 + 1]);
+    // Equal power: both at cos(pi/4) at the join
+    CHECK_NEAR(24000.0 * std::cos(0.25 * 3.14159265358979), samples[2 * 1000], 100.0);
+    bool rising = true;
+    for (size_t i = 901; i < 1000; i++) rising = rising && samples[2 * i] >= samples[2 * (i - 1)];
+    CHECK(rising);
+
+    // Nothing before B's first frame, so that join stays a hard cut
+    EditList hard;
+    hard.append(hard.addSource(TAKE_A), 0, 1000);
+    hard.append(hard.addSource(TAKE_B), 0, 1000);
+    hard.setCrossfade(200);
+    samples = readAll(hard);
+    CHECK_EQ(8000, samples[2 * 999]);
+    CHECK_EQ(16000, samples[2 * 1000]);
+}
+
+static void testRenderMatchesPlayback() {
+    writeTake(TAKE_A, 50000, 0);
+    writeTake(TAKE_B, 30000, 10000);
+
+    EditList list;
+    list.append(list.addSource(TAKE_A), 0, 50000);
+    list.append(list.addSource(TAKE_B), 0, 30000);
+    CHECK(list.cut(10000, 5000));
+    CHECK(list.cut(40000, 12345));
+    CHECK(list.trim(7, 60000));
+    list.setCrossfade(160);
+    std::vector<short> expected = readAll(list);
+
+    CHECK(list.render(RENDERED));
+    WavInfo info;
+    CHECK(probeWavFile(RENDERED, info));
+    CHECK_EQ(60000u, info.frameCount);
+    CHECK_EQ(8000u, info.sampleRate);
+    std::ifstream in(RENDERED, std::ios::binary);
+    std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK_EQ(WAV_HEADER_SIZE + expected.size() * sizeof(short), file.size());
+    CHECK(memcmp(file.data() + WAV_HEADER_SIZE, expected.data(), expected.size() * sizeof(short)) == 0);
+
+    // Sources are never written
+    CHECK(!list.render(TAKE_A));
+    CHECK(EditList().render(RENDERED) == false);
+
+    // The player reads the list the same way, with no render in between
+    FakeAudioBackend backend;
+    AudioPlayer player(backend);
+    CHECK(player.initialize());
+    CHECK(player.loadEditList(list));
+    CHECK_EQ(7500, player.getDurationMs());
+    CHECK(player.startPlayback());
+    backend.renderBuffers(1000);
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK(backend.getRendered() == expected);
+
+    // Later edits to the list leave what was loaded alone
+    list.clear();
+    CHECK_EQ(7500, player.getDurationMs());
+
+    remove(RENDERED);
+}
+
+int main() {
+    RUN_TEST(testEditsOnlyTheList);
+    RUN_TEST(testSplitJoinSaveAndLoad);
+    RUN_TEST(testCrossfadeIsCentredOnTheJoin);
+    RUN_TEST(testRenderMatchesPlayback);
+    remove(TAKE_A);
+    remove(TAKE_B);
+    return TEST_RESULT();
+}
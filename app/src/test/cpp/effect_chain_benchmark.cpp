@@ -0,0 +1,131 @@
+#include "biquad_cascade.h"
+#include "effect_chain.h"
+#include "sample_convert.h"
+#include "test_util.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Capture effects: the biquad cascade against its scalar loop, then each
+// effect and the whole chain per capture block, as a share of the time
+// the callback has before the next block is due.
+
+static const int SAMPLE_RATE = 48000;
+static const size_t TOTAL_FRAMES = 1ull << 24;
+
+static volatile float g_sink = 0.0f;
+
+static double measureCascade(bool simd, int channels, const std::vector<float>& noise) {
+    BiquadCascade cascade(channels);
+    BiquadCoefficients sections[2] = {BiquadCoefficients::highPass(SAMPLE_RATE, 80.0, 0.5412),
+                                      BiquadCoefficients::highPass(SAMPLE_RATE, 80.0, 1.3066)};
+    cascade.setSections(sections, 2);
+    const size_t blockFrames = 1024;
+    std::vector<float> block(blockFrames * channels);
+    Stopwatch stopwatch;
+    for (size_t done = 0; done < TOTAL_FRAMES; done += blockFrames) {
+        std::copy(noise.begin(), noise.begin() + block.size(), block.begin());
+        if (simd) {
+            cascade.process(block.data(), blockFrames);
+        } else {
+            cascade.processScalar(block.data(), blockFrames);
+        }
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    g_sink = g_sink + block[0];
+    return TOTAL_FRAMES / seconds;
+}
+
+// Microseconds per block of |blockFrames|, fresh input for every block as
+// the device would give
+static double measureChain(const EffectSettings& settings, int channels, size_t blockFrames,
+                           const std::vector<float>& noise) {
+    EffectChain chain(SAMPLE_RATE, channels);
+    chain.setSettings(settings);
+    std::vector<float> block(blockFrames * channels);
+    size_t blocks = TOTAL_FRAMES / blockFrames;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < blocks; i++) {
+        std::copy(noise.begin(), noise.begin() + block.size(), block.begin());
+        if (chain.beginBlock()) {
+            chain.process(block.data(), blockFrames);
+        }
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    g_sink = g_sink + block[0];
+    return seconds * 1e6 / blocks;
+}
+
+// The recorder's 16-bit path converts to float and back around the chain
+static double measureRoundTrip(int channels, size_t blockFrames, const std::vector<float>& noise) {
+    std::vector<short> captured(blockFrames * channels), out(blockFrames * channels);
+    convertSamples(noise.data(), captured.data(), captured.size());
+    std::vector<float> block(blockFrames * channels);
+    size_t blocks = TOTAL_FRAMES / blockFrames;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < blocks; i++) {
+        convertSamples(captured.data(), block.data(), block.size());
+        convertSamples(block.data(), out.data(), out.size());
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    g_sink = g_sink + out[0];
+    return seconds * 1e6 / blocks;
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::normal_distribution<float> dist(0.0f, 0.1f);
+    std::vector<float> noise(2 * 4096);
+    for (float& sample : noise) sample = dist(random);
+
+    printf("Biquad cascade, 4th-order high-pass\n");
+    printf("%-10s %14s %14s %8s\n", "channels", "scalar", "simd", "speedup");
+    for (int channels = 1; channels <= 2; channels++) {
+        double scalar = measureCascade(false, channels, noise);
+        double simd = measureCascade(true, channels, noise);
+        printf("%-10d %7.1f Mfr/s %7.1f Mfr/s %7.1fx\n", channels, scalar / 1e6, simd / 1e6, simd / scalar);
+    }
+
+    EffectSettings highPass;
+    highPass.highPassHz = 80.0f;
+    EffectSettings gate;
+    gate.gateEnabled = true;
+    EffectSettings agc;
+    agc.agcEnabled = true;
+    EffectSettings limiter;
+    limiter.limiterEnabled = true;
+    EffectSettings all;
+    all.highPassHz = 80.0f;
+    all.gateEnabled = true;
+    all.agcEnabled = true;
+    all.limiterEnabled = true;
+    struct Row {
+        const char* name;
+        EffectSettings settings;
+    };
+    const Row rows[] = {{"high-pass", highPass}, {"gate", gate}, {"agc", agc}, {"limiter", limiter},
+                        {"all four", all}};
+
+    for (size_t blockFrames : {256, 1024}) {
+        double periodUs = 1e6 * blockFrames / SAMPLE_RATE;
+        printf("\n%zu-frame blocks at 48 kHz, due every %.0f us: us per block (%% of period)\n",
+               blockFrames, periodUs);
+        printf("%-18s %16s %16s\n", "effect", "mono", "stereo");
+        for (const Row& row : rows) {
+            printf("%-18s", row.name);
+            for (int channels = 1; channels <= 2; channels++) {
+                double us = measureChain(row.settings, channels, blockFrames, noise);
+                printf(" %8.2f (%5.2f%%)", us, 100.0 * us / periodUs);
+            }
+            printf("\n");
+        }
+        printf("%-18s", "16-bit round trip");
+        for (int channels = 1; channels <= 2; channels++) {
+            double us = measureRoundTrip(channels, blockFrames, noise);
+            printf(" %8.2f (%5.2f%%)", us, 100.0 * us / periodUs);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,284 @@
+#include "audio_recorder.h"
+#include "biquad_cascade.h"
+#include "effect_chain.h"
+#include "fake_audio_backend.h"
+#include "sample_convert.h"
+#include "test_util.h"
+#include "wav_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const double PI = 3.14159265358979323846;
+static const char* TEST_FILE = "effect_chain_test.wav";
+
+// |seconds| of a sine at |amplitude|, the same in every channel
+static std::vector<float> makeSine(int sampleRate, int channels, double frequency, double amplitude,
+                                   double seconds) {
+    size_t frames = static_cast<size_t>(sampleRate * seconds);
+    std::vector<float> samples(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        float value = static_cast<float>(amplitude * std::sin(2.0 * PI * frequency * i / sampleRate));
+        for (int c = 0; c < channels; c++) samples[i * channels + c] = value;
+    }
+    return samples;
+}
+
+static void runChain(EffectChain& chain, std::vector<float>& samples, int channels, size_t blockFrames) {
+    size_t frames = samples.size() / channels;
+    for (size_t done = 0; done < frames; done += blockFrames) {
+        if (chain.beginBlock()) {
+            chain.process(samples.data() + done * channels, std::min(blockFrames, frames - done));
+        }
+    }
+}
+
+static double rmsDb(const float* samples, size_t count) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) sum += static_cast<double>(samples[i]) * samples[i];
+    return 10.0 * std::log10(sum / count);
+}
+
+static float peakOf(const float* samples, size_t count) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < count; i++) peak = std::max(peak, std::fabs(samples[i]));
+    return peak;
+}
+
+static void testCascadeMatchesScalar() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    BiquadCoefficients sections[3] = {BiquadCoefficients::highPass(48000, 40.0, 0.54),
+                                      BiquadCoefficients::highPass(48000, 300.0, 1.31),
+                                      BiquadCoefficients::highPass(48000, 2000.0, 0.7)};
+    for (int channels = 1; channels <= 2; channels++) {
+        BiquadCascade simd(channels), scalar(channels);
+        simd.setSections(sections, 3);
+        scalar.setSections(sections, 3);
+        const size_t blockSizes[] = {1, 7, 256, 1023};
+        bool matches = true;
+        for (size_t blockFrames : blockSizes) {
+            std::vector<float> a(blockFrames * channels);
+            for (float& sample : a) sample = dist(random);
+            std::vector<float> b = a;
+            simd.process(a.data(), blockFrames);
+            scalar.processScalar(b.data(), blockFrames);
+            for (size_t i = 0; i < a.size(); i++) matches = matches && std::fabs(a[i] - b[i]) <= 1e-5f;
+        }
+        CHECK(matches);
+    }
+
+    // Unused sections pass samples through, LATENCY_FRAMES late
+    BiquadCascade passThrough(2);
+    std::vector<float> samples(2 * 64);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i + 1);
+    std::vector<float> input = samples;
+    passThrough.process(samples.data(), 64);
+    for (int i = 0; i < 2 * BiquadCascade::LATENCY_FRAMES; i++) CHECK_EQ(0.0f, samples[i]);
+    bool delayed = true;
+    for (size_t i = 2 * BiquadCascade::LATENCY_FRAMES; i < samples.size(); i++) {
+        delayed = delayed && samples[i] == input[i - 2 * BiquadCascade::LATENCY_FRAMES];
+    }
+    CHECK(delayed);
+}
+
+static void testHighPassRemovesDcAndRumble() {
+    EffectChain chain(48000, 2);
+    EffectSettings settings;
+    settings.highPassHz = 80.0f;
+    chain.setSettings(settings);
+
+    // An offset and a 20 Hz hum under a 1 kHz tone
+    std::vector<float> samples = makeSine(48000, 2, 1000.0, 0.25, 2.0);
+    std::vector<float> hum = makeSine(48000, 2, 20.0, 0.25, 2.0);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] += 0.2f + hum[i];
+    runChain(chain, samples, 2, 480);
+
+    // Past the first half second: the tone at full level, the rest gone
+    const float* settled = samples.data() + 48000;
+    size_t count = samples.size() - 48000;
+    double mean = 0.0;
+    for (size_t i = 0; i < count; i++) mean += settled[i];
+    CHECK_NEAR(0.0, mean / count, 1e-4);
+    CHECK_NEAR(20.0 * std::log10(0.25 / std::sqrt(2.0)), rmsDb(settled, count), 0.1);
+}
+
+static void testGateTurnsDownQuietInput() {
+    EffectChain chain(48000, 1);
+    EffectSettings settings;
+    settings.gateEnabled = true;
+    settings.gateThresholdDb = -40.0f;
+    settings.gateHoldMs = 50;
+    chain.setSettings(settings);
+
+    // Speech-level tone, then room noise under the threshold
+    std::vector<float> samples = makeSine(48000, 1, 500.0, 0.1, 1.0);
+    std::vector<float> quiet = makeSine(48000, 1, 500.0, 0.003, 1.0);
+    samples.insert(samples.end(), quiet.begin(), quiet.end());
+    runChain(chain, samples, 1, 256);
+
+    CHECK_NEAR(20.0 * std::log10(0.1 / std::sqrt(2.0)), rmsDb(samples.data() + 4800, 43200), 0.05);
+    // Hold and release are long over well into the quiet
+    double quietDb = 20.0 * std::log10(0.003 / std::sqrt(2.0));
+    CHECK_NEAR(quietDb - EffectChain::GATE_RANGE_DB, rmsDb(samples.data() + 84000, 12000), 0.1);
+}
+
+static void testAgcRidesTowardTarget() {
+    EffectChain chain(48000, 1);
+    EffectSettings settings;
+    settings.agcEnabled = true;
+    settings.agcTargetDb = -18.0f;
+    settings.agcMaxGainDb = 24.0f;
+    chain.setSettings(settings);
+
+    // 12 dB short of the target: brought up within a few seconds
+    double quietRms = std::pow(10.0, -30.0 / 20.0);
+    std::vector<float> samples = makeSine(48000, 1, 300.0, quietRms * std::sqrt(2.0), 5.0);
+    runChain(chain, samples, 1, 480);
+    CHECK_NEAR(-18.0, rmsDb(samples.data() + 48000 * 4, 48000), 0.2);
+
+    // Much too loud: brought down faster, but never past the minimum gain
+    double loudRms = std::pow(10.0, -3.0 / 20.0);
+    samples = makeSine(48000, 1, 300.0, loudRms * std::sqrt(2.0), 3.0);
+    runChain(chain, samples, 1, 480);
+    CHECK_NEAR(-15.0, rmsDb(samples.data() + 48000 * 2, 48000), 0.2);
+
+    // Near silence leaves the gain alone rather than pumping it up
+    samples = makeSine(48000, 1, 300.0, 1e-4, 2.0);
+    runChain(chain, samples, 1, 480);
+    CHECK_NEAR(20.0 * std::log10(1e-4 / std::sqrt(2.0)) - 12.0, rmsDb(samples.data() + 48000, 48000), 0.2);
+}
+
+static void testLimiterHoldsCeiling() {
+    for (int channels = 1; channels <= 2; channels++) {
+        EffectChain chain(44100, channels);
+        EffectSettings settings;
+        settings.limiterEnabled = true;
+        settings.limiterCeilingDb = -1.0f;
+        chain.setSettings(settings);
+
+        // 6 dB over full scale, with single-sample spikes in one channel
+        std::vector<float> samples = makeSine(44100, channels, 200.0, 2.0, 1.0);
+        for (size_t i = 0; i < samples.size(); i += 997) samples[i] = -4.0f;
+        runChain(chain, samples, channels, 192);
+        CHECK(peakOf(samples.data(), samples.size()) <= std::pow(10.0f, -1.0f / 20.0f) * 1.00001f);
+    }
+
+    // Under the ceiling nothing changes
+    EffectChain chain(44100, 1);
+    EffectSettings settings;
+    settings.limiterEnabled = true;
+    chain.setSettings(settings);
+    std::vector<float> samples = makeSine(44100, 1, 200.0, 0.5, 0.5);
+    std::vector<float> input = samples;
+    runChain(chain, samples, 1, 192);
+    CHECK(samples == input);
+}
+
+static void testSettingsChangeWhileProcessing() {
+    EffectChain chain(48000, 2);
+    CHECK(!chain.beginBlock());
+
+    // A control thread flips effects while the audio thread runs
+    std::atomic<bool> done{false};
+    std::thread control([&] {
+        EffectSettings settings;
+        for (int i = 0; !done.load(); i++) {
+            settings.highPassHz = i % 2 == 0 ? 100.0f : 0.0f;
+            settings.gateEnabled = i % 3 == 0;
+            settings.agcEnabled = i % 5 != 0;
+            settings.limiterEnabled = true;
+            chain.setSettings(settings);
+            std::this_thread::yield();
+        }
+    });
+    std::vector<float> samples = makeSine(48000, 2, 1000.0, 1.5, 0.02);
+    bool bounded = true;
+    for (int block = 0; block < 2000; block++) {
+        std::vector<float> copy = samples;
+        if (chain.beginBlock()) {
+            chain.process(copy.data(), copy.size() / 2);
+            bounded = bounded && peakOf(copy.data(), copy.size()) <= 0.9f;
+        }
+    }
+    done = true;
+    control.join();
+    CHECK(bounded);
+
+    // Off again: the block is left alone
+    chain.setSettings(EffectSettings());
+    CHECK(!chain.beginBlock());
+    CHECK(!chain.getSettings().limiterEnabled);
+}
+
+static void testRecorderAppliesEffects() {
+    const SampleFormat formats[] = {SampleFormat::INT16, SampleFormat::INT24_PACKED, SampleFormat::FLOAT32};
+    for (SampleFormat format : formats) {
+        FakeAudioBackend backend;
+        // A 1 kHz tone riding on a large DC offset
+        backend.setCaptureSource([](uint64_t index) {
+            return static_cast<short>(6000 + 8000 * std::sin(2.0 * PI * 1000.0 * index / 48000));
+        });
+        AudioRecorder recorder(backend);
+        recorder.initialize();
+        CHECK(recorder.configureFormat(48000, 1, format));
+        CHECK(recorder.startRecording(TEST_FILE));
+        backend.advanceCapture(48000);
+
+        // Switched on mid-take; the first second is left as captured
+        EffectSettings settings;
+        settings.highPassHz = 50.0f;
+        CHECK(recorder.setEffects(settings));
+        backend.advanceCapture(48000);
+        CHECK(recorder.stopRecording());
+
+        MappedWavFile file;
+        CHECK(file.open(TEST_FILE));
+        std::vector<float> samples(file.getSampleCount());
+        if (format == SampleFormat::INT24_PACKED) {
+            convertSamples(reinterpret_cast<const Int24*>(file.getData()), samples.data(), samples.size());
+        } else if (format == SampleFormat::FLOAT32) {
+            const float* data = reinterpret_cast<const float*>(file.getData());
+            samples.assign(data, data + file.getSampleCount());
+        } else {
+            convertSamples(file.getSamples(), samples.data(), samples.size());
+        }
+        // Whole 1024-frame blocks reach the file: 46 before the change
+        const size_t untouched = 46 * 1024;
+        CHECK(samples.size() >= 2 * untouched);
+        double before = 0.0, after = 0.0;
+        for (size_t i = 0; i < untouched; i++) before += samples[i];
+        for (size_t i = untouched + 24000; i < samples.size(); i++) after += samples[i];
+        CHECK_NEAR(6000.0 / 32768.0, before / untouched, 1e-3);
+        CHECK_NEAR(0.0, after / (samples.size() - untouched - 24000), 1e-3);
+        file.close();
+        remove(TEST_FILE);
+        remove("effect_chain_test.peaks");
+    }
+
+    // Out of range settings are turned away
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    EffectSettings settings;
+    settings.highPassHz = 5.0f;
+    CHECK(!recorder.setEffects(settings));
+    settings.highPassHz = 0.0f;
+    settings.limiterCeilingDb = 3.0f;
+    CHECK(!recorder.setEffects(settings));
+}
+
+int main() {
+    RUN_TEST(testCascadeMatchesScalar);
+    RUN_TEST(testHighPassRemovesDcAndRumble);
+    RUN_TEST(testGateTurnsDownQuietInput);
+    RUN_TEST(testAgcRidesTowardTarget);
+    RUN_TEST(testLimiterHoldsCeiling);
+    RUN_TEST(testSettingsChangeWhileProcessing);
+    RUN_TEST(testRecorderAppliesEffects);
+    return TEST_RESULT();
+}
@@ -0,0 +1,165 @@
+#include "fake_audio_backend.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "sample_convert.h"
+
+FakeAudioBackend::FakeAudioBackend() {
+    // Default input is a 16-bit ramp, easy to check for gaps and repeats
+    captureSource = [](uint64_t sampleIndex) {
+        return static_cast<short>(sampleIndex & 0xFFFF);
+    };
+}
+
+bool FakeAudioBackend::openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) {
+    captureConfig = config;
+    captureCallback = callback;
+    captureRunning = false;
+    captureBuffer.assign(static_cast<size_t>(config.framesPerBuffer) * config.channels, 0);
+    captureBytes.assign(static_cast<size_t>(config.framesPerBuffer) * config.getBytesPerFrame(), 0);
+    captureOpenCount++;
+    return true;
+}
+
+bool FakeAudioBackend::startCapture() {
+    if (captureCallback == nullptr) return false;
+    captureRunning = true;
+    return true;
+}
+
+void FakeAudioBackend::stopCapture() {
+    captureRunning = false;
+}
+
+void FakeAudioBackend::closeCapture() {
+    captureRunning = false;
+    captureCallback = nullptr;
+}
+
+void FakeAudioBackend::setCaptureSamples(std::vector<short> samples) {
+    auto shared = std::make_shared<std::vector<short>>(std::move(samples));
+    captureSource = [shared](uint64_t sampleIndex) {
+        return shared->empty() ? short(0) : (*shared)[sampleIndex % shared->size()];
+    };
+}
+
+size_t FakeAudioBackend::advanceCapture(uint64_t frames) {
+    if (captureCallback == nullptr || captureConfig.framesPerBuffer <= 0) return 0;
+
+    const uint64_t framesPerBuffer = captureConfig.framesPerBuffer;
+    const uint64_t target = captureClockFrames + frames;
+    size_t callbacks = 0;
+
+    // A buffer is delivered each time the clock crosses a buffer boundary
+    while ((captureClockFrames / framesPerBuffer + 1) * framesPerBuffer <= target) {
+        captureClockFrames = (captureClockFrames / framesPerBuffer + 1) * framesPerBuffer;
+        if (!captureRunning) continue;
+
+        for (short& sample : captureBuffer) {
+            sample = captureSource(capturedSamples++);
+        }
+
+        const void* block = captureBuffer.data();
+        if (captureConfig.format == SampleFormat::INT24_PACKED) {
+            convertSamples(captureBuffer.data(), reinterpret_cast<Int24*>(captureBytes.data()), captureBuffer.size());
+            block = captureBytes.data();
+        } else if (captureConfig.format == SampleFormat::FLOAT32) {
+            convertSamples(captureBuffer.data(), reinterpret_cast<float*>(captureBytes.data()), captureBuffer.size());
+            block = captureBytes.data();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        captureCallback->onCaptureBlock(block, captureBuffer.size());
+        if (recordTimings) {
+            callbackSeconds.push_back(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+        callbacks++;
+    }
+
+    captureClockFrames = target;
+    return callbacks;
+}
+
+size_t FakeAudioBackend::runCaptureAtSpeed(uint64_t frames, double speed) {
+    const uint64_t framesPerBuffer = captureConfig.framesPerBuffer;
+    const double bufferSeconds = static_cast<double>(framesPerBuffer) /
+                                 captureConfig.sampleRate / speed;
+    auto start = std::chrono::steady_clock::now();
+    size_t callbacks = 0;
+    uint64_t periods = 0;
+
+    for (uint64_t done = 0; done < frames; done += framesPerBuffer) {
+        callbacks += advanceCapture(framesPerBuffer);
+        periods++;
+        std::this_thread::sleep_until(start + std::chrono::duration<double>(bufferSeconds * periods));
+    }
+    return callbacks;
+}
+
+bool FakeAudioBackend::openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) {
+    std::lock_guard<std::recursive_mutex> lock(playbackMutex);
+    playbackConfig = config;
+    renderCallback = callback;
+    playbackRunning = false;
+    playbackOpenCount++;
+    return true;
+}
+
+bool FakeAudioBackend::startPlayback() {
+    std::lock_guard<std::recursive_mutex> lock(playbackMutex);
+    if (renderCallback == nullptr) return false;
+    playbackRunning = true;
+    return true;
+}
+
+void FakeAudioBackend::stopPlayback() {
+    std::lock_guard<std::recursive_mutex> lock(playbackMutex);
+    playbackRunning = false;
+}
+
+void FakeAudioBackend::closePlayback() {
+    std::lock_guard<std::recursive_mutex> lock(playbackMutex);
+    playbackRunning = false;
+    renderCallback = nullptr;
+}
+
+size_t FakeAudioBackend::renderBuffers(size_t maxBuffers) {
+    std::lock_guard<std::recursive_mutex> lock(playbackMutex);
+    size_t pulled = 0;
+
+    while (playbackRunning && renderCallback != nullptr && pulled < maxBuffers) {
+        const void* samples = nullptr;
+        size_t sampleCount = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        bool more = renderCallback->onRenderBuffer(samples, sampleCount);
+        if (recordTimings) {
+            callbackSeconds.push_back(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+        if (!more) {
+            playbackRunning = false;
+            break;
+        }
+
+        if (keepRendered) {
+            const short* block = static_cast<const short*>(samples);
+            if (playbackConfig.format != SampleFormat::INT16) {
+                renderScratch.resize(sampleCount);
+                if (playbackConfig.format == SampleFormat::INT24_PACKED) {
+                    convertSamples(static_cast<const Int24*>(samples), renderScratch.data(), sampleCount);
+                } else {
+                    convertSamples(static_cast<const float*>(samples), renderScratch.data(), sampleCount);
+                }
+                block = renderScratch.data();
+            }
+            rendered.insert(rendered.end(), block, block + sampleCount);
+        }
+        renderedSampleCount += sampleCount;
+        pulled++;
+    }
+    return pulled;
+}
@@ -0,0 +1,142 @@
+#ifndef AUDIORECORDINGAPP_FAKE_AUDIO_BACKEND_H
+#define AUDIORECORDINGAPP_FAKE_AUDIO_BACKEND_H
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "audio_backend.h"
+
+// Deterministic AudioBackend for host tests and benchmarks. Nothing runs on
+// its own: the caller advances a synthetic clock and the backend issues one
+// capture callback per completed buffer period, on the calling thread, with
+// samples from a generator or a recorded file. Playback callbacks are pulled
+// the same way and the rendered samples can be kept for inspection.
+// Sources and rendered samples are 16-bit; streams opened in another
+// SampleFormat are converted on the way in and out.
+class FakeAudioBackend : public AudioBackend {
+public:
+    // Returns the sample at absolute interleaved index |sampleIndex|
+    using SampleSource = std::function<short(uint64_t sampleIndex)>;
+
+private:
+    SampleSource captureSource;
+    AudioStreamConfig captureConfig;
+    AudioCaptureCallback* captureCallback = nullptr;
+    bool captureRunning = false;
+    uint64_t captureClockFrames = 0;
+    uint64_t capturedSamples = 0;
+    std::vector<short> captureBuffer;
+    std::vector<uint8_t> captureBytes;
+
+    // A player's own thread may restart playback while the test pulls
+    // buffers; it waits until renderBuffers() returns
+    std::recursive_mutex playbackMutex;
+    AudioStreamConfig playbackConfig;
+    AudioRenderCallback* renderCallback = nullptr;
+    bool playbackRunning = false;
+    bool keepRendered = true;
+    std::vector<short> rendered;
+    std::vector<short> renderScratch;
+    uint64_t renderedSampleCount = 0;
+
+    int captureOpenCount = 0;
+    int playbackOpenCount = 0;
+
+    bool recordTimings = false;
+    std::vector<double> callbackSeconds;
+
+public:
+    FakeAudioBackend();
+
+    bool initialize() override {
+        return true;
+    }
+
+    // Buffers are pulled as fast as the test asks for them
+    bool isRealtime() const override {
+        return false;
+    }
+
+    bool openCapture(const AudioStreamConfig& config, AudioCaptureCallback* callback) override;
+    bool startCapture() override;
+    void stopCapture() override;
+    void closeCapture() override;
+
+    bool openPlayback(const AudioStreamConfig& config, AudioRenderCallback* callback) override;
+    bool startPlayback() override;
+    void stopPlayback() override;
+    void closePlayback() override;
+
+    void setCaptureSource(SampleSource source) {
+        captureSource = std::move(source);
+    }
+
+    // Loops |samples| as the capture input
+    void setCaptureSamples(std::vector<short> samples);
+
+    // Moves the capture clock forward, delivering a callback for every
+    // buffer period that completes. Returns the number of callbacks.
+    size_t advanceCapture(uint64_t frames);
+
+    // Like advanceCapture(), but paced against the wall clock so the
+    // callbacks arrive |speed| times faster than real time
+    size_t runCaptureAtSpeed(uint64_t frames, double speed);
+
+    // Pulls up to |maxBuffers| buffers from the render callback, stopping
+    // early when it ends the stream. Returns the number pulled.
+    size_t renderBuffers(size_t maxBuffers);
+
+    void setKeepRendered(bool keep) {
+        keepRendered = keep;
+    }
+
+    const std::vector<short>& getRendered() const {
+        return rendered;
+    }
+
+    uint64_t getRenderedSampleCount() const {
+        return renderedSampleCount;
+    }
+
+    uint64_t getCapturedSampleCount() const {
+        return capturedSamples;
+    }
+
+    bool isCaptureRunning() const {
+        return captureRunning;
+    }
+
+    bool isPlaybackRunning() const {
+        return playbackRunning;
+    }
+
+    int getCaptureOpenCount() const {
+        return captureOpenCount;
+    }
+
+    int getPlaybackOpenCount() const {
+        return playbackOpenCount;
+    }
+
+    const AudioStreamConfig& getCaptureConfig() const {
+        return captureConfig;
+    }
+
+    const AudioStreamConfig& getPlaybackConfig() const {
+        return playbackConfig;
+    }
+
+    // Wall-clock duration of every callback while enabled
+    void setRecordTimings(bool record) {
+        recordTimings = record;
+        callbackSeconds.clear();
+    }
+
+    const std::vector<double>& getCallbackSeconds() const {
+        return callbackSeconds;
+    }
+};
+
+#endif // AUDIORECORDINGAPP_FAKE_AUDIO_BACKEND_H
@@ -0,0 +1,126 @@
+#include "fft.h"
+#include "spectrogram.h"
+#include "test_util.h"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// FFT throughput against a naive DFT and against its own scalar stages,
+// with the largest error of each against the DFT in double, then the
+// whole live spectrogram per second of 48 kHz stereo capture.
+
+static const double PI = 3.14159265358979323846;
+static const size_t TOTAL_POINTS = 1ull << 24;
+
+static volatile float g_sink = 0.0f;
+
+// Naive DFT from a precomputed table, in float as a fair baseline
+static void naiveDft(const std::vector<float>& cosines, const std::vector<float>& sines, const float* inRe,
+                     const float* inIm, float* outRe, float* outIm, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        float sumRe = 0.0f;
+        float sumIm = 0.0f;
+        size_t index = 0;
+        for (size_t j = 0; j < n; j++) {
+            sumRe += inRe[j] * cosines[index] + inIm[j] * sines[index];
+            sumIm += inIm[j] * cosines[index] - inRe[j] * sines[index];
+            index = (index + k) & (n - 1);
+        }
+        outRe[k] = sumRe;
+        outIm[k] = sumIm;
+    }
+}
+
+// Largest error against the DFT in double, relative to its largest
+// magnitude
+static double measureError(const float* re, const float* im, const std::vector<float>& inRe,
+                           const std::vector<float>& inIm) {
+    size_t n = inRe.size();
+    double largest = 0.0;
+    double error = 0.0;
+    for (size_t k = 0; k < n; k++) {
+        std::complex<double> sum = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            sum += std::complex<double>(inRe[j], inIm[j]) *
+                   std::polar(1.0, -2.0 * PI * static_cast<double>((j * k) % n) / n);
+        }
+        largest = std::max(largest, std::abs(sum));
+        error = std::max(error, std::abs(sum - std::complex<double>(re[k], im[k])));
+    }
+    return error / largest;
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    printf("Complex FFT: transforms per second and error against a double DFT\n");
+    printf("%-8s %12s %12s %12s %9s %10s %10s %10s\n", "size", "naive dft", "scalar", "simd", "vs dft",
+           "dft err", "scalar err", "simd err");
+    for (size_t n = 64; n <= 8192; n *= 2) {
+        std::vector<float> inRe(n), inIm(n);
+        for (size_t i = 0; i < n; i++) {
+            inRe[i] = dist(random);
+            inIm[i] = dist(random);
+        }
+        std::vector<float> re(n), im(n);
+
+        // The DFT is quadratic, so it gets fewer rounds
+        std::vector<float> cosines(n), sines(n);
+        for (size_t i = 0; i < n; i++) {
+            cosines[i] = static_cast<float>(std::cos(2.0 * PI * i / n));
+            sines[i] = static_cast<float>(std::sin(2.0 * PI * i / n));
+        }
+        size_t dftRounds = std::max<size_t>(TOTAL_POINTS / 64 / (n * n / 64), 1);
+        Stopwatch dftWatch;
+        for (size_t round = 0; round < dftRounds; round++) {
+            naiveDft(cosines, sines, inRe.data(), inIm.data(), re.data(), im.data(), n);
+        }
+        double dftRate = dftRounds / dftWatch.elapsedSeconds();
+        double dftError = measureError(re.data(), im.data(), inRe, inIm);
+
+        FftPlan plan(n);
+        size_t rounds = TOTAL_POINTS / n;
+        double rates[2];
+        double errors[2];
+        for (int simd = 0; simd < 2; simd++) {
+            Stopwatch stopwatch;
+            for (size_t round = 0; round < rounds; round++) {
+                std::copy(inRe.begin(), inRe.end(), re.begin());
+                std::copy(inIm.begin(), inIm.end(), im.begin());
+                if (simd) {
+                    plan.forward(re.data(), im.data());
+                } else {
+                    plan.forwardScalar(re.data(), im.data());
+                }
+            }
+            rates[simd] = rounds / stopwatch.elapsedSeconds();
+            errors[simd] = measureError(re.data(), im.data(), inRe, inIm);
+            g_sink = g_sink + re[1];
+        }
+        printf("%-8zu %12.0f %12.0f %12.0f %8.0fx %10.1e %10.1e %10.1e\n", n, dftRate, rates[0], rates[1],
+               rates[1] / dftRate, dftError, errors[0], errors[1]);
+    }
+
+    printf("\nLive spectrogram, 48 kHz stereo in 256-frame blocks: ms of work per second of audio\n");
+    printf("%-8s %8s %10s\n", "fft", "hop", "ms/s");
+    std::vector<short> block(2 * 256);
+    for (short& sample : block) sample = static_cast<short>(dist(random) * 20000.0f);
+    for (size_t fftSize : {512, 1024, 2048, 4096}) {
+        for (size_t hop : {fftSize / 4, fftSize / 2}) {
+            LiveSpectrogram live(fftSize, hop, 2, 64);
+            std::vector<uint8_t> frames(64 * live.getBinCount());
+            const size_t seconds = 60;
+            Stopwatch stopwatch;
+            for (size_t done = 0; done < seconds * 48000; done += 256) {
+                live.write(block.data(), block.size());
+                live.read(frames.data(), 64);
+            }
+            printf("%-8zu %8zu %10.3f\n", fftSize, hop, stopwatch.elapsedSeconds() * 1000.0 / seconds);
+        }
+    }
+    return 0;
+}
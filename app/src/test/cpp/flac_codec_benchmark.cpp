@@ -0,0 +1,73 @@
+#include "flac_decoder.h"
+#include "flac_encoder.h"
+#include "test_util.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// FLAC encode and decode speed as a multiple of realtime, and the size of
+// the encoded stream relative to 16-bit PCM, for a speech-like signal (a
+// few modulated tones over a quiet noise floor) and for white noise.
+
+static std::vector<short> makeSignal(size_t frames, int channels, bool noiseOnly) {
+    std::mt19937 random(3);
+    std::normal_distribution<double> floor(0.0, noiseOnly ? 6000.0 : 20.0);
+    std::vector<short> samples(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / 44100;
+        double envelope = 0.5 + 0.5 * std::sin(2 * M_PI * 3 * t);
+        double voice = noiseOnly ? 0.0
+                                 : envelope * (6000 * std::sin(2 * M_PI * 180 * t) +
+                                               3000 * std::sin(2 * M_PI * 720 * t) +
+                                               1000 * std::sin(2 * M_PI * 2400 * t));
+        for (int c = 0; c < channels; c++) {
+            double value = voice * (c == 0 ? 1.0 : 0.8) + floor(random);
+            samples[i * channels + c] = static_cast<short>(std::max(-32768.0, std::min(32767.0, value)));
+        }
+    }
+    return samples;
+}
+
+static void run(const char* name, int channels, bool noiseOnly) {
+    const size_t frames = 60 * 44100;
+    std::vector<short> samples = makeSignal(frames, channels, noiseOnly);
+
+    FlacEncoder encoder(44100, channels);
+    std::vector<uint8_t> stream;
+    stream.reserve(samples.size() * sizeof(short));
+    encoder.writeStreamHeader(stream);
+
+    Stopwatch encodeWatch;
+    for (size_t done = 0; done < frames; done += encoder.getBlockSize()) {
+        size_t count = std::min(frames - done, static_cast<size_t>(encoder.getBlockSize()));
+        encoder.encodeBlock(samples.data() + done * channels, count, stream);
+    }
+    double encodeSeconds = encodeWatch.elapsedSeconds();
+
+    FlacDecoder decoder;
+    decoder.openMemory(stream.data(), stream.size());
+    std::vector<short> frame;
+    size_t decoded = 0;
+    bool exact = true;
+    Stopwatch decodeWatch;
+    while (size_t count = decoder.decodeFrame(frame)) {
+        exact = exact && std::equal(frame.begin(), frame.end(), samples.begin() + decoded * channels);
+        decoded += count;
+    }
+    double decodeSeconds = decodeWatch.elapsedSeconds();
+
+    printf("%-14s %8.0fx %8.0fx %7.1f%%%s\n", name, 60 / encodeSeconds, 60 / decodeSeconds,
+           100.0 * stream.size() / (samples.size() * sizeof(short)),
+           exact && decoded == frames ? "" : "  MISMATCH");
+}
+
+int main() {
+    printf("%-14s %9s %9s %8s\n", "signal", "encode", "decode", "size");
+    run("speech mono", 1, false);
+    run("speech stereo", 2, false);
+    run("noise mono", 1, true);
+    run("noise stereo", 2, true);
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "flac_decoder.h"
+#include "flac_encoder.h"
+#include "flac_writer.h"
+#include "test_util.h"
+#include "wav_probe.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Encodes |samples| in blocks of |blockSize| frames into a complete stream
+static std::vector<uint8_t> encodeStream(const std::vector<short>& samples, int channels, int blockSize) {
+    FlacEncoder encoder(44100, channels, blockSize);
+    std::vector<uint8_t> stream;
+    encoder.writeStreamHeader(stream);
+
+    size_t frames = samples.size() / channels;
+    for (size_t done = 0; done < frames; done += blockSize) {
+        size_t count = std::min(frames - done, static_cast<size_t>(blockSize));
+        encoder.encodeBlock(samples.data() + done * channels, count, stream);
+    }
+
+    // Patch the totals in, as FlacWriter does on close
+    std::vector<uint8_t> header;
+    encoder.writeStreamHeader(header);
+    std::copy(header.begin(), header.end(), stream.begin());
+    return stream;
+}
+
+// Encodes |samples| in blocks of |blockSize| frames and decodes them back
+static std::vector<short> roundTrip(const std::vector<short>& samples, int channels, int blockSize,
+                                    size_t* encodedBytes = nullptr) {
+    size_t frames = samples.size() / channels;
+    std::vector<uint8_t> stream = encodeStream(samples, channels, blockSize);
+    if (encodedBytes) *encodedBytes = stream.size();
+
+    FlacDecoder decoder;
+    std::vector<short> decoded;
+    if (!decoder.openMemory(stream.data(), stream.size())) return decoded;
+    CHECK_EQ(frames, decoder.getStreamInfo().totalFrames);
+
+    std::vector<short> frame;
+    while (decoder.decodeFrame(frame) > 0) decoded.insert(decoded.end(), frame.begin(), frame.end());
+    CHECK(!decoder.hasError());
+    return decoded;
+}
+
+static std::vector<short> makeSignal(size_t frames, int channels, int kind) {
+    std::mt19937 random(kind);
+    std::normal_distribution<double> noise(0.0, 3000.0);
+    std::vector<short> samples(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        double tone = 12000.0 * std::sin(i * 2 * M_PI * 440 / 44100) + noise(random) * 0.1;
+        for (int c = 0; c < channels; c++) {
+            double value = 0.0;
+            switch (kind) {
+                case 0: value = 0.0; break;                                     // silence
+                case 1: value = tone * (c == 0 ? 1.0 : 0.9); break;             // correlated
+                case 2: value = noise(random) * 8; break;                       // white noise
+                case 3: value = (i / 100) % 2 ? 32767 : -32768; break;          // full-scale square
+                case 4: value = c == 0 ? 32767.0 : -32768.0; break;             // widest side channel
+                default: value = c == 0 ? tone : noise(random); break;          // unrelated channels
+            }
+            samples[i * channels + c] = static_cast<short>(std::max(-32768.0, std::min(32767.0, value)));
+        }
+    }
+    return samples;
+}
+
+static void testRoundTripIsLossless() {
+    for (int channels : {1, 2}) {
+        for (int kind = 0; kind <= 5; kind++) {
+            for (size_t frames : {1, 5, 4096, 10000, 44100}) {
+                std::vector<short> samples = makeSignal(frames, channels, kind);
+                std::vector<short> decoded = roundTrip(samples, channels, FlacEncoder::DEFAULT_BLOCK_SIZE);
+                if (decoded != samples) {
+                    fprintf(stderr, "  mismatch: %d channels, signal %d, %zu frames\n", channels, kind, frames);
+                }
+                CHECK(decoded == samples);
+            }
+        }
+    }
+
+    // Non-power-of-two block sizes use the explicit block size header fields
+    // Over 128 frames, so frame numbers take multi-byte UTF-8 coding
+    std::vector<short> samples = makeSignal(60000, 2, 1);
+    CHECK(roundTrip(samples, 2, 1152) == samples);
+    CHECK(roundTrip(samples, 2, 192) == samples);
+}
+
+static void testCompressesTonalAudio() {
+    // A tone with a little dither, roughly what a quiet room recording holds
+    std::mt19937 random(7);
+    std::normal_distribution<double> dither(0.0, 4.0);
+    std::vector<short> samples(10 * 44100);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<short>(std::lround(8000.0 * std::sin(i * 2 * M_PI * 440 / 44100) + dither(random)));
+    }
+    size_t encodedBytes = 0;
+    CHECK(roundTrip(samples, 1, FlacEncoder::DEFAULT_BLOCK_SIZE, &encodedBytes) == samples);
+    double ratio = static_cast<double>(encodedBytes) / (samples.size() * sizeof(short));
+    printf("  dithered tone: %.1f%% of PCM size\n", ratio * 100);
+    CHECK(ratio < 0.4);
+
+    std::vector<short> silence(44100 * 2, 0);
+    CHECK(roundTrip(silence, 2, FlacEncoder::DEFAULT_BLOCK_SIZE, &encodedBytes) == silence);
+    CHECK(encodedBytes < 1000);
+}
+
+static void testDecoderRejectsCorruption() {
+    std::vector<short> samples = makeSignal(8192, 1, 1);
+    FlacEncoder encoder(44100, 1);
+    std::vector<uint8_t> stream;
+    encoder.writeStreamHeader(stream);
+    encoder.encodeBlock(samples.data(), 4096, stream);
+    size_t secondFrame = stream.size();
+    encoder.encodeBlock(samples.data() + 4096, 4096, stream);
+
+    stream[secondFrame + 100] ^= 0x10;
+    FlacDecoder decoder;
+    CHECK(decoder.openMemory(stream.data(), stream.size()));
+    std::vector<short> frame;
+    CHECK_EQ(4096u, decoder.decodeFrame(frame));
+    CHECK_EQ(0u, decoder.decodeFrame(frame));
+    CHECK(decoder.hasError());
+
+    uint8_t notFlac[64] = {'R', 'I', 'F', 'F'};
+    CHECK(!decoder.openMemory(notFlac, sizeof(notFlac)));
+}
+
+static void testDecoderSeeks() {
+    for (int blockSize : {FlacEncoder::DEFAULT_BLOCK_SIZE, 1152}) {
+        // Loud and quiet stretches, so frames differ a lot in size
+        const int channels = 2;
+        std::vector<short> samples = makeSignal(600000, channels, 5);
+        for (size_t i = 200000 * channels; i < 300000 * channels; i++) samples[i] /= 256;
+        std::vector<uint8_t> stream = encodeStream(samples, channels, blockSize);
+
+        FlacDecoder decoder;
+        CHECK(decoder.openMemory(stream.data(), stream.size()));
+        std::vector<short> frame;
+        const uint64_t targets[] = {599999, 0, 1, 4095, 4096, 123457, 250000, 300001, 451152, 12};
+        for (uint64_t target : targets) {
+            uint64_t frameStart = 0;
+            CHECK(decoder.seek(target, frameStart));
+            size_t count = decoder.decodeFrame(frame);
+            CHECK(frameStart <= target && target < frameStart + count);
+            CHECK(std::equal(frame.begin(), frame.end(), samples.begin() + frameStart * channels));
+        }
+
+        // Decoding carries on from a seek, and past the end there is nothing
+        uint64_t frameStart = 0;
+        CHECK(decoder.seek(300000, frameStart));
+        size_t decoded = 0;
+        while (decoder.decodeFrame(frame) > 0) decoded += frame.size() / channels;
+        CHECK_EQ(600000 - frameStart, decoded);
+        CHECK(!decoder.hasError());
+        CHECK(!decoder.seek(600000, frameStart));
+    }
+}
+
+static void testRecordAndPlayFlac() {
+    const char* path = "flac_codec_test.flac";
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    CHECK(recorder.startRecording(path, AudioFileFormat::FLAC));
+    backend.advanceCapture(2 * 44100);
+    CHECK(recorder.stopRecording());
+    uint64_t captured = backend.getCapturedSampleCount();
+    CHECK_EQ(captured, recorder.getFileWriter().getSamplesWritten());
+
+    WavInfo info;
+    CHECK(probeWavFile(path, info));
+    CHECK_EQ(44100u, info.sampleRate);
+    CHECK_EQ(captured, info.frameCount);
+
+    AudioPlayer player(backend);
+    player.initialize();
+    CHECK(player.loadAudioFile(path));
+    CHECK(player.startPlayback());
+    backend.renderBuffers(1000);
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK_EQ(captured, backend.getRendered().size());
+
+    bool isRamp = true;
+    for (size_t i = 0; i < backend.getRendered().size(); i++) {
+        isRamp = isRamp && backend.getRendered()[i] == static_cast<short>(i & 0xFFFF);
+    }
+    CHECK(isRamp);
+
+    // A second playback starts from the top again
+    CHECK(player.startPlayback());
+    CHECK(backend.renderBuffers(1) == 1u);
+    CHECK_EQ(captured + 4096, backend.getRendered().size());
+
+    // Resampled to a 48 kHz device, frame by decoded frame
+    player.stopPlayback();
+    CHECK(player.setOutputSampleRate(48000));
+    CHECK(player.startPlayback());
+    size_t before = backend.getRendered().size();
+    backend.renderBuffers(1000);
+    CHECK(!player.isCurrentlyPlaying());
+    CHECK_EQ((captured * 48000 + 44099) / 44100, backend.getRendered().size() - before);
+    remove(path);
+    remove("flac_codec_test.peaks");
+}
+
+int main() {
+    RUN_TEST(testRoundTripIsLossless);
+    RUN_TEST(testCompressesTonalAudio);
+    RUN_TEST(testDecoderRejectsCorruption);
+    RUN_TEST(testDecoderSeeks);
+    RUN_TEST(testRecordAndPlayFlac);
+    return TEST_RESULT();
+}
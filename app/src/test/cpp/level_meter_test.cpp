@@ -0,0 +1,132 @@
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "level_meter.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static void testMeasuresBlock() {
+    LevelMeter meter;
+    LevelSnapshot snapshot;
+    CHECK(meter.read(snapshot));
+    CHECK_EQ(0u, snapshot.blockCount);
+
+    // Square wave at half scale: peak and RMS both 0.5
+    std::vector<short> square(1024);
+    for (size_t i = 0; i < square.size(); i++) square[i] = (i & 8) ? 16384 : -16384;
+    meter.publish(square.data(), square.size());
+    CHECK(meter.read(snapshot));
+    CHECK_NEAR(0.5, snapshot.peak, 1e-6);
+    CHECK_NEAR(0.5, snapshot.rms, 1e-6);
+    CHECK_EQ(0u, snapshot.clipCount);
+    CHECK_EQ(1u, snapshot.blockCount);
+
+    // Clipped samples at either rail accumulate across blocks
+    std::vector<short> clipped(1024, 100);
+    clipped[10] = SHRT_MAX;
+    clipped[20] = SHRT_MIN;
+    clipped[30] = SHRT_MIN;
+    meter.publish(clipped.data(), clipped.size());
+    meter.publish(clipped.data(), clipped.size());
+    CHECK(meter.read(snapshot));
+    CHECK_NEAR(1.0, snapshot.peak, 1e-6);
+    CHECK_EQ(6u, snapshot.clipCount);
+    CHECK_EQ(3u, snapshot.blockCount);
+
+    meter.reset();
+    CHECK(meter.read(snapshot));
+    CHECK_EQ(0.0f, snapshot.peak);
+    CHECK_EQ(0u, snapshot.clipCount);
+    CHECK_EQ(0u, snapshot.blockCount);
+}
+
+static void testSharedWordsMatchSnapshot() {
+    LevelMeter meter;
+    std::vector<short> block(256, -8192);
+    meter.publish(block.data(), block.size());
+
+    const uint32_t* words = static_cast<const uint32_t*>(meter.getSharedWords());
+    float peak;
+    memcpy(&peak, &words[LevelMeter::PEAK_WORD], sizeof(peak));
+    CHECK_EQ(0u, words[LevelMeter::SEQUENCE_WORD] & 1);
+    CHECK_NEAR(0.25, peak, 1e-6);
+    CHECK_EQ(1u, words[LevelMeter::BLOCK_COUNT_WORD]);
+    CHECK_EQ(20u, LevelMeter::getSharedSize());
+}
+
+static void testReadersNeverSeeTornSnapshots() {
+    LevelMeter meter;
+    std::atomic<bool> done{false};
+
+    // Every block is a constant level derived from its index, so a snapshot
+    // is consistent only if peak, RMS and block count all agree
+    std::thread writer([&]() {
+        std::vector<short> block(64);
+        for (uint32_t i = 1; i <= 200000; i++) {
+            std::fill(block.begin(), block.end(), static_cast<short>(i % 30000));
+            meter.publish(block.data(), block.size());
+        }
+        done = true;
+    });
+
+    size_t reads = 0, torn = 0;
+    uint32_t lastBlock = 0;
+    bool monotonic = true;
+    while (!done) {
+        LevelSnapshot snapshot;
+        if (!meter.read(snapshot)) continue;
+        reads++;
+        float expected = (snapshot.blockCount % 30000) / 32768.0f;
+        if (snapshot.peak != expected || snapshot.rms != snapshot.peak) torn++;
+        monotonic = monotonic && snapshot.blockCount >= lastBlock;
+        lastBlock = snapshot.blockCount;
+    }
+    writer.join();
+
+    CHECK(reads > 0);
+    CHECK_EQ(0u, torn);
+    CHECK(monotonic);
+}
+
+static void testRecorderAndPlayerPublish() {
+    const char* path = "level_meter_test.wav";
+    FakeAudioBackend backend;
+    backend.setCaptureSamples({8192, -8192});
+
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+    recorder.startRecording(path);
+    backend.advanceCapture(10 * 1024);
+    recorder.stopRecording();
+
+    LevelSnapshot snapshot;
+    CHECK(recorder.getLevelMeter().read(snapshot));
+    CHECK_EQ(10u, snapshot.blockCount);
+    CHECK_NEAR(0.25, snapshot.peak, 1e-6);
+
+    AudioPlayer player(backend);
+    player.initialize();
+    player.loadAudioFile(path);
+    player.startPlayback();
+    backend.renderBuffers(100);
+    CHECK(player.getLevelMeter().read(snapshot));
+    // 10240 samples in 4096-sample buffers
+    CHECK_EQ(3u, snapshot.blockCount);
+    CHECK_NEAR(0.25, snapshot.rms, 1e-6);
+    remove(path);
+    remove("level_meter_test.peaks");
+}
+
+int main() {
+    RUN_TEST(testMeasuresBlock);
+    RUN_TEST(testSharedWordsMatchSnapshot);
+    RUN_TEST(testReadersNeverSeeTornSnapshots);
+    RUN_TEST(testRecorderAndPlayerPublish);
+    return TEST_RESULT();
+}
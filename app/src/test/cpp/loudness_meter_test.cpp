@@ -0,0 +1,89 @@
+#include "loudness_meter.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// EBU Tech 3341 allows +/-0.1 LU on its test signals
+static const double TOLERANCE_LU = 0.1;
+
+// |seconds| of a 1 kHz sine at |dbfs| peak, the same in every channel
+static std::vector<float> makeSine(int sampleRate, int channels, double dbfs, double seconds) {
+    const double pi = 3.14159265358979323846;
+    double amplitude = std::pow(10.0, dbfs / 20.0);
+    size_t frames = static_cast<size_t>(sampleRate * seconds);
+    std::vector<float> samples(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        float value = static_cast<float>(amplitude * std::sin(2.0 * pi * 1000.0 * i / sampleRate));
+        for (int channel = 0; channel < channels; channel++) {
+            samples[i * channels + channel] = value;
+        }
+    }
+    return samples;
+}
+
+static double measure(int sampleRate, int channels, const std::vector<float>& samples, size_t blockFrames) {
+    LoudnessMeter meter(sampleRate, channels);
+    size_t frames = samples.size() / channels;
+    for (size_t done = 0; done < frames; done += blockFrames) {
+        meter.process(samples.data() + done * channels, std::min(blockFrames, frames - done));
+    }
+    return meter.getIntegratedLoudness();
+}
+
+static void testReferenceSines() {
+    // Tech 3341 case 1: stereo -23 dBFS reads -23 LUFS
+    CHECK_NEAR(-23.0, measure(48000, 2, makeSine(48000, 2, -23.0, 20.0), 4096), TOLERANCE_LU);
+    // Case 2 at another rate
+    CHECK_NEAR(-33.0, measure(44100, 2, makeSine(44100, 2, -33.0, 20.0), 4096), TOLERANCE_LU);
+    // One channel carries half the energy
+    CHECK_NEAR(-23.0 - 3.01, measure(48000, 1, makeSine(48000, 1, -23.0, 20.0), 4096), TOLERANCE_LU);
+}
+
+static void testGating() {
+    // Tech 3341 case 3: the quiet ends fall under the relative gate
+    std::vector<float> samples = makeSine(48000, 2, -36.0, 10.0);
+    std::vector<float> loud = makeSine(48000, 2, -23.0, 60.0);
+    samples.insert(samples.end(), loud.begin(), loud.end());
+    std::vector<float> tail = makeSine(48000, 2, -36.0, 10.0);
+    samples.insert(samples.end(), tail.begin(), tail.end());
+    CHECK_NEAR(-23.0, measure(48000, 2, samples, 4096), TOLERANCE_LU);
+
+    // Case 4 adds stretches under the absolute gate as well
+    samples = makeSine(48000, 2, -72.0, 10.0);
+    std::vector<float> middle = makeSine(48000, 2, -36.0, 10.0);
+    samples.insert(samples.end(), middle.begin(), middle.end());
+    samples.insert(samples.end(), loud.begin(), loud.end());
+    samples.insert(samples.end(), middle.begin(), middle.end());
+    std::vector<float> quiet = makeSine(48000, 2, -72.0, 10.0);
+    samples.insert(samples.end(), quiet.begin(), quiet.end());
+    CHECK_NEAR(-23.0, measure(48000, 2, samples, 4096), TOLERANCE_LU);
+
+    // Nothing over the absolute gate, or too short for one block
+    CHECK(std::isinf(measure(48000, 2, makeSine(48000, 2, -75.0, 5.0), 4096)));
+    CHECK(std::isinf(measure(48000, 2, makeSine(48000, 2, -10.0, 0.3), 4096)));
+    CHECK(std::isinf(measure(48000, 2, std::vector<float>(48000 * 2, 0.0f), 4096)));
+}
+
+static void testBlockSizeDoesNotMatter() {
+    std::vector<float> samples = makeSine(48000, 2, -18.0, 3.0);
+    for (size_t i = 0; i < samples.size(); i += 7) samples[i] *= 0.5f;
+    double reference = measure(48000, 2, samples, 4096);
+    CHECK_EQ(reference, measure(48000, 2, samples, 1));
+    CHECK_EQ(reference, measure(48000, 2, samples, 4799));
+
+    LoudnessMeter meter(48000, 2);
+    meter.process(samples.data(), samples.size() / 2);
+    CHECK_NEAR(std::pow(10.0, -18.0 / 20.0), meter.getSamplePeak(), 1e-4);
+    meter.reset();
+    CHECK(std::isinf(meter.getIntegratedLoudness()));
+    CHECK_EQ(0.0f, meter.getSamplePeak());
+}
+
+int main() {
+    RUN_TEST(testReferenceSines);
+    RUN_TEST(testGating);
+    RUN_TEST(testBlockSizeDoesNotMatter);
+    return TEST_RESULT();
+}
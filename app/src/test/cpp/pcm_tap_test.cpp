@@ -0,0 +1,144 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "pcm_tap.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const char* TEST_FILE = "pcm_tap_test.wav";
+
+static uint32_t headerWord(PcmTap& tap, int word) {
+    uint32_t value;
+    memcpy(&value, static_cast<uint8_t*>(tap.getSharedMemory()) + word * sizeof(uint32_t), sizeof(value));
+    return value;
+}
+
+// Whether |samples| continue the fake backend's 16-bit ramp from |first|
+static bool continuesRamp(const std::vector<short>& samples, uint64_t first) {
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (samples[i] != static_cast<short>((first + i) & 0xFFFF)) return false;
+    }
+    return true;
+}
+
+static void testWrapsAndCountsOverflow() {
+    PcmTap tap(48000, 2, SampleFormat::INT16, 100);
+    CHECK_EQ(128u, tap.getCapacity());
+    CHECK_EQ(PcmTap::DATA_OFFSET + 128 * sizeof(short), tap.getSharedSize());
+    CHECK_EQ(128u, headerWord(tap, PcmTap::CAPACITY_WORD));
+    CHECK_EQ(2u, headerWord(tap, PcmTap::BYTES_PER_SAMPLE_WORD));
+    CHECK_EQ(2u, headerWord(tap, PcmTap::CHANNELS_WORD));
+    CHECK_EQ(48000u, headerWord(tap, PcmTap::SAMPLE_RATE_WORD));
+    CHECK_EQ(static_cast<uint32_t>(SampleFormat::INT16), headerWord(tap, PcmTap::SAMPLE_FORMAT_WORD));
+
+    std::vector<short> in(200);
+    for (size_t i = 0; i < in.size(); i++) in[i] = static_cast<short>(i);
+    std::vector<short> out(200);
+
+    CHECK(tap.write(in.data(), 100));
+    CHECK_EQ(60u, tap.read(out.data(), 60));
+    // 40 left plus 80 more runs past the end of the ring
+    CHECK(tap.write(in.data() + 100, 80));
+    CHECK_EQ(120u, tap.getAvailableSamples());
+    CHECK_EQ(120u, tap.read(out.data(), 200));
+    out.resize(120);
+    CHECK(std::equal(out.begin(), out.end(), in.begin() + 60));
+    CHECK_EQ(180u, headerWord(tap, PcmTap::WRITE_INDEX_WORD));
+    CHECK_EQ(180u, headerWord(tap, PcmTap::READ_INDEX_WORD));
+
+    // Too big for the whole ring, then too big for what is left
+    CHECK(!tap.write(in.data(), 200));
+    CHECK(tap.write(in.data(), 100));
+    CHECK(!tap.write(in.data(), 40));
+    CHECK_EQ(2u, tap.getOverflowCount());
+    CHECK_EQ(240u, tap.getDroppedSamples());
+    CHECK_EQ(2u, headerWord(tap, PcmTap::OVERFLOW_COUNT_WORD));
+    CHECK_EQ(100u, tap.getAvailableSamples());
+}
+
+static void testRecorderFeedsTap() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    CHECK(recorder.initialize());
+    CHECK(recorder.configureFormat(48000, 1, SampleFormat::INT16));
+    CHECK(recorder.openPcmTap(0) == nullptr);
+    PcmTap* tap = recorder.openPcmTap(1000);
+    CHECK(tap != nullptr);
+    CHECK(tap->getCapacity() >= 48000u);
+
+    // Every block of the take, exactly as captured
+    CHECK(recorder.startRecording(TEST_FILE));
+    size_t callbacks = backend.advanceCapture(20 * 1024);
+    CHECK_EQ(20u, callbacks);
+    std::vector<short> out(tap->getCapacity());
+    size_t got = tap->read(out.data(), out.size());
+    CHECK_EQ(20u * 1024, got);
+    out.resize(got);
+    CHECK(continuesRamp(out, 0));
+
+    // The format stays put while the tap is open
+    CHECK(recorder.stopRecording());
+    CHECK(!recorder.configureFormat(44100, 1, SampleFormat::INT16));
+
+    // Armed input goes to the tap too; nobody reading means overflows,
+    // while the take's own blocks are never held up
+    CHECK(recorder.arm(500));
+    backend.advanceCapture(100 * 1024);
+    CHECK(tap->getOverflowCount() > 0);
+    CHECK_EQ(tap->getOverflowCount() * 1024, tap->getDroppedSamples());
+    CHECK_EQ(tap->getCapacity() / 1024 * 1024, tap->getAvailableSamples());
+    recorder.disarm();
+
+    recorder.closePcmTap();
+    CHECK(recorder.getPcmTap() == nullptr);
+    CHECK(recorder.configureFormat(44100, 1, SampleFormat::INT16));
+
+    remove(TEST_FILE);
+    remove("pcm_tap_test.peaks");
+}
+
+static void testReaderOnAnotherThread() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+    recorder.configureFormat(48000, 1, SampleFormat::INT16);
+    PcmTap* tap = recorder.openPcmTap(100);
+
+    std::atomic<bool> done{false};
+    std::vector<short> received;
+    std::thread reader([&] {
+        std::vector<short> chunk(4096);
+        while (!done || tap->getAvailableSamples() > 0) {
+            size_t got = tap->read(chunk.data(), chunk.size());
+            received.insert(received.end(), chunk.begin(), chunk.begin() + got);
+            if (got == 0) std::this_thread::yield();
+        }
+    });
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    backend.runCaptureAtSpeed(48000, 20.0);
+    CHECK(recorder.stopRecording());
+    done = true;
+    reader.join();
+
+    // Whatever was not dropped arrived in order
+    CHECK_EQ(backend.getCapturedSampleCount(), received.size() + tap->getDroppedSamples());
+    if (tap->getOverflowCount() == 0) {
+        CHECK(continuesRamp(received, 0));
+    }
+
+    recorder.closePcmTap();
+    remove(TEST_FILE);
+    remove("pcm_tap_test.peaks");
+}
+
+int main() {
+    RUN_TEST(testWrapsAndCountsOverflow);
+    RUN_TEST(testRecorderFeedsTap);
+    RUN_TEST(testReaderOnAnotherThread);
+    return TEST_RESULT();
+}
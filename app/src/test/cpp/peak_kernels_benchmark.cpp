@@ -0,0 +1,54 @@
+#include "peak_kernels.h"
+#include "test_util.h"
+#include "waveform_index.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Min/max/sum-of-squares reduction: SIMD kernel against the scalar loop,
+// for block sizes from one capture buffer up to a long stretch of audio,
+// plus the full per-block cost of updating the waveform index.
+
+static double measure(void (*kernel)(const short*, size_t, PeakStats&),
+                      const std::vector<short>& samples, size_t blockSize, int64_t& checksum) {
+    const size_t totalSamples = 1ull << 27;
+    PeakStats stats;
+    Stopwatch stopwatch;
+    for (size_t done = 0; done < totalSamples; done += blockSize) {
+        size_t offset = done % (samples.size() - blockSize + 1);
+        kernel(samples.data() + offset, blockSize, stats);
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    checksum = stats.sumSquares + stats.min + stats.max;
+    return totalSamples / seconds;
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> sampleDist(SHRT_MIN, SHRT_MAX);
+    std::vector<short> samples(1 << 20);
+    for (short& sample : samples) sample = static_cast<short>(sampleDist(random));
+
+    printf("%-12s %14s %14s %8s\n", "block", "scalar", "simd", "speedup");
+    for (size_t blockSize : {256, 1024, 4096, 65536}) {
+        int64_t scalarChecksum = 0, simdChecksum = 0;
+        double scalar = measure(reducePeaksScalar, samples, blockSize, scalarChecksum);
+        double simd = measure(reducePeaks, samples, blockSize, simdChecksum);
+        printf("%-12zu %9.0f Ms/s %9.0f Ms/s %7.1fx%s\n", blockSize, scalar / 1e6, simd / 1e6,
+               simd / scalar, scalarChecksum == simdChecksum ? "" : "  MISMATCH");
+    }
+
+    // Whole index update per 1024-frame capture block, one hour of mono audio
+    const size_t blocks = 3600ull * 44100 / 1024;
+    WaveformIndex index(44100, 1);
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < blocks; i++) {
+        index.addSamples(samples.data() + (i * 1024) % (samples.size() - 1024), 1024);
+    }
+    index.finish();
+    double seconds = stopwatch.elapsedSeconds();
+    printf("index update: %.3f us per 1024-frame block, %zu level-0 bins for one hour\n",
+           seconds * 1e6 / blocks, index.getBinCount(0));
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "audio_player.h"
+#include "fake_audio_backend.h"
+#include "flac_writer.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Streaming playback: how long startPlayback() takes to get the first
+// block in, and how long a seek takes to reach the device, for a short and
+// a long take in each format. Both should stay flat as the file grows; the
+// seek time is mostly the prefetch thread's poll while stale blocks drain.
+
+static const char* WAV_FILE = "playback_stream_benchmark.wav";
+static const char* FLAC_FILE = "playback_stream_benchmark.flac";
+static const int SAMPLE_RATE = 44100;
+static const int SEEK_COUNT = 200;
+
+// A dithered tone, so FLAC frames vary in size the way real takes do
+static void writeTake(AudioFileWriter& writer, const char* path, size_t frames) {
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0.0, 200.0);
+    std::vector<short> chunk(65536);
+    writer.open(path);
+    for (size_t done = 0; done < frames; done += chunk.size()) {
+        size_t count = std::min(chunk.size(), frames - done);
+        for (size_t i = 0; i < count; i++) {
+            chunk[i] = static_cast<short>(8000.0 * std::sin((done + i) * 0.03) + noise(random));
+        }
+        writer.write(chunk.data(), count);
+        // Paced so the writer thread keeps up
+        std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    }
+    writer.close();
+}
+
+static void benchmarkFile(const char* name, const char* path, int minutes) {
+    FakeAudioBackend backend;
+    backend.setKeepRendered(false);
+    AudioPlayer player(backend);
+    player.initialize();
+    player.loadAudioFile(path);
+
+    // Cold open the first time; the best of a few warm starts after that
+    double startMs = 1e9;
+    for (int i = 0; i < 5; i++) {
+        Stopwatch stopwatch;
+        player.startPlayback();
+        startMs = std::min(startMs, stopwatch.elapsedSeconds() * 1000.0);
+        player.stopPlayback();
+    }
+
+    // Each seek is timed until the first block from the new position has
+    // been rendered
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int64_t> position(0, player.getDurationMs() - 1000);
+    std::vector<double> seekUs;
+    player.startPlayback();
+    for (int i = 0; i < SEEK_COUNT; i++) {
+        int64_t target = position(random);
+        Stopwatch stopwatch;
+        player.seekTo(target);
+        backend.renderBuffers(1);
+        seekUs.push_back(stopwatch.elapsedSeconds() * 1e6);
+    }
+    player.stopPlayback();
+    std::sort(seekUs.begin(), seekUs.end());
+
+    printf("  %-6s %4d min %10.3f ms %9.0f us %9.0f us\n", name, minutes, startMs,
+           seekUs[seekUs.size() / 2], seekUs[seekUs.size() * 99 / 100]);
+}
+
+int main() {
+    printf("Ring: %zu blocks of up to %zu samples, whatever the file length\n\n",
+           PlaybackStream::BLOCK_COUNT, PlaybackStream::BLOCK_SAMPLES);
+    printf("  %-6s %8s %13s %12s %12s\n", "format", "length", "start", "seek p50", "seek p99");
+
+    for (int minutes : {1, 30}) {
+        size_t frames = static_cast<size_t>(minutes) * 60 * SAMPLE_RATE;
+        WavWriter wavWriter(SAMPLE_RATE, 1, SampleFormat::INT16);
+        writeTake(wavWriter, WAV_FILE, frames);
+        benchmarkFile("wav", WAV_FILE, minutes);
+        remove(WAV_FILE);
+
+        FlacWriter flacWriter(SAMPLE_RATE, 1);
+        writeTake(flacWriter, FLAC_FILE, frames);
+        benchmarkFile("flac", FLAC_FILE, minutes);
+        remove(FLAC_FILE);
+    }
+    return 0;
+}
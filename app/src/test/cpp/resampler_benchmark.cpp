@@ -0,0 +1,164 @@
+#include "audio_player.h"
+#include "fake_audio_backend.h"
+#include "resampler.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Polyphase resampler: the dot-product kernel against the scalar loop,
+// streaming throughput for the common rate pairs in mono and stereo with
+// the measured stopband attenuation of each, and the player's resampled
+// render path end to end.
+
+static const char* BENCH_FILE = "resampler_benchmark.wav";
+static const size_t BLOCK_FRAMES = 1024;
+
+// Keeps the timed dot products from being optimized away
+static volatile float g_sink;
+
+static std::vector<float> makeTone(double frequency, int rate, size_t frames) {
+    std::vector<float> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        samples[i] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * frequency * i / rate));
+    }
+    return samples;
+}
+
+// Amplitude of one whole-hertz frequency over one second from |offset|
+static double measureAmplitude(const std::vector<float>& samples, size_t offset, double frequency, int rate) {
+    std::complex<double> sum = 0.0;
+    for (int i = 0; i < rate; i++) {
+        sum += static_cast<double>(samples[offset + i]) * std::polar(1.0, -2.0 * M_PI * frequency * i / rate);
+    }
+    return 2.0 * std::abs(sum) / rate;
+}
+
+// Worst leak of a tone into the stopband: above the output Nyquist
+// frequency when downsampling, the first image when upsampling
+static double measureStopbandDb(int from, int to) {
+    double tone;
+    double leak;
+    if (to < from) {
+        tone = std::min(from / 2.0 - 500.0, to / 2.0 + 1000.0);
+        leak = to - tone;
+    } else {
+        tone = std::floor(from * 0.35);
+        leak = from - tone;
+        if (leak > to / 2.0) leak = to - leak;
+    }
+    std::vector<float> in = makeTone(tone, from, 3 * static_cast<size_t>(from));
+    std::vector<float> out;
+    resampleBuffer(in.data(), in.size(), 1, from, to, out);
+    return 20.0 * std::log10(std::max(measureAmplitude(out, to, leak, to) / 0.5, 1e-12));
+}
+
+static void benchmarkDotProduct() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> a(4096), b(4096);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = dist(random);
+        b[i] = dist(random);
+    }
+
+    printf("%-24s %14s %14s %8s\n", "kernel", "scalar", "simd", "speedup");
+    const size_t lengths[] = {64, 72, 192};
+    for (size_t length : lengths) {
+        const size_t calls = (1ull << 28) / length;
+        float sink = 0.0f;
+        Stopwatch scalarWatch;
+        for (size_t i = 0; i < calls; i++) sink += dotProductScalar(a.data() + i % 2048, b.data(), length);
+        double scalarRate = calls * length / scalarWatch.elapsedSeconds();
+        Stopwatch simdWatch;
+        for (size_t i = 0; i < calls; i++) sink += dotProduct(a.data() + i % 2048, b.data(), length);
+        double simdRate = calls * length / simdWatch.elapsedSeconds();
+
+        char name[32];
+        snprintf(name, sizeof(name), "dot product x%zu", length);
+        printf("  %-22s %7.0f MMAC/s %7.0f MMAC/s %7.1fx\n", name, scalarRate / 1e6, simdRate / 1e6,
+               simdRate / scalarRate);
+        g_sink = sink;
+    }
+}
+
+static void benchmarkRatios() {
+    printf("\nStreaming, %zu-frame blocks\n", BLOCK_FRAMES);
+    printf("  %-20s %6s %14s %14s %10s\n", "conversion", "taps", "mono", "stereo", "stopband");
+    const int pairs[][2] = {{44100, 48000}, {48000, 44100}, {22050, 48000}, {16000, 48000},
+                            {8000, 44100}, {96000, 48000}, {192000, 44100}};
+
+    for (const auto& pair : pairs) {
+        const int from = pair[0];
+        const int to = pair[1];
+        double realtime[2] = {0.0, 0.0};
+        int taps = 0;
+
+        for (int channels = 1; channels <= 2; channels++) {
+            Resampler resampler;
+            resampler.configure(from, to, channels);
+            taps = resampler.getTapsPerPhase();
+
+            std::vector<float> in = makeTone(997.0, from, BLOCK_FRAMES * channels);
+            std::vector<float> out(4 * BLOCK_FRAMES * channels * (to / from + 1));
+            const size_t outFrames = out.size() / channels;
+            const size_t totalFrames = 20 * static_cast<size_t>(from);
+
+            Stopwatch stopwatch;
+            for (size_t done = 0; done < totalFrames;) {
+                size_t used = 0;
+                resampler.process(in.data(), BLOCK_FRAMES, used, out.data(), outFrames);
+                done += used;
+            }
+            realtime[channels - 1] = totalFrames / static_cast<double>(from) / stopwatch.elapsedSeconds();
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%d -> %d", from, to);
+        printf("  %-20s %6d %13.0fx %13.0fx %7.1f dB\n", name, taps, realtime[0], realtime[1],
+               measureStopbandDb(from, to));
+    }
+}
+
+static void benchmarkPlayer() {
+    printf("\nPlayer render, 44.1 kHz file on a 48 kHz device\n");
+    for (int channels = 1; channels <= 2; channels++) {
+        std::vector<short> data(30 * 44100 * channels);
+        for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<short>(i * 31);
+        WavWriter writer(44100, channels, SampleFormat::INT16);
+        writer.open(BENCH_FILE);
+        // Paced so the writer thread keeps up
+        for (size_t done = 0; done < data.size(); done += 44100) {
+            writer.write(data.data() + done, std::min<size_t>(44100, data.size() - done));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        writer.close();
+
+        FakeAudioBackend backend;
+        backend.setKeepRendered(false);
+        AudioPlayer player(backend);
+        player.initialize();
+        player.setOutputSampleRate(48000);
+        player.loadAudioFile(BENCH_FILE);
+        player.startPlayback();
+        Stopwatch stopwatch;
+        backend.renderBuffers(SIZE_MAX);
+        double seconds = stopwatch.elapsedSeconds();
+        double audioSeconds = backend.getRenderedSampleCount() / (48000.0 * channels);
+        printf("  %-20s %13.0fx realtime\n", channels == 1 ? "mono" : "stereo", audioSeconds / seconds);
+    }
+    remove(BENCH_FILE);
+}
+
+int main() {
+    benchmarkDotProduct();
+    benchmarkRatios();
+    benchmarkPlayer();
+    return 0;
+}
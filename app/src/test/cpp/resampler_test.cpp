@@ -0,0 +1,197 @@
+#include "resampler.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+static std::vector<float> makeTone(double frequency, int rate, size_t frames, float amplitude) {
+    std::vector<float> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        samples[i] = amplitude * static_cast<float>(std::sin(2.0 * M_PI * frequency * i / rate));
+    }
+    return samples;
+}
+
+// Amplitude of one frequency over exactly one second of |samples| from
+// |offset|, so every whole-hertz frequency has whole cycles and no leakage
+static double measureAmplitude(const std::vector<float>& samples, size_t offset, double frequency, int rate) {
+    std::complex<double> sum = 0.0;
+    for (int i = 0; i < rate; i++) {
+        sum += static_cast<double>(samples[offset + i]) * std::polar(1.0, -2.0 * M_PI * frequency * i / rate);
+    }
+    return 2.0 * std::abs(sum) / rate;
+}
+
+static double toDb(double ratio) {
+    return 20.0 * std::log10(std::max(ratio, 1e-12));
+}
+
+static void testConfigure() {
+    Resampler resampler;
+    CHECK(!resampler.isConfigured());
+    CHECK(resampler.configure(44100, 48000, 2));
+    CHECK_EQ(64, resampler.getTapsPerPhase());
+    CHECK_EQ(32u, resampler.getDelayFrames());
+
+    // 147:160 downsampling lengthens the filter to keep the transition width
+    CHECK(resampler.configure(48000, 44100, 1));
+    CHECK_EQ(72, resampler.getTapsPerPhase());
+
+    const int rates[] = {8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 192000};
+    for (int from : rates) {
+        for (int to : rates) {
+            CHECK(resampler.configure(from, to, 2));
+        }
+    }
+
+    CHECK(!resampler.configure(44100, 44101, 1));
+    CHECK(!resampler.configure(0, 48000, 1));
+    CHECK(!resampler.configure(48000, 44100, 3));
+    CHECK(!resampler.configure(192000, 1000, 1));
+    CHECK(!resampler.isConfigured());
+}
+
+static void testDotProductMatchesScalar() {
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> a(40), b(40);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = dist(random);
+        b[i] = dist(random);
+    }
+    for (size_t count = 0; count <= a.size(); count++) {
+        CHECK_NEAR(dotProductScalar(a.data(), b.data(), count), dotProduct(a.data(), b.data(), count), 1e-5);
+    }
+}
+
+static void testConstantHasNoPhaseRipple() {
+    std::vector<float> in(44100, 0.25f);
+    std::vector<float> out;
+    CHECK(resampleBuffer(in.data(), in.size(), 1, 44100, 48000, out));
+    CHECK_EQ(48000u, out.size());
+    // Away from the edges every phase gives the same value
+    for (size_t i = 200; i < out.size() - 200; i++) {
+        CHECK_NEAR(0.25, out[i], 1e-6);
+    }
+}
+
+static void testPassbandToneIsPreserved() {
+    const int pairs[][2] = {{44100, 48000}, {48000, 44100}, {16000, 48000}, {48000, 16000}, {22050, 44100}};
+    for (const auto& pair : pairs) {
+        const int from = pair[0];
+        const int to = pair[1];
+        std::vector<float> in = makeTone(1000.0, from, 3 * from, 0.5f);
+        std::vector<float> out;
+        CHECK(resampleBuffer(in.data(), in.size(), 1, from, to, out));
+        CHECK_EQ(static_cast<size_t>(3 * to), out.size());
+
+        // In step with the input: the output matches the same tone sampled
+        // at the new rate, after the edges
+        std::vector<float> ideal = makeTone(1000.0, to, out.size(), 0.5f);
+        double worst = 0.0;
+        for (size_t i = to / 10; i < out.size() - to / 10; i++) {
+            worst = std::max(worst, static_cast<double>(std::fabs(out[i] - ideal[i])));
+        }
+        printf("  %6d -> %6d Hz: 1 kHz gain %+.5f dB, worst error %.2f dB\n", from, to,
+               toDb(measureAmplitude(out, to, 1000.0, to) / 0.5), toDb(worst / 0.5));
+        CHECK_NEAR(0.5, measureAmplitude(out, to, 1000.0, to), 0.5 * 1e-4);
+        CHECK(toDb(worst / 0.5) < -60.0);
+    }
+}
+
+static void testStopbandAttenuation() {
+    // Downsampling: a tone above the output Nyquist frequency would alias
+    {
+        std::vector<float> in = makeTone(23000.0, 48000, 3 * 48000, 0.5f);
+        std::vector<float> out;
+        CHECK(resampleBuffer(in.data(), in.size(), 1, 48000, 44100, out));
+        double alias = measureAmplitude(out, 44100, 44100 - 23000, 44100);
+        double peak = 0.0;
+        for (size_t i = 44100; i < 2 * 44100; i++) peak = std::max(peak, static_cast<double>(std::fabs(out[i])));
+        printf("  48000 -> 44100 Hz: 23 kHz alias %.1f dB, peak %.1f dB\n", toDb(alias / 0.5), toDb(peak / 0.5));
+        CHECK(toDb(alias / 0.5) < -85.0);
+        CHECK(toDb(peak / 0.5) < -80.0);
+    }
+
+    // Upsampling: the input's image above its own Nyquist frequency
+    const int pairs[][3] = {{44100, 48000, 15000}, {16000, 48000, 5000}, {8000, 44100, 3000}};
+    for (const auto& pair : pairs) {
+        const int from = pair[0];
+        const int to = pair[1];
+        const int tone = pair[2];
+        std::vector<float> in = makeTone(tone, from, 3 * from, 0.5f);
+        std::vector<float> out;
+        CHECK(resampleBuffer(in.data(), in.size(), 1, from, to, out));
+        int image = from - tone;
+        if (image > to / 2) image = to - image;
+        double level = measureAmplitude(out, to, image, to);
+        printf("  %6d -> %6d Hz: image of %d Hz at %d Hz %.1f dB\n", from, to, tone, image, toDb(level / 0.5));
+        CHECK(toDb(level / 0.5) < -85.0);
+    }
+}
+
+static void testStreamingMatchesOffline() {
+    const int pairs[][2] = {{44100, 48000}, {48000, 44100}, {8000, 44100}, {96000, 22050}};
+    std::mt19937 random(17);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    for (const auto& pair : pairs) {
+        for (int channels = 1; channels <= 2; channels++) {
+            const size_t frames = 20000;
+            std::vector<float> in(frames * channels);
+            for (float& sample : in) sample = dist(random);
+
+            std::vector<float> offline;
+            CHECK(resampleBuffer(in.data(), frames, channels, pair[0], pair[1], offline));
+
+            // Ragged input and output blocks, then silence to flush
+            Resampler resampler;
+            CHECK(resampler.configure(pair[0], pair[1], channels));
+            std::vector<float> streamed;
+            std::vector<float> block(777 * channels);
+            std::vector<float> silence(resampler.getDelayFrames() * channels, 0.0f);
+            std::uniform_int_distribution<size_t> sizes(1, 777);
+            size_t consumed = 0;
+            while (streamed.size() < offline.size()) {
+                const float* source = consumed < frames ? in.data() + consumed * channels : silence.data();
+                size_t available = consumed < frames ? std::min(sizes(random), frames - consumed)
+                                                     : silence.size() / channels;
+                size_t used = 0;
+                size_t produced = resampler.process(source, available, used, block.data(), sizes(random));
+                if (consumed < frames) consumed += used;
+                streamed.insert(streamed.end(), block.begin(), block.begin() + produced * channels);
+            }
+            streamed.resize(offline.size());
+            CHECK(streamed == offline);
+        }
+    }
+}
+
+static void testResetStartsNewStream() {
+    Resampler resampler;
+    CHECK(resampler.configure(44100, 48000, 1));
+    std::vector<float> in = makeTone(440.0, 44100, 4096, 0.5f);
+    std::vector<float> first(8192), second(8192);
+    size_t used = 0;
+    size_t firstCount = resampler.process(in.data(), in.size(), used, first.data(), first.size());
+    CHECK_EQ(in.size(), used);
+
+    resampler.reset();
+    size_t secondCount = resampler.process(in.data(), in.size(), used, second.data(), second.size());
+    CHECK_EQ(firstCount, secondCount);
+    CHECK(first == second);
+}
+
+int main() {
+    RUN_TEST(testConfigure);
+    RUN_TEST(testDotProductMatchesScalar);
+    RUN_TEST(testConstantHasNoPhaseRipple);
+    RUN_TEST(testPassbandToneIsPreserved);
+    RUN_TEST(testStopbandAttenuation);
+    RUN_TEST(testStreamingMatchesOffline);
+    RUN_TEST(testResetStartsNewStream);
+    return TEST_RESULT();
+}
@@ -0,0 +1,137 @@
+#include "audio_player.h"
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "sample_convert.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Format conversion and stereo (de)interleave kernels, SIMD against the
+// scalar loops, then each recorder and player specialization end to end:
+// per-block capture callback cost and render throughput, for every sample
+// format in mono and stereo at 48 kHz.
+
+static const char* BENCH_FILE = "sample_convert_benchmark.wav";
+static const size_t BLOCK = 2048;
+static const size_t TOTAL_SAMPLES = 1ull << 26;
+
+template <typename In, typename Out>
+static double measure(void (*kernel)(const In*, Out*, size_t), const std::vector<In>& in, std::vector<Out>& out) {
+    Stopwatch stopwatch;
+    for (size_t done = 0; done < TOTAL_SAMPLES; done += BLOCK) {
+        size_t offset = done % (in.size() - BLOCK + 1);
+        kernel(in.data() + offset, out.data() + offset, BLOCK);
+    }
+    return TOTAL_SAMPLES / stopwatch.elapsedSeconds();
+}
+
+template <typename In, typename Out>
+static void compare(const char* name, void (*simd)(const In*, Out*, size_t),
+                    void (*scalar)(const In*, Out*, size_t), const std::vector<In>& in) {
+    std::vector<Out> out(in.size());
+    double scalarRate = measure(scalar, in, out);
+    double simdRate = measure(simd, in, out);
+    printf("  %-22s %9.0f Ms/s %9.0f Ms/s %7.1fx\n", name, scalarRate / 1e6, simdRate / 1e6, simdRate / scalarRate);
+}
+
+template <typename T>
+static void compareInterleave(const char* name, const std::vector<T>& interleaved) {
+    size_t frames = interleaved.size() / 2;
+    std::vector<T> left(frames), right(frames), out(interleaved.size());
+    const size_t blockFrames = BLOCK / 2;
+
+    auto run = [&](bool simd) {
+        Stopwatch stopwatch;
+        for (size_t done = 0; done < TOTAL_SAMPLES / 2; done += blockFrames) {
+            size_t offset = done % (frames - blockFrames + 1);
+            if (simd) {
+                deinterleaveStereo(interleaved.data() + 2 * offset, left.data() + offset, right.data() + offset, blockFrames);
+                interleaveStereo(left.data() + offset, right.data() + offset, out.data() + 2 * offset, blockFrames);
+            } else {
+                deinterleaveStereoScalar(interleaved.data() + 2 * offset, left.data() + offset, right.data() + offset, blockFrames);
+                interleaveStereoScalar(left.data() + offset, right.data() + offset, out.data() + 2 * offset, blockFrames);
+            }
+        }
+        return TOTAL_SAMPLES / stopwatch.elapsedSeconds();
+    };
+    double scalarRate = run(false);
+    double simdRate = run(true);
+    printf("  %-22s %9.0f Ms/s %9.0f Ms/s %7.1fx\n", name, scalarRate / 1e6, simdRate / 1e6, simdRate / scalarRate);
+}
+
+static const char* formatName(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::INT24_PACKED: return "int24";
+        case SampleFormat::FLOAT32: return "float32";
+        default: return "int16";
+    }
+}
+
+static void benchmarkSpecializations() {
+    printf("\nRecorder and player per format, 48 kHz, 1024-frame capture blocks\n");
+    printf("  %-16s %18s %18s\n", "format", "capture p50/block", "render realtime");
+    const SampleFormat formats[] = {SampleFormat::INT16, SampleFormat::INT24_PACKED, SampleFormat::FLOAT32};
+
+    for (SampleFormat format : formats) {
+        for (int channels = 1; channels <= 2; channels++) {
+            FakeAudioBackend backend;
+            AudioRecorder recorder(backend);
+            recorder.initialize();
+            recorder.configureFormat(48000, channels, format);
+            recorder.startRecording(BENCH_FILE);
+            backend.setRecordTimings(true);
+            // Paced so the writer keeps up and every block takes the full path
+            backend.runCaptureAtSpeed(20ull * 48000, 50);
+            recorder.stopRecording();
+
+            std::vector<double> seconds = backend.getCallbackSeconds();
+            std::sort(seconds.begin(), seconds.end());
+            double captureUs = seconds.empty() ? 0.0 : seconds[seconds.size() / 2] * 1e6;
+
+            AudioPlayer player(backend);
+            player.initialize();
+            player.loadAudioFile(BENCH_FILE);
+            player.startPlayback();
+            backend.setKeepRendered(false);
+            uint64_t before = backend.getRenderedSampleCount();
+            Stopwatch stopwatch;
+            backend.renderBuffers(SIZE_MAX);
+            double renderSeconds = stopwatch.elapsedSeconds();
+            double audioSeconds = (backend.getRenderedSampleCount() - before) / (48000.0 * channels);
+
+            char name[32];
+            snprintf(name, sizeof(name), "%s %s", formatName(format), channels == 1 ? "mono" : "stereo");
+            printf("  %-16s %15.2f us %17.0fx\n", name, captureUs, audioSeconds / renderSeconds);
+        }
+    }
+    remove(BENCH_FILE);
+    remove("sample_convert_benchmark.peaks");
+}
+
+int main() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> dist(SHRT_MIN, SHRT_MAX);
+    std::vector<short> shorts(1 << 20);
+    for (short& sample : shorts) sample = static_cast<short>(dist(random));
+    std::vector<float> floats(shorts.size());
+    std::vector<Int24> packed(shorts.size());
+    convertSamples(shorts.data(), floats.data(), shorts.size());
+    convertSamples(shorts.data(), packed.data(), shorts.size());
+
+    printf("%-24s %14s %14s %8s\n", "kernel", "scalar", "simd", "speedup");
+    compare<float, short>("float32 -> int16", convertSamples, convertSamplesScalar, floats);
+    compare<short, float>("int16 -> float32", convertSamples, convertSamplesScalar, shorts);
+    compare<Int24, short>("int24 -> int16", convertSamples, convertSamplesScalar, packed);
+    compare<short, Int24>("int16 -> int24", convertSamples, convertSamplesScalar, shorts);
+    compare<Int24, float>("int24 -> float32", convertSamples, convertSamplesScalar, packed);
+    compareInterleave<short>("int16 split + merge", shorts);
+    compareInterleave<float>("float32 split + merge", floats);
+
+    benchmarkSpecializations();
+    return 0;
+}
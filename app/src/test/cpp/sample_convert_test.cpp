@@ -0,0 +1,156 @@
+#include "sample_convert.h"
+#include "test_util.h"
+
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Every length from 0 to 40 covers the SIMD bodies and all tail lengths
+static const size_t MAX_COUNT = 40;
+
+static std::vector<short> makeShorts(size_t count, int seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> dist(SHRT_MIN, SHRT_MAX);
+    std::vector<short> samples(count);
+    for (short& sample : samples) sample = static_cast<short>(dist(random));
+    if (count > 1) {
+        samples[0] = SHRT_MIN;
+        samples[1] = SHRT_MAX;
+    }
+    return samples;
+}
+
+static void testFloatToInt16MatchesScalar() {
+    std::vector<float> in = {0.0f, 1.0f, -1.0f, 1.5f, -1.5f, 0.5f / 32768, 1.5f / 32768,
+                             -0.5f / 32768, 2.5f / 32768, 32767.5f / 32768, -32768.5f / 32768,
+                             NAN, 1e30f, -1e30f};
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+    while (in.size() < MAX_COUNT) in.push_back(dist(random));
+
+    for (size_t count = 0; count <= MAX_COUNT; count++) {
+        std::vector<short> simd(count), scalar(count);
+        convertSamples(in.data(), simd.data(), count);
+        convertSamplesScalar(in.data(), scalar.data(), count);
+        CHECK(simd == scalar);
+    }
+
+    short out[14];
+    convertSamples(in.data(), out, 14);
+    CHECK_EQ(0, out[0]);
+    CHECK_EQ(32767, out[1]);
+    CHECK_EQ(-32768, out[2]);
+    CHECK_EQ(32767, out[3]);
+    CHECK_EQ(-32768, out[4]);
+    // Ties round to even
+    CHECK_EQ(0, out[5]);
+    CHECK_EQ(2, out[6]);
+    CHECK_EQ(0, out[7]);
+    CHECK_EQ(2, out[8]);
+    CHECK_EQ(32767, out[12]);
+    CHECK_EQ(-32768, out[13]);
+}
+
+static void testInt16RoundTrips() {
+    for (size_t count = 0; count <= MAX_COUNT; count++) {
+        std::vector<short> in = makeShorts(count, static_cast<int>(count));
+
+        std::vector<float> floats(count), floatsScalar(count);
+        convertSamples(in.data(), floats.data(), count);
+        convertSamplesScalar(in.data(), floatsScalar.data(), count);
+        CHECK(floats == floatsScalar);
+
+        std::vector<Int24> packed(count), packedScalar(count);
+        convertSamples(in.data(), packed.data(), count);
+        convertSamplesScalar(in.data(), packedScalar.data(), count);
+        CHECK(count == 0 || memcmp(packed.data(), packedScalar.data(), count * sizeof(Int24)) == 0);
+
+        std::vector<short> back(count);
+        convertSamples(floats.data(), back.data(), count);
+        CHECK(back == in);
+        convertSamples(packed.data(), back.data(), count);
+        CHECK(back == in);
+    }
+
+    Int24 sample;
+    sample.set(-2);
+    CHECK_EQ(0xFE, sample.bytes[0]);
+    CHECK_EQ(0xFF, sample.bytes[2]);
+    CHECK_EQ(-2, sample.get());
+    sample.set(0x7FFFFF);
+    CHECK_EQ(0x7FFFFF, sample.get());
+}
+
+static void testInt24Conversions() {
+    std::mt19937 random(9);
+    std::uniform_int_distribution<int32_t> dist(-(1 << 23), (1 << 23) - 1);
+    std::vector<Int24> in(MAX_COUNT);
+    for (Int24& sample : in) sample.set(dist(random));
+    in[0].set(-(1 << 23));
+    in[1].set((1 << 23) - 1);
+    in[2].set(-1);
+
+    for (size_t count = 0; count <= MAX_COUNT; count++) {
+        std::vector<short> simd(count), scalar(count);
+        convertSamples(in.data(), simd.data(), count);
+        convertSamplesScalar(in.data(), scalar.data(), count);
+        CHECK(simd == scalar);
+        for (size_t i = 0; i < count; i++) CHECK_EQ(in[i].get() >> 8, simd[i]);
+
+        std::vector<float> floats(count), floatsScalar(count);
+        convertSamples(in.data(), floats.data(), count);
+        convertSamplesScalar(in.data(), floatsScalar.data(), count);
+        CHECK(floats == floatsScalar);
+        for (size_t i = 0; i < count; i++) CHECK(floats[i] * 8388608.0f == static_cast<float>(in[i].get()));
+
+        std::vector<Int24> back(count), backScalar(count);
+        convertSamples(floats.data(), back.data(), count);
+        convertSamplesScalar(floats.data(), backScalar.data(), count);
+        CHECK(count == 0 || memcmp(back.data(), backScalar.data(), count * sizeof(Int24)) == 0);
+        CHECK(count == 0 || memcmp(back.data(), in.data(), count * sizeof(Int24)) == 0);
+    }
+
+    // Rounds to nearest and saturates, NaN low
+    const float edges[] = {1.0f, -1.0f, 2.0f, -2.0f, 0.5f / 8388608.0f, 1.5f / 8388608.0f, NAN,
+                           -0.6f / 8388608.0f};
+    const int32_t expected[] = {8388607, -8388608, 8388607, -8388608, 0, 2, -8388608, -1};
+    std::vector<float> floats(MAX_COUNT);
+    for (size_t i = 0; i < floats.size(); i++) floats[i] = edges[i % 8];
+    std::vector<Int24> packed(MAX_COUNT);
+    convertSamples(floats.data(), packed.data(), floats.size());
+    for (size_t i = 0; i < packed.size(); i++) CHECK_EQ(expected[i % 8], packed[i].get());
+}
+
+static void testInterleaveRoundTrips() {
+    for (size_t frames = 0; frames <= MAX_COUNT; frames++) {
+        std::vector<short> interleaved = makeShorts(2 * frames, 100 + static_cast<int>(frames));
+        std::vector<short> left(frames), right(frames), back(2 * frames);
+        deinterleaveStereo(interleaved.data(), left.data(), right.data(), frames);
+        for (size_t i = 0; i < frames; i++) {
+            CHECK_EQ(interleaved[2 * i], left[i]);
+            CHECK_EQ(interleaved[2 * i + 1], right[i]);
+        }
+        interleaveStereo(left.data(), right.data(), back.data(), frames);
+        CHECK(back == interleaved);
+
+        std::vector<float> floats(2 * frames), leftF(frames), rightF(frames), backF(2 * frames);
+        convertSamples(interleaved.data(), floats.data(), 2 * frames);
+        deinterleaveStereo(floats.data(), leftF.data(), rightF.data(), frames);
+        for (size_t i = 0; i < frames; i++) {
+            CHECK(leftF[i] == floats[2 * i]);
+            CHECK(rightF[i] == floats[2 * i + 1]);
+        }
+        interleaveStereo(leftF.data(), rightF.data(), backF.data(), frames);
+        CHECK(backF == floats);
+    }
+}
+
+int main() {
+    RUN_TEST(testFloatToInt16MatchesScalar);
+    RUN_TEST(testInt16RoundTrips);
+    RUN_TEST(testInt24Conversions);
+    RUN_TEST(testInterleaveRoundTrips);
+    return TEST_RESULT();
+}
@@ -0,0 +1,292 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "fft.h"
+#include "spectrogram.h"
+#include "test_util.h"
+#include "wav_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+static const double PI = 3.14159265358979323846;
+static const char* TEST_FILE = "spectrogram_test.wav";
+
+// Straight from the definition, in double
+static std::vector<std::complex<double>> dft(const std::vector<std::complex<double>>& in) {
+    size_t n = in.size();
+    std::vector<std::complex<double>> out(n);
+    for (size_t k = 0; k < n; k++) {
+        std::complex<double> sum = 0.0;
+        for (size_t j = 0; j < n; j++) {
+            sum += in[j] * std::polar(1.0, -2.0 * PI * static_cast<double>((j * k) % n) / n);
+        }
+        out[k] = sum;
+    }
+    return out;
+}
+
+// Largest error against |expected|, relative to its largest magnitude
+static double relativeError(const std::vector<std::complex<double>>& expected, const float* re, const float* im,
+                            size_t count) {
+    double largest = 0.0;
+    double error = 0.0;
+    for (size_t k = 0; k < count; k++) {
+        largest = std::max(largest, std::abs(expected[k]));
+        error = std::max(error, std::abs(expected[k] - std::complex<double>(re[k], im[k])));
+    }
+    return error / largest;
+}
+
+// Mono 16-bit WAV of |frames| of sine at |amplitude|, switching from
+// |firstHz| to |secondHz| halfway through
+static void writeToneFile(const std::string& path, int sampleRate, size_t frames, double firstHz,
+                          double secondHz, double amplitude) {
+    std::vector<short> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        double frequency = i < frames / 2 ? firstHz : secondHz;
+        samples[i] = static_cast<short>(std::lround(amplitude * 32767.0 * std::sin(2.0 * PI * frequency * i / sampleRate)));
+    }
+
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(sampleRate, 1, SampleFormat::INT16, samples.size() * sizeof(short), header);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size() * sizeof(short)));
+}
+
+static size_t peakBin(const uint8_t* frame, size_t bins) {
+    return static_cast<size_t>(std::max_element(frame, frame + bins) - frame);
+}
+
+static void testFftMatchesDft() {
+    CHECK(!FftPlan::isValidSize(8));
+    CHECK(!FftPlan::isValidSize(48));
+    CHECK(!FftPlan::isValidSize(2 * FftPlan::MAX_SIZE));
+
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    // Odd and even powers of two, so both the radix-2 tail and without
+    for (size_t n = FftPlan::MIN_SIZE; n <= 4096; n *= 2) {
+        std::vector<float> re(n), im(n);
+        std::vector<std::complex<double>> in(n);
+        for (size_t i = 0; i < n; i++) {
+            re[i] = dist(random);
+            im[i] = dist(random);
+            in[i] = {re[i], im[i]};
+        }
+        std::vector<float> scalarRe = re, scalarIm = im;
+
+        FftPlan plan(n);
+        plan.forward(re.data(), im.data());
+        plan.forwardScalar(scalarRe.data(), scalarIm.data());
+        std::vector<std::complex<double>> expected = dft(in);
+        CHECK(relativeError(expected, re.data(), im.data(), n) < 1e-6);
+        CHECK(relativeError(expected, scalarRe.data(), scalarIm.data(), n) < 1e-6);
+    }
+
+    // A unit impulse, unnormalized, at the largest size
+    std::vector<float> re(FftPlan::MAX_SIZE, 0.0f), im(FftPlan::MAX_SIZE, 0.0f);
+    re[0] = 1.0f;
+    FftPlan plan(FftPlan::MAX_SIZE);
+    plan.forward(re.data(), im.data());
+    bool flat = true;
+    for (size_t k = 0; k < re.size(); k++) {
+        flat = flat && re[k] == 1.0f && im[k] == 0.0f;
+    }
+    CHECK(flat);
+}
+
+static void testRealFftMatchesDft() {
+    CHECK(!RealFft::isValidSize(FftPlan::MIN_SIZE));
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (size_t n = 2 * FftPlan::MIN_SIZE; n <= 4096; n *= 2) {
+        std::vector<float> in(n);
+        std::vector<std::complex<double>> complexIn(n);
+        for (size_t i = 0; i < n; i++) {
+            in[i] = dist(random);
+            complexIn[i] = in[i];
+        }
+
+        RealFft fft(n);
+        CHECK_EQ(n / 2 + 1, fft.getBinCount());
+        std::vector<float> re(fft.getBinCount()), im(fft.getBinCount());
+        fft.forward(in.data(), re.data(), im.data());
+        CHECK(relativeError(dft(complexIn), re.data(), im.data(), fft.getBinCount()) < 1e-6);
+    }
+}
+
+static void testSineLandsInItsBin() {
+    // Bin 64 of a 1024-point window at 48 kHz is 3 kHz exactly
+    StftAnalyzer analyzer(1024, 512, 1);
+    std::vector<float> samples(4096);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = static_cast<float>(0.5 * std::sin(2.0 * PI * 3000.0 * i / 48000.0));
+    }
+
+    size_t frames = 0;
+    analyzer.process(samples.data(), samples.size(), [&](const float* power) {
+        frames++;
+        CHECK_NEAR(0.25, power[64], 1e-4);
+        // Hann leaks half the amplitude into each neighbour and next to
+        // nothing further out
+        CHECK_NEAR(0.0625, power[63], 1e-4);
+        CHECK(power[70] < 1e-8f);
+
+        uint8_t bytes[512];
+        quantizeSpectrum(power, bytes, 512);
+        // -6.02 dB of a 100 dB range
+        CHECK_EQ(240, bytes[64]);
+        CHECK_EQ(0, bytes[200]);
+    });
+    CHECK_EQ((4096u - 1024) / 512 + 1, frames);
+}
+
+static void testQuantizesAcrossTheRange() {
+    float power[] = {1.0f, 2.0f, 1e-6f, 1e-10f, 1e-12f, 0.0f, NAN};
+    uint8_t bytes[7];
+    quantizeSpectrum(power, bytes, 7);
+    CHECK_EQ(255, bytes[0]);
+    CHECK_EQ(255, bytes[1]);
+    // -60 and -100 dB
+    CHECK_EQ(102, bytes[2]);
+    CHECK_EQ(0, bytes[3]);
+    CHECK_EQ(0, bytes[4]);
+    CHECK_EQ(0, bytes[5]);
+    CHECK_EQ(0, bytes[6]);
+
+    // Within a step of the exact dB everywhere in between
+    bool close = true;
+    for (float db = -100.0f; db <= 0.0f; db += 0.37f) {
+        float value = std::pow(10.0f, db / 10.0f);
+        uint8_t byte;
+        quantizeSpectrum(&value, &byte, 1);
+        close = close && std::fabs(byte - (db + 100.0f) * 2.55f) <= 0.51f;
+    }
+    CHECK(close);
+}
+
+static void testBlockSizeDoesNotMatter() {
+    std::mt19937 random(5);
+    std::uniform_int_distribution<int> dist(-20000, 20000);
+    std::vector<short> samples(2 * 5000);
+    for (short& sample : samples) sample = static_cast<short>(dist(random));
+
+    auto collect = [&](size_t blockFrames) {
+        StftAnalyzer analyzer(256, 100, 2);
+        std::vector<float> out;
+        auto sink = [&](const float* power) { out.insert(out.end(), power, power + 128); };
+        for (size_t done = 0; done < 5000; done += blockFrames) {
+            size_t frames = std::min(blockFrames, 5000 - done);
+            analyzer.process(samples.data() + 2 * done, frames, sink);
+        }
+        analyzer.flush(sink);
+        // Nothing new since the flush, so nothing more
+        analyzer.flush(sink);
+        return out;
+    };
+
+    std::vector<float> whole = collect(5000);
+    // Every complete window, then the tail padded out
+    CHECK_EQ(((5000u - 256) / 100 + 2) * 128, whole.size());
+    CHECK(collect(1) == whole);
+    CHECK(collect(7) == whole);
+    CHECK(collect(1024) == whole);
+}
+
+static void testLiveDropsWholeFrames() {
+    LiveSpectrogram live(256, 128, 1, 4);
+    CHECK_EQ(128u, live.getBinCount());
+    std::vector<short> samples(128 * 11, 1000);
+    live.write(samples.data(), samples.size());
+
+    // Ten frames for room for four: the rest are dropped, not split
+    CHECK_EQ(6u, live.getDroppedFrames());
+    std::vector<uint8_t> out(5 * 128);
+    CHECK_EQ(3u, live.read(out.data(), 3));
+    CHECK_EQ(1u, live.read(out.data(), 5));
+    CHECK_EQ(0u, live.read(out.data(), 5));
+    // DC, 1000 / 32768 of full scale, stays in the first bins
+    CHECK(out[0] > 150);
+    CHECK_EQ(0, out[100]);
+}
+
+static void testRecorderFeedsSpectrogram() {
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    CHECK(recorder.initialize());
+    CHECK(recorder.configureFormat(48000, 2, SampleFormat::FLOAT32));
+    CHECK(!recorder.openSpectrogram(1000, 500));
+    CHECK(!recorder.openSpectrogram(1024, 0));
+    CHECK(!recorder.openSpectrogram(1024, 2048));
+    CHECK(recorder.openSpectrogram(1024, 512));
+    LiveSpectrogram* live = recorder.getSpectrogram();
+    CHECK(live != nullptr);
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    backend.advanceCapture(20 * 1024);
+    CHECK(recorder.stopRecording());
+    std::vector<uint8_t> out(64 * live->getBinCount());
+    CHECK_EQ((20u * 1024 - 1024) / 512 + 1, live->read(out.data(), 64));
+    CHECK_EQ(0u, live->getDroppedFrames());
+
+    // The format stays put while it is open
+    CHECK(!recorder.configureFormat(44100, 1, SampleFormat::INT16));
+    recorder.closeSpectrogram();
+    CHECK(recorder.getSpectrogram() == nullptr);
+    CHECK(recorder.configureFormat(44100, 1, SampleFormat::INT16));
+
+    remove(TEST_FILE);
+    remove("spectrogram_test.peaks");
+}
+
+static void testAnalyzesFileInColumns() {
+    // 750 Hz then 3 kHz: bins 16 and 64 of a 1024-point window
+    writeToneFile(TEST_FILE, 48000, 48000, 750.0, 3000.0, 0.5);
+    std::vector<uint8_t> out;
+    CHECK(!analyzeSpectrogram(TEST_FILE, 1000, 20, out));
+    CHECK(!analyzeSpectrogram(TEST_FILE, 1024, 0, out));
+    CHECK(!analyzeSpectrogram("missing.wav", 1024, 20, out));
+
+    CHECK(analyzeSpectrogram(TEST_FILE, 1024, 20, out));
+    CHECK_EQ(20u * 512, out.size());
+    for (size_t column = 0; column < 8; column++) {
+        CHECK_EQ(16u, peakBin(out.data() + column * 512, 512));
+    }
+    for (size_t column = 12; column < 20; column++) {
+        CHECK_EQ(64u, peakBin(out.data() + column * 512, 512));
+    }
+    CHECK_NEAR(240, out[5 * 512 + 16], 1);
+
+    // Fewer frames than columns, and than one window: the one padded
+    // window fills every column
+    writeToneFile(TEST_FILE, 48000, 100, 3000.0, 3000.0, 0.5);
+    CHECK(analyzeSpectrogram(TEST_FILE, 1024, 300, out));
+    CHECK_EQ(300u * 512, out.size());
+    CHECK(out[64] > 0);
+    bool filled = true;
+    for (size_t column = 1; column < 300; column++) {
+        filled = filled && std::equal(out.begin(), out.begin() + 512, out.begin() + column * 512);
+    }
+    CHECK(filled);
+
+    remove(TEST_FILE);
+}
+
+int main() {
+    RUN_TEST(testFftMatchesDft);
+    RUN_TEST(testRealFftMatchesDft);
+    RUN_TEST(testSineLandsInItsBin);
+    RUN_TEST(testQuantizesAcrossTheRange);
+    RUN_TEST(testBlockSizeDoesNotMatter);
+    RUN_TEST(testLiveDropsWholeFrames);
+    RUN_TEST(testRecorderFeedsSpectrogram);
+    RUN_TEST(testAnalyzesFileInColumns);
+    return TEST_RESULT();
+}
@@ -0,0 +1,63 @@
+#include "spsc_ring_buffer.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Throughput of the lock-free ring against the mutex-guarded vector append
+// the capture callback used before, for a few callback block sizes.
+
+static const size_t TOTAL_SAMPLES = 200 * 1000 * 1000;
+static const size_t RING_SAMPLES = 128 * 1024;
+
+static double runRing(size_t blockSize) {
+    SpscRingBuffer<short> ring(RING_SAMPLES);
+    std::atomic<bool> done{false};
+    const size_t blocks = TOTAL_SAMPLES / blockSize;
+
+    Stopwatch stopwatch;
+    std::thread consumer([&] {
+        std::vector<short> out(16 * 1024);
+        while (!done || ring.availableToRead() > 0) {
+            if (ring.read(out.data(), out.size()) == 0) std::this_thread::yield();
+        }
+    });
+
+    std::vector<short> block(blockSize, 1);
+    for (size_t b = 0; b < blocks; b++) {
+        while (!ring.write(block.data(), blockSize)) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    consumer.join();
+    return blocks * blockSize / stopwatch.elapsedSeconds();
+}
+
+static double runMutexVector(size_t blockSize) {
+    std::vector<short> buffer;
+    std::mutex mutex;
+    const size_t blocks = TOTAL_SAMPLES / blockSize / 4;
+
+    Stopwatch stopwatch;
+    std::vector<short> block(blockSize, 1);
+    for (size_t b = 0; b < blocks; b++) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.insert(buffer.end(), block.begin(), block.end());
+    }
+    return blocks * blockSize / stopwatch.elapsedSeconds();
+}
+
+int main() {
+    const size_t blockSizes[] = {256, 1024, 4096};
+
+    printf("%-10s %18s %18s\n", "block", "ring Msamples/s", "mutex+vector");
+    for (size_t blockSize : blockSizes) {
+        double ring = runRing(blockSize);
+        double mutexVector = runMutexVector(blockSize);
+        printf("%-10zu %18.1f %18.1f\n", blockSize, ring / 1e6, mutexVector / 1e6);
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "spsc_ring_buffer.h"
+#include "test_util.h"
+
+#include <thread>
+#include <vector>
+
+static void testCapacityRoundsUpToPowerOfTwo() {
+    SpscRingBuffer<short> ring(1000);
+    CHECK_EQ(1024u, ring.getCapacity());
+    CHECK_EQ(0u, ring.availableToRead());
+    CHECK_EQ(1024u, ring.availableToWrite());
+}
+
+static void testWriteThenReadPreservesOrder() {
+    SpscRingBuffer<int> ring(16);
+    int in[10];
+    for (int i = 0; i < 10; i++) in[i] = i;
+
+    CHECK(ring.write(in, 10));
+    CHECK_EQ(10u, ring.availableToRead());
+
+    int out[10] = {};
+    CHECK_EQ(10u, ring.read(out, 10));
+    for (int i = 0; i < 10; i++) {
+        CHECK_EQ(i, out[i]);
+    }
+    CHECK_EQ(0u, ring.availableToRead());
+}
+
+static void testWrapAround() {
+    SpscRingBuffer<int> ring(8);
+    int block[5];
+    int out[5];
+    int next = 0;
+    int expected = 0;
+
+    // 5 does not divide 8, so the copies straddle the end of storage
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 5; i++) block[i] = next++;
+        CHECK(ring.write(block, 5));
+        CHECK_EQ(5u, ring.read(out, 5));
+        for (int i = 0; i < 5; i++) {
+            CHECK_EQ(expected++, out[i]);
+        }
+    }
+}
+
+static void testOverflowIsAllOrNothingAndCounted() {
+    SpscRingBuffer<int> ring(8);
+    int block[6] = {1, 2, 3, 4, 5, 6};
+
+    CHECK(ring.write(block, 6));
+    CHECK(!ring.write(block, 6));
+    CHECK(!ring.write(block, 3));
+    CHECK(ring.write(block, 2));
+
+    CHECK_EQ(2u, ring.getOverflowCount());
+    CHECK_EQ(9u, ring.getDroppedItems());
+    CHECK_EQ(8u, ring.availableToRead());
+
+    // Rejected blocks left no partial data behind
+    int out[8];
+    CHECK_EQ(8u, ring.read(out, 8));
+    CHECK_EQ(6, out[5]);
+    CHECK_EQ(1, out[6]);
+    CHECK_EQ(2, out[7]);
+}
+
+static void testHighWaterMark() {
+    SpscRingBuffer<int> ring(32);
+    int block[10] = {};
+    int out[10];
+
+    ring.write(block, 10);
+    ring.write(block, 10);
+    ring.read(out, 10);
+    ring.read(out, 10);
+    ring.write(block, 5);
+
+    CHECK_EQ(20u, ring.getHighWaterMark());
+}
+
+static void testPartialRead() {
+    SpscRingBuffer<int> ring(16);
+    int block[4] = {7, 8, 9, 10};
+    int out[16];
+
+    ring.write(block, 4);
+    CHECK_EQ(4u, ring.read(out, 16));
+    CHECK_EQ(0u, ring.read(out, 16));
+}
+
+static void testResetClearsStateAndStatistics() {
+    SpscRingBuffer<int> ring(4);
+    int block[4] = {};
+
+    ring.write(block, 4);
+    ring.write(block, 4);
+    ring.reset();
+
+    CHECK_EQ(0u, ring.availableToRead());
+    CHECK_EQ(0u, ring.getOverflowCount());
+    CHECK_EQ(0u, ring.getDroppedItems());
+    CHECK_EQ(0u, ring.getHighWaterMark());
+}
+
+static void testConcurrentProducerConsumer() {
+    const size_t totalBlocks = 20000;
+    const size_t blockSize = 256;
+    SpscRingBuffer<unsigned> ring(4096);
+
+    std::thread producer([&] {
+        std::vector<unsigned> block(blockSize);
+        unsigned next = 0;
+        for (size_t b = 0; b < totalBlocks; b++) {
+            for (size_t i = 0; i < blockSize; i++) block[i] = next + i;
+            while (!ring.write(block.data(), blockSize)) {
+                std::this_thread::yield();
+            }
+            next += blockSize;
+        }
+    });
+
+    std::vector<unsigned> out(1000);
+    unsigned expected = 0;
+    size_t received = 0;
+    bool inOrder = true;
+    while (received < totalBlocks * blockSize) {
+        size_t count = ring.read(out.data(), out.size());
+        for (size_t i = 0; i < count; i++) {
+            inOrder = inOrder && out[i] == expected;
+            expected++;
+        }
+        received += count;
+        if (count == 0) std::this_thread::yield();
+    }
+    producer.join();
+
+    CHECK(inOrder);
+    CHECK_EQ(totalBlocks * blockSize, received);
+    CHECK(ring.getHighWaterMark() <= ring.getCapacity());
+}
+
+int main() {
+    RUN_TEST(testCapacityRoundsUpToPowerOfTwo);
+    RUN_TEST(testWriteThenReadPreservesOrder);
+    RUN_TEST(testWrapAround);
+    RUN_TEST(testOverflowIsAllOrNothingAndCounted);
+    RUN_TEST(testHighWaterMark);
+    RUN_TEST(testPartialRead);
+    RUN_TEST(testResetClearsStateAndStatistics);
+    RUN_TEST(testConcurrentProducerConsumer);
+    return TEST_RESULT();
+}
@@ -0,0 +1,120 @@
+#include "take_recovery.h"
+#include "test_util.h"
+#include "wav_file.h"
+#include "wav_writer.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// What crash safety costs a minute of 48 kHz stereo: syncs and bytes on
+// top of the audio itself, for the writer with commits off, at the
+// recorder's interval and at a shorter one, against syncing and patching
+// the header after every capture block. Sync time is the count times the
+// mean sync measured in the per-block run, as the writer's own pace is
+// set by its polling. Then how long recovery takes for short and long
+// takes.
+
+static const int SAMPLE_RATE = 48000;
+static const int CHANNELS = 2;
+static const size_t BLOCK_FRAMES = 1024;
+static const int SECONDS = 60;
+static const char* TEST_FILE = "take_recovery_benchmark.wav";
+// Well inside the writer's ring
+static const uint64_t MAX_PENDING_SAMPLES = 64 * 1024;
+
+struct Result {
+    uint64_t syncs;
+    uint64_t headerWrites;
+};
+
+static Result measureWriter(int commitMs) {
+    WavWriter writer(SAMPLE_RATE, CHANNELS, SampleFormat::INT16);
+    writer.setCommitInterval(commitMs);
+    std::vector<short> block(BLOCK_FRAMES * CHANNELS, 100);
+    writer.open(TEST_FILE);
+    size_t blocks = static_cast<size_t>(SECONDS) * SAMPLE_RATE / BLOCK_FRAMES;
+    for (size_t i = 0; i < blocks; i++) {
+        // As fast as the writer takes it, never dropping
+        while (writer.getSamplesPending() > MAX_PENDING_SAMPLES) {
+            std::this_thread::yield();
+        }
+        writer.write(block.data(), block.size());
+    }
+    writer.close();
+    Result result;
+    // Plus the sync at close; the header goes out at open and close too
+    result.syncs = writer.getCommitCount() + (commitMs > 0 ? 1 : 0);
+    result.headerWrites = writer.getCommitCount() + 2;
+    return result;
+}
+
+// The obvious design: every block is synced and committed as it arrives
+static Result measurePerBlock(double& syncMs) {
+    std::vector<short> block(BLOCK_FRAMES * CHANNELS, 100);
+    size_t blockBytes = block.size() * sizeof(short);
+    uint8_t header[WAV_HEADER_SIZE];
+    double syncSeconds = 0.0;
+    int fd = open(TEST_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    size_t blocks = static_cast<size_t>(SECONDS) * SAMPLE_RATE / BLOCK_FRAMES;
+    for (size_t i = 0; i < blocks; i++) {
+        if (pwrite(fd, block.data(), blockBytes, static_cast<off_t>(WAV_HEADER_SIZE + i * blockBytes)) < 0) break;
+        Stopwatch stopwatch;
+        fdatasync(fd);
+        syncSeconds += stopwatch.elapsedSeconds();
+        buildWavHeader(SAMPLE_RATE, CHANNELS, SampleFormat::INT16, (i + 1) * blockBytes, header);
+        if (pwrite(fd, header, sizeof(header), 0) < 0) break;
+    }
+    close(fd);
+    syncMs = syncSeconds * 1000.0 / blocks;
+    Result result;
+    result.syncs = blocks;
+    result.headerWrites = blocks;
+    return result;
+}
+
+static void printRow(const char* name, const Result& result, double syncMs) {
+    double audioBytes = static_cast<double>(SECONDS) * SAMPLE_RATE * CHANNELS * sizeof(short);
+    double extraBytes = static_cast<double>(result.headerWrites) * WAV_HEADER_SIZE;
+    printf("%-16s %8llu %10llu %12.5f %12.1f\n", name, static_cast<unsigned long long>(result.syncs),
+           static_cast<unsigned long long>(result.headerWrites), (audioBytes + extraBytes) / audioBytes,
+           result.syncs * syncMs);
+}
+
+static double measureRecovery(size_t minutes) {
+    size_t bytes = minutes * 60 * SAMPLE_RATE * CHANNELS * sizeof(short);
+    uint8_t header[WAV_HEADER_SIZE];
+    buildWavHeader(SAMPLE_RATE, CHANNELS, SampleFormat::INT16, 0, header);
+    int fd = open(TEST_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = pwrite(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                   ftruncate(fd, static_cast<off_t>(WAV_HEADER_SIZE + bytes + 3)) == 0;
+    close(fd);
+    close(open(getOpenTakeMarkerPath(TEST_FILE).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644));
+    if (!written) return -1.0;
+
+    uint64_t frames;
+    Stopwatch stopwatch;
+    recoverWavTake(TEST_FILE, frames);
+    return stopwatch.elapsedSeconds() * 1000.0;
+}
+
+int main() {
+    printf("%d s of %d Hz stereo 16-bit in %zu-frame blocks\n", SECONDS, SAMPLE_RATE, BLOCK_FRAMES);
+    double syncMs;
+    Result perBlock = measurePerBlock(syncMs);
+    printf("Mean sync %.3f ms\n", syncMs);
+    printf("%-16s %8s %10s %12s %12s\n", "commits", "syncs", "headers", "bytes/audio", "sync ms");
+    printRow("off", measureWriter(0), syncMs);
+    printRow("every 2000 ms", measureWriter(2000), syncMs);
+    printRow("every 500 ms", measureWriter(500), syncMs);
+    printRow("every block", perBlock, syncMs);
+
+    printf("\nRecovery, header read and patch only\n");
+    for (size_t minutes : {1, 60}) {
+        printf("%3zu min take: %8.3f ms\n", minutes, measureRecovery(minutes));
+    }
+    remove(TEST_FILE);
+    return 0;
+}
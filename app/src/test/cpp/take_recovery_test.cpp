@@ -0,0 +1,222 @@
+#include "take_recovery.h"
+#include "test_util.h"
+#include "wav_file.h"
+#include "wav_probe.h"
+#include "wav_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const char* TEST_DIR = "take_recovery_test_dir";
+
+static bool fileExists(const std::string& path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const uint8_t* data, size_t size) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+// 16-bit ramp, continued from sample |first|
+static void fillRamp(std::vector<short>& samples, uint64_t first) {
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<short>((first + i) & 0xFFFF);
+}
+
+static bool holdsRamp(const std::vector<uint8_t>& file) {
+    size_t count = (file.size() - WAV_HEADER_SIZE) / sizeof(short);
+    std::vector<short> samples(count);
+    memcpy(samples.data(), file.data() + WAV_HEADER_SIZE, count * sizeof(short));
+    for (size_t i = 0; i < count; i++) {
+        if (samples[i] != static_cast<short>(i & 0xFFFF)) return false;
+    }
+    return true;
+}
+
+static bool waitFor(const std::function<bool()>& condition) {
+    for (int i = 0; i < 500 && !condition(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+static void testCommitsWhileOpen() {
+    std::string path = std::string(TEST_DIR) + "/committed.wav";
+    WavWriter writer(8000, 1, SampleFormat::INT16);
+    // 1600 bytes, so every 64 KiB write commits
+    CHECK(writer.setCommitInterval(100));
+    CHECK(writer.open(path));
+    CHECK(!writer.setCommitInterval(0));
+    CHECK(fileExists(getOpenTakeMarkerPath(path)));
+
+    std::vector<short> block(1000);
+    for (uint64_t done = 0; done < 100000; done += block.size()) {
+        fillRamp(block, done);
+        CHECK(writer.write(block.data(), block.size()));
+    }
+    CHECK(waitFor([&] { return writer.getCommitCount() >= 3; }));
+
+    // Already a valid WAV, up to the last commit, with the take still open
+    std::vector<uint8_t> file = readFile(path);
+    WavInfo info;
+    CHECK(parseWavHeader(file.data(), file.size(), file.size(), info));
+    CHECK_EQ(writer.getSamplesCommitted() * sizeof(short), info.dataSize);
+    CHECK(info.dataSize >= 3u * 64 * 1024 - WAV_HEADER_SIZE);
+    CHECK(holdsRamp(file));
+
+    CHECK(writer.close());
+    CHECK(!fileExists(getOpenTakeMarkerPath(path)));
+    CHECK(probeWavFile(path, info));
+    CHECK_EQ(100000u, info.frameCount);
+
+    // Commits off leave no marker
+    CHECK(writer.setCommitInterval(0));
+    CHECK(writer.open(path));
+    CHECK(!fileExists(getOpenTakeMarkerPath(path)));
+    CHECK(writer.write(block.data(), block.size()));
+    CHECK(waitFor([&] { return writer.getSamplesPending() == 0; }));
+    CHECK(writer.close());
+    CHECK_EQ(0u, writer.getCommitCount());
+    remove(path.c_str());
+}
+
+static void testRecoversFromAnyCut() {
+    // A finished stereo take to cut short
+    std::string path = std::string(TEST_DIR) + "/cut.wav";
+    WavWriter writer(48000, 2, SampleFormat::INT16);
+    CHECK(writer.open(path));
+    std::vector<short> ramp(2 * 30000);
+    fillRamp(ramp, 0);
+    CHECK(writer.write(ramp.data(), ramp.size()));
+    CHECK(waitFor([&] { return writer.getSamplesPending() == 0; }));
+    CHECK(writer.close());
+    std::vector<uint8_t> whole = readFile(path);
+
+    std::mt19937 random(6);
+    bool allMatch = true;
+    for (int round = 0; round < 200; round++) {
+        // Anywhere in the file, with the header from any earlier commit
+        size_t cut = std::uniform_int_distribution<size_t>(0, whole.size())(random);
+        std::vector<uint8_t> image(whole.begin(), whole.begin() + cut);
+        if (cut >= WAV_HEADER_SIZE) {
+            size_t committed = std::uniform_int_distribution<size_t>(0, cut - WAV_HEADER_SIZE)(random) & ~size_t(3);
+            buildWavHeader(48000, 2, SampleFormat::INT16, committed, image.data());
+        }
+        writeFile(path, image.data(), image.size());
+        writeFile(getOpenTakeMarkerPath(path), nullptr, 0);
+
+        std::vector<std::string> recovered;
+        recoverTakes(TEST_DIR, recovered);
+        size_t frames = cut >= WAV_HEADER_SIZE ? (cut - WAV_HEADER_SIZE) / 4 : 0;
+        allMatch = allMatch && !fileExists(getOpenTakeMarkerPath(path));
+        if (frames == 0) {
+            // Nothing recorded, so nothing kept
+            allMatch = allMatch && recovered.empty() && !fileExists(path);
+            continue;
+        }
+
+        WavInfo info;
+        std::vector<uint8_t> file = readFile(path);
+        allMatch = allMatch && recovered.size() == 1 && recovered[0] == path && probeWavFile(path, info) &&
+                   info.frameCount == frames && file.size() == WAV_HEADER_SIZE + frames * 4 &&
+                   std::equal(file.begin() + WAV_HEADER_SIZE, file.end(), whole.begin() + WAV_HEADER_SIZE);
+    }
+    CHECK(allMatch);
+
+    // A marker with no take goes; a file that is not our WAV stays
+    std::string orphan = std::string(TEST_DIR) + "/orphan.wav";
+    writeFile(getOpenTakeMarkerPath(orphan), nullptr, 0);
+    std::string foreign = std::string(TEST_DIR) + "/foreign.wav";
+    std::vector<uint8_t> junk(1000, 0x5A);
+    writeFile(foreign, junk.data(), junk.size());
+    writeFile(getOpenTakeMarkerPath(foreign), nullptr, 0);
+    std::vector<std::string> recovered;
+    recoverTakes(TEST_DIR, recovered);
+    CHECK(recovered.empty());
+    CHECK(!fileExists(getOpenTakeMarkerPath(orphan)));
+    CHECK(!fileExists(getOpenTakeMarkerPath(foreign)));
+    CHECK(readFile(foreign) == junk);
+
+    remove(path.c_str());
+    remove(foreign.c_str());
+}
+
+// Child: records a ramp through a committing writer, about four times
+// real time, until it is killed
+[[noreturn]] static void recordUntilKilled(const std::string& path) {
+    WavWriter writer(48000, 2, SampleFormat::INT16);
+    writer.setCommitInterval(50);
+    if (!writer.open(path)) _exit(1);
+    std::vector<short> block(2 * 1024);
+    for (uint64_t done = 0; done < 2 * 48000 * 60; done += block.size()) {
+        fillRamp(block, done);
+        writer.write(block.data(), block.size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    _exit(0);
+}
+
+static void testRecoversKilledWriter() {
+    std::string path = std::string(TEST_DIR) + "/killed.wav";
+    std::mt19937 random(7);
+    int recoveredTakes = 0;
+    bool allMatch = true;
+    for (int round = 0; round < 12; round++) {
+        pid_t child = fork();
+        if (child == 0) {
+            recordUntilKilled(path);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(5, 300)(random)));
+        kill(child, SIGKILL);
+        int status;
+        waitpid(child, &status, 0);
+        CHECK(WIFSIGNALED(status));
+
+        std::vector<std::string> recovered;
+        recoverTakes(TEST_DIR, recovered);
+        allMatch = allMatch && !fileExists(getOpenTakeMarkerPath(path));
+        if (recovered.empty()) {
+            // Killed before the first write reached the file, maybe even
+            // before the marker went down
+            remove(path.c_str());
+            continue;
+        }
+
+        // Every sample that reached the file, in order, in a valid WAV
+        recoveredTakes++;
+        WavInfo info;
+        std::vector<uint8_t> file = readFile(path);
+        allMatch = allMatch && probeWavFile(path, info) && info.channels == 2 &&
+                   info.dataSize == file.size() - WAV_HEADER_SIZE && info.frameCount > 0 && holdsRamp(file);
+        remove(path.c_str());
+    }
+    CHECK(allMatch);
+    CHECK(recoveredTakes > 0);
+}
+
+int main() {
+    mkdir(TEST_DIR, 0755);
+    RUN_TEST(testCommitsWhileOpen);
+    RUN_TEST(testRecoversFromAnyCut);
+    RUN_TEST(testRecoversKilledWriter);
+    rmdir(TEST_DIR);
+    return TEST_RESULT();
+}
@@ -0,0 +1,70 @@
+#ifndef AUDIORECORDINGAPP_TEST_UTIL_H
+#define AUDIORECORDINGAPP_TEST_UTIL_H
+
+#include <chrono>
+#include <cstdio>
+
+// Minimal assertion helpers for the host-side native tests. Each test
+// binary registers its cases with RUN_TEST and returns TEST_RESULT() from
+// main, so ctest sees a non-zero exit code when any check fails.
+
+inline int g_testFailures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,    \
+                    #condition);                                                \
+            ++g_testFailures;                                                   \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_EQ(expected, actual)                                              \
+    do {                                                                        \
+        auto checkExpected = (expected);                                        \
+        auto checkActual = (actual);                                            \
+        if (!(checkExpected == checkActual)) {                                  \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", \
+                    __FILE__, __LINE__, #expected, #actual,                     \
+                    static_cast<long long>(checkExpected),                      \
+                    static_cast<long long>(checkActual));                       \
+            ++g_testFailures;                                                   \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_NEAR(expected, actual, tolerance)                                 \
+    do {                                                                        \
+        double checkExpected = (expected);                                      \
+        double checkActual = (actual);                                          \
+        double checkDiff = checkExpected - checkActual;                         \
+        if (checkDiff < 0) checkDiff = -checkDiff;                              \
+        if (checkDiff > (tolerance)) {                                          \
+            fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s ~ %s (%g vs %g)\n",   \
+                    __FILE__, __LINE__, #expected, #actual, checkExpected,      \
+                    checkActual);                                               \
+            ++g_testFailures;                                                   \
+        }                                                                       \
+    } while (0)
+
+#define RUN_TEST(test)                                                          \
+    do {                                                                        \
+        int failuresBefore = g_testFailures;                                    \
+        test();                                                                 \
+        printf("[%s] %s\n", g_testFailures == failuresBefore ? " OK " : "FAIL", \
+               #test);                                                          \
+    } while (0)
+
+#define TEST_RESULT() (g_testFailures == 0 ? 0 : 1)
+
+// Wall-clock stopwatch for the benchmark binaries
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+public:
+    double elapsedSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#endif // AUDIORECORDINGAPP_TEST_UTIL_H
@@ -0,0 +1,129 @@
+#include "test_util.h"
+#include "time_stretch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// WSOLA time stretch: the cross-correlation kernel against the scalar
+// loop at the search sizes each common rate uses, then the CPU each second
+// of output costs at several speeds, mono and stereo, with the share of
+// that spent in the search.
+
+static const size_t BLOCK_FRAMES = 1024;
+
+// Keeps the timed correlations from being optimized away
+static volatile float g_sink;
+
+// A voice-like signal: harmonics of a fundamental that wanders between
+// 100 and 140 Hz, with a little noise
+static std::vector<float> makeVoice(int rate, size_t frames, int channels) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> noise(-0.02f, 0.02f);
+    std::vector<float> samples(frames * channels);
+    double phase = 0.0;
+    for (size_t i = 0; i < frames; i++) {
+        double fundamental = 120.0 + 20.0 * std::sin(2.0 * M_PI * 0.7 * i / rate);
+        phase += 2.0 * M_PI * fundamental / rate;
+        float value = static_cast<float>(0.4 * std::sin(phase) + 0.2 * std::sin(2 * phase) + 0.1 * std::sin(3 * phase));
+        for (int c = 0; c < channels; c++) samples[i * channels + c] = value + noise(random);
+    }
+    return samples;
+}
+
+static void benchmarkKernel() {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> signal(4096), pattern(1024);
+    for (float& s : signal) s = dist(random);
+    for (float& s : pattern) s = dist(random);
+
+    printf("%-28s %14s %14s %8s\n", "cross-correlation", "scalar", "simd", "speedup");
+    for (int rate : {16000, 44100, 48000}) {
+        TimeStretch stretch;
+        stretch.configure(rate, 1);
+        const size_t length = stretch.getSegmentFrames() / 2;
+        const size_t lags = 2 * stretch.getSearchFrames() + 1;
+        std::vector<float> out(lags);
+        const size_t calls = std::max<size_t>(1, (1ull << 29) / (length * lags));
+
+        Stopwatch scalarWatch;
+        for (size_t i = 0; i < calls; i++) {
+            crossCorrelateScalar(signal.data() + i % 64, pattern.data(), length, lags, out.data());
+            g_sink = g_sink + out[i % lags];
+        }
+        double scalarRate = calls * length * lags / scalarWatch.elapsedSeconds();
+        Stopwatch simdWatch;
+        for (size_t i = 0; i < calls; i++) {
+            crossCorrelate(signal.data() + i % 64, pattern.data(), length, lags, out.data());
+            g_sink = g_sink + out[i % lags];
+        }
+        double simdRate = calls * length * lags / simdWatch.elapsedSeconds();
+
+        char name[64];
+        snprintf(name, sizeof(name), "%d Hz, %zu x %zu lags", rate, length, lags);
+        printf("  %-26s %7.0f MMAC/s %7.0f MMAC/s %7.1fx\n", name, scalarRate / 1e6, simdRate / 1e6,
+               simdRate / scalarRate);
+    }
+}
+
+// CPU seconds per second of output for |speed|, streaming |BLOCK_FRAMES|
+// at a time as the player does
+static double measureCost(int rate, int channels, float speed) {
+    std::vector<float> in = makeVoice(rate, 30 * static_cast<size_t>(rate), channels);
+    std::vector<float> out(BLOCK_FRAMES * channels);
+    TimeStretch stretch;
+    stretch.configure(rate, channels);
+    stretch.setSpeed(speed);
+
+    const size_t frames = in.size() / channels;
+    size_t produced = 0;
+    Stopwatch stopwatch;
+    for (size_t done = 0; done < frames;) {
+        size_t used = 0;
+        produced += stretch.process(in.data() + done * channels, std::min(BLOCK_FRAMES, frames - done), used,
+                                    out.data(), BLOCK_FRAMES);
+        done += used;
+    }
+    double seconds = stopwatch.elapsedSeconds();
+    g_sink = g_sink + out[0];
+    return seconds / (produced / static_cast<double>(rate));
+}
+
+// The search alone, for the same hops: one correlation per output hop
+static double measureSearchCost(int rate, float speed) {
+    TimeStretch stretch;
+    stretch.configure(rate, 1);
+    const size_t length = stretch.getSegmentFrames() / 2;
+    const size_t lags = 2 * stretch.getSearchFrames() + 1;
+    std::vector<float> signal = makeVoice(rate, 4096, 1);
+    std::vector<float> out(lags);
+    const size_t hops = 10 * static_cast<size_t>(rate) / length;
+
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < hops; i++) {
+        crossCorrelate(signal.data() + i % 512, signal.data() + 2048, length, lags, out.data());
+        g_sink = g_sink + out[i % lags];
+    }
+    // None at all at speed 1, where the next segment is known
+    return speed == 1.0f ? 0.0 : stopwatch.elapsedSeconds() / 10.0;
+}
+
+int main() {
+    benchmarkKernel();
+
+    printf("\nCPU per second of output, %zu-frame blocks (ms; 10 ms is 1%% of a core)\n", BLOCK_FRAMES);
+    printf("  %-10s %6s %10s %10s %10s\n", "rate", "speed", "mono", "stereo", "search");
+    for (int rate : {44100, 48000}) {
+        for (float speed : {0.75f, 1.0f, 1.5f, 2.0f, 2.5f, 3.0f}) {
+            double mono = measureCost(rate, 1, speed);
+            double stereo = measureCost(rate, 2, speed);
+            double search = measureSearchCost(rate, speed);
+            printf("  %-10d %5.2fx %10.2f %10.2f %9.0f%%\n", rate, speed, mono * 1e3, stereo * 1e3,
+                   100.0 * search / stereo);
+        }
+    }
+    return 0;
+}
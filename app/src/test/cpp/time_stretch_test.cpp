@@ -0,0 +1,210 @@
+#include "test_util.h"
+#include "time_stretch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+static const int RATE = 48000;
+
+// Sum of harmonics of |fundamental| with the given amplitudes, mono
+static std::vector<float> makeTone(double fundamental, const std::vector<float>& amplitudes, size_t frames) {
+    std::vector<float> samples(frames, 0.0f);
+    for (size_t h = 0; h < amplitudes.size(); h++) {
+        for (size_t i = 0; i < frames; i++) {
+            samples[i] += amplitudes[h] * static_cast<float>(std::sin(2.0 * M_PI * fundamental * (h + 1) * i / RATE));
+        }
+    }
+    return samples;
+}
+
+// Amplitude of one frequency over exactly one second from |offset|, so
+// whole-hertz frequencies have whole cycles and no leakage
+static double measureAmplitude(const std::vector<float>& samples, size_t offset, double frequency) {
+    std::complex<double> sum = 0.0;
+    for (int i = 0; i < RATE; i++) {
+        sum += static_cast<double>(samples[offset + i]) * std::polar(1.0, -2.0 * M_PI * frequency * i / RATE);
+    }
+    return 2.0 * std::abs(sum) / RATE;
+}
+
+// Largest step between neighbouring samples: a seam shows up as a jump
+// well beyond what the signal's own slope allows
+static float maxStep(const std::vector<float>& samples, size_t from, size_t to) {
+    float step = 0.0f;
+    for (size_t i = from + 1; i < to; i++) {
+        step = std::max(step, std::fabs(samples[i] - samples[i - 1]));
+    }
+    return step;
+}
+
+// Everything out of |stretch| for |input|, fed in odd-sized pieces. Calls
+// |beforeBlock| with the input frame reached before each, and flushes the
+// tail with silence if |flush|.
+template <typename BeforeBlock>
+static std::vector<float> stretchAll(TimeStretch& stretch, const std::vector<float>& input, bool flush,
+                                     BeforeBlock beforeBlock) {
+    const size_t channels = static_cast<size_t>(stretch.getChannels());
+    std::vector<float> padded = input;
+    if (flush) padded.resize(input.size() + stretch.getFlushFrames() * channels, 0.0f);
+
+    std::vector<float> output;
+    std::vector<float> block(777 * channels);
+    size_t frames = padded.size() / channels;
+    size_t done = 0;
+    while (true) {
+        beforeBlock(done);
+        size_t used = 0;
+        size_t pieceFrames = std::min<size_t>(313, frames - done);
+        size_t produced = stretch.process(padded.data() + done * channels, pieceFrames, used, block.data(), 777);
+        output.insert(output.end(), block.begin(), block.begin() + produced * channels);
+        done += used;
+        if (produced == 0 && used == 0) break;
+    }
+    return output;
+}
+
+static std::vector<float> stretchAll(TimeStretch& stretch, const std::vector<float>& input, bool flush) {
+    return stretchAll(stretch, input, flush, [](size_t) {});
+}
+
+static void testConfigure() {
+    TimeStretch stretch;
+    CHECK(!stretch.isConfigured());
+    CHECK(stretch.configure(48000, 2));
+    CHECK_EQ(960u, stretch.getSegmentFrames());
+    CHECK_EQ(288u, stretch.getSearchFrames());
+    CHECK(stretch.configure(8000, 1));
+    CHECK(!stretch.configure(0, 1));
+    CHECK(!stretch.configure(48000, 3));
+    CHECK(!stretch.isConfigured());
+
+    stretch.setSpeed(10.0f);
+    CHECK_EQ(TimeStretch::MAX_SPEED, stretch.getSpeed());
+    stretch.setSpeed(0.1f);
+    CHECK_EQ(TimeStretch::MIN_SPEED, stretch.getSpeed());
+    stretch.setSpeed(NAN);
+    CHECK_EQ(TimeStretch::MIN_SPEED, stretch.getSpeed());
+}
+
+static void testCrossCorrelateMatchesScalar() {
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> signal(2000), pattern(480);
+    for (float& s : signal) s = dist(random);
+    for (float& s : pattern) s = dist(random);
+
+    // Lag counts on and off the SIMD width
+    for (size_t lags : {1u, 7u, 8u, 17u, 577u}) {
+        for (size_t length : {1u, 5u, 480u}) {
+            std::vector<float> fast(lags), reference(lags);
+            crossCorrelate(signal.data(), pattern.data(), length, lags, fast.data());
+            crossCorrelateScalar(signal.data(), pattern.data(), length, lags, reference.data());
+            float worst = 0.0f;
+            for (size_t k = 0; k < lags; k++) worst = std::max(worst, std::fabs(fast[k] - reference[k]));
+            CHECK(worst < 1e-3f);
+        }
+    }
+}
+
+static void testUnitSpeedPassesThrough() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> input(2 * RATE * 2);
+    for (float& s : input) s = dist(random);
+
+    TimeStretch stretch;
+    stretch.configure(RATE, 2);
+    std::vector<float> output = stretchAll(stretch, input, true);
+    CHECK(output.size() >= input.size());
+    float worst = 0.0f;
+    for (size_t i = 0; i < std::min(output.size(), input.size()); i++) {
+        worst = std::max(worst, std::fabs(output[i] - input[i]));
+    }
+    CHECK(worst < 1e-5f);
+}
+
+static void testLengthFollowsSpeed() {
+    std::vector<float> input = makeTone(150.0, {0.5f, 0.3f, 0.1f}, 10 * RATE);
+    for (float speed : {0.5f, 0.75f, 1.5f, 2.0f, 3.0f}) {
+        TimeStretch stretch;
+        stretch.configure(RATE, 1);
+        stretch.setSpeed(speed);
+        std::vector<float> output = stretchAll(stretch, input, true);
+        // The flush adds a little silence at the end
+        double expected = input.size() / speed;
+        double slack = stretch.getFlushFrames() / speed + stretch.getSegmentFrames();
+        CHECK(output.size() >= expected - stretch.getSegmentFrames());
+        CHECK(output.size() <= expected + slack);
+    }
+}
+
+static void testPitchAndHarmonicsAreKept() {
+    // A voice-like tone: harmonics of 120 Hz
+    const std::vector<float> harmonics = {0.4f, 0.25f, 0.15f, 0.1f};
+    std::vector<float> input = makeTone(120.0, harmonics, 12 * RATE);
+    for (float speed : {0.75f, 1.5f, 2.0f, 3.0f}) {
+        TimeStretch stretch;
+        stretch.configure(RATE, 1);
+        stretch.setSpeed(speed);
+        std::vector<float> output = stretchAll(stretch, input, false);
+        CHECK(output.size() > 3 * static_cast<size_t>(RATE));
+
+        // Every harmonic stays where it was at nearly its level, and
+        // nothing turns up where a resampled copy would put the
+        // fundamental, unless that is another harmonic
+        size_t offset = output.size() / 2 - RATE / 2;
+        for (size_t h = 0; h < harmonics.size(); h++) {
+            double level = measureAmplitude(output, offset, 120.0 * (h + 1));
+            CHECK_NEAR(harmonics[h], level, 0.1 * harmonics[h]);
+        }
+        if (std::fmod(speed, 1.0f) != 0.0f) {
+            CHECK(measureAmplitude(output, offset, 120.0 * speed) < 0.02);
+        }
+
+        // No seams between segments
+        float slope = maxStep(input, 0, input.size());
+        CHECK(maxStep(output, 0, output.size()) < 1.2f * slope);
+    }
+}
+
+static void testSpeedChangesWithoutSeams() {
+    std::vector<float> input = makeTone(200.0, {0.6f, 0.2f}, 8 * RATE);
+    TimeStretch stretch;
+    stretch.configure(RATE, 1);
+    const float speeds[] = {1.0f, 1.7f, 3.0f, 0.6f, 2.4f, 1.0f, 1.25f};
+    size_t changes = 0;
+    std::vector<float> output = stretchAll(stretch, input, false, [&](size_t frame) {
+        stretch.setSpeed(speeds[(frame / 10000) % 7]);
+        changes++;
+    });
+    CHECK(changes > 100);
+    CHECK(output.size() > 3 * static_cast<size_t>(RATE));
+    float slope = maxStep(input, 0, input.size());
+    CHECK(maxStep(output, 0, output.size()) < 1.2f * slope);
+}
+
+static void testResetStartsANewStream() {
+    std::vector<float> input = makeTone(300.0, {0.5f}, RATE);
+    TimeStretch stretch;
+    stretch.configure(RATE, 1);
+    stretch.setSpeed(2.0f);
+    std::vector<float> first = stretchAll(stretch, input, true);
+    stretch.reset();
+    std::vector<float> second = stretchAll(stretch, input, true);
+    CHECK(first == second);
+    CHECK_EQ(2.0f, stretch.getSpeed());
+}
+
+int main() {
+    RUN_TEST(testConfigure);
+    RUN_TEST(testCrossCorrelateMatchesScalar);
+    RUN_TEST(testUnitSpeedPassesThrough);
+    RUN_TEST(testLengthFollowsSpeed);
+    RUN_TEST(testPitchAndHarmonicsAreKept);
+    RUN_TEST(testSpeedChangesWithoutSeams);
+    RUN_TEST(testResetStartsANewStream);
+    return TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "peak_kernels.h"
+#include "test_util.h"
+#include "voice_activity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Voice activity gating: the zero-crossing kernel against the scalar loop,
+// the detector's cost per capture block against the block's real-time
+// budget, and how much of each synthetic corpus a gated take keeps.
+
+static const char* BENCH_FILE = "voice_activity_benchmark.wav";
+static const int SAMPLE_RATE = 48000;
+static const size_t BLOCK_FRAMES = 1024;
+
+// Keeps the timed kernels from being optimized away
+static volatile size_t g_sink;
+
+// Speech-like bursts: voiced syllables with a few fricatives, 1-4 s
+// phrases separated by 2-8 s pauses over a quiet room
+static std::vector<short> makeSpeechCorpus(size_t frames) {
+    std::mt19937 random(11);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<short> samples(frames);
+    size_t i = 0;
+    while (i < frames) {
+        size_t pause = static_cast<size_t>((2.0 + 6.0 * uniform(random)) * SAMPLE_RATE);
+        for (size_t end = std::min(frames, i + pause); i < end; i++) {
+            samples[i] = static_cast<short>(15.0 * noise(random));
+        }
+        size_t phrase = static_cast<size_t>((1.0 + 3.0 * uniform(random)) * SAMPLE_RATE);
+        double pitch = 100.0 + 120.0 * uniform(random);
+        for (size_t start = i, end = std::min(frames, i + phrase); i < end; i++) {
+            double t = static_cast<double>(i - start) / SAMPLE_RATE;
+            double syllable = std::max(0.0, std::sin(M_PI * 4.0 * t));
+            bool fricative = std::fmod(t, 0.6) > 0.5;
+            double voiced = std::sin(2.0 * M_PI * pitch * t) + 0.5 * std::sin(2.0 * M_PI * 3.0 * pitch * t);
+            double value = fricative ? 1500.0 * noise(random) : 6000.0 * syllable * voiced;
+            samples[i] = static_cast<short>(std::max(-32768.0, std::min(32767.0, value + 15.0 * noise(random))));
+        }
+    }
+    return samples;
+}
+
+// Chords that never stop, with slow swells
+static std::vector<short> makeMusicCorpus(size_t frames) {
+    std::vector<short> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / SAMPLE_RATE;
+        double swell = 0.6 + 0.4 * std::sin(2.0 * M_PI * 0.1 * t);
+        double chord = std::sin(2.0 * M_PI * 220.0 * t) + std::sin(2.0 * M_PI * 277.2 * t) +
+                       std::sin(2.0 * M_PI * 329.6 * t);
+        samples[i] = static_cast<short>(3000.0 * swell * chord);
+    }
+    return samples;
+}
+
+// Steady room noise at about -50 dBFS
+static std::vector<short> makeRoomCorpus(size_t frames) {
+    std::mt19937 random(13);
+    std::normal_distribution<double> noise(0.0, 100.0);
+    std::vector<short> samples(frames);
+    for (short& sample : samples) sample = static_cast<short>(noise(random));
+    return samples;
+}
+
+// Noise that climbs from -70 to -40 dBFS over the corpus, like a fan
+// spinning up
+static std::vector<short> makeRisingNoiseCorpus(size_t frames) {
+    std::mt19937 random(17);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::vector<short> samples(frames);
+    for (size_t i = 0; i < frames; i++) {
+        double db = -70.0 + 30.0 * i / frames;
+        samples[i] = static_cast<short>(32768.0 * std::pow(10.0, db / 20.0) * noise(random));
+    }
+    return samples;
+}
+
+static void benchmarkCrossings() {
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> dist(-1000, 1000);
+    std::vector<short> samples(BLOCK_FRAMES * 2);
+    for (short& sample : samples) sample = static_cast<short>(dist(random));
+
+    printf("%-24s %14s %14s %8s\n", "kernel", "scalar", "simd", "speedup");
+    const size_t calls = 200000;
+    for (size_t stride = 1; stride <= 2; stride++) {
+        size_t sink = 0;
+        Stopwatch scalarWatch;
+        for (size_t i = 0; i < calls; i++) sink += countZeroCrossingsScalar(samples.data(), samples.size(), stride);
+        double scalarRate = calls * samples.size() / scalarWatch.elapsedSeconds();
+        Stopwatch simdWatch;
+        for (size_t i = 0; i < calls; i++) sink += countZeroCrossings(samples.data(), samples.size(), stride);
+        double simdRate = calls * samples.size() / simdWatch.elapsedSeconds();
+        g_sink = sink;
+
+        printf("  %-22s %7.0f Msmp/s %7.0f Msmp/s %7.1fx\n", stride == 1 ? "crossings mono" : "crossings stereo",
+               scalarRate / 1e6, simdRate / 1e6, simdRate / scalarRate);
+    }
+}
+
+static void benchmarkBlockCost(const std::vector<short>& corpus) {
+    printf("\nDetector cost per %zu-frame block at %d Hz (budget %.1f ms)\n", BLOCK_FRAMES, SAMPLE_RATE,
+           1000.0 * BLOCK_FRAMES / SAMPLE_RATE);
+    printf("  %-10s %10s %10s %10s\n", "channels", "p50", "p99", "of budget");
+    for (int channels = 1; channels <= 2; channels++) {
+        VoiceActivityConfig config;
+        config.enabled = true;
+        VoiceActivityDetector detector(SAMPLE_RATE, channels);
+        detector.configure(config);
+
+        // Stereo duplicates each sample so both layouts see the same signal
+        const size_t blockSamples = BLOCK_FRAMES * channels;
+        std::vector<short> block(blockSamples);
+        std::vector<double> costs;
+        for (size_t offset = 0; offset + BLOCK_FRAMES <= corpus.size(); offset += BLOCK_FRAMES) {
+            for (size_t i = 0; i < blockSamples; i++) block[i] = corpus[offset + i / channels];
+            Stopwatch stopwatch;
+            g_sink = detector.process(block.data(), blockSamples);
+            costs.push_back(stopwatch.elapsedSeconds() * 1e6);
+        }
+        std::sort(costs.begin(), costs.end());
+        double p50 = costs[costs.size() / 2];
+        double p99 = costs[costs.size() * 99 / 100];
+        double budget = 1e6 * BLOCK_FRAMES / SAMPLE_RATE;
+        printf("  %-10s %8.2f us %8.2f us %9.3f%%\n", channels == 1 ? "mono" : "stereo", p50, p99,
+               100.0 * p99 / budget);
+    }
+}
+
+static void benchmarkStorage(const char* name, const std::vector<short>& corpus) {
+    FakeAudioBackend backend;
+    backend.setCaptureSource([&corpus](uint64_t index) { return corpus[index % corpus.size()]; });
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+    recorder.configureFormat(SAMPLE_RATE, 1, SampleFormat::INT16);
+    VoiceActivityConfig config;
+    config.enabled = true;
+    recorder.configureVoiceActivity(config);
+
+    recorder.startRecording(BENCH_FILE);
+    // Paced so the writer thread keeps up
+    backend.runCaptureAtSpeed(corpus.size(), 200.0);
+    recorder.stopRecording();
+
+    uint64_t kept = 0;
+    for (const VoiceSegment& segment : recorder.getVoiceSegments()) kept += segment.frameCount;
+    printf("  %-14s %8.1f s %8.1f s %9.1f%% %9zu\n", name, corpus.size() / static_cast<double>(SAMPLE_RATE),
+           kept / static_cast<double>(SAMPLE_RATE), 100.0 * (1.0 - static_cast<double>(kept) / corpus.size()),
+           recorder.getVoiceSegments().size());
+    remove(BENCH_FILE);
+    remove(getVoiceSegmentsPath(BENCH_FILE).c_str());
+    remove("voice_activity_benchmark.peaks");
+}
+
+int main() {
+    const size_t frames = 120 * static_cast<size_t>(SAMPLE_RATE);
+    std::vector<short> speech = makeSpeechCorpus(frames);
+
+    benchmarkCrossings();
+    benchmarkBlockCost(speech);
+
+    printf("\nStorage, two minutes of each corpus, default settings\n");
+    printf("  %-14s %10s %10s %10s %9s\n", "corpus", "captured", "kept", "saved", "segments");
+    benchmarkStorage("speech", speech);
+    benchmarkStorage("music", makeMusicCorpus(frames));
+    benchmarkStorage("room noise", makeRoomCorpus(frames));
+    benchmarkStorage("rising noise", makeRisingNoiseCorpus(frames));
+    return 0;
+}
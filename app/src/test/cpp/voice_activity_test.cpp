@@ -0,0 +1,182 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "peak_kernels.h"
+#include "test_util.h"
+#include "voice_activity.h"
+#include "wav_file.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const char* TEST_FILE = "voice_activity_test.wav";
+static const char* CUES_FILE = "voice_activity_test.cues";
+
+// Room noise around -70 dBFS, deterministic per sample
+static short noiseAt(uint64_t index) {
+    uint64_t x = (index + 1) * 0x9E3779B97F4A7C15ull;
+    x ^= x >> 29;
+    return static_cast<short>(static_cast<int>(x % 41) - 20);
+}
+
+static short toneAt(uint64_t index) {
+    return static_cast<short>(4000.0 * std::sin(index * 0.05));
+}
+
+// Noise with loud tone bursts over [2 s, 3 s) and [6 s, 7 s) at 44.1 kHz
+static short burstsAt(uint64_t index) {
+    bool burst = (index >= 88200 && index < 132300) || (index >= 264600 && index < 308700);
+    return burst ? static_cast<short>(8000.0 * std::sin(index * 0.07)) : noiseAt(index);
+}
+
+static void testCountZeroCrossings() {
+    std::mt19937 random(3);
+    std::uniform_int_distribution<int> dist(-200, 200);
+
+    // Odd lengths and offsets exercise the vector tails
+    const size_t counts[] = {0, 1, 2, 7, 16, 17, 63, 1000, 70001};
+    for (size_t count : counts) {
+        std::vector<short> samples(count + 3);
+        for (short& sample : samples) sample = static_cast<short>(dist(random));
+        for (size_t stride = 1; stride <= 2; stride++) {
+            CHECK_EQ(countZeroCrossingsScalar(samples.data() + 1, count, stride),
+                     countZeroCrossings(samples.data() + 1, count, stride));
+        }
+    }
+
+    // Alternating signs cross on every pair; stereo pairs are per channel
+    std::vector<short> alternating(100000);
+    for (size_t i = 0; i < alternating.size(); i++) alternating[i] = (i & 1) ? -5 : 5;
+    CHECK_EQ(alternating.size() - 1, countZeroCrossings(alternating.data(), alternating.size(), 1));
+    CHECK_EQ(0u, countZeroCrossings(alternating.data(), alternating.size(), 2));
+}
+
+static void testDetectsSpeechAndHangover() {
+    VoiceActivityConfig config;
+    config.enabled = true;
+    config.hangoverMs = 300;
+    VoiceActivityDetector detector(44100, 1);
+    detector.configure(config);
+
+    std::vector<short> block(441);
+    uint64_t index = 0;
+    auto next = [&](short (*source)(uint64_t)) {
+        for (short& sample : block) sample = source(index++);
+        return detector.process(block.data(), block.size());
+    };
+
+    // The first frames of quiet noise sit under the hangover of nothing
+    bool keptNoise = false;
+    for (int i = 0; i < 100; i++) keptNoise = next(noiseAt) || keptNoise;
+    CHECK(!keptNoise);
+
+    CHECK(next(toneAt));
+    CHECK(next(toneAt));
+
+    // Kept for the 30 frames of hangover, then dropped
+    int kept = 0;
+    for (int i = 0; i < 60; i++) kept += next(noiseAt) ? 1 : 0;
+    CHECK(kept >= 30 && kept <= 31);
+}
+
+static void testNoiseFloorFollowsSteadyNoise() {
+    VoiceActivityConfig config;
+    config.enabled = true;
+    VoiceActivityDetector detector(16000, 1);
+    detector.configure(config);
+
+    // Steady -40 dBFS hiss reads as speech until the floor climbs to it
+    std::mt19937 random(5);
+    std::normal_distribution<double> hiss(0.0, 328.0);
+    std::vector<short> block(160);
+    int lastKept = -1;
+    for (int frame = 0; frame < 2000; frame++) {
+        for (short& sample : block) sample = static_cast<short>(hiss(random));
+        if (detector.process(block.data(), block.size())) lastKept = frame;
+    }
+    CHECK(lastKept > 0);
+    CHECK(lastKept < 1200);
+    CHECK_NEAR(-40.0, 10.0 * std::log10(detector.getNoiseFloor()), 3.0);
+}
+
+static void testSegmentsRoundTrip() {
+    std::vector<VoiceSegment> segments = {{0, 0, 4410}, {88200, 4410, 1 << 20}};
+    CHECK(saveVoiceSegments(CUES_FILE, 44100, segments));
+
+    std::vector<VoiceSegment> loaded;
+    CHECK(loadVoiceSegments(CUES_FILE, loaded));
+    CHECK_EQ(2u, loaded.size());
+    CHECK_EQ(88200u, loaded[1].captureFrame);
+    CHECK_EQ(4410u, loaded[1].fileFrame);
+    CHECK_EQ(1u << 20, loaded[1].frameCount);
+    CHECK(!loadVoiceSegments("voice_activity_missing.cues", loaded));
+    CHECK(getVoiceSegmentsPath("take.wav") == "take.cues");
+    remove(CUES_FILE);
+}
+
+static void testRecorderDropsSilence() {
+    FakeAudioBackend backend;
+    backend.setCaptureSource(burstsAt);
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+
+    VoiceActivityConfig config;
+    config.enabled = true;
+    CHECK(!recorder.configureVoiceActivity({true, 0.0f, 400, 200}));
+    CHECK(!recorder.configureVoiceActivity({true, 12.0f, 400, 60000}));
+    CHECK(recorder.configureVoiceActivity(config));
+
+    CHECK(recorder.startRecording(TEST_FILE));
+    CHECK(!recorder.configureVoiceActivity(config));
+    backend.advanceCapture(9 * 44100);
+    CHECK(recorder.stopRecording());
+
+    const std::vector<VoiceSegment>& segments = recorder.getVoiceSegments();
+    CHECK_EQ(2u, segments.size());
+
+    // Each segment opens on the block the burst starts in, less the
+    // pre-roll, and runs through the hangover to a block boundary
+    const uint64_t preRoll = 200 * 44100 / 1000;
+    const uint64_t hangover = 400 * 44100 / 1000;
+    CHECK_EQ(88064 - preRoll, segments[0].captureFrame);
+    CHECK_EQ(0u, segments[0].fileFrame);
+    CHECK_EQ(segments[0].frameCount, segments[1].fileFrame);
+    for (const VoiceSegment& segment : segments) {
+        uint64_t end = segment.captureFrame + segment.frameCount;
+        uint64_t burstEnd = segment.captureFrame < 200000 ? 132300 : 308700;
+        CHECK(end >= burstEnd + hangover);
+        CHECK(end <= burstEnd + hangover + 2048);
+    }
+
+    // The file holds exactly the kept stretches, sample for sample
+    MappedWavFile file;
+    CHECK(file.open(TEST_FILE));
+    CHECK_EQ(segments[1].fileFrame + segments[1].frameCount, file.getSampleCount());
+    CHECK(file.getSampleCount() < 4 * 44100);
+    bool matches = true;
+    for (const VoiceSegment& segment : segments) {
+        for (uint64_t i = 0; i < segment.frameCount; i++) {
+            matches = matches && file.getSamples()[segment.fileFrame + i] == burstsAt(segment.captureFrame + i);
+        }
+    }
+    CHECK(matches);
+    file.close();
+
+    std::vector<VoiceSegment> loaded;
+    CHECK(loadVoiceSegments(CUES_FILE, loaded));
+    CHECK_EQ(segments.size(), loaded.size());
+    CHECK_EQ(segments[1].captureFrame, loaded[1].captureFrame);
+    remove(TEST_FILE);
+    remove(CUES_FILE);
+    remove("voice_activity_test.peaks");
+}
+
+int main() {
+    RUN_TEST(testCountZeroCrossings);
+    RUN_TEST(testDetectsSpeechAndHangover);
+    RUN_TEST(testNoiseFloorFollowsSteadyNoise);
+    RUN_TEST(testSegmentsRoundTrip);
+    RUN_TEST(testRecorderDropsSilence);
+    return TEST_RESULT();
+}
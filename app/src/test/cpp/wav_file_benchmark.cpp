@@ -0,0 +1,96 @@
+#include "wav_file.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Load time of the memory-mapped WAV loader against the previous
+// push_back-per-sample loop, for a range of file sizes.
+
+static void writeTestFile(const std::string& path, size_t samples) {
+    std::ofstream out(path, std::ios::binary);
+    uint32_t dataBytes = samples * sizeof(short);
+    uint32_t riffSize = 36 + dataBytes;
+    uint32_t fmtSize = 16;
+    uint16_t format = 1;
+    uint16_t channels = 1;
+    uint32_t rate = 44100;
+    uint32_t byteRate = rate * 2;
+    uint16_t blockAlign = 2;
+    uint16_t bits = 16;
+
+    out.write("RIFF", 4);
+    out.write(reinterpret_cast<const char*>(&riffSize), 4);
+    out.write("WAVEfmt ", 8);
+    out.write(reinterpret_cast<const char*>(&fmtSize), 4);
+    out.write(reinterpret_cast<const char*>(&format), 2);
+    out.write(reinterpret_cast<const char*>(&channels), 2);
+    out.write(reinterpret_cast<const char*>(&rate), 4);
+    out.write(reinterpret_cast<const char*>(&byteRate), 4);
+    out.write(reinterpret_cast<const char*>(&blockAlign), 2);
+    out.write(reinterpret_cast<const char*>(&bits), 2);
+    out.write("data", 4);
+    out.write(reinterpret_cast<const char*>(&dataBytes), 4);
+
+    std::vector<short> block(1 << 16);
+    for (size_t i = 0; i < block.size(); i++) block[i] = static_cast<short>(i);
+    for (size_t written = 0; written < samples; written += block.size()) {
+        size_t count = std::min(block.size(), samples - written);
+        out.write(reinterpret_cast<const char*>(block.data()), count * sizeof(short));
+    }
+}
+
+static size_t legacyLoad(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(44);
+    std::vector<short> audioData;
+    short sample;
+    while (file.read(reinterpret_cast<char*>(&sample), sizeof(short))) {
+        audioData.push_back(sample);
+    }
+    return audioData.size();
+}
+
+static size_t mappedLoad(const std::string& path) {
+    MappedWavFile file;
+    file.open(path);
+    return file.getSampleCount();
+}
+
+int main(int argc, char** argv) {
+    // Largest file in minutes of 44.1 kHz mono, override on the command line
+    int maxMinutes = argc > 1 ? atoi(argv[1]) : 60;
+    std::string path = "wav_file_benchmark.wav";
+
+    printf("%-10s %14s %14s %14s\n", "minutes", "legacy ms", "mmap ms", "speedup");
+    for (int minutes = 1; minutes <= maxMinutes; minutes *= 4) {
+        size_t samples = static_cast<size_t>(minutes) * 60 * 44100;
+        writeTestFile(path, samples);
+
+        Stopwatch legacyTimer;
+        size_t legacySamples = legacyLoad(path);
+        double legacyMs = legacyTimer.elapsedSeconds() * 1000;
+
+        const int mappedRuns = 100;
+        Stopwatch mappedTimer;
+        size_t mappedSamples = 0;
+        for (int i = 0; i < mappedRuns; i++) {
+            mappedSamples = mappedLoad(path);
+        }
+        double mappedMs = mappedTimer.elapsedSeconds() * 1000 / mappedRuns;
+
+        if (legacySamples != samples || mappedSamples != samples) {
+            fprintf(stderr, "sample count mismatch: %zu / %zu / %zu\n", samples, legacySamples,
+                    mappedSamples);
+            return 1;
+        }
+        printf("%-10d %14.2f %14.4f %13.0fx\n", minutes, legacyMs, mappedMs, legacyMs / mappedMs);
+    }
+
+    remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "wav_file.h"
+#include "test_util.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Builds WAV images chunk by chunk so each test can lay out the file the
+// way a particular encoder would.
+class WavBuilder {
+private:
+    std::vector<uint8_t> bytes;
+
+    void put16(uint16_t value) {
+        bytes.push_back(value & 0xFF);
+        bytes.push_back(value >> 8);
+    }
+
+    void put32(uint32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back((value >> (8 * i)) & 0xFF);
+    }
+
+public:
+    WavBuilder() : bytes({'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'}) {
+    }
+
+    WavBuilder& chunk(const char* id, const std::vector<uint8_t>& body) {
+        bytes.insert(bytes.end(), id, id + 4);
+        put32(body.size());
+        bytes.insert(bytes.end(), body.begin(), body.end());
+        if (body.size() & 1) bytes.push_back(0);
+        return *this;
+    }
+
+    WavBuilder& fmt(uint16_t format, uint16_t channels, uint32_t rate, uint16_t bits) {
+        bytes.insert(bytes.end(), {'f', 'm', 't', ' '});
+        put32(16);
+        put16(format);
+        put16(channels);
+        put32(rate);
+        put32(rate * channels * bits / 8);
+        put16(channels * bits / 8);
+        put16(bits);
+        return *this;
+    }
+
+    WavBuilder& data(const std::vector<short>& samples, uint32_t declaredBytes) {
+        bytes.insert(bytes.end(), {'d', 'a', 't', 'a'});
+        put32(declaredBytes);
+        const uint8_t* raw = reinterpret_cast<const uint8_t*>(samples.data());
+        bytes.insert(bytes.end(), raw, raw + samples.size() * sizeof(short));
+        return *this;
+    }
+
+    WavBuilder& data(const std::vector<short>& samples) {
+        return data(samples, samples.size() * sizeof(short));
+    }
+
+    std::vector<uint8_t> build() {
+        uint32_t riffSize = bytes.size() - 8;
+        memcpy(&bytes[4], &riffSize, 4);
+        return bytes;
+    }
+};
+
+static bool parse(const std::vector<uint8_t>& bytes, WavInfo& info) {
+    return parseWavHeader(bytes.data(), bytes.size(), bytes.size(), info);
+}
+
+static void testCanonicalHeader() {
+    std::vector<short> samples = {1, 2, 3, 4, 5, 6};
+    WavInfo info;
+    CHECK(parse(WavBuilder().fmt(WAV_FORMAT_PCM, 1, 44100, 16).data(samples).build(), info));
+    CHECK_EQ(WAV_FORMAT_PCM, info.audioFormat);
+    CHECK_EQ(1, info.channels);
+    CHECK_EQ(44100u, info.sampleRate);
+    CHECK_EQ(16, info.bitsPerSample);
+    CHECK_EQ(44u, info.dataOffset);
+    CHECK_EQ(12u, info.dataSize);
+    CHECK_EQ(6u, info.frameCount);
+}
+
+static void testSkipsListAndFactChunks() {
+    std::vector<short> samples = {100, -100};
+    std::vector<uint8_t> listBody = {'I', 'N', 'F', 'O', 'I', 'S', 'F', 'T', 3, 0, 0, 0, 'a', 'b', 0};
+    WavInfo info;
+    CHECK(parse(WavBuilder()
+                        .chunk("LIST", listBody)
+                        .fmt(WAV_FORMAT_PCM, 2, 48000, 16)
+                        .chunk("fact", {0, 1, 0, 0})
+                        .data(samples)
+                        .build(),
+                info));
+    // 12 RIFF + 24 LIST (odd body padded) + 24 fmt + 12 fact + 8 data header
+    CHECK_EQ(80u, info.dataOffset);
+    CHECK_EQ(2, info.channels);
+    CHECK_EQ(48000u, info.sampleRate);
+    CHECK_EQ(1u, info.frameCount);
+}
+
+static void testTruncatedDataIsClampedToFile() {
+    std::vector<short> samples(100, 7);
+    WavInfo info;
+    CHECK(parse(WavBuilder().fmt(WAV_FORMAT_PCM, 1, 44100, 16).data(samples, 100000).build(), info));
+    CHECK_EQ(200u, info.dataSize);
+    CHECK_EQ(100u, info.frameCount);
+}
+
+static void testPartialFrameIsDropped() {
+    std::vector<short> samples = {1, 2, 3};
+    WavInfo info;
+    CHECK(parse(WavBuilder().fmt(WAV_FORMAT_PCM, 2, 44100, 16).data(samples).build(), info));
+    CHECK_EQ(4u, info.dataSize);
+    CHECK_EQ(1u, info.frameCount);
+}
+
+static void testRejectsMalformedFiles() {
+    std::vector<short> samples = {1, 2};
+    WavInfo info;
+
+    std::vector<uint8_t> notRiff = WavBuilder().fmt(WAV_FORMAT_PCM, 1, 44100, 16).data(samples).build();
+    memcpy(&notRiff[0], "RIFX", 4);
+    CHECK(!parse(notRiff, info));
+
+    CHECK(!parse(WavBuilder().data(samples).build(), info));
+    CHECK(!parse(WavBuilder().fmt(WAV_FORMAT_PCM, 1, 44100, 16).build(), info));
+
+    std::vector<uint8_t> tiny = {'R', 'I', 'F', 'F'};
+    CHECK(!parse(tiny, info));
+}
+
+static void testMappedFileReadsSamplesInPlace() {
+    std::vector<short> samples(10000);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<short>(i * 3);
+    std::vector<uint8_t> bytes = WavBuilder()
+            .chunk("LIST", {'I', 'N', 'F', 'O'})
+            .fmt(WAV_FORMAT_PCM, 1, 44100, 16)
+            .data(samples)
+            .build();
+
+    std::string path = "wav_file_test_mapped.wav";
+    FILE* out = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), out);
+    fclose(out);
+
+    MappedWavFile file;
+    CHECK(file.open(path));
+    CHECK_EQ(samples.size(), file.getSampleCount());
+    CHECK(memcmp(samples.data(), file.getSamples(), samples.size() * sizeof(short)) == 0);
+
+    file.close();
+    CHECK(!file.isOpen());
+    CHECK(!file.open("does_not_exist.wav"));
+    remove(path.c_str());
+}
+
+int main() {
+    RUN_TEST(testCanonicalHeader);
+    RUN_TEST(testSkipsListAndFactChunks);
+    RUN_TEST(testTruncatedDataIsClampedToFile);
+    RUN_TEST(testPartialFrameIsDropped);
+    RUN_TEST(testRejectsMalformedFiles);
+    RUN_TEST(testMappedFileReadsSamplesInPlace);
+    return TEST_RESULT();
+}
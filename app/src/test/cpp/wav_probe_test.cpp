@@ -0,0 +1,110 @@
+#include "wav_probe.h"
+#include "test_util.h"
+#include "wav_writer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static void writeRecording(const std::string& path, int sampleRate, int channels, size_t samples) {
+    std::vector<short> data(samples, 100);
+    WavWriter writer(sampleRate, channels, SampleFormat::INT16);
+    writer.open(path);
+    writer.write(data.data(), data.size());
+    writer.close();
+}
+
+static void writeBytes(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static void put32(std::vector<uint8_t>& bytes, uint32_t value) {
+    for (int i = 0; i < 4; i++) bytes.push_back((value >> (8 * i)) & 0xFF);
+}
+
+static void testProbesOwnRecording() {
+    const std::string path = "wav_probe_test.wav";
+    writeRecording(path, 48000, 2, 96000);
+
+    WavInfo info;
+    CHECK(probeWavFile(path, info));
+    CHECK_EQ(48000u, info.sampleRate);
+    CHECK_EQ(2, info.channels);
+    CHECK_EQ(16, info.bitsPerSample);
+    CHECK_EQ(48000u, info.frameCount);
+    CHECK_EQ(1000, getWavDurationMs(info));
+    remove(path.c_str());
+}
+
+static void testHeaderBehindLargeMetadata() {
+    // A 200 KiB LIST chunk ahead of "fmt " pushes the header well past the
+    // first read window
+    std::vector<uint8_t> bytes = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E'};
+    bytes.insert(bytes.end(), {'L', 'I', 'S', 'T'});
+    put32(bytes, 200 * 1024);
+    bytes.resize(bytes.size() + 200 * 1024, 0);
+    bytes.insert(bytes.end(), {'f', 'm', 't', ' '});
+    put32(bytes, 16);
+    bytes.insert(bytes.end(), {1, 0, 1, 0});
+    put32(bytes, 22050);
+    put32(bytes, 44100);
+    bytes.insert(bytes.end(), {2, 0, 16, 0});
+    bytes.insert(bytes.end(), {'d', 'a', 't', 'a'});
+    put32(bytes, 44100);
+    bytes.resize(bytes.size() + 44100, 0);
+
+    const std::string path = "wav_probe_test_list.wav";
+    writeBytes(path, bytes);
+
+    WavInfo info;
+    CHECK(probeWavFile(path, info));
+    CHECK_EQ(22050u, info.sampleRate);
+    CHECK_EQ(22050u, info.frameCount);
+    CHECK_EQ(1000, getWavDurationMs(info));
+    remove(path.c_str());
+}
+
+static void testRejectsMissingAndForeignFiles() {
+    WavInfo info;
+    CHECK(!probeWavFile("does_not_exist.wav", info));
+
+    const std::string path = "wav_probe_test_foreign.wav";
+    writeBytes(path, std::vector<uint8_t>(8192, 'x'));
+    CHECK(!probeWavFile(path, info));
+
+    writeBytes(path, {});
+    CHECK(!probeWavFile(path, info));
+    remove(path.c_str());
+}
+
+static void testBatchKeepsOrder() {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 40; i++) {
+        paths.push_back("wav_probe_test_batch_" + std::to_string(i) + ".wav");
+        if (i % 7 != 3) writeRecording(paths.back(), 8000, 1, 800 * (i + 1));
+    }
+
+    for (int threads : {1, 4, 64}) {
+        std::vector<WavProbeResult> results = probeWavFiles(paths, threads);
+        CHECK_EQ(paths.size(), results.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            CHECK_EQ(i % 7 != 3, results[i].valid);
+            if (results[i].valid) {
+                CHECK_EQ(100 * static_cast<int64_t>(i + 1), getWavDurationMs(results[i].info));
+            }
+        }
+    }
+
+    CHECK(probeWavFiles({}).empty());
+    for (const std::string& path : paths) remove(path.c_str());
+}
+
+int main() {
+    RUN_TEST(testProbesOwnRecording);
+    RUN_TEST(testHeaderBehindLargeMetadata);
+    RUN_TEST(testRejectsMissingAndForeignFiles);
+    RUN_TEST(testBatchKeepsOrder);
+    return TEST_RESULT();
+}
@@ -0,0 +1,142 @@
+#include "audio_recorder.h"
+#include "fake_audio_backend.h"
+#include "peak_kernels.h"
+#include "test_util.h"
+#include "waveform_index.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static void testSimdMatchesScalar() {
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> sampleDist(SHRT_MIN, SHRT_MAX);
+
+    // Odd lengths and offsets exercise the scalar tail and unaligned loads
+    for (size_t count : {0, 1, 15, 16, 17, 255, 4096, 100003}) {
+        std::vector<short> samples(count + 1);
+        for (short& sample : samples) sample = static_cast<short>(sampleDist(random));
+        if (count > 10) {
+            samples[5] = SHRT_MIN;
+            samples[9] = SHRT_MIN;
+        }
+
+        PeakStats simd, scalar;
+        reducePeaks(samples.data() + 1, count, simd);
+        reducePeaksScalar(samples.data() + 1, count, scalar);
+        CHECK_EQ(scalar.min, simd.min);
+        CHECK_EQ(scalar.max, simd.max);
+        CHECK_EQ(scalar.sumSquares, simd.sumSquares);
+        CHECK_EQ(count, simd.sampleCount);
+    }
+
+    // Worst case for the squared sums: every sample at negative full scale
+    std::vector<short> fullScale(1 << 16, SHRT_MIN);
+    PeakStats stats;
+    reducePeaks(fullScale.data(), fullScale.size(), stats);
+    CHECK_EQ(static_cast<int64_t>(fullScale.size()) << 30, stats.sumSquares);
+}
+
+static void testLevelsAreConsistent() {
+    WaveformIndex index(44100, 1);
+
+    // One second of a sine whose amplitude ramps up, fed in uneven blocks
+    std::vector<short> samples(44100);
+    for (size_t i = 0; i < samples.size(); i++) {
+        double amplitude = 30000.0 * i / samples.size();
+        samples[i] = static_cast<short>(amplitude * std::sin(i * 0.05));
+    }
+    for (size_t offset = 0; offset < samples.size(); offset += 1000) {
+        index.addSamples(samples.data() + offset, std::min<size_t>(1000, samples.size() - offset));
+    }
+    index.finish();
+
+    // 44100 frames: 172.3 bins at level 0, 43.07 at level 1, ...
+    CHECK_EQ(173u, index.getBinCount(0));
+    CHECK_EQ(44u, index.getBinCount(1));
+    CHECK_EQ(11u, index.getBinCount(2));
+    CHECK_EQ(3u, index.getBinCount(3));
+    CHECK_EQ(1u, index.getBinCount(4));
+    CHECK_EQ(1u, index.getBinCount(5));
+
+    // A coarse bin covers exactly the fine bins under it
+    const auto& fine = index.getLevel(0);
+    const auto& coarse = index.getLevel(1);
+    for (size_t i = 0; i < coarse.size(); i++) {
+        short min = SHRT_MAX, max = SHRT_MIN;
+        for (size_t j = 4 * i; j < std::min(fine.size(), 4 * i + 4); j++) {
+            min = std::min(min, fine[j].min);
+            max = std::max(max, fine[j].max);
+        }
+        CHECK_EQ(min, coarse[i].min);
+        CHECK_EQ(max, coarse[i].max);
+    }
+
+    const PeakBin& whole = index.getLevel(5)[0];
+    PeakStats stats;
+    reducePeaksScalar(samples.data(), samples.size(), stats);
+    CHECK_EQ(stats.min, whole.min);
+    CHECK_EQ(stats.max, whole.max);
+    CHECK_NEAR(std::sqrt(static_cast<double>(stats.sumSquares) / samples.size()), whole.rms, 0.5);
+}
+
+static void testSidecarRoundTrip() {
+    const char* path = "waveform_index_test.peaks";
+    WaveformIndex index(48000, 2);
+    std::vector<short> samples(48000 * 2);
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<short>((i % 200) * 100 - 10000);
+    index.addSamples(samples.data(), samples.size());
+    index.finish();
+    CHECK(index.save(path));
+
+    for (int level = 0; level < WaveformIndex::LEVEL_COUNT; level++) {
+        std::vector<PeakBin> bins;
+        CHECK(WaveformIndex::loadLevel(path, level, bins));
+        CHECK_EQ(index.getBinCount(level), bins.size());
+        bool same = true;
+        for (size_t i = 0; i < bins.size(); i++) {
+            const PeakBin& expected = index.getLevel(level)[i];
+            same = same && bins[i].min == expected.min && bins[i].max == expected.max &&
+                   bins[i].rms == expected.rms;
+        }
+        CHECK(same);
+    }
+
+    std::vector<PeakBin> bins;
+    CHECK(!WaveformIndex::loadLevel(path, WaveformIndex::LEVEL_COUNT, bins));
+    CHECK(!WaveformIndex::loadLevel("does_not_exist.peaks", 0, bins));
+    remove(path);
+
+    CHECK(WaveformIndex::getSidecarPath("/data/take.wav") == "/data/take.peaks");
+    CHECK(WaveformIndex::getSidecarPath("/data.dir/take") == "/data.dir/take.peaks");
+}
+
+static void testRecorderWritesSidecar() {
+    const char* wavPath = "waveform_index_test.wav";
+    const char* peaksPath = "waveform_index_test.peaks";
+
+    FakeAudioBackend backend;
+    AudioRecorder recorder(backend);
+    recorder.initialize();
+    recorder.startRecording(wavPath);
+    backend.advanceCapture(44100);
+    recorder.stopRecording();
+
+    std::vector<PeakBin> bins;
+    CHECK(WaveformIndex::loadLevel(peaksPath, 0, bins));
+    // 43 buffers of 1024 frames
+    CHECK_EQ(172u, bins.size());
+    CHECK_EQ(0, bins[0].min);
+    CHECK_EQ(255, bins[0].max);
+    remove(wavPath);
+    remove(peaksPath);
+}
+
+int main() {
+    RUN_TEST(testSimdMatchesScalar);
+    RUN_TEST(testLevelsAreConsistent);
+    RUN_TEST(testSidecarRoundTrip);
+    RUN_TEST(testRecorderWritesSidecar);
+    return TEST_RESULT();
+}